@@ -0,0 +1,943 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/common.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/batch.h>
+
+/* Room left for the next message, one nested list stays below 64KB */
+#define MSG_ROOM	65536
+#define ELEMS_PER_MSG	500
+#define ELEMS_BUFSIZ	(2 * MSG_ROOM)
+
+static uint32_t num_rules = 1000;
+static uint32_t num_chains = 10;
+static uint32_t num_sets = 10;
+static uint32_t num_elems = 10000;
+static uint64_t min_ns = 200000000ULL;
+
+/* Synthetic ruleset every benchmark works on */
+static struct nftnl_ruleset *rs;
+static struct nftnl_table_list *tables;
+static struct nftnl_chain_list *chains;
+static struct nftnl_set_list *sets;
+static struct nftnl_rule_list *rules;
+static struct nftnl_set *elems;
+
+struct bench_ctx {
+	uint64_t	objs;
+	uint64_t	bytes;
+	char		*buf;
+	size_t		len;
+	uint32_t	type;
+	void		*data;
+};
+
+struct bench {
+	const char	*name;
+	int		(*init)(struct bench_ctx *ctx);
+	void		(*run)(struct bench_ctx *ctx);
+	void		(*fini)(struct bench_ctx *ctx);
+	void		(*report)(struct bench_ctx *ctx);
+};
+
+static void oom(void)
+{
+	fprintf(stderr, "out of memory\n");
+	exit(EXIT_FAILURE);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct nftnl_expr *expr_alloc(const char *name)
+{
+	struct nftnl_expr *e;
+
+	e = nftnl_expr_alloc(name);
+	if (e == NULL)
+		oom();
+
+	return e;
+}
+
+/* ip saddr 10.0.x.y counter accept */
+static struct nftnl_rule *rule_alloc(uint32_t i, const char *chain)
+{
+	struct nftnl_rule *r;
+	struct nftnl_expr *e;
+	uint32_t addr = htonl(0x0a000000 | i);
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		oom();
+
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, NFPROTO_IPV4);
+	nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+
+	e = expr_alloc("payload");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET, 12);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_LEN, sizeof(addr));
+	nftnl_rule_add_expr(r, e);
+
+	e = expr_alloc("cmp");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, &addr, sizeof(addr));
+	nftnl_rule_add_expr(r, e);
+
+	e = expr_alloc("counter");
+	nftnl_expr_set_u64(e, NFTNL_EXPR_CTR_PACKETS, i);
+	nftnl_expr_set_u64(e, NFTNL_EXPR_CTR_BYTES, i * 64);
+	nftnl_rule_add_expr(r, e);
+
+	e = expr_alloc("immediate");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, NF_ACCEPT);
+	nftnl_rule_add_expr(r, e);
+
+	return r;
+}
+
+static struct nftnl_set *set_alloc(const char *name, uint32_t nelems)
+{
+	struct nftnl_set_elem *e;
+	struct nftnl_set *s;
+	uint32_t i, key;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		oom();
+
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, name);
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, NFPROTO_IPV4);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_TYPE, 7);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(key));
+	nftnl_set_set_u32(s, NFTNL_SET_ID, 1);
+
+	for (i = 0; i < nelems; i++) {
+		e = nftnl_set_elem_alloc();
+		if (e == NULL)
+			oom();
+		key = htonl(0x0a000000 | i);
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &key, sizeof(key));
+		nftnl_set_elem_add(s, e);
+	}
+
+	return s;
+}
+
+static void ruleset_init(void)
+{
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	char name[32];
+	uint32_t i;
+
+	rs = nftnl_ruleset_alloc();
+	tables = nftnl_table_list_alloc();
+	chains = nftnl_chain_list_alloc();
+	sets = nftnl_set_list_alloc();
+	rules = nftnl_rule_list_alloc();
+	t = nftnl_table_alloc();
+	if (rs == NULL || tables == NULL || chains == NULL || sets == NULL ||
+	    rules == NULL || t == NULL)
+		oom();
+
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, NFPROTO_IPV4);
+	nftnl_table_list_add_tail(t, tables);
+
+	for (i = 0; i < num_chains; i++) {
+		c = nftnl_chain_alloc();
+		if (c == NULL)
+			oom();
+		snprintf(name, sizeof(name), "chain%u", i);
+		nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+		nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, name);
+		nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, NFPROTO_IPV4);
+		nftnl_chain_set_u64(c, NFTNL_CHAIN_HANDLE, i + 1);
+		if (i == 0) {
+			nftnl_chain_set_str(c, NFTNL_CHAIN_TYPE, "filter");
+			nftnl_chain_set_u32(c, NFTNL_CHAIN_HOOKNUM,
+					    NF_INET_LOCAL_IN);
+			nftnl_chain_set_s32(c, NFTNL_CHAIN_PRIO, 0);
+			nftnl_chain_set_u32(c, NFTNL_CHAIN_POLICY, NF_ACCEPT);
+		}
+		nftnl_chain_list_add_tail(c, chains);
+	}
+
+	for (i = 0; i < num_rules; i++) {
+		snprintf(name, sizeof(name), "chain%u", i % num_chains);
+		nftnl_rule_list_add_tail(rule_alloc(i, name), rules);
+	}
+
+	/* Empty sets for the per-object paths, one big set for the elements */
+	for (i = 0; i < num_sets; i++) {
+		snprintf(name, sizeof(name), "set%u", i);
+		nftnl_set_list_add_tail(set_alloc(name, 0), sets);
+	}
+	elems = set_alloc("elems", num_elems);
+	nftnl_set_list_add_tail(elems, sets);
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tables);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, chains);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sets);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rules);
+}
+
+/*
+ * Messages are laid out back to back in ctx->buf, as they are in a batch
+ * or a dump. Building stores them there, parsing walks them.
+ */
+static struct nlmsghdr *msg_next(struct bench_ctx *ctx, uint16_t cmd)
+{
+	struct nlmsghdr *nlh;
+
+	if (ctx->bytes + MSG_ROOM > ctx->len) {
+		ctx->len = ctx->len * 2 + MSG_ROOM;
+		ctx->buf = realloc(ctx->buf, ctx->len);
+		if (ctx->buf == NULL)
+			oom();
+	}
+
+	nlh = nftnl_nlmsg_build_hdr(ctx->buf + ctx->bytes, cmd, NFPROTO_IPV4,
+				    NLM_F_CREATE, 1);
+	return nlh;
+}
+
+static void msg_done(struct bench_ctx *ctx, struct nlmsghdr *nlh)
+{
+	ctx->bytes += NLMSG_ALIGN(nlh->nlmsg_len);
+	ctx->objs++;
+}
+
+#define msg_for_each(nlh, ctx)						\
+	for (nlh = (struct nlmsghdr *)(ctx)->buf;			\
+	     (char *)nlh < (ctx)->buf + (ctx)->bytes;			\
+	     nlh = (struct nlmsghdr *)((char *)nlh +			\
+				       NLMSG_ALIGN(nlh->nlmsg_len)))
+
+static void table_build(struct bench_ctx *ctx)
+{
+	struct nftnl_table_list_iter *it;
+	struct nftnl_table *t;
+	struct nlmsghdr *nlh;
+
+	ctx->objs = ctx->bytes = 0;
+	it = nftnl_table_list_iter_create(tables);
+	while ((t = nftnl_table_list_iter_next(it)) != NULL) {
+		nlh = msg_next(ctx, NFT_MSG_NEWTABLE);
+		nftnl_table_nlmsg_build_payload(nlh, t);
+		msg_done(ctx, nlh);
+	}
+	nftnl_table_list_iter_destroy(it);
+}
+
+static void table_parse(struct bench_ctx *ctx)
+{
+	struct nftnl_table *t;
+	struct nlmsghdr *nlh;
+
+	msg_for_each(nlh, ctx) {
+		t = nftnl_table_alloc();
+		if (t == NULL || nftnl_table_nlmsg_parse(nlh, t) < 0)
+			oom();
+		nftnl_table_free(t);
+	}
+}
+
+static void chain_build(struct bench_ctx *ctx)
+{
+	struct nftnl_chain_list_iter *it;
+	struct nftnl_chain *c;
+	struct nlmsghdr *nlh;
+
+	ctx->objs = ctx->bytes = 0;
+	it = nftnl_chain_list_iter_create(chains);
+	while ((c = nftnl_chain_list_iter_next(it)) != NULL) {
+		nlh = msg_next(ctx, NFT_MSG_NEWCHAIN);
+		nftnl_chain_nlmsg_build_payload(nlh, c);
+		msg_done(ctx, nlh);
+	}
+	nftnl_chain_list_iter_destroy(it);
+}
+
+static void chain_parse(struct bench_ctx *ctx)
+{
+	struct nftnl_chain *c;
+	struct nlmsghdr *nlh;
+
+	msg_for_each(nlh, ctx) {
+		c = nftnl_chain_alloc();
+		if (c == NULL || nftnl_chain_nlmsg_parse(nlh, c) < 0)
+			oom();
+		nftnl_chain_free(c);
+	}
+}
+
+static void rule_build(struct bench_ctx *ctx)
+{
+	struct nftnl_rule_list_iter *it;
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	ctx->objs = ctx->bytes = 0;
+	it = nftnl_rule_list_iter_create(rules);
+	while ((r = nftnl_rule_list_iter_next(it)) != NULL) {
+		nlh = msg_next(ctx, NFT_MSG_NEWRULE);
+		nftnl_rule_nlmsg_build_payload(nlh, r);
+		msg_done(ctx, nlh);
+	}
+	nftnl_rule_list_iter_destroy(it);
+}
+
+static void rule_parse(struct bench_ctx *ctx)
+{
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	msg_for_each(nlh, ctx) {
+		r = nftnl_rule_alloc();
+		if (r == NULL || nftnl_rule_nlmsg_parse(nlh, r) < 0)
+			oom();
+		nftnl_rule_free(r);
+	}
+}
+
+static int set_build_cb(struct nftnl_set *s, void *data)
+{
+	struct bench_ctx *ctx = data;
+	struct nlmsghdr *nlh;
+
+	if (s == elems)
+		return 0;
+
+	nlh = msg_next(ctx, NFT_MSG_NEWSET);
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	msg_done(ctx, nlh);
+
+	return 0;
+}
+
+static void set_build(struct bench_ctx *ctx)
+{
+	ctx->objs = ctx->bytes = 0;
+	nftnl_set_list_foreach(sets, set_build_cb, ctx);
+}
+
+static void set_parse(struct bench_ctx *ctx)
+{
+	struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+
+	msg_for_each(nlh, ctx) {
+		s = nftnl_set_alloc();
+		if (s == NULL || nftnl_set_nlmsg_parse(nlh, s) < 0)
+			oom();
+		nftnl_set_free(s);
+	}
+}
+
+/* The build path of each object type also fills in what parsing reads */
+static int table_init(struct bench_ctx *ctx)
+{
+	table_build(ctx);
+	return 0;
+}
+
+static int chain_init(struct bench_ctx *ctx)
+{
+	chain_build(ctx);
+	return 0;
+}
+
+static int rule_init(struct bench_ctx *ctx)
+{
+	rule_build(ctx);
+	return 0;
+}
+
+static int set_init(struct bench_ctx *ctx)
+{
+	set_build(ctx);
+	return 0;
+}
+
+static void setelem_encode(struct bench_ctx *ctx)
+{
+	struct nftnl_set_elems_iter *it;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	ctx->bytes = 0;
+	it = nftnl_set_elems_iter_create(elems);
+	if (it == NULL)
+		oom();
+	do {
+		nlh = nftnl_set_elem_nlmsg_build_hdr(ctx->buf,
+						     NFT_MSG_NEWSETELEM,
+						     NFPROTO_IPV4,
+						     NLM_F_CREATE, 1);
+		ret = nftnl_set_elems_nlmsg_build_payload_iter(nlh, it);
+		ctx->bytes += nlh->nlmsg_len;
+	} while (ret > 0);
+	nftnl_set_elems_iter_destroy(it);
+}
+
+static int setelem_encode_init(struct bench_ctx *ctx)
+{
+	ctx->buf = malloc(ELEMS_BUFSIZ);
+	if (ctx->buf == NULL)
+		oom();
+
+	ctx->objs = num_elems;
+	return 0;
+}
+
+/*
+ * nftnl_set_elems_nlmsg_build_payload() numbers the list entries instead of
+ * using NFTA_LIST_ELEM, which the parser rejects, so lay out what the kernel
+ * sends in dumps by hand.
+ */
+static int setelem_decode_init(struct bench_ctx *ctx)
+{
+	struct nlattr *list = NULL, *elem, *key;
+	struct nlmsghdr *nlh = NULL;
+	uint32_t i;
+
+	for (i = 0; i < num_elems; i++) {
+		if (i % ELEMS_PER_MSG == 0) {
+			if (nlh != NULL) {
+				mnl_attr_nest_end(nlh, list);
+				ctx->bytes += NLMSG_ALIGN(nlh->nlmsg_len);
+			}
+			nlh = msg_next(ctx, NFT_MSG_NEWSETELEM);
+			mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE,
+					  "filter");
+			mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, "elems");
+			list = mnl_attr_nest_start(nlh,
+						   NFTA_SET_ELEM_LIST_ELEMENTS);
+		}
+		elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+		key = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY);
+		mnl_attr_put_u32(nlh, NFTA_DATA_VALUE, htonl(0x0a000000 | i));
+		mnl_attr_nest_end(nlh, key);
+		mnl_attr_nest_end(nlh, elem);
+	}
+	if (nlh != NULL) {
+		mnl_attr_nest_end(nlh, list);
+		ctx->bytes += NLMSG_ALIGN(nlh->nlmsg_len);
+	}
+
+	ctx->objs = num_elems;
+	return 0;
+}
+
+static void setelem_decode(struct bench_ctx *ctx)
+{
+	struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		oom();
+
+	msg_for_each(nlh, ctx) {
+		if (nftnl_set_elems_nlmsg_parse(nlh, s) < 0)
+			oom();
+	}
+	nftnl_set_free(s);
+}
+
+static int batch_init(struct bench_ctx *ctx)
+{
+	ctx->objs = num_rules;
+	return 0;
+}
+
+static void batch_build(struct bench_ctx *ctx)
+{
+	struct nftnl_rule_list_iter *it;
+	struct nftnl_batch *batch;
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	batch = nftnl_batch_alloc(MNL_SOCKET_BUFFER_SIZE,
+				  MNL_SOCKET_BUFFER_SIZE);
+	if (batch == NULL)
+		oom();
+
+	ctx->bytes = 0;
+	it = nftnl_rule_list_iter_create(rules);
+	while ((r = nftnl_rule_list_iter_next(it)) != NULL) {
+		nlh = nftnl_rule_nlmsg_build_hdr(nftnl_batch_buffer(batch),
+						 NFT_MSG_NEWRULE, NFPROTO_IPV4,
+						 NLM_F_CREATE | NLM_F_APPEND,
+						 1);
+		nftnl_rule_nlmsg_build_payload(nlh, r);
+		ctx->bytes += nlh->nlmsg_len;
+		if (nftnl_batch_update(batch) < 0)
+			oom();
+	}
+	nftnl_rule_list_iter_destroy(it);
+
+	nftnl_batch_free(batch);
+}
+
+static int export_init(struct bench_ctx *ctx, uint32_t type)
+{
+	ctx->data = nftnl_sink_alloc(65536);
+	if (ctx->data == NULL)
+		oom();
+
+	ctx->type = type;
+	ctx->objs = num_rules + num_chains + num_sets + num_elems;
+	return 0;
+}
+
+static int export_default_init(struct bench_ctx *ctx)
+{
+	return export_init(ctx, NFTNL_OUTPUT_DEFAULT);
+}
+
+static int export_xml_init(struct bench_ctx *ctx)
+{
+	return export_init(ctx, NFTNL_OUTPUT_XML);
+}
+
+static int export_json_init(struct bench_ctx *ctx)
+{
+	return export_init(ctx, NFTNL_OUTPUT_JSON);
+}
+
+static void export_run(struct bench_ctx *ctx)
+{
+	struct nftnl_sink *sink = ctx->data;
+
+	nftnl_sink_reset(sink);
+	if (nftnl_ruleset_export(sink, rs, ctx->type, 0) < 0)
+		oom();
+	ctx->bytes = nftnl_sink_len(sink);
+}
+
+static void export_fini(struct bench_ctx *ctx)
+{
+	nftnl_sink_free(ctx->data);
+}
+
+static void import_run(struct bench_ctx *ctx)
+{
+	struct nftnl_ruleset *copy;
+
+	copy = nftnl_ruleset_alloc();
+	if (copy == NULL ||
+	    nftnl_ruleset_parse(copy, ctx->type, ctx->buf, ctx->data) < 0)
+		oom();
+	nftnl_ruleset_free(copy);
+}
+
+/*
+ * Import what the export path produces as "add" commands, the only form the
+ * parsers take. Skipped unless built with XML or JSON parsing.
+ */
+static int import_init(struct bench_ctx *ctx, uint32_t output, uint32_t type)
+{
+	struct nftnl_ruleset *copy;
+	struct nftnl_sink *sink;
+	int ret;
+
+	sink = nftnl_sink_alloc(65536);
+	if (sink == NULL || nftnl_ruleset_export(sink, rs, output,
+						    NFTNL_OF_EVENT_NEW) < 0)
+		oom();
+	ctx->bytes = nftnl_sink_len(sink);
+	ctx->buf = strndup(nftnl_sink_data(sink), ctx->bytes);
+	nftnl_sink_free(sink);
+
+	ctx->data = nftnl_parse_err_alloc();
+	copy = nftnl_ruleset_alloc();
+	if (ctx->buf == NULL || ctx->data == NULL || copy == NULL)
+		oom();
+
+	ctx->type = type;
+	ctx->objs = num_rules + num_chains + num_sets + num_elems;
+
+	ret = nftnl_ruleset_parse(copy, type, ctx->buf, ctx->data);
+	nftnl_ruleset_free(copy);
+
+	return ret;
+}
+
+static int import_xml_init(struct bench_ctx *ctx)
+{
+	return import_init(ctx, NFTNL_OUTPUT_XML, NFTNL_PARSE_XML);
+}
+
+static int import_json_init(struct bench_ctx *ctx)
+{
+	return import_init(ctx, NFTNL_OUTPUT_JSON, NFTNL_PARSE_JSON);
+}
+
+static void import_fini(struct bench_ctx *ctx)
+{
+	nftnl_parse_err_free(ctx->data);
+}
+
+static int list_init(struct bench_ctx *ctx)
+{
+	ctx->objs = num_rules;
+	return 0;
+}
+
+static int expr_count_cb(struct nftnl_expr *e, void *data)
+{
+	(*(uint64_t *)data)++;
+	return 0;
+}
+
+static void rule_list_iterate(struct bench_ctx *ctx)
+{
+	struct nftnl_rule_list_iter *it;
+	struct nftnl_rule *r;
+	uint64_t nexprs = 0;
+
+	it = nftnl_rule_list_iter_create(rules);
+	while ((r = nftnl_rule_list_iter_next(it)) != NULL)
+		nftnl_expr_foreach(r, expr_count_cb, &nexprs);
+	nftnl_rule_list_iter_destroy(it);
+
+	if (nexprs != num_rules * 4)
+		oom();
+}
+
+static int chain_lookup_init(struct bench_ctx *ctx)
+{
+	ctx->objs = num_chains;
+	return 0;
+}
+
+/* Find every chain by name, the way callers do with this API */
+static void chain_list_lookup(struct bench_ctx *ctx)
+{
+	struct nftnl_chain_list_iter *it;
+	struct nftnl_chain *c;
+	char name[32];
+	uint32_t i;
+
+	for (i = 0; i < num_chains; i++) {
+		snprintf(name, sizeof(name), "chain%u", i);
+		it = nftnl_chain_list_iter_create(chains);
+		while ((c = nftnl_chain_list_iter_next(it)) != NULL) {
+			if (strcmp(nftnl_chain_get_str(c, NFTNL_CHAIN_NAME),
+				   name) == 0)
+				break;
+		}
+		nftnl_chain_list_iter_destroy(it);
+		if (c == NULL)
+			oom();
+	}
+}
+
+static int elem_count_cb(struct nftnl_set_elem *e, void *data)
+{
+	(*(uint64_t *)data)++;
+	return 0;
+}
+
+static int setelem_iterate_init(struct bench_ctx *ctx)
+{
+	ctx->objs = num_elems;
+	return 0;
+}
+
+static void setelem_iterate(struct bench_ctx *ctx)
+{
+	uint64_t n = 0;
+
+	nftnl_set_elem_foreach(elems, elem_count_cb, &n);
+	if (n != num_elems)
+		oom();
+}
+
+/*
+ * Memory held by the synthetic ruleset as built by the caller, and by rules
+ * and elements as parsed from what the kernel sends.
+ */
+struct memsize {
+	struct nftnl_rule_list	*rules;
+	struct nftnl_set	*set;
+};
+
+/* Keeps the compiler from dropping the timed calls */
+static volatile size_t memsize_total;
+
+static size_t empty_set_memsize(void)
+{
+	struct nftnl_set *s;
+	size_t size;
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		oom();
+	size = nftnl_set_memsize(s);
+	nftnl_set_free(s);
+
+	return size;
+}
+
+static void memsize_print(size_t total, size_t rules_size, size_t elems_size)
+{
+	printf(",\"mem_bytes\":%zu,\"bytes_per_rule\":%.1f,"
+	       "\"bytes_per_elem\":%.1f", total,
+	       num_rules ? (double)rules_size / num_rules : 0.0,
+	       num_elems ? (double)elems_size / num_elems : 0.0);
+}
+
+static int memsize_built_init(struct bench_ctx *ctx)
+{
+	ctx->objs = num_rules + num_chains + num_sets + num_elems;
+	return 0;
+}
+
+static void memsize_built(struct bench_ctx *ctx)
+{
+	memsize_total = nftnl_ruleset_memsize(rs);
+}
+
+static void memsize_built_report(struct bench_ctx *ctx)
+{
+	memsize_print(nftnl_ruleset_memsize(rs), nftnl_rule_list_memsize(rules),
+		      nftnl_set_memsize(elems) - empty_set_memsize());
+}
+
+static int memsize_parsed_init(struct bench_ctx *ctx)
+{
+	struct memsize *m;
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	m = calloc(1, sizeof(struct memsize));
+	if (m == NULL)
+		oom();
+	m->rules = nftnl_rule_list_alloc();
+	m->set = nftnl_set_alloc();
+	if (m->rules == NULL || m->set == NULL)
+		oom();
+
+	rule_build(ctx);
+	msg_for_each(nlh, ctx) {
+		r = nftnl_rule_alloc();
+		if (r == NULL || nftnl_rule_nlmsg_parse(nlh, r) < 0)
+			oom();
+		nftnl_rule_list_add_tail(r, m->rules);
+	}
+
+	ctx->bytes = 0;
+	setelem_decode_init(ctx);
+	msg_for_each(nlh, ctx) {
+		if (nftnl_set_elems_nlmsg_parse(nlh, m->set) < 0)
+			oom();
+	}
+
+	ctx->data = m;
+	ctx->objs = num_rules + num_elems;
+	ctx->bytes = 0;
+	return 0;
+}
+
+static void memsize_parsed(struct bench_ctx *ctx)
+{
+	struct memsize *m = ctx->data;
+
+	memsize_total = nftnl_rule_list_memsize(m->rules) +
+			nftnl_set_memsize(m->set);
+}
+
+static void memsize_parsed_report(struct bench_ctx *ctx)
+{
+	struct memsize *m = ctx->data;
+	size_t rules_size = nftnl_rule_list_memsize(m->rules);
+	size_t set_size = nftnl_set_memsize(m->set);
+
+	memsize_print(rules_size + set_size, rules_size,
+		      set_size - empty_set_memsize());
+}
+
+static void memsize_parsed_fini(struct bench_ctx *ctx)
+{
+	struct memsize *m = ctx->data;
+
+	nftnl_rule_list_free(m->rules);
+	nftnl_set_free(m->set);
+	free(m);
+}
+
+static struct bench benches[] = {
+	{ "table_build",	table_init,	table_build },
+	{ "table_parse",	table_init,	table_parse },
+	{ "chain_build",	chain_init,	chain_build },
+	{ "chain_parse",	chain_init,	chain_parse },
+	{ "rule_build",		rule_init,	rule_build },
+	{ "rule_parse",		rule_init,	rule_parse },
+	{ "set_build",		set_init,	set_build },
+	{ "set_parse",		set_init,	set_parse },
+	{ "setelem_encode",	setelem_encode_init, setelem_encode },
+	{ "setelem_decode",	setelem_decode_init, setelem_decode },
+	{ "batch_build",	batch_init,	batch_build },
+	{ "export_default",	export_default_init, export_run, export_fini },
+	{ "export_xml",		export_xml_init, export_run, export_fini },
+	{ "export_json",	export_json_init, export_run, export_fini },
+	{ "import_xml",		import_xml_init, import_run, import_fini },
+	{ "import_json",	import_json_init, import_run, import_fini },
+	{ "rule_list_iterate",	list_init,	rule_list_iterate },
+	{ "chain_list_lookup",	chain_lookup_init, chain_list_lookup },
+	{ "setelem_iterate",	setelem_iterate_init, setelem_iterate },
+	{ "memsize_built",	memsize_built_init, memsize_built, NULL,
+	  memsize_built_report },
+	{ "memsize_parsed",	memsize_parsed_init, memsize_parsed,
+	  memsize_parsed_fini, memsize_parsed_report },
+};
+
+static void print_head(const char *name)
+{
+	printf("{\"bench\":\"%s\",\"rules\":%u,\"chains\":%u,\"sets\":%u,"
+	       "\"elems\":%u", name, num_rules, num_chains, num_sets,
+	       num_elems);
+}
+
+/* Double the iterations until one round takes at least min_ns */
+static void bench_run(struct bench *b)
+{
+	struct bench_ctx ctx = {};
+	uint64_t iters, i, start, ns;
+
+	if (b->init(&ctx) < 0) {
+		print_head(b->name);
+		printf(",\"skipped\":\"%s\"}\n", strerror(errno));
+		goto out;
+	}
+
+	for (iters = 1; ; iters *= 2) {
+		start = now_ns();
+		for (i = 0; i < iters; i++)
+			b->run(&ctx);
+		ns = now_ns() - start;
+		if (ns >= min_ns)
+			break;
+	}
+
+	print_head(b->name);
+	printf(",\"iterations\":%llu,\"ns_per_iter\":%.1f,\"objs\":%llu,"
+	       "\"ns_per_obj\":%.1f,\"bytes\":%llu,\"mb_per_sec\":%.1f",
+	       (unsigned long long)iters, (double)ns / iters,
+	       (unsigned long long)ctx.objs,
+	       ctx.objs ? (double)ns / iters / ctx.objs : 0.0,
+	       (unsigned long long)ctx.bytes,
+	       (double)ctx.bytes * iters * 1000.0 / ns);
+	if (b->report)
+		b->report(&ctx);
+	printf("}\n");
+	fflush(stdout);
+out:
+	if (b->fini)
+		b->fini(&ctx);
+	free(ctx.buf);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-r rules] [-c chains] [-s sets] [-e elems] "
+		"[-t msecs] [-b name] [-l]\n"
+		"Prints one JSON object per benchmark on stdout\n", prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *filter = NULL;
+	bool list = false;
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "r:c:s:e:t:b:lh")) != -1) {
+		switch (opt) {
+		case 'r':
+			num_rules = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			num_chains = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			num_sets = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			num_elems = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			min_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 'b':
+			filter = optarg;
+			break;
+		case 'l':
+			list = true;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (num_chains == 0)
+		usage(argv[0]);
+
+	for (i = 0; list && i < sizeof(benches) / sizeof(benches[0]); i++)
+		printf("%s\n", benches[i].name);
+	if (list)
+		return EXIT_SUCCESS;
+
+	ruleset_init();
+
+	for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+		if (filter && strstr(benches[i].name, filter) == NULL)
+			continue;
+		bench_run(&benches[i]);
+	}
+
+	nftnl_ruleset_free(rs);
+	return EXIT_SUCCESS;
+}
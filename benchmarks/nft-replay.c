@@ -0,0 +1,786 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/common.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/gen.h>
+#include <libnftnl/trace.h>
+#include <libnftnl/batch.h>
+#include <libnftnl/snapshot.h>
+#include <libnftnl/stats.h>
+
+/*
+ * A corpus is what nftnl_snapshot_dump_record() writes: nf_tables netlink
+ * messages as the kernel sent them, back to back, from dumps and from the
+ * event socket alike. Snapshots written by nftnl_snapshot_write() are taken
+ * too. Replaying needs neither root nor nf_tables.
+ */
+
+/* Netlink attribute length is 16 bits wide, one message never needs more */
+#define MSG_ROOM	(2 * 65536)
+#define ELEMS_PER_MSG	500
+
+enum replay_type {
+	REPLAY_TABLE = 0,
+	REPLAY_CHAIN,
+	REPLAY_RULE,
+	REPLAY_SET,
+	REPLAY_SET_ELEM,
+	REPLAY_GEN,
+	REPLAY_TRACE,
+	__REPLAY_MAX
+};
+
+static const char *replay_names[__REPLAY_MAX] = {
+	[REPLAY_TABLE]		= "table",
+	[REPLAY_CHAIN]		= "chain",
+	[REPLAY_RULE]		= "rule",
+	[REPLAY_SET]		= "set",
+	[REPLAY_SET_ELEM]	= "set_elem",
+	[REPLAY_GEN]		= "gen",
+	[REPLAY_TRACE]		= "trace",
+};
+
+static const uint16_t replay_stats[__REPLAY_MAX] = {
+	[REPLAY_TABLE]		= NFTNL_STATS_TABLE,
+	[REPLAY_CHAIN]		= NFTNL_STATS_CHAIN,
+	[REPLAY_RULE]		= NFTNL_STATS_RULE,
+	[REPLAY_SET]		= NFTNL_STATS_SET,
+	[REPLAY_SET_ELEM]	= NFTNL_STATS_SET_ELEM,
+	[REPLAY_GEN]		= NFTNL_STATS_GEN,
+	[REPLAY_TRACE]		= NFTNL_STATS_TRACE,
+};
+
+struct corpus {
+	const char	*name;
+	char		*buf;
+	size_t		len;
+	uint32_t	msgs[__REPLAY_MAX];
+	uint32_t	total;
+	uint32_t	skipped;
+};
+
+/* Objects parsed once, built again into batches */
+struct replay_obj {
+	enum replay_type	type;
+	uint16_t		cmd;
+	uint16_t		family;
+	void			*obj;
+};
+
+static uint64_t min_ns = 200000000ULL;
+
+static void oom(void)
+{
+	fprintf(stderr, "out of memory\n");
+	exit(EXIT_FAILURE);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int replay_type(const struct nlmsghdr *nlh)
+{
+	if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES)
+		return -1;
+
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWTABLE:
+	case NFT_MSG_DELTABLE:
+		return REPLAY_TABLE;
+	case NFT_MSG_NEWCHAIN:
+	case NFT_MSG_DELCHAIN:
+		return REPLAY_CHAIN;
+	case NFT_MSG_NEWRULE:
+	case NFT_MSG_DELRULE:
+		return REPLAY_RULE;
+	case NFT_MSG_NEWSET:
+	case NFT_MSG_DELSET:
+		return REPLAY_SET;
+	case NFT_MSG_NEWSETELEM:
+	case NFT_MSG_DELSETELEM:
+		return REPLAY_SET_ELEM;
+	case NFT_MSG_NEWGEN:
+		return REPLAY_GEN;
+	case NFT_MSG_TRACE:
+		return REPLAY_TRACE;
+	}
+
+	return -1;
+}
+
+static void *replay_parse(enum replay_type type, const struct nlmsghdr *nlh)
+{
+	void *obj;
+	int ret;
+
+	switch (type) {
+	case REPLAY_TABLE:
+		obj = nftnl_table_alloc();
+		ret = obj ? nftnl_table_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_CHAIN:
+		obj = nftnl_chain_alloc();
+		ret = obj ? nftnl_chain_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_RULE:
+		obj = nftnl_rule_alloc();
+		ret = obj ? nftnl_rule_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_SET:
+		obj = nftnl_set_alloc();
+		ret = obj ? nftnl_set_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_SET_ELEM:
+		obj = nftnl_set_alloc();
+		ret = obj ? nftnl_set_elems_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_GEN:
+		obj = nftnl_gen_alloc();
+		ret = obj ? nftnl_gen_nlmsg_parse(nlh, obj) : -1;
+		break;
+	case REPLAY_TRACE:
+		obj = nftnl_trace_alloc();
+		ret = obj ? nftnl_trace_nlmsg_parse(nlh, obj) : -1;
+		break;
+	default:
+		return NULL;
+	}
+
+	if (obj == NULL)
+		oom();
+	if (ret < 0) {
+		fprintf(stderr, "cannot parse %s message: %s\n",
+			replay_names[type], strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	return obj;
+}
+
+static void replay_free(enum replay_type type, void *obj)
+{
+	switch (type) {
+	case REPLAY_TABLE:
+		nftnl_table_free(obj);
+		break;
+	case REPLAY_CHAIN:
+		nftnl_chain_free(obj);
+		break;
+	case REPLAY_RULE:
+		nftnl_rule_free(obj);
+		break;
+	case REPLAY_SET:
+	case REPLAY_SET_ELEM:
+		nftnl_set_free(obj);
+		break;
+	case REPLAY_GEN:
+		nftnl_gen_free(obj);
+		break;
+	case REPLAY_TRACE:
+		nftnl_trace_free(obj);
+		break;
+	default:
+		break;
+	}
+}
+
+#define corpus_for_each(nlh, c, len)					\
+	for (nlh = (const struct nlmsghdr *)(c)->buf, len = (c)->len;	\
+	     mnl_nlmsg_ok(nlh, len); nlh = mnl_nlmsg_next(nlh, &len))
+
+/* Parses the messages of type @only, or all of them if it is negative */
+static void corpus_parse(const struct corpus *c, int only)
+{
+	const struct nlmsghdr *nlh;
+	int type, len;
+
+	corpus_for_each(nlh, c, len) {
+		type = replay_type(nlh);
+		if (type < 0 || (only >= 0 && type != only))
+			continue;
+		replay_free(type, replay_parse(type, nlh));
+	}
+}
+
+/* Nothing to build for generations and traces, they only come from the kernel */
+static uint32_t corpus_objs(const struct corpus *c, struct replay_obj **objs)
+{
+	const struct nlmsghdr *nlh;
+	struct replay_obj *o;
+	uint32_t num = 0;
+	int type, len;
+
+	o = calloc(c->total, sizeof(struct replay_obj));
+	if (o == NULL && c->total > 0)
+		oom();
+
+	corpus_for_each(nlh, c, len) {
+		type = replay_type(nlh);
+		if (type < 0 || type == REPLAY_GEN || type == REPLAY_TRACE)
+			continue;
+		o[num].type = type;
+		o[num].cmd = NFNL_MSG_TYPE(nlh->nlmsg_type);
+		o[num].family = ((struct nfgenmsg *)
+				 mnl_nlmsg_get_payload(nlh))->nfgen_family;
+		o[num].obj = replay_parse(type, nlh);
+		num++;
+	}
+
+	*objs = o;
+	return num;
+}
+
+static uint64_t corpus_build(const struct replay_obj *objs, uint32_t num)
+{
+	struct nftnl_batch *batch;
+	struct nlmsghdr *nlh;
+	uint64_t bytes = 0;
+	uint32_t i;
+
+	batch = nftnl_batch_alloc(MNL_SOCKET_BUFFER_SIZE, MSG_ROOM);
+	if (batch == NULL)
+		oom();
+
+	for (i = 0; i < num; i++) {
+		nlh = nftnl_nlmsg_build_hdr(nftnl_batch_buffer(batch),
+					    objs[i].cmd, objs[i].family,
+					    NLM_F_CREATE | NLM_F_ACK, i);
+		switch (objs[i].type) {
+		case REPLAY_TABLE:
+			nftnl_table_nlmsg_build_payload(nlh, objs[i].obj);
+			break;
+		case REPLAY_CHAIN:
+			nftnl_chain_nlmsg_build_payload(nlh, objs[i].obj);
+			break;
+		case REPLAY_RULE:
+			nftnl_rule_nlmsg_build_payload(nlh, objs[i].obj);
+			break;
+		case REPLAY_SET:
+			nftnl_set_nlmsg_build_payload(nlh, objs[i].obj);
+			break;
+		case REPLAY_SET_ELEM:
+			nftnl_set_elems_nlmsg_build_payload(nlh, objs[i].obj);
+			break;
+		default:
+			break;
+		}
+		bytes += nlh->nlmsg_len;
+		if (nftnl_batch_update(batch) < 0)
+			oom();
+	}
+
+	nftnl_batch_free(batch);
+	return bytes;
+}
+
+static int corpus_dump_replay(const struct corpus *c)
+{
+	struct nftnl_batch *batch;
+	uint32_t seq = 0;
+	int ret;
+
+	/* Messages are copied as they are, pages have to hold the largest */
+	batch = nftnl_batch_alloc(MSG_ROOM, MSG_ROOM);
+	if (batch == NULL)
+		oom();
+
+	ret = nftnl_snapshot_dump_replay(c->buf, c->len, batch, &seq);
+	nftnl_batch_free(batch);
+
+	return ret;
+}
+
+static int corpus_snapshot_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct corpus *c = data;
+
+	memcpy(c->buf + c->len, nlh, nlh->nlmsg_len);
+	c->len += MNL_ALIGN(nlh->nlmsg_len);
+	return 0;
+}
+
+static void corpus_load(struct corpus *c, const char *name)
+{
+	const struct nlmsghdr *nlh;
+	struct nftnl_snapshot *snap;
+	ssize_t ret;
+	size_t size;
+	int fd, len, type;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+
+	c->name = name;
+	size = lseek(fd, 0, SEEK_END);
+	lseek(fd, 0, SEEK_SET);
+	c->buf = malloc(size + 1);
+	if (c->buf == NULL)
+		oom();
+
+	/* Snapshots have a header of their own, recorded dumps do not */
+	snap = nftnl_snapshot_map(fd);
+	if (snap != NULL) {
+		nftnl_snapshot_foreach(snap, corpus_snapshot_cb, c);
+		nftnl_snapshot_unmap(snap);
+	} else {
+		while (c->len < size) {
+			ret = read(fd, c->buf + c->len, size - c->len);
+			if (ret <= 0) {
+				perror(name);
+				exit(EXIT_FAILURE);
+			}
+			c->len += ret;
+		}
+	}
+	close(fd);
+
+	corpus_for_each(nlh, c, len) {
+		type = replay_type(nlh);
+		if (type < 0) {
+			c->skipped++;
+			continue;
+		}
+		c->msgs[type]++;
+		c->total++;
+	}
+	if (len != 0) {
+		fprintf(stderr, "%s: truncated message at offset %zu\n", name,
+			c->len - len);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static uint64_t stats_delta(struct nftnl_stats *a, struct nftnl_stats *b,
+			    uint16_t obj, uint16_t attr)
+{
+	return nftnl_stats_obj_get(b, obj, attr) -
+	       nftnl_stats_obj_get(a, obj, attr);
+}
+
+static uint64_t stats_allocs(struct nftnl_stats *a, struct nftnl_stats *b)
+{
+	uint64_t allocs = 0;
+	int i;
+
+	for (i = 0; i <= NFTNL_STATS_OBJ_MAX; i++)
+		allocs += stats_delta(a, b, i, NFTNL_STATS_OBJ_ALLOC);
+
+	return allocs;
+}
+
+/*
+ * Untimed passes with counters on, one per message type, so that every
+ * allocation is put down to the messages that caused it: the sets that
+ * setelem messages are parsed into, expressions of rules and so on.
+ */
+static void report_allocs(const struct corpus *c)
+{
+	uint64_t allocs[__REPLAY_MAX] = {}, bytes[__REPLAY_MAX] = {};
+	struct nftnl_stats *before, *after;
+	uint64_t total = 0;
+	int i;
+
+	nftnl_stats_enable(true);
+	for (i = 0; i < __REPLAY_MAX; i++) {
+		if (c->msgs[i] == 0)
+			continue;
+
+		before = nftnl_stats_snapshot();
+		corpus_parse(c, i);
+		after = nftnl_stats_snapshot();
+		if (before == NULL || after == NULL)
+			oom();
+
+		allocs[i] = stats_allocs(before, after);
+		bytes[i] = stats_delta(before, after, replay_stats[i],
+				       NFTNL_STATS_OBJ_PARSE_BYTES);
+		total += allocs[i];
+
+		nftnl_stats_free(before);
+		nftnl_stats_free(after);
+	}
+	nftnl_stats_enable(false);
+
+	printf("{\"replay\":\"allocs\",\"corpus\":\"%s\",\"msgs\":%u,"
+	       "\"allocs\":%llu,\"allocs_per_msg\":%.1f}\n", c->name,
+	       c->total, (unsigned long long)total,
+	       c->total ? (double)total / c->total : 0.0);
+
+	for (i = 0; i < __REPLAY_MAX; i++) {
+		if (c->msgs[i] == 0)
+			continue;
+		printf("{\"replay\":\"allocs\",\"corpus\":\"%s\","
+		       "\"type\":\"%s\",\"msgs\":%u,\"bytes\":%llu,"
+		       "\"allocs\":%llu,\"allocs_per_msg\":%.1f}\n",
+		       c->name, replay_names[i], c->msgs[i],
+		       (unsigned long long)bytes[i],
+		       (unsigned long long)allocs[i],
+		       (double)allocs[i] / c->msgs[i]);
+	}
+}
+
+static void report(const char *what, const struct corpus *c, uint32_t msgs,
+		   uint64_t bytes, uint64_t iters, uint64_t ns)
+{
+	printf("{\"replay\":\"%s\",\"corpus\":\"%s\",\"msgs\":%u,"
+	       "\"bytes\":%llu,\"iterations\":%llu,\"ns_per_msg\":%.1f,"
+	       "\"msgs_per_sec\":%.0f,\"mb_per_sec\":%.1f}\n",
+	       what, c->name, msgs, (unsigned long long)bytes,
+	       (unsigned long long)iters,
+	       msgs ? (double)ns / iters / msgs : 0.0,
+	       (double)msgs * iters * 1000000000.0 / ns,
+	       (double)bytes * iters * 1000.0 / ns);
+	fflush(stdout);
+}
+
+/* Double the iterations until one round takes at least min_ns */
+#define timed(iters, ns, expr)						\
+	for (iters = 1; ; iters *= 2) {					\
+		uint64_t __i, __start = now_ns();			\
+									\
+		for (__i = 0; __i < iters; __i++)			\
+			expr;						\
+		ns = now_ns() - __start;				\
+		if (ns >= min_ns)					\
+			break;						\
+	}
+
+static void replay(const char *name)
+{
+	struct corpus c = {};
+	struct replay_obj *objs;
+	uint64_t iters, ns, bytes = 0;
+	uint32_t num, i;
+
+	corpus_load(&c, name);
+	if (c.total == 0) {
+		fprintf(stderr, "%s: no nf_tables messages\n", name);
+		exit(EXIT_FAILURE);
+	}
+
+	report_allocs(&c);
+
+	timed(iters, ns, corpus_parse(&c, -1));
+	report("parse", &c, c.total, c.len, iters, ns);
+
+	num = corpus_objs(&c, &objs);
+	timed(iters, ns, bytes = corpus_build(objs, num));
+	report("build", &c, num, bytes, iters, ns);
+	for (i = 0; i < num; i++)
+		replay_free(objs[i].type, objs[i].obj);
+	free(objs);
+
+	/* Dumps turn into batches as they are, event streams do not */
+	if (corpus_dump_replay(&c) < 0) {
+		printf("{\"replay\":\"dump_replay\",\"corpus\":\"%s\","
+		       "\"skipped\":\"%s\"}\n", c.name, strerror(errno));
+	} else {
+		timed(iters, ns, corpus_dump_replay(&c));
+		report("dump_replay", &c, c.total, c.len, iters, ns);
+	}
+
+	free(c.buf);
+}
+
+/*
+ * Generator: a synthetic ruleset dump followed by a stream of events, laid
+ * out as the kernel sends them. Without events, the corpus can be replayed
+ * as a dump too.
+ */
+struct gen {
+	int		fd;
+	char		*buf;
+	size_t		len;
+	uint32_t	seq;
+};
+
+static struct nlmsghdr *gen_msg(struct gen *g, uint16_t cmd, uint16_t flags)
+{
+	if (g->len + MSG_ROOM > 8 * MSG_ROOM) {
+		if (nftnl_snapshot_dump_record(g->fd, g->buf, g->len) < 0) {
+			perror("write");
+			exit(EXIT_FAILURE);
+		}
+		g->len = 0;
+	}
+
+	return nftnl_nlmsg_build_hdr(g->buf + g->len, cmd, NFPROTO_IPV4, flags,
+				     g->seq++);
+}
+
+static void gen_end(struct gen *g, struct nlmsghdr *nlh)
+{
+	nlh->nlmsg_flags &= ~NLM_F_REQUEST;
+	g->len += MNL_ALIGN(nlh->nlmsg_len);
+}
+
+static void gen_rule(struct gen *g, uint16_t cmd, uint16_t flags, uint32_t i,
+		     uint32_t num_chains)
+{
+	struct nftnl_rule *r;
+	struct nftnl_expr *e;
+	struct nlmsghdr *nlh;
+	uint32_t addr = htonl(0x0a000000 | i);
+	char chain[32];
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		oom();
+
+	snprintf(chain, sizeof(chain), "chain%u", i % num_chains);
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+
+	e = nftnl_expr_alloc("payload");
+	if (e == NULL)
+		oom();
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_OFFSET, 12);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_PAYLOAD_LEN, sizeof(addr));
+	nftnl_rule_add_expr(r, e);
+
+	e = nftnl_expr_alloc("cmp");
+	if (e == NULL)
+		oom();
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(e, NFTNL_EXPR_CMP_DATA, &addr, sizeof(addr));
+	nftnl_rule_add_expr(r, e);
+
+	e = nftnl_expr_alloc("counter");
+	if (e == NULL)
+		oom();
+	nftnl_rule_add_expr(r, e);
+
+	e = nftnl_expr_alloc("immediate");
+	if (e == NULL)
+		oom();
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, NF_ACCEPT);
+	nftnl_rule_add_expr(r, e);
+
+	nlh = gen_msg(g, cmd, flags);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	gen_end(g, nlh);
+
+	nftnl_rule_free(r);
+}
+
+/* Laid out by hand, the library numbers list entries instead */
+static void gen_elems(struct gen *g, uint16_t cmd, uint16_t flags,
+		      uint32_t first, uint32_t num)
+{
+	struct nlattr *list, *elem, *key;
+	struct nlmsghdr *nlh;
+	uint32_t i;
+
+	nlh = gen_msg(g, cmd, flags);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, "addrs");
+	list = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+	for (i = first; i < first + num; i++) {
+		elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+		key = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY);
+		mnl_attr_put_u32(nlh, NFTA_DATA_VALUE, htonl(0x0a000000 | i));
+		mnl_attr_nest_end(nlh, key);
+		mnl_attr_nest_end(nlh, elem);
+	}
+	mnl_attr_nest_end(nlh, list);
+	gen_end(g, nlh);
+}
+
+static void gen_done(struct gen *g)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = mnl_nlmsg_put_header(g->buf + g->len);
+	nlh->nlmsg_type = NLMSG_DONE;
+	nlh->nlmsg_flags = NLM_F_MULTI;
+	nlh->nlmsg_seq = g->seq++;
+	g->len += MNL_ALIGN(nlh->nlmsg_len);
+}
+
+static void generate(const char *name, uint32_t num_rules,
+		     uint32_t num_chains, uint32_t num_elems,
+		     uint32_t num_events)
+{
+	struct gen g = {};
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+	char chain[32];
+	uint32_t i, n;
+
+	g.fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (g.fd < 0) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+	g.buf = malloc(8 * MSG_ROOM);
+	t = nftnl_table_alloc();
+	s = nftnl_set_alloc();
+	if (g.buf == NULL || t == NULL || s == NULL)
+		oom();
+
+	/* Dump: table, chains, sets and elements, then rules */
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nlh = gen_msg(&g, NFT_MSG_NEWTABLE, NLM_F_MULTI);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	gen_end(&g, nlh);
+	gen_done(&g);
+
+	for (i = 0; i < num_chains; i++) {
+		c = nftnl_chain_alloc();
+		if (c == NULL)
+			oom();
+		snprintf(chain, sizeof(chain), "chain%u", i);
+		nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+		nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, chain);
+		nftnl_chain_set_u64(c, NFTNL_CHAIN_HANDLE, i + 1);
+		nlh = gen_msg(&g, NFT_MSG_NEWCHAIN, NLM_F_MULTI);
+		nftnl_chain_nlmsg_build_payload(nlh, c);
+		gen_end(&g, nlh);
+		nftnl_chain_free(c);
+	}
+	gen_done(&g);
+
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "addrs");
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_TYPE, 7);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(uint32_t));
+	nlh = gen_msg(&g, NFT_MSG_NEWSET, NLM_F_MULTI);
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	gen_end(&g, nlh);
+	gen_done(&g);
+
+	for (i = 0; i < num_elems; i += ELEMS_PER_MSG) {
+		n = num_elems - i < ELEMS_PER_MSG ? num_elems - i :
+						    ELEMS_PER_MSG;
+		gen_elems(&g, NFT_MSG_NEWSETELEM, NLM_F_MULTI, i, n);
+	}
+	gen_done(&g);
+
+	for (i = 0; i < num_rules; i++)
+		gen_rule(&g, NFT_MSG_NEWRULE, NLM_F_MULTI, i, num_chains);
+	gen_done(&g);
+
+	/* Events: each transaction replaces a rule and an element */
+	for (i = 0; i < num_events; i++) {
+		gen_rule(&g, NFT_MSG_DELRULE, 0, i % num_rules, num_chains);
+		gen_rule(&g, NFT_MSG_NEWRULE, NLM_F_APPEND, num_rules + i,
+			 num_chains);
+		gen_elems(&g, NFT_MSG_DELSETELEM, 0, i % num_elems, 1);
+		gen_elems(&g, NFT_MSG_NEWSETELEM, 0, num_elems + i, 1);
+
+		nlh = gen_msg(&g, NFT_MSG_NEWGEN, 0);
+		mnl_attr_put_u32(nlh, NFTA_GEN_ID, htonl(i + 2));
+		gen_end(&g, nlh);
+	}
+
+	if (nftnl_snapshot_dump_record(g.fd, g.buf, g.len) < 0) {
+		perror(name);
+		exit(EXIT_FAILURE);
+	}
+
+	nftnl_table_free(t);
+	nftnl_set_free(s);
+	free(g.buf);
+	close(g.fd);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-t msecs] corpus...\n"
+		"       %s -g corpus [-r rules] [-c chains] [-e elems] "
+		"[-n events]\n"
+		"With -n 0, the generated corpus is a ruleset dump only\n"
+		"Prints one JSON object per measurement on stdout\n",
+		prog, prog);
+	exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t num_rules = 1000, num_chains = 10, num_elems = 10000;
+	uint32_t num_events = 1000;
+	const char *output = NULL;
+	int opt, i;
+
+	while ((opt = getopt(argc, argv, "g:r:c:e:n:t:h")) != -1) {
+		switch (opt) {
+		case 'g':
+			output = optarg;
+			break;
+		case 'r':
+			num_rules = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			num_chains = strtoul(optarg, NULL, 0);
+			break;
+		case 'e':
+			num_elems = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			num_events = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			min_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (output != NULL) {
+		if (num_rules == 0 || num_chains == 0 || num_elems == 0)
+			usage(argv[0]);
+		generate(output, num_rules, num_chains, num_elems, num_events);
+		return EXIT_SUCCESS;
+	}
+
+	if (optind == argc)
+		usage(argv[0]);
+
+	for (i = optind; i < argc; i++)
+		replay(argv[i]);
+
+	return EXIT_SUCCESS;
+}
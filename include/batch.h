@@ -0,0 +1,15 @@
+#ifndef _LIBNFTNL_BATCH_INTERNAL_H_
+#define _LIBNFTNL_BATCH_INTERNAL_H_
+
+#include <stdint.h>
+
+struct nftnl_batch;
+struct nlmsghdr;
+
+uint32_t nftnl_batch_msg_max(const struct nftnl_batch *batch);
+struct nlmsghdr *nftnl_batch_copy_nlmsg(struct nftnl_batch *batch,
+					const struct nlmsghdr *nlh);
+int nftnl_batch_add_nlmsg(struct nftnl_batch *batch,
+			  const struct nlmsghdr *nlh, uint32_t seq);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <sys/types.h>
 
 struct nftnl_buf {
 	char		*buf;
@@ -18,6 +19,39 @@ struct nftnl_buf {
 		.len	= __len,			\
 	};
 
+struct nftnl_data_reg_memo;
+
+/* Growable output area, objects are formatted straight into its free space.
+ * If write is set, complete chunks are handed over to it as they fill up.
+ */
+struct nftnl_sink {
+	char		*data;
+	size_t		size;
+	size_t		len;
+	size_t		chunk;
+	uint64_t	total;
+	ssize_t		(*write)(void *data, const void *buf, size_t len);
+	void		*write_data;
+	int		fd;
+	struct nftnl_data_reg_memo *memo;
+};
+
+typedef int (*nftnl_snprintf_cb)(char *buf, size_t bufsiz, void *obj,
+				 uint32_t cmd, uint32_t type, uint32_t flags);
+
+int nftnl_sink_printf(struct nftnl_sink *s, void *obj, uint32_t cmd,
+		      uint32_t type, uint32_t flags, nftnl_snprintf_cb cb);
+int nftnl_sink_puts(struct nftnl_sink *s, const char *str);
+
+/* UINT64_MAX has 20 decimal digits */
+#define NFTNL_FMT_U64_LEN	20
+
+int nftnl_fmt_mem(char *buf, size_t size, const char *str, size_t len);
+int nftnl_fmt_str(char *buf, size_t size, const char *str);
+int nftnl_fmt_u64(char *buf, size_t size, uint64_t value);
+int nftnl_fmt_s32(char *buf, size_t size, int32_t value);
+int nftnl_fmt_hex32(char *buf, size_t size, uint32_t value);
+
 int nftnl_buf_update(struct nftnl_buf *b, int ret);
 int nftnl_buf_done(struct nftnl_buf *b);
 
@@ -6,6 +6,43 @@
 
 #define NFTNL_SNPRINTF_BUFSIZ 4096
 
+#include "linux_list.h"
+
+#include <stdbool.h>
+
+/*
+ * List owned by an object and its clones. The owner allocates it on the first
+ * change, clones take a reference and whoever changes it while there are
+ * other references gets a copy of its own first.
+ */
+struct nftnl_shared_list {
+	struct list_head	list;
+	unsigned int		refcnt;
+};
+
+/* What objects without a list of their own iterate over, never modified */
+extern struct list_head nftnl_shared_list_empty;
+
+struct nftnl_shared_list *nftnl_shared_list_alloc(void);
+
+/* Clones may be taken while other threads read the same object */
+static inline void nftnl_shared_list_get(struct nftnl_shared_list *l)
+{
+	__atomic_add_fetch(&l->refcnt, 1, __ATOMIC_RELAXED);
+}
+
+/* True if that was the last reference, the list can be freed then */
+static inline bool nftnl_shared_list_put(struct nftnl_shared_list *l)
+{
+	return __atomic_sub_fetch(&l->refcnt, 1, __ATOMIC_ACQ_REL) == 0;
+}
+
+static inline unsigned int
+nftnl_shared_list_refs(const struct nftnl_shared_list *l)
+{
+	return __atomic_load_n(&l->refcnt, __ATOMIC_ACQUIRE);
+}
+
 struct nftnl_parse_err {
 	int line;
 	int column;
@@ -20,13 +57,46 @@ enum nftnl_parse_input {
 
 #include <stdio.h>
 
+/* Reads a document piecewise, only one value is held in memory at a time */
+struct nftnl_parse_stream {
+	FILE		*fp;
+	char		buf[4096];
+	size_t		pos;
+	size_t		len;
+	int		line;
+	int		column;
+	char		*val;
+	size_t		val_len;
+	size_t		val_size;
+	int		val_line;
+	int		val_column;
+};
+
+void nftnl_parse_stream_init(struct nftnl_parse_stream *s, FILE *fp);
+void nftnl_parse_stream_fini(struct nftnl_parse_stream *s);
+int nftnl_parse_stream_getc(struct nftnl_parse_stream *s);
+void nftnl_parse_stream_ungetc(struct nftnl_parse_stream *s);
+int nftnl_parse_stream_next(struct nftnl_parse_stream *s);
+int nftnl_parse_stream_store(struct nftnl_parse_stream *s, int c);
+int nftnl_parse_stream_error(const struct nftnl_parse_stream *s,
+			     struct nftnl_parse_err *err);
+
+struct nftnl_table;
+void nftnl_table_reset(struct nftnl_table *t);
+struct nftnl_chain;
+void nftnl_chain_reset(struct nftnl_chain *c);
+struct nftnl_rule;
+void nftnl_rule_reset(struct nftnl_rule *r);
+
+struct nftnl_sink;
+
 int nftnl_cmd_header_snprintf(char *buf, size_t bufsize, uint32_t cmd,
 			   uint32_t format, uint32_t flags);
-int nftnl_cmd_header_fprintf(FILE *fp, uint32_t cmd, uint32_t format,
-			  uint32_t flags);
 int nftnl_cmd_footer_snprintf(char *buf, size_t bufsize, uint32_t cmd,
 			   uint32_t format, uint32_t flags);
-int nftnl_cmd_footer_fprintf(FILE *fp, uint32_t cmd, uint32_t format,
-			  uint32_t flags);
+int nftnl_cmd_header_export(struct nftnl_sink *s, uint32_t cmd,
+			    uint32_t format, uint32_t flags);
+int nftnl_cmd_footer_export(struct nftnl_sink *s, uint32_t cmd,
+			    uint32_t format, uint32_t flags);
 
 #endif
@@ -26,8 +26,16 @@ union nftnl_data_reg {
 int nftnl_data_reg_snprintf(char *buf, size_t size, union nftnl_data_reg *reg,
                         uint32_t output_format, uint32_t flags, int reg_type);
 struct nlattr;
+struct nftnl_data_reg_memo;
+
+struct nftnl_data_reg_memo *nftnl_data_reg_memo_alloc(void);
+void nftnl_data_reg_memo_free(struct nftnl_data_reg_memo *memo);
+struct nftnl_data_reg_memo *
+nftnl_data_reg_memo_swap(struct nftnl_data_reg_memo *memo);
 
 int nftnl_parse_data(union nftnl_data_reg *data, struct nlattr *attr, int *type);
 void nftnl_free_verdict(union nftnl_data_reg *data);
+size_t nftnl_verdict_memsize(const union nftnl_data_reg *data);
+int nftnl_verdict_clone(union nftnl_data_reg *data);
 
 #endif
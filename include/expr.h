@@ -14,6 +14,7 @@ struct nlmsghdr;
 
 void nftnl_expr_build_payload(struct nlmsghdr *nlh, struct nftnl_expr *expr);
 struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr);
+struct nftnl_expr *nftnl_expr_clone(const struct nftnl_expr *expr);
 
 
 #endif
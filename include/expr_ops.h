@@ -13,6 +13,8 @@ struct expr_ops {
 	uint32_t alloc_len;
 	int	max_attr;
 	void	(*free)(struct nftnl_expr *e);
+	size_t	(*memsize)(const struct nftnl_expr *e);
+	int	(*clone)(struct nftnl_expr *e);
 	int	(*set)(struct nftnl_expr *e, uint16_t type, const void *data, uint32_t data_len);
 	const void *(*get)(const struct nftnl_expr *e, uint16_t type, uint32_t *data_len);
 	int 	(*parse)(struct nftnl_expr *e, struct nlattr *attr);
@@ -25,6 +27,8 @@ struct expr_ops {
 };
 
 struct expr_ops *nftnl_expr_ops_lookup(const char *name);
+int nftnl_expr_ops_index(const struct expr_ops *ops);
+struct expr_ops *nftnl_expr_ops_get(unsigned int index);
 
 #define nftnl_expr_data(ops) (void *)ops->data
 
@@ -14,5 +14,9 @@
 #include "expr.h"
 #include "expr_ops.h"
 #include "buffer.h"
+#include "batch.h"
+#include "pool.h"
+#include "stats.h"
+#include "probe.h"
 
 #endif /* _LIBNFTNL_INTERNAL_H_ */
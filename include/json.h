@@ -49,6 +49,20 @@ int nftnl_jansson_parse_set(struct nftnl_set *s, json_t *tree,
 int nftnl_jansson_parse_elem(struct nftnl_set *s, json_t *tree,
 			   struct nftnl_parse_err *err);
 
+#define NFTNL_JSON_KEY_MAX	32
+
+struct nftnl_parse_stream;
+
+int nftnl_jansson_stream_key(struct nftnl_parse_stream *s, char *key,
+			     size_t size);
+int nftnl_jansson_stream_skip(struct nftnl_parse_stream *s, int c);
+int nftnl_jansson_stream_slice(struct nftnl_parse_stream *s, int c,
+			       struct nftnl_parse_err *err);
+json_t *nftnl_jansson_load_slice(const char *buf, size_t len, int line,
+				 int column, struct nftnl_parse_err *err);
+json_t *nftnl_jansson_stream_load(struct nftnl_parse_stream *s, int c,
+				  struct nftnl_parse_err *err);
+
 int nftnl_data_reg_json_parse(union nftnl_data_reg *reg, json_t *data,
 			    struct nftnl_parse_err *err);
 #else
@@ -1,7 +1,10 @@
 #ifndef _LIBNFTNL_COMMON_H_
 #define _LIBNFTNL_COMMON_H_
 
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
 
 enum {
 	NFTNL_PARSE_EBADINPUT	= 0,
@@ -40,9 +43,20 @@ enum nftnl_parse_type {
 };
 
 struct nftnl_parse_err;
+struct nftnl_sink;
+
+struct nftnl_counter_sample {
+	uint64_t	handle;
+	uint64_t	packets;
+	uint64_t	bytes;
+};
 
 struct nlmsghdr *nftnl_nlmsg_build_hdr(char *buf, uint16_t cmd, uint16_t family,
 				     uint16_t type, uint32_t seq);
+int nftnl_nlmsg_build_filter(struct nlmsghdr *nlh, const char *table,
+			     const char *name);
+bool nftnl_nlmsg_filter(const struct nlmsghdr *nlh, const char *table,
+			const char *name);
 
 struct nftnl_parse_err *nftnl_parse_err_alloc(void);
 void nftnl_parse_err_free(struct nftnl_parse_err *);
@@ -52,6 +66,20 @@ int nftnl_batch_is_supported(void);
 void nftnl_batch_begin(char *buf, uint32_t seq);
 void nftnl_batch_end(char *buf, uint32_t seq);
 
+struct nftnl_sink *nftnl_sink_alloc(size_t chunk);
+struct nftnl_sink *nftnl_sink_alloc_cb(size_t chunk,
+				       ssize_t (*cb)(void *data,
+						     const void *buf,
+						     size_t len),
+				       void *data);
+struct nftnl_sink *nftnl_sink_alloc_fd(size_t chunk, int fd);
+void nftnl_sink_free(struct nftnl_sink *s);
+int nftnl_sink_flush(struct nftnl_sink *s);
+const char *nftnl_sink_data(const struct nftnl_sink *s);
+size_t nftnl_sink_len(const struct nftnl_sink *s);
+uint64_t nftnl_sink_total(const struct nftnl_sink *s);
+void nftnl_sink_reset(struct nftnl_sink *s);
+
 /*
  * Compat
  */
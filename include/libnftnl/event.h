@@ -0,0 +1,52 @@
+#ifndef _LIBNFTNL_EVENT_H_
+#define _LIBNFTNL_EVENT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum nftnl_event_type {
+	NFTNL_EVENT_TABLE = 0,
+	NFTNL_EVENT_CHAIN,
+	NFTNL_EVENT_RULE,
+	NFTNL_EVENT_SET,
+	NFTNL_EVENT_SETELEM,
+	NFTNL_EVENT_GEN,
+	NFTNL_EVENT_TRACE,
+	__NFTNL_EVENT_MAX,
+};
+#define NFTNL_EVENT_MAX (__NFTNL_EVENT_MAX - 1)
+
+struct nlmsghdr;
+struct nftnl_event_loop;
+
+/*
+ * @event is the NFT_MSG_* type of @nlh. @obj is the table, chain, rule,
+ * set, gen or trace object the message was parsed into; setelem events
+ * come as a set holding the elements. The object is reused for the next
+ * event of the same type, handlers copy whatever they want to keep.
+ *
+ * Return MNL_CB_OK to go on, MNL_CB_STOP to stop or MNL_CB_ERROR on error.
+ */
+typedef int (*nftnl_event_cb)(const struct nlmsghdr *nlh, uint32_t event,
+			      void *obj, void *data);
+
+struct nftnl_event_loop *nftnl_event_loop_alloc(int fd, unsigned int nbufs,
+						size_t bufsiz);
+void nftnl_event_loop_free(struct nftnl_event_loop *l);
+
+int nftnl_event_loop_register(struct nftnl_event_loop *l,
+			      enum nftnl_event_type type,
+			      nftnl_event_cb cb, void *data);
+int nftnl_event_loop_run(struct nftnl_event_loop *l);
+uint64_t nftnl_event_loop_overruns(const struct nftnl_event_loop *l);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_EVENT_H_ */
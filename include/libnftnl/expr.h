@@ -18,6 +18,7 @@ enum {
 
 struct nftnl_expr *nftnl_expr_alloc(const char *name);
 void nftnl_expr_free(struct nftnl_expr *expr);
+size_t nftnl_expr_memsize(const struct nftnl_expr *expr);
 
 bool nftnl_expr_is_set(const struct nftnl_expr *expr, uint16_t type);
 void nftnl_expr_set(struct nftnl_expr *expr, uint16_t type, const void *data, uint32_t data_len);
@@ -40,10 +40,36 @@ int nftnl_gen_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_gen *gen);
 
 int nftnl_gen_snprintf(char *buf, size_t size, struct nftnl_gen *gen, uint32_t type, uint32_t flags);
 int nftnl_gen_fprintf(FILE *fp, struct nftnl_gen *gen, uint32_t type, uint32_t flags);
+int nftnl_gen_export(struct nftnl_sink *s, struct nftnl_gen *gen, uint32_t type, uint32_t flags);
 
 #define nftnl_gen_nlmsg_build_hdr	nftnl_nlmsg_build_hdr
 int nftnl_gen_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_gen *gen);
 
+enum {
+	NFTNL_GEN_DUMP_UNCHANGED	= 0,
+	NFTNL_GEN_DUMP_UPDATED,
+	NFTNL_GEN_DUMP_SEND,	/* send the next request */
+	NFTNL_GEN_DUMP_RECV,	/* more replies to the current request */
+};
+
+struct mnl_socket;
+int nftnl_gen_dump(struct mnl_socket *nl, uint16_t family,
+		   struct nftnl_gen *gen,
+		   int (*cb)(const struct nlmsghdr *nlh, void *data),
+		   void (*restart_cb)(void *data), void *data);
+
+struct nftnl_gen_dump_ctx;
+
+struct nftnl_gen_dump_ctx *
+nftnl_gen_dump_ctx_alloc(uint16_t family, struct nftnl_gen *gen,
+			 int (*cb)(const struct nlmsghdr *nlh, void *data),
+			 void (*restart_cb)(void *data), void *data);
+void nftnl_gen_dump_ctx_free(struct nftnl_gen_dump_ctx *ctx);
+struct nlmsghdr *nftnl_gen_dump_ctx_request(struct nftnl_gen_dump_ctx *ctx,
+					    char *buf, uint32_t seq);
+int nftnl_gen_dump_ctx_recv(struct nftnl_gen_dump_ctx *ctx, const void *buf,
+			    size_t len, uint32_t portid);
+
 /*
  * Compat
  */
@@ -17,6 +17,8 @@ struct nftnl_expr;
 
 struct nftnl_rule *nftnl_rule_alloc(void);
 void nftnl_rule_free(struct nftnl_rule *);
+struct nftnl_rule *nftnl_rule_clone(const struct nftnl_rule *r);
+size_t nftnl_rule_memsize(const struct nftnl_rule *r);
 
 enum nftnl_rule_attr {
 	NFTNL_RULE_FAMILY	= 0,
@@ -60,24 +62,44 @@ int nftnl_rule_parse_file(struct nftnl_rule *r, enum nftnl_parse_type type,
 			FILE *fp, struct nftnl_parse_err *err);
 int nftnl_rule_snprintf(char *buf, size_t size, struct nftnl_rule *t, uint32_t type, uint32_t flags);
 int nftnl_rule_fprintf(FILE *fp, struct nftnl_rule *r, uint32_t type, uint32_t flags);
+int nftnl_rule_export(struct nftnl_sink *s, struct nftnl_rule *r, uint32_t type, uint32_t flags);
 
 #define nftnl_rule_nlmsg_build_hdr	nftnl_nlmsg_build_hdr
 int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *t);
+int nftnl_rule_nlmsg_counters(const struct nlmsghdr *nlh,
+			      struct nftnl_counter_sample *samples,
+			      uint32_t max);
 
 int nftnl_expr_foreach(struct nftnl_rule *r,
 			  int (*cb)(struct nftnl_expr *e, void *data),
 			  void *data);
+int nftnl_expr_foreach_ro(const struct nftnl_rule *r,
+			  int (*cb)(const struct nftnl_expr *e, void *data),
+			  void *data);
 
 struct nftnl_expr_iter;
 
 struct nftnl_expr_iter *nftnl_expr_iter_create(struct nftnl_rule *r);
+struct nftnl_expr_iter *nftnl_expr_iter_create_ro(const struct nftnl_rule *r);
 struct nftnl_expr *nftnl_expr_iter_next(struct nftnl_expr_iter *iter);
 void nftnl_expr_iter_destroy(struct nftnl_expr_iter *iter);
 
+struct nftnl_rule_tmpl;
+
+struct nftnl_rule_tmpl *nftnl_rule_tmpl_alloc(const struct nftnl_rule *r,
+					      uint16_t cmd, uint16_t family,
+					      uint16_t flags);
+void nftnl_rule_tmpl_free(struct nftnl_rule_tmpl *t);
+int nftnl_rule_tmpl_add_param(struct nftnl_rule_tmpl *t,
+			      struct nftnl_expr *expr);
+struct nlmsghdr *nftnl_rule_tmpl_nlmsg_build(struct nftnl_rule_tmpl *t,
+					     char *buf, uint32_t seq);
+
 struct nftnl_rule_list;
 
 struct nftnl_rule_list *nftnl_rule_list_alloc(void);
 void nftnl_rule_list_free(struct nftnl_rule_list *list);
+size_t nftnl_rule_list_memsize(const struct nftnl_rule_list *list);
 int nftnl_rule_list_is_empty(struct nftnl_rule_list *list);
 void nftnl_rule_list_add(struct nftnl_rule *r, struct nftnl_rule_list *list);
 void nftnl_rule_list_add_tail(struct nftnl_rule *r, struct nftnl_rule_list *list);
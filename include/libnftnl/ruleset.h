@@ -17,6 +17,7 @@ struct nftnl_ruleset;
 
 struct nftnl_ruleset *nftnl_ruleset_alloc(void);
 void nftnl_ruleset_free(struct nftnl_ruleset *r);
+size_t nftnl_ruleset_memsize(const struct nftnl_ruleset *r);
 
 enum {
 	NFTNL_RULESET_TABLELIST = 0,
@@ -60,6 +61,16 @@ uint32_t nftnl_ruleset_ctx_get_u32(const struct nftnl_parse_ctx *ctx,
 int nftnl_ruleset_parse_file_cb(enum nftnl_parse_type type, FILE *fp,
 			      struct nftnl_parse_err *err, void *data,
 			      int (*cb)(const struct nftnl_parse_ctx *ctx));
+
+enum {
+	NFTNL_PARSE_F_UNORDERED	= (1 << 0),
+};
+
+int nftnl_ruleset_parse_file_cb_parallel(enum nftnl_parse_type type, FILE *fp,
+					 struct nftnl_parse_err *err,
+					 void *data,
+					 int (*cb)(const struct nftnl_parse_ctx *ctx),
+					 unsigned int nthreads, uint32_t flags);
 int nftnl_ruleset_parse_buffer_cb(enum nftnl_parse_type type, const char *buffer,
 				struct nftnl_parse_err *err, void *data,
 				int (*cb)(const struct nftnl_parse_ctx *ctx));
@@ -67,8 +78,18 @@ int nftnl_ruleset_parse(struct nftnl_ruleset *rs, enum nftnl_parse_type type,
 		      const char *data, struct nftnl_parse_err *err);
 int nftnl_ruleset_parse_file(struct nftnl_ruleset *rs, enum nftnl_parse_type type,
 			   FILE *fp, struct nftnl_parse_err *err);
+
+struct nftnl_batch;
+
+int nftnl_ruleset_compile_buffer(enum nftnl_parse_type type,
+				 const char *buffer, struct nftnl_batch *batch,
+				 uint32_t *seq, struct nftnl_parse_err *err);
+int nftnl_ruleset_compile_file(enum nftnl_parse_type type, FILE *fp,
+			       struct nftnl_batch *batch, uint32_t *seq,
+			       struct nftnl_parse_err *err);
 int nftnl_ruleset_snprintf(char *buf, size_t size, const struct nftnl_ruleset *rs, uint32_t type, uint32_t flags);
 int nftnl_ruleset_fprintf(FILE *fp, const struct nftnl_ruleset *rs, uint32_t type, uint32_t flags);
+int nftnl_ruleset_export(struct nftnl_sink *s, const struct nftnl_ruleset *rs, uint32_t type, uint32_t flags);
 
 /*
  * Compat
@@ -32,6 +32,7 @@ struct nftnl_set *nftnl_set_alloc(void);
 void nftnl_set_free(struct nftnl_set *s);
 
 struct nftnl_set *nftnl_set_clone(const struct nftnl_set *set);
+size_t nftnl_set_memsize(const struct nftnl_set *s);
 
 bool nftnl_set_is_set(const struct nftnl_set *s, uint16_t attr);
 void nftnl_set_unset(struct nftnl_set *s, uint16_t attr);
@@ -58,11 +59,13 @@ int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
 
 int nftnl_set_snprintf(char *buf, size_t size, struct nftnl_set *s, uint32_t type, uint32_t flags);
 int nftnl_set_fprintf(FILE *fp, struct nftnl_set *s, uint32_t type, uint32_t flags);
+int nftnl_set_export(struct nftnl_sink *sink, struct nftnl_set *s, uint32_t type, uint32_t flags);
 
 struct nftnl_set_list;
 
 struct nftnl_set_list *nftnl_set_list_alloc(void);
 void nftnl_set_list_free(struct nftnl_set_list *list);
+size_t nftnl_set_list_memsize(const struct nftnl_set_list *list);
 int nftnl_set_list_is_empty(struct nftnl_set_list *list);
 void nftnl_set_list_add(struct nftnl_set *s, struct nftnl_set_list *list);
 void nftnl_set_list_add_tail(struct nftnl_set *s, struct nftnl_set_list *list);
@@ -102,6 +105,7 @@ struct nftnl_set_elem *nftnl_set_elem_alloc(void);
 void nftnl_set_elem_free(struct nftnl_set_elem *s);
 
 struct nftnl_set_elem *nftnl_set_elem_clone(struct nftnl_set_elem *elem);
+size_t nftnl_set_elem_memsize(const struct nftnl_set_elem *s);
 
 void nftnl_set_elem_add(struct nftnl_set *s, struct nftnl_set_elem *elem);
 
@@ -111,10 +115,10 @@ void nftnl_set_elem_set_u32(struct nftnl_set_elem *s, uint16_t attr, uint32_t va
 void nftnl_set_elem_set_u64(struct nftnl_set_elem *s, uint16_t attr, uint64_t val);
 void nftnl_set_elem_set_str(struct nftnl_set_elem *s, uint16_t attr, const char *str);
 
-const void *nftnl_set_elem_get(struct nftnl_set_elem *s, uint16_t attr, uint32_t *data_len);
-const char *nftnl_set_elem_get_str(struct nftnl_set_elem *s, uint16_t attr);
-uint32_t nftnl_set_elem_get_u32(struct nftnl_set_elem *s, uint16_t attr);
-uint64_t nftnl_set_elem_get_u64(struct nftnl_set_elem *s, uint16_t attr);
+const void *nftnl_set_elem_get(const struct nftnl_set_elem *s, uint16_t attr, uint32_t *data_len);
+const char *nftnl_set_elem_get_str(const struct nftnl_set_elem *s, uint16_t attr);
+uint32_t nftnl_set_elem_get_u32(const struct nftnl_set_elem *s, uint16_t attr);
+uint64_t nftnl_set_elem_get_u64(const struct nftnl_set_elem *s, uint16_t attr);
 
 bool nftnl_set_elem_is_set(const struct nftnl_set_elem *s, uint16_t attr);
 
@@ -128,11 +132,14 @@ int nftnl_set_elem_parse_file(struct nftnl_set_elem *e, enum nftnl_parse_type ty
 			    FILE *fp, struct nftnl_parse_err *err);
 int nftnl_set_elem_snprintf(char *buf, size_t size, struct nftnl_set_elem *s, uint32_t type, uint32_t flags);
 int nftnl_set_elem_fprintf(FILE *fp, struct nftnl_set_elem *se, uint32_t type, uint32_t flags);
+int nftnl_set_elem_export(struct nftnl_sink *s, struct nftnl_set_elem *se, uint32_t type, uint32_t flags);
 
 int nftnl_set_elem_foreach(struct nftnl_set *s, int (*cb)(struct nftnl_set_elem *e, void *data), void *data);
+int nftnl_set_elem_foreach_ro(const struct nftnl_set *s, int (*cb)(const struct nftnl_set_elem *e, void *data), void *data);
 
 struct nftnl_set_elems_iter;
 struct nftnl_set_elems_iter *nftnl_set_elems_iter_create(struct nftnl_set *s);
+struct nftnl_set_elems_iter *nftnl_set_elems_iter_create_ro(const struct nftnl_set *s);
 struct nftnl_set_elem *nftnl_set_elems_iter_cur(struct nftnl_set_elems_iter *iter);
 struct nftnl_set_elem *nftnl_set_elems_iter_next(struct nftnl_set_elems_iter *iter);
 void nftnl_set_elems_iter_destroy(struct nftnl_set_elems_iter *iter);
@@ -140,6 +147,23 @@ void nftnl_set_elems_iter_destroy(struct nftnl_set_elems_iter *iter);
 int nftnl_set_elems_nlmsg_build_payload_iter(struct nlmsghdr *nlh,
 					   struct nftnl_set_elems_iter *iter);
 
+/*
+ * Net element changes per set, accumulated between generations
+ */
+struct nftnl_set_delta;
+
+struct nftnl_set_delta *
+nftnl_set_delta_alloc(int (*cb)(struct nftnl_set *added,
+				struct nftnl_set *deleted, void *data),
+		      void *data);
+void nftnl_set_delta_free(struct nftnl_set_delta *d);
+
+int nftnl_set_delta_add(struct nftnl_set_delta *d, uint32_t event,
+			struct nftnl_set *s);
+int nftnl_set_delta_nlmsg(struct nftnl_set_delta *d,
+			  const struct nlmsghdr *nlh);
+int nftnl_set_delta_flush(struct nftnl_set_delta *d);
+
 /*
  * Compat
  */
@@ -0,0 +1,37 @@
+#ifndef _LIBNFTNL_SNAPSHOT_H_
+#define _LIBNFTNL_SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct nlmsghdr;
+struct nftnl_batch;
+struct nftnl_ruleset;
+
+struct nftnl_snapshot;
+
+int nftnl_snapshot_write(int fd, const struct nftnl_ruleset *rs);
+
+struct nftnl_snapshot *nftnl_snapshot_map(int fd);
+void nftnl_snapshot_unmap(struct nftnl_snapshot *snap);
+
+uint32_t nftnl_snapshot_count(const struct nftnl_snapshot *snap);
+int nftnl_snapshot_foreach(const struct nftnl_snapshot *snap,
+			   int (*cb)(const struct nlmsghdr *nlh, void *data),
+			   void *data);
+int nftnl_snapshot_batch(const struct nftnl_snapshot *snap,
+			 struct nftnl_batch *batch, uint32_t *seq);
+
+int nftnl_snapshot_dump_record(int fd, const void *buf, size_t len);
+int nftnl_snapshot_dump_replay(const void *buf, size_t len,
+			       struct nftnl_batch *batch, uint32_t *seq);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_SNAPSHOT_H_ */
@@ -0,0 +1,72 @@
+#ifndef _LIBNFTNL_STATS_H_
+#define _LIBNFTNL_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum nftnl_stats_obj {
+	NFTNL_STATS_TABLE = 0,
+	NFTNL_STATS_CHAIN,
+	NFTNL_STATS_RULE,
+	NFTNL_STATS_SET,
+	NFTNL_STATS_SET_ELEM,
+	NFTNL_STATS_EXPR,
+	NFTNL_STATS_GEN,
+	NFTNL_STATS_TRACE,
+	__NFTNL_STATS_OBJ_MAX
+};
+#define NFTNL_STATS_OBJ_MAX (__NFTNL_STATS_OBJ_MAX - 1)
+
+/* Bytes are counted per netlink message, setelem messages as NFTNL_STATS_SET_ELEM */
+enum nftnl_stats_obj_attr {
+	NFTNL_STATS_OBJ_ALLOC = 0,
+	NFTNL_STATS_OBJ_FREE,
+	NFTNL_STATS_OBJ_PARSE_MSGS,
+	NFTNL_STATS_OBJ_PARSE_BYTES,
+	NFTNL_STATS_OBJ_BUILD_MSGS,
+	NFTNL_STATS_OBJ_BUILD_BYTES,
+	__NFTNL_STATS_OBJ_ATTR_MAX
+};
+#define NFTNL_STATS_OBJ_ATTR_MAX (__NFTNL_STATS_OBJ_ATTR_MAX - 1)
+
+enum nftnl_stats_expr_attr {
+	NFTNL_STATS_EXPR_PARSE_CALLS = 0,
+	NFTNL_STATS_EXPR_PARSE_NS,
+	NFTNL_STATS_EXPR_BUILD_CALLS,
+	NFTNL_STATS_EXPR_BUILD_NS,
+	__NFTNL_STATS_EXPR_ATTR_MAX
+};
+#define NFTNL_STATS_EXPR_ATTR_MAX (__NFTNL_STATS_EXPR_ATTR_MAX - 1)
+
+enum nftnl_stats_attr {
+	NFTNL_STATS_BATCH_PAGES = 0,
+	NFTNL_STATS_BATCH_ROLLOVERS,
+	NFTNL_STATS_SNPRINTF_RETRIES,
+	__NFTNL_STATS_MAX
+};
+#define NFTNL_STATS_MAX (__NFTNL_STATS_MAX - 1)
+
+struct nftnl_stats;
+
+void nftnl_stats_enable(bool enable);
+
+struct nftnl_stats *nftnl_stats_snapshot(void);
+void nftnl_stats_free(struct nftnl_stats *s);
+
+uint64_t nftnl_stats_get(const struct nftnl_stats *s, uint16_t attr);
+uint64_t nftnl_stats_obj_get(const struct nftnl_stats *s, uint16_t obj,
+			     uint16_t attr);
+const char *nftnl_stats_expr_name(const struct nftnl_stats *s,
+				  unsigned int index);
+uint64_t nftnl_stats_expr_get(const struct nftnl_stats *s, const char *name,
+			      uint16_t attr);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* _LIBNFTNL_STATS_H_ */
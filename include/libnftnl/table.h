@@ -16,6 +16,7 @@ struct nftnl_table;
 
 struct nftnl_table *nftnl_table_alloc(void);
 void nftnl_table_free(struct nftnl_table *);
+size_t nftnl_table_memsize(const struct nftnl_table *t);
 
 enum nftnl_table_attr {
 	NFTNL_TABLE_NAME	= 0,
@@ -52,6 +53,7 @@ int nftnl_table_parse_file(struct nftnl_table *t, enum nftnl_parse_type type,
 			 FILE *fp, struct nftnl_parse_err *err);
 int nftnl_table_snprintf(char *buf, size_t size, struct nftnl_table *t, uint32_t type, uint32_t flags);
 int nftnl_table_fprintf(FILE *fp, struct nftnl_table *t, uint32_t type, uint32_t flags);
+int nftnl_table_export(struct nftnl_sink *s, struct nftnl_table *t, uint32_t type, uint32_t flags);
 
 #define nftnl_table_nlmsg_build_hdr	nftnl_nlmsg_build_hdr
 int nftnl_table_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_table *t);
@@ -60,6 +62,7 @@ struct nftnl_table_list;
 
 struct nftnl_table_list *nftnl_table_list_alloc(void);
 void nftnl_table_list_free(struct nftnl_table_list *list);
+size_t nftnl_table_list_memsize(const struct nftnl_table_list *list);
 int nftnl_table_list_is_empty(struct nftnl_table_list *list);
 int nftnl_table_list_foreach(struct nftnl_table_list *table_list, int (*cb)(struct nftnl_table *t, void *data), void *data);
 
@@ -48,6 +48,92 @@ uint64_t nftnl_trace_get_u64(const struct nftnl_trace *trace, uint16_t type);
 const char *nftnl_trace_get_str(const struct nftnl_trace *trace, uint16_t type);
 
 int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t);
+int nftnl_trace_nlmsg_parse_view(const struct nlmsghdr *nlh,
+				 struct nftnl_trace *t);
+
+/*
+ * Trace correlator: groups trace events by trace id into the path each
+ * packet took, using a fixed number of paths and steps per path.
+ */
+struct nftnl_trace_corr;
+struct nftnl_trace_path;
+
+struct nftnl_trace_corr *
+nftnl_trace_corr_alloc(unsigned int max_paths, unsigned int max_steps,
+		       uint64_t timeout,
+		       int (*cb)(const struct nftnl_trace_path *p, void *data),
+		       void *data);
+void nftnl_trace_corr_free(struct nftnl_trace_corr *c);
+
+int nftnl_trace_corr_add(struct nftnl_trace_corr *c,
+			 const struct nftnl_trace *t, uint64_t now);
+int nftnl_trace_corr_expire(struct nftnl_trace_corr *c, uint64_t now);
+int nftnl_trace_corr_flush(struct nftnl_trace_corr *c);
+
+bool nftnl_trace_path_is_complete(const struct nftnl_trace_path *p);
+uint32_t nftnl_trace_path_id(const struct nftnl_trace_path *p);
+uint32_t nftnl_trace_path_family(const struct nftnl_trace_path *p);
+uint32_t nftnl_trace_path_verdict(const struct nftnl_trace_path *p);
+unsigned int nftnl_trace_path_num_steps(const struct nftnl_trace_path *p);
+unsigned int nftnl_trace_path_num_dropped(const struct nftnl_trace_path *p);
+
+bool nftnl_trace_path_step_is_set(const struct nftnl_trace_path *p,
+				  unsigned int step, uint16_t attr);
+uint32_t nftnl_trace_path_step_get_u32(const struct nftnl_trace_path *p,
+				       unsigned int step, uint16_t attr);
+uint64_t nftnl_trace_path_step_get_u64(const struct nftnl_trace_path *p,
+				       unsigned int step, uint16_t attr);
+const char *nftnl_trace_path_step_get_str(const struct nftnl_trace_path *p,
+					  unsigned int step, uint16_t attr);
+
+/*
+ * Trace histogram: counts rule hits, verdicts and interfaces over trace
+ * events in per-thread shards that can be read without locking.
+ */
+struct nftnl_trace_hist;
+struct nftnl_trace_hist_snap;
+
+struct nftnl_trace_hist *nftnl_trace_hist_alloc(unsigned int nshards,
+						unsigned int max_rules);
+void nftnl_trace_hist_free(struct nftnl_trace_hist *h);
+
+int nftnl_trace_hist_add(struct nftnl_trace_hist *h, unsigned int shard,
+			 const struct nftnl_trace *t);
+int nftnl_trace_hist_add_nlmsg(struct nftnl_trace_hist *h, unsigned int shard,
+			       const struct nlmsghdr *nlh);
+
+struct nftnl_trace_hist_snap *
+nftnl_trace_hist_snapshot(const struct nftnl_trace_hist *h);
+int nftnl_trace_hist_snap_merge(struct nftnl_trace_hist_snap *dst,
+				const struct nftnl_trace_hist_snap *src);
+void nftnl_trace_hist_snap_free(struct nftnl_trace_hist_snap *snap);
+
+unsigned int
+nftnl_trace_hist_snap_num_rules(const struct nftnl_trace_hist_snap *snap);
+uint64_t nftnl_trace_hist_snap_rule_hits(const struct nftnl_trace_hist_snap *snap,
+					 unsigned int i);
+uint32_t
+nftnl_trace_hist_snap_rule_get_u32(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr);
+uint64_t
+nftnl_trace_hist_snap_rule_get_u64(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr);
+const char *
+nftnl_trace_hist_snap_rule_get_str(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr);
+uint64_t nftnl_trace_hist_snap_verdict(const struct nftnl_trace_hist_snap *snap,
+				       uint32_t verdict);
+unsigned int
+nftnl_trace_hist_snap_num_ifaces(const struct nftnl_trace_hist_snap *snap,
+				 uint16_t attr);
+uint32_t
+nftnl_trace_hist_snap_iface_index(const struct nftnl_trace_hist_snap *snap,
+				  uint16_t attr, unsigned int i);
+uint64_t
+nftnl_trace_hist_snap_iface_hits(const struct nftnl_trace_hist_snap *snap,
+				 uint16_t attr, unsigned int i);
+uint64_t
+nftnl_trace_hist_snap_overflow(const struct nftnl_trace_hist_snap *snap);
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
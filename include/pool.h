@@ -0,0 +1,15 @@
+#ifndef _NFTNL_POOL_H_
+#define _NFTNL_POOL_H_
+
+#include <stdbool.h>
+
+struct nftnl_pool;
+
+struct nftnl_pool *nftnl_pool_alloc(unsigned int nthreads, unsigned int size,
+				    void (*work)(void *job));
+void nftnl_pool_free(struct nftnl_pool *pool);
+bool nftnl_pool_full(struct nftnl_pool *pool);
+int nftnl_pool_submit(struct nftnl_pool *pool, void *job);
+void *nftnl_pool_complete(struct nftnl_pool *pool, bool ordered);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _LIBNFTNL_PROBE_H_
+#define _LIBNFTNL_PROBE_H_
+
+/*
+ * Static probe points, built with ./configure --enable-usdt. They show up
+ * as USDT probes under the "libnftnl" provider, e.g. for bpftrace:
+ *
+ *	usdt:/usr/lib/libnftnl.so:libnftnl:rule_parse_return
+ *
+ * Probes and their arguments:
+ *
+ *	rule_parse_entry	rule, message length
+ *	rule_parse_return	rule, number of expressions, return value
+ *	rule_build_entry	rule, message length so far
+ *	rule_build_return	rule, number of expressions, message length
+ *	set_elems_parse_entry	set, message length
+ *	set_elems_parse_return	set, number of elements, return value
+ *	batch_update_entry	batch, length of the message just added
+ *	batch_update_return	batch, number of pages, return value
+ *	expr_parse_entry	attribute length
+ *	expr_parse_return	expression, return value
+ *
+ * Without --enable-usdt the probes and their arguments compile to nothing.
+ */
+#ifdef HAVE_USDT
+#include <sys/sdt.h>
+
+#define NFTNL_PROBE1(name, a)		DTRACE_PROBE1(libnftnl, name, a)
+#define NFTNL_PROBE2(name, a, b)	DTRACE_PROBE2(libnftnl, name, a, b)
+#define NFTNL_PROBE3(name, a, b, c)	DTRACE_PROBE3(libnftnl, name, a, b, c)
+#else
+#define NFTNL_PROBE1(name, a)		\
+	do { if (0) { (void)(a); } } while (0)
+#define NFTNL_PROBE2(name, a, b)	\
+	do { if (0) { (void)(a); (void)(b); } } while (0)
+#define NFTNL_PROBE3(name, a, b, c)	\
+	do { if (0) { (void)(a); (void)(b); (void)(c); } } while (0)
+#endif
+
+#endif
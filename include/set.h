@@ -19,13 +19,25 @@ struct nftnl_set {
 	struct {
 		uint32_t	size;
 	} desc;
-	struct list_head	element_list;
+	struct nftnl_shared_list *elems;
 
 	uint32_t		flags;
 	uint32_t		gc_interval;
 	uint64_t		timeout;
 };
 
+/* Elements of this set, they may be shared with clones of this set */
+static inline struct list_head *nftnl_set_elems(const struct nftnl_set *s)
+{
+	if (s->elems == NULL)
+		return &nftnl_shared_list_empty;
+
+	return &s->elems->list;
+}
+
+int nftnl_set_elems_unshare(struct nftnl_set *s);
+void nftnl_set_reset(struct nftnl_set *s);
+
 struct nftnl_set_list;
 struct nftnl_expr;
 int nftnl_set_lookup_id(struct nftnl_expr *e, struct nftnl_set_list *set_list,
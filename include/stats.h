@@ -0,0 +1,72 @@
+#ifndef _LIBNFTNL_STATS_INTERNAL_H_
+#define _LIBNFTNL_STATS_INTERNAL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <libnftnl/stats.h>
+
+/* Room for every expression type, including those yet to be added */
+#define NFTNL_STATS_EXPR_OPS_MAX	32
+
+#define NFTNL_STATS_OBJ_BASE	__NFTNL_STATS_MAX
+#define NFTNL_STATS_EXPR_BASE	\
+	(NFTNL_STATS_OBJ_BASE + __NFTNL_STATS_OBJ_MAX * __NFTNL_STATS_OBJ_ATTR_MAX)
+#define NFTNL_STATS_NUM_COUNTERS	\
+	(NFTNL_STATS_EXPR_BASE +	\
+	 NFTNL_STATS_EXPR_OPS_MAX * __NFTNL_STATS_EXPR_ATTR_MAX)
+
+extern int nftnl_stats_on;
+
+static inline bool nftnl_stats_enabled(void)
+{
+	return __builtin_expect(__atomic_load_n(&nftnl_stats_on,
+						__ATOMIC_RELAXED), 0);
+}
+
+void __nftnl_stats_add(unsigned int counter, uint64_t val);
+uint64_t __nftnl_stats_now(void);
+
+static inline void nftnl_stats_add(uint16_t attr, uint64_t val)
+{
+	if (nftnl_stats_enabled())
+		__nftnl_stats_add(attr, val);
+}
+
+static inline void nftnl_stats_obj_add(uint16_t obj, uint16_t attr,
+				       uint64_t val)
+{
+	if (nftnl_stats_enabled())
+		__nftnl_stats_add(NFTNL_STATS_OBJ_BASE +
+				  obj * __NFTNL_STATS_OBJ_ATTR_MAX + attr, val);
+}
+
+static inline void nftnl_stats_obj_msg(uint16_t obj, uint16_t attr,
+				       uint32_t len)
+{
+	if (nftnl_stats_enabled()) {
+		__nftnl_stats_add(NFTNL_STATS_OBJ_BASE +
+				  obj * __NFTNL_STATS_OBJ_ATTR_MAX + attr, 1);
+		__nftnl_stats_add(NFTNL_STATS_OBJ_BASE +
+				  obj * __NFTNL_STATS_OBJ_ATTR_MAX + attr + 1,
+				  len);
+	}
+}
+
+/* Start of a timed section, zero when statistics are off */
+static inline uint64_t nftnl_stats_now(void)
+{
+	return nftnl_stats_enabled() ? __nftnl_stats_now() : 0;
+}
+
+struct expr_ops;
+void __nftnl_stats_expr(const struct expr_ops *ops, uint16_t attr,
+			uint64_t start);
+
+static inline void nftnl_stats_expr(const struct expr_ops *ops,
+				    uint16_t attr, uint64_t start)
+{
+	if (start != 0)
+		__nftnl_stats_expr(ops, attr, start);
+}
+
+#endif
@@ -23,6 +23,9 @@
 
 #define div_round_up(n, d)	(((n) + (d) - 1) / (d))
 
+/* Bytes a string owned by an object takes, for the *_memsize() functions */
+#define nftnl_strsize(str)	((str) ? strlen(str) + 1 : 0)
+
 void __noreturn __abi_breakage(const char *file, int line, const char *reason);
 
 #define abi_breakage()	\
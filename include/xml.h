@@ -18,6 +18,27 @@ union nftnl_data_reg;
 
 mxml_node_t *nftnl_mxml_build_tree(const void *data, const char *treename,
 				 struct nftnl_parse_err *err, enum nftnl_parse_input input);
+
+#define NFTNL_XML_NAME_MAX	32
+
+enum nftnl_mxml_tag {
+	NFTNL_MXML_TAG_EOF,
+	NFTNL_MXML_TAG_OPEN,
+	NFTNL_MXML_TAG_CLOSE,
+	NFTNL_MXML_TAG_EMPTY,
+	NFTNL_MXML_TAG_OTHER,
+};
+
+struct nftnl_parse_stream;
+
+int nftnl_mxml_stream_tag(struct nftnl_parse_stream *s, char *name,
+			  size_t size);
+int nftnl_mxml_stream_slice(struct nftnl_parse_stream *s, int tag,
+			    struct nftnl_parse_err *err);
+mxml_node_t *nftnl_mxml_load_slice(const char *buf, int line, int column,
+				   struct nftnl_parse_err *err);
+mxml_node_t *nftnl_mxml_stream_load(struct nftnl_parse_stream *s, int tag,
+				    struct nftnl_parse_err *err);
 struct nftnl_expr *nftnl_mxml_expr_parse(mxml_node_t *node,
 					  struct nftnl_parse_err *err,
 					  struct nftnl_set_list *set_list);
@@ -41,6 +41,7 @@ static struct nftnl_batch_page *nftnl_batch_page_alloc(struct nftnl_batch *batch
 	if (page->batch == NULL)
 		goto err2;
 
+	nftnl_stats_add(NFTNL_STATS_BATCH_PAGES, 1);
 	return page;
 err2:
 	free(buf);
@@ -101,26 +102,72 @@ int nftnl_batch_update(struct nftnl_batch *batch)
 	struct nftnl_batch_page *page;
 	struct nlmsghdr *last_nlh;
 
-	if (mnl_nlmsg_batch_next(batch->current_page->batch))
-		return 0;
-
 	last_nlh = nftnl_batch_buffer(batch);
+	NFTNL_PROBE2(batch_update_entry, batch, last_nlh->nlmsg_len);
+
+	if (mnl_nlmsg_batch_next(batch->current_page->batch))
+		goto out;
 
 	page = nftnl_batch_page_alloc(batch);
 	if (page == NULL)
 		goto err1;
 
 	nftnl_batch_add_page(page, batch);
+	nftnl_stats_add(NFTNL_STATS_BATCH_ROLLOVERS, 1);
 
 	memcpy(nftnl_batch_buffer(batch), last_nlh, last_nlh->nlmsg_len);
 	mnl_nlmsg_batch_next(batch->current_page->batch);
-
+out:
+	NFTNL_PROBE3(batch_update_return, batch, batch->num_pages, 0);
 	return 0;
 err1:
+	NFTNL_PROBE3(batch_update_return, batch, batch->num_pages, -1);
 	return -1;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_batch_update, nft_batch_update);
 
+/* Largest message that can be put at nftnl_batch_buffer(), it has to fit
+ * both in a page and in the overrun area past the end of the current one.
+ */
+uint32_t nftnl_batch_msg_max(const struct nftnl_batch *batch)
+{
+	return batch->page_size < batch->page_overrun_size ?
+	       batch->page_size : batch->page_overrun_size;
+}
+
+/* Copy a message that was built elsewhere into the current page. The
+ * caller may still modify it before calling nftnl_batch_update().
+ */
+struct nlmsghdr *nftnl_batch_copy_nlmsg(struct nftnl_batch *batch,
+					const struct nlmsghdr *nlh)
+{
+	struct nlmsghdr *dst;
+
+	if (nlh->nlmsg_len > nftnl_batch_msg_max(batch)) {
+		errno = EMSGSIZE;
+		return NULL;
+	}
+
+	dst = nftnl_batch_buffer(batch);
+	memcpy(dst, nlh, nlh->nlmsg_len);
+
+	return dst;
+}
+
+int nftnl_batch_add_nlmsg(struct nftnl_batch *batch,
+			  const struct nlmsghdr *nlh, uint32_t seq)
+{
+	struct nlmsghdr *dst;
+
+	dst = nftnl_batch_copy_nlmsg(batch, nlh);
+	if (dst == NULL)
+		return -1;
+
+	dst->nlmsg_seq = seq;
+
+	return nftnl_batch_update(batch);
+}
+
 void *nftnl_batch_buffer(struct nftnl_batch *batch)
 {
 	return mnl_nlmsg_batch_current(batch->current_page->batch);
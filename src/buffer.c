@@ -8,10 +8,12 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdint.h>
-#include <stdarg.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <string.h>
+#include <unistd.h>
 #include <buffer.h>
 #include <libnftnl/common.h>
 #include "internal.h"
@@ -46,26 +48,149 @@ int nftnl_buf_done(struct nftnl_buf *b)
 	return b->off;
 }
 
-static int nftnl_buf_put(struct nftnl_buf *b, const char *fmt, ...)
+static const char nftnl_hex_digits[] = "0123456789abcdef";
+
+static const char nftnl_dec_pairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+/* These helpers have snprintf() semantics: output is truncated to fit into
+ * size bytes including the trailing nul, and the untruncated length is
+ * returned.
+ */
+int nftnl_fmt_mem(char *buf, size_t size, const char *str, size_t len)
+{
+	size_t n = len;
+
+	if (size > 0) {
+		if (n >= size)
+			n = size - 1;
+		memcpy(buf, str, n);
+		buf[n] = '\0';
+	}
+
+	return len;
+}
+
+int nftnl_fmt_str(char *buf, size_t size, const char *str)
+{
+	return nftnl_fmt_mem(buf, size, str, strlen(str));
+}
+
+int nftnl_fmt_u64(char *buf, size_t size, uint64_t value)
+{
+	char tmp[NFTNL_FMT_U64_LEN];
+	char *p = tmp + sizeof(tmp);
+
+	while (value >= 100) {
+		p -= 2;
+		memcpy(p, &nftnl_dec_pairs[(value % 100) * 2], 2);
+		value /= 100;
+	}
+	if (value >= 10) {
+		p -= 2;
+		memcpy(p, &nftnl_dec_pairs[value * 2], 2);
+	} else {
+		*--p = '0' + value;
+	}
+
+	return nftnl_fmt_mem(buf, size, p, tmp + sizeof(tmp) - p);
+}
+
+int nftnl_fmt_s32(char *buf, size_t size, int32_t value)
 {
 	int ret;
-	va_list ap;
 
-	va_start(ap, fmt);
-	ret = vsnprintf(b->buf + b->off, b->len, fmt, ap);
-	ret = nftnl_buf_update(b, ret);
-	va_end(ap);
+	if (value >= 0)
+		return nftnl_fmt_u64(buf, size, value);
 
-	return ret;
+	ret = nftnl_fmt_mem(buf, size, "-", 1);
+	if (size > 0)
+		size--;
+
+	return ret + nftnl_fmt_u64(buf + 1, size, -(int64_t)value);
+}
+
+int nftnl_fmt_hex32(char *buf, size_t size, uint32_t value)
+{
+	char tmp[8];
+	int i;
+
+	for (i = sizeof(tmp) - 1; i >= 0; i--) {
+		tmp[i] = nftnl_hex_digits[value & 0xf];
+		value >>= 4;
+	}
+
+	return nftnl_fmt_mem(buf, size, tmp, sizeof(tmp));
+}
+
+static int nftnl_buf_mem(struct nftnl_buf *b, const char *str, size_t len)
+{
+	return nftnl_buf_update(b, nftnl_fmt_mem(b->buf + b->off, b->len,
+						 str, len));
+}
+
+static int nftnl_buf_puts(struct nftnl_buf *b, const char *str)
+{
+	return nftnl_buf_mem(b, str, strlen(str));
+}
+
+#define nftnl_buf_lit(b, str)	nftnl_buf_mem(b, str, sizeof(str) - 1)
+
+/* Emit <tag>value</tag> or "tag":value, with value quoted in json if
+ * requested.
+ */
+static int nftnl_buf_field(struct nftnl_buf *b, int type, const char *tag,
+			   const char *value, size_t len, bool quote)
+{
+	int ret = 0;
+
+	switch (type) {
+	case NFTNL_OUTPUT_XML:
+		ret += nftnl_buf_lit(b, "<");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		ret += nftnl_buf_mem(b, value, len);
+		ret += nftnl_buf_lit(b, "</");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		return ret;
+	case NFTNL_OUTPUT_JSON:
+		ret += nftnl_buf_lit(b, "\"");
+		ret += nftnl_buf_puts(b, tag);
+		if (quote) {
+			ret += nftnl_buf_lit(b, "\":\"");
+			ret += nftnl_buf_mem(b, value, len);
+			ret += nftnl_buf_lit(b, "\",");
+		} else {
+			ret += nftnl_buf_lit(b, "\":");
+			ret += nftnl_buf_mem(b, value, len);
+			ret += nftnl_buf_lit(b, ",");
+		}
+		return ret;
+	default:
+		return 0;
+	}
 }
 
 int nftnl_buf_open(struct nftnl_buf *b, int type, const char *tag)
 {
+	int ret = 0;
+
 	switch (type) {
 	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>", tag);
+		ret += nftnl_buf_lit(b, "<");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		return ret;
 	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "{\"%s\":{", tag);
+		ret += nftnl_buf_lit(b, "{\"");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, "\":{");
+		return ret;
 	default:
 		return 0;
 	}
@@ -73,9 +198,14 @@ int nftnl_buf_open(struct nftnl_buf *b, int type, const char *tag)
 
 int nftnl_buf_close(struct nftnl_buf *b, int type, const char *tag)
 {
+	int ret = 0;
+
 	switch (type) {
 	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "</%s>", tag);
+		ret += nftnl_buf_lit(b, "</");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		return ret;
 	case NFTNL_OUTPUT_JSON:
 		/* Remove trailing comma in json */
 		if (b->size > 0 && b->buf[b->size - 1] == ',') {
@@ -84,7 +214,7 @@ int nftnl_buf_close(struct nftnl_buf *b, int type, const char *tag)
 			b->len++;
 		}
 
-		return nftnl_buf_put(b, "}}");
+		return nftnl_buf_lit(b, "}}");
 	default:
 		return 0;
 	}
@@ -92,11 +222,19 @@ int nftnl_buf_close(struct nftnl_buf *b, int type, const char *tag)
 
 int nftnl_buf_open_array(struct nftnl_buf *b, int type, const char *tag)
 {
+	int ret = 0;
+
 	switch (type) {
 	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "{\"%s\":[", tag);
+		ret += nftnl_buf_lit(b, "{\"");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, "\":[");
+		return ret;
 	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>", tag);
+		ret += nftnl_buf_lit(b, "<");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		return ret;
 	default:
 		return 0;
 	}
@@ -104,11 +242,16 @@ int nftnl_buf_open_array(struct nftnl_buf *b, int type, const char *tag)
 
 int nftnl_buf_close_array(struct nftnl_buf *b, int type, const char *tag)
 {
+	int ret = 0;
+
 	switch (type) {
 	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "]}");
+		return nftnl_buf_lit(b, "]}");
 	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "</%s>", tag);
+		ret += nftnl_buf_lit(b, "</");
+		ret += nftnl_buf_puts(b, tag);
+		ret += nftnl_buf_lit(b, ">");
+		return ret;
 	default:
 		return 0;
 	}
@@ -116,50 +259,32 @@ int nftnl_buf_close_array(struct nftnl_buf *b, int type, const char *tag)
 
 int nftnl_buf_u32(struct nftnl_buf *b, int type, uint32_t value, const char *tag)
 {
-	switch (type) {
-	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>%u</%s>", tag, value, tag);
-	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "\"%s\":%u,", tag, value);
-	default:
-		return 0;
-	}
+	return nftnl_buf_u64(b, type, value, tag);
 }
 
 int nftnl_buf_s32(struct nftnl_buf *b, int type, uint32_t value, const char *tag)
 {
-	switch (type) {
-	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>%d</%s>", tag, value, tag);
-	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "\"%s\":%d,", tag, value);
-	default:
-		return 0;
-	}
+	char tmp[NFTNL_FMT_U64_LEN + 1];
+	int len;
+
+	len = nftnl_fmt_s32(tmp, sizeof(tmp), value);
+
+	return nftnl_buf_field(b, type, tag, tmp, len, false);
 }
 
 int nftnl_buf_u64(struct nftnl_buf *b, int type, uint64_t value, const char *tag)
 {
-	switch (type) {
-	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>%"PRIu64"</%s>", tag, value, tag);
-	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "\"%s\":%"PRIu64",", tag, value);
-	default:
-		return 0;
-	}
+	char tmp[NFTNL_FMT_U64_LEN + 1];
+	int len;
+
+	len = nftnl_fmt_u64(tmp, sizeof(tmp), value);
+
+	return nftnl_buf_field(b, type, tag, tmp, len, false);
 }
 
 int nftnl_buf_str(struct nftnl_buf *b, int type, const char *str, const char *tag)
 {
-	switch (type) {
-	case NFTNL_OUTPUT_XML:
-		return nftnl_buf_put(b, "<%s>%s</%s>", tag, str, tag);
-	case NFTNL_OUTPUT_JSON:
-		return nftnl_buf_put(b, "\"%s\":\"%s\",", tag, str);
-	default:
-		return 0;
-	}
+	return nftnl_buf_field(b, type, tag, str, strlen(str), true);
 }
 
 int nftnl_buf_reg(struct nftnl_buf *b, int type, union nftnl_data_reg *reg,
@@ -169,17 +294,239 @@ int nftnl_buf_reg(struct nftnl_buf *b, int type, union nftnl_data_reg *reg,
 
 	switch (type) {
 	case NFTNL_OUTPUT_XML:
-		ret = nftnl_buf_put(b, "<%s>", tag);
+		nftnl_buf_open(b, type, tag);
 		ret = nftnl_data_reg_snprintf(b->buf + b->off, b->len, reg,
                                     NFTNL_OUTPUT_XML, 0, reg_type);
 		nftnl_buf_update(b, ret);
-		return nftnl_buf_put(b, "</%s>", tag);
+		return nftnl_buf_close(b, type, tag);
 	case NFTNL_OUTPUT_JSON:
-		nftnl_buf_put(b, "\"%s\":{", tag);
+		nftnl_buf_lit(b, "\"");
+		nftnl_buf_puts(b, tag);
+		nftnl_buf_lit(b, "\":{");
 		ret = nftnl_data_reg_snprintf(b->buf + b->off, b->len, reg,
 					    NFTNL_OUTPUT_JSON, 0, reg_type);
 		nftnl_buf_update(b, ret);
-		return nftnl_buf_put(b, "},");
+		return nftnl_buf_lit(b, "},");
 	}
 	return 0;
 }
+
+static int nftnl_sink_grow(struct nftnl_sink *s, size_t needed)
+{
+	size_t size = s->size;
+	char *data;
+
+	while (size - s->len < needed) {
+		if (size > SIZE_MAX / 2) {
+			errno = ENOMEM;
+			return -1;
+		}
+		size *= 2;
+	}
+
+	data = realloc(s->data, size);
+	if (data == NULL)
+		return -1;
+
+	s->data = data;
+	s->size = size;
+	return 0;
+}
+
+static int nftnl_sink_write(struct nftnl_sink *s, size_t len)
+{
+	size_t off = 0;
+	ssize_t ret;
+
+	while (off < len) {
+		ret = s->write(s->write_data, s->data + off, len - off);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		} else if (ret == 0) {
+			errno = EIO;
+			return -1;
+		}
+		off += ret;
+	}
+
+	/* Keep the unwritten tail, it is less than one chunk */
+	memmove(s->data, s->data + len, s->len - len + 1);
+	s->len -= len;
+
+	return 0;
+}
+
+/* Streaming sinks hand over whole chunks as soon as they are complete, so
+ * memory use is bounded by the chunk size plus the largest single object.
+ */
+static int nftnl_sink_commit(struct nftnl_sink *s, size_t len)
+{
+	s->len += len;
+	s->total += len;
+
+	if (s->write == NULL || s->len < s->chunk)
+		return 0;
+
+	return nftnl_sink_write(s, s->len - s->len % s->chunk);
+}
+
+/* Format one object at the tail of the sink. Since the sink grows
+ * geometrically, an object is only formatted twice when the sink runs out
+ * of room, which happens a logarithmic number of times per document.
+ */
+int nftnl_sink_printf(struct nftnl_sink *s, void *obj, uint32_t cmd,
+		      uint32_t type, uint32_t flags, nftnl_snprintf_cb cb)
+{
+	struct nftnl_data_reg_memo *memo;
+	size_t avail;
+	int ret;
+
+	memo = nftnl_data_reg_memo_swap(s->memo);
+	for (;;) {
+		avail = s->size - s->len;
+		ret = cb(s->data + s->len, avail, obj, cmd, type, flags);
+		if (ret < 0)
+			break;
+		if ((size_t)ret < avail)
+			break;
+
+		nftnl_stats_add(NFTNL_STATS_SNPRINTF_RETRIES, 1);
+		if (nftnl_sink_grow(s, ret + 1) < 0) {
+			s->data[s->len] = '\0';
+			ret = -1;
+			break;
+		}
+	}
+	nftnl_data_reg_memo_swap(memo);
+
+	if (ret < 0)
+		return -1;
+
+	return nftnl_sink_commit(s, ret);
+}
+
+int nftnl_sink_puts(struct nftnl_sink *s, const char *str)
+{
+	size_t len = strlen(str);
+
+	if (len >= s->size - s->len && nftnl_sink_grow(s, len + 1) < 0)
+		return -1;
+
+	memcpy(s->data + s->len, str, len + 1);
+
+	return nftnl_sink_commit(s, len);
+}
+
+EXPORT_SYMBOL(nftnl_sink_alloc);
+struct nftnl_sink *nftnl_sink_alloc(size_t chunk)
+{
+	struct nftnl_sink *s;
+
+	s = calloc(1, sizeof(struct nftnl_sink));
+	if (s == NULL)
+		return NULL;
+
+	s->chunk = chunk ? chunk : NFTNL_SNPRINTF_BUFSIZ;
+	s->data = malloc(s->chunk);
+	if (s->data == NULL)
+		goto err1;
+
+	/* Verdict renderings are cached for as long as the sink lives */
+	s->memo = nftnl_data_reg_memo_alloc();
+	if (s->memo == NULL)
+		goto err2;
+
+	s->size = s->chunk;
+	s->data[0] = '\0';
+
+	return s;
+err2:
+	xfree(s->data);
+err1:
+	xfree(s);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_sink_alloc_cb);
+struct nftnl_sink *nftnl_sink_alloc_cb(size_t chunk,
+				       ssize_t (*cb)(void *data,
+						     const void *buf,
+						     size_t len),
+				       void *data)
+{
+	struct nftnl_sink *s;
+
+	s = nftnl_sink_alloc(chunk);
+	if (s == NULL)
+		return NULL;
+
+	s->write = cb;
+	s->write_data = data;
+
+	return s;
+}
+
+static ssize_t nftnl_sink_fd_write(void *data, const void *buf, size_t len)
+{
+	return write(*(int *)data, buf, len);
+}
+
+EXPORT_SYMBOL(nftnl_sink_alloc_fd);
+struct nftnl_sink *nftnl_sink_alloc_fd(size_t chunk, int fd)
+{
+	struct nftnl_sink *s;
+
+	s = nftnl_sink_alloc_cb(chunk, nftnl_sink_fd_write, NULL);
+	if (s == NULL)
+		return NULL;
+
+	s->fd = fd;
+	s->write_data = &s->fd;
+
+	return s;
+}
+
+EXPORT_SYMBOL(nftnl_sink_flush);
+int nftnl_sink_flush(struct nftnl_sink *s)
+{
+	if (s->write == NULL)
+		return 0;
+
+	return nftnl_sink_write(s, s->len);
+}
+
+EXPORT_SYMBOL(nftnl_sink_free);
+void nftnl_sink_free(struct nftnl_sink *s)
+{
+	nftnl_data_reg_memo_free(s->memo);
+	xfree(s->data);
+	xfree(s);
+}
+
+EXPORT_SYMBOL(nftnl_sink_data);
+const char *nftnl_sink_data(const struct nftnl_sink *s)
+{
+	return s->data;
+}
+
+EXPORT_SYMBOL(nftnl_sink_len);
+size_t nftnl_sink_len(const struct nftnl_sink *s)
+{
+	return s->len;
+}
+
+EXPORT_SYMBOL(nftnl_sink_total);
+uint64_t nftnl_sink_total(const struct nftnl_sink *s)
+{
+	return s->total;
+}
+
+EXPORT_SYMBOL(nftnl_sink_reset);
+void nftnl_sink_reset(struct nftnl_sink *s)
+{
+	s->len = 0;
+	s->total = 0;
+	s->data[0] = '\0';
+}
@@ -89,7 +89,13 @@ static const char *nftnl_hooknum2str(int family, int hooknum)
 
 struct nftnl_chain *nftnl_chain_alloc(void)
 {
-	return calloc(1, sizeof(struct nftnl_chain));
+	struct nftnl_chain *c;
+
+	c = calloc(1, sizeof(struct nftnl_chain));
+	if (c != NULL)
+		nftnl_stats_obj_add(NFTNL_STATS_CHAIN, NFTNL_STATS_OBJ_ALLOC, 1);
+
+	return c;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_alloc, nft_chain_alloc);
 
@@ -102,10 +108,53 @@ void nftnl_chain_free(struct nftnl_chain *c)
 	if (c->dev != NULL)
 		xfree(c->dev);
 
+	nftnl_stats_obj_add(NFTNL_STATS_CHAIN, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(c);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_free, nft_chain_free);
 
+EXPORT_SYMBOL(nftnl_chain_memsize);
+size_t nftnl_chain_memsize(const struct nftnl_chain *c)
+{
+	return sizeof(struct nftnl_chain) + nftnl_strsize(c->table) +
+	       nftnl_strsize(c->type) + nftnl_strsize(c->dev);
+}
+
+/* Chains have no variable-sized payload, the clone is a plain copy */
+EXPORT_SYMBOL(nftnl_chain_clone);
+struct nftnl_chain *nftnl_chain_clone(const struct nftnl_chain *c)
+{
+	struct nftnl_chain *newc;
+
+	newc = nftnl_chain_alloc();
+	if (newc == NULL)
+		return NULL;
+
+	memcpy(newc, c, sizeof(*c));
+	newc->table = newc->type = newc->dev = NULL;
+
+	if (c->flags & (1 << NFTNL_CHAIN_TABLE)) {
+		newc->table = strdup(c->table);
+		if (newc->table == NULL)
+			goto err;
+	}
+	if (c->flags & (1 << NFTNL_CHAIN_TYPE)) {
+		newc->type = strdup(c->type);
+		if (newc->type == NULL)
+			goto err;
+	}
+	if (c->flags & (1 << NFTNL_CHAIN_DEV)) {
+		newc->dev = strdup(c->dev);
+		if (newc->dev == NULL)
+			goto err;
+	}
+
+	return newc;
+err:
+	nftnl_chain_free(newc);
+	return NULL;
+}
+
 bool nftnl_chain_is_set(const struct nftnl_chain *c, uint16_t attr)
 {
 	return c->flags & (1 << attr);
@@ -155,6 +204,15 @@ void nftnl_chain_unset(struct nftnl_chain *c, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_unset, nft_chain_attr_unset);
 
+/* Drop all attributes so the chain can be parsed into again */
+void nftnl_chain_reset(struct nftnl_chain *c)
+{
+	uint16_t attr;
+
+	for (attr = 0; attr <= NFTNL_CHAIN_MAX; attr++)
+		nftnl_chain_unset(c, attr);
+}
+
 static uint32_t nftnl_chain_validate[NFTNL_CHAIN_MAX + 1] = {
 	[NFTNL_CHAIN_HOOKNUM]	= sizeof(uint32_t),
 	[NFTNL_CHAIN_PRIO]		= sizeof(int32_t),
@@ -396,6 +454,9 @@ void nftnl_chain_nlmsg_build_payload(struct nlmsghdr *nlh, const struct nftnl_ch
 		mnl_attr_put_u64(nlh, NFTA_CHAIN_HANDLE, be64toh(c->handle));
 	if (c->flags & (1 << NFTNL_CHAIN_TYPE))
 		mnl_attr_put_strz(nlh, NFTA_CHAIN_TYPE, c->type);
+
+	nftnl_stats_obj_msg(NFTNL_STATS_CHAIN, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_nlmsg_build_payload, nft_chain_nlmsg_build_payload);
 
@@ -526,6 +587,9 @@ int nftnl_chain_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_chain *c)
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
 	int ret = 0;
 
+	nftnl_stats_obj_msg(NFTNL_STATS_CHAIN, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
 	if (mnl_attr_parse(nlh, sizeof(*nfg), nftnl_chain_parse_attr_cb, tb) < 0)
 		return -1;
 
@@ -574,6 +638,49 @@ int nftnl_chain_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_chain *c)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_nlmsg_parse, nft_chain_nlmsg_parse);
 
+/*
+ * nftnl_chain_nlmsg_counters - harvest the counters of a chain message
+ *
+ * Returns 1 and fills @sample if the chain carries counters, 0 if it does
+ * not (ie. it is not a base chain), or -1 on error.
+ */
+EXPORT_SYMBOL(nftnl_chain_nlmsg_counters);
+int nftnl_chain_nlmsg_counters(const struct nlmsghdr *nlh,
+			       struct nftnl_counter_sample *sample)
+{
+	struct nlattr *tb[NFTA_COUNTER_MAX+1] = {};
+	const struct nlattr *attr, *counters = NULL;
+	uint64_t handle = 0;
+
+	mnl_attr_for_each(attr, nlh, sizeof(struct nfgenmsg)) {
+		switch (mnl_attr_get_type(attr)) {
+		case NFTA_CHAIN_HANDLE:
+			if (mnl_attr_validate(attr, MNL_TYPE_U64) < 0)
+				abi_breakage();
+			handle = be64toh(mnl_attr_get_u64(attr));
+			break;
+		case NFTA_CHAIN_COUNTERS:
+			counters = attr;
+			break;
+		}
+	}
+
+	if (counters == NULL)
+		return 0;
+
+	if (mnl_attr_parse_nested(counters, nftnl_chain_parse_counters_cb,
+				  tb) < 0)
+		return -1;
+
+	sample->handle = handle;
+	sample->packets = tb[NFTA_COUNTER_PACKETS] ?
+		be64toh(mnl_attr_get_u64(tb[NFTA_COUNTER_PACKETS])) : 0;
+	sample->bytes = tb[NFTA_COUNTER_BYTES] ?
+		be64toh(mnl_attr_get_u64(tb[NFTA_COUNTER_BYTES])) : 0;
+
+	return 1;
+}
+
 static inline int nftnl_str2hooknum(int family, const char *hook)
 {
 	int hooknum;
@@ -833,8 +940,8 @@ int nftnl_chain_parse_file(struct nftnl_chain *c, enum nftnl_parse_type type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_parse_file, nft_chain_parse_file);
 
-static int nftnl_chain_export(char *buf, size_t size, struct nftnl_chain *c,
-			    int type)
+static int nftnl_chain_snprintf_export(char *buf, size_t size,
+				       struct nftnl_chain *c, int type)
 {
 	NFTNL_BUF_INIT(b, buf, size);
 
@@ -913,7 +1020,7 @@ static int nftnl_chain_cmd_snprintf(char *buf, size_t size, struct nftnl_chain *
 		break;
 	case NFTNL_OUTPUT_XML:
 	case NFTNL_OUTPUT_JSON:
-		ret = nftnl_chain_export(buf+offset, len, c, type);
+		ret = nftnl_chain_snprintf_export(buf+offset, len, c, type);
 		break;
 	default:
 		return -1;
@@ -950,6 +1057,14 @@ int nftnl_chain_fprintf(FILE *fp, struct nftnl_chain *c, uint32_t type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_fprintf, nft_chain_fprintf);
 
+EXPORT_SYMBOL(nftnl_chain_export);
+int nftnl_chain_export(struct nftnl_sink *s, struct nftnl_chain *c,
+		       uint32_t type, uint32_t flags)
+{
+	return nftnl_sink_printf(s, c, NFTNL_CMD_UNSPEC, type, flags,
+				 nftnl_chain_do_snprintf);
+}
+
 struct nftnl_chain_list {
 	struct list_head list;
 };
@@ -980,6 +1095,18 @@ void nftnl_chain_list_free(struct nftnl_chain_list *list)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_chain_list_free, nft_chain_list_free);
 
+EXPORT_SYMBOL(nftnl_chain_list_memsize);
+size_t nftnl_chain_list_memsize(const struct nftnl_chain_list *list)
+{
+	size_t size = sizeof(struct nftnl_chain_list);
+	struct nftnl_chain *c;
+
+	list_for_each_entry(c, &list->list, head)
+		size += nftnl_chain_memsize(c);
+
+	return size;
+}
+
 int nftnl_chain_list_is_empty(struct nftnl_chain_list *list)
 {
 	return list_empty(&list->list);
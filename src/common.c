@@ -8,6 +8,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <sys/socket.h>
 #include <time.h>
 #include <linux/netlink.h>
@@ -42,6 +43,127 @@ struct nlmsghdr *nftnl_nlmsg_build_hdr(char *buf, uint16_t cmd, uint16_t family,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_nlmsg_build_hdr, nft_nlmsg_build_hdr);
 
+/* Attributes that carry the table and the chain (or set) name, per message */
+static int nftnl_nlmsg_filter_attrs(const struct nlmsghdr *nlh,
+				    uint16_t *table, uint16_t *name)
+{
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWTABLE:
+	case NFT_MSG_GETTABLE:
+	case NFT_MSG_DELTABLE:
+		*table = NFTA_TABLE_NAME;
+		*name = 0;
+		break;
+	case NFT_MSG_NEWCHAIN:
+	case NFT_MSG_GETCHAIN:
+	case NFT_MSG_DELCHAIN:
+		*table = NFTA_CHAIN_TABLE;
+		*name = NFTA_CHAIN_NAME;
+		break;
+	case NFT_MSG_NEWRULE:
+	case NFT_MSG_GETRULE:
+	case NFT_MSG_DELRULE:
+		*table = NFTA_RULE_TABLE;
+		*name = NFTA_RULE_CHAIN;
+		break;
+	case NFT_MSG_NEWSET:
+	case NFT_MSG_GETSET:
+	case NFT_MSG_DELSET:
+		*table = NFTA_SET_TABLE;
+		*name = NFTA_SET_NAME;
+		break;
+	case NFT_MSG_NEWSETELEM:
+	case NFT_MSG_GETSETELEM:
+	case NFT_MSG_DELSETELEM:
+		*table = NFTA_SET_ELEM_LIST_TABLE;
+		*name = NFTA_SET_ELEM_LIST_SET;
+		break;
+	case NFT_MSG_TRACE:
+		*table = NFTA_TRACE_TABLE;
+		*name = NFTA_TRACE_CHAIN;
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * nftnl_nlmsg_build_filter - restrict a dump request to one table/chain/set
+ *
+ * @name refers to the chain for chain and rule requests, and to the set for
+ * set and set element requests. Any of them can be NULL. Kernels that
+ * cannot filter some dump just ignore these attributes, so use
+ * nftnl_nlmsg_filter() on the replies to skip what you do not want.
+ */
+int nftnl_nlmsg_build_filter(struct nlmsghdr *nlh, const char *table,
+			     const char *name)
+{
+	uint16_t table_attr, name_attr;
+
+	if (nftnl_nlmsg_filter_attrs(nlh, &table_attr, &name_attr) < 0) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	if (table)
+		mnl_attr_put_strz(nlh, table_attr, table);
+	if (name && name_attr)
+		mnl_attr_put_strz(nlh, name_attr, name);
+
+	return 0;
+}
+EXPORT_SYMBOL(nftnl_nlmsg_build_filter);
+
+static bool nftnl_attr_streq(const struct nlattr *attr, const char *str)
+{
+	const char *payload = mnl_attr_get_payload(attr);
+	size_t len = strlen(str);
+	uint16_t payload_len = mnl_attr_get_payload_len(attr);
+
+	if (payload_len < len)
+		return false;
+	if (payload_len > len && payload[len] != '\0')
+		return false;
+
+	return memcmp(payload, str, len) == 0;
+}
+
+/*
+ * nftnl_nlmsg_filter - check if a message belongs to a table/chain/set
+ *
+ * This only walks the top-level attributes, so it is meant to be called
+ * before allocating and parsing the object. Messages that do not refer to
+ * any table, such as generation messages, always match.
+ */
+bool nftnl_nlmsg_filter(const struct nlmsghdr *nlh, const char *table,
+			const char *name)
+{
+	uint16_t table_attr, name_attr;
+	const struct nlattr *attr;
+	bool table_ok = !table, name_ok = !name;
+
+	if (nftnl_nlmsg_filter_attrs(nlh, &table_attr, &name_attr) < 0)
+		return true;
+
+	if (!name_attr)
+		name_ok = true;
+
+	mnl_attr_for_each(attr, nlh, sizeof(struct nfgenmsg)) {
+		uint16_t type = mnl_attr_get_type(attr);
+
+		if (!table_ok && type == table_attr)
+			table_ok = nftnl_attr_streq(attr, table);
+		else if (!name_ok && type == name_attr)
+			name_ok = nftnl_attr_streq(attr, name);
+
+		if (table_ok && name_ok)
+			return true;
+	}
+	return table_ok && name_ok;
+}
+EXPORT_SYMBOL(nftnl_nlmsg_filter);
+
 struct nftnl_parse_err *nftnl_parse_err_alloc(void)
 {
 	struct nftnl_parse_err *err;
@@ -116,11 +238,11 @@ static int nftnl_cmd_header_fprintf_cb(char *buf, size_t size, void *obj,
 	return nftnl_cmd_header_snprintf(buf, size, cmd, type, flags);
 }
 
-int nftnl_cmd_header_fprintf(FILE *fp, uint32_t cmd, uint32_t type,
-			   uint32_t flags)
+int nftnl_cmd_header_export(struct nftnl_sink *s, uint32_t cmd, uint32_t type,
+			    uint32_t flags)
 {
-	return nftnl_fprintf(fp, NULL, cmd, type, flags,
-			   nftnl_cmd_header_fprintf_cb);
+	return nftnl_sink_printf(s, NULL, cmd, type, flags,
+				 nftnl_cmd_header_fprintf_cb);
 }
 
 int nftnl_cmd_footer_snprintf(char *buf, size_t size, uint32_t cmd, uint32_t type,
@@ -149,11 +271,11 @@ static int nftnl_cmd_footer_fprintf_cb(char *buf, size_t size, void *obj,
 	return nftnl_cmd_footer_snprintf(buf, size, cmd, type, flags);
 }
 
-int nftnl_cmd_footer_fprintf(FILE *fp, uint32_t cmd, uint32_t type,
-			   uint32_t flags)
+int nftnl_cmd_footer_export(struct nftnl_sink *s, uint32_t cmd, uint32_t type,
+			    uint32_t flags)
 {
-	return nftnl_fprintf(fp, NULL, cmd, type, flags,
-			   nftnl_cmd_footer_fprintf_cb);
+	return nftnl_sink_printf(s, NULL, cmd, type, flags,
+				 nftnl_cmd_footer_fprintf_cb);
 }
 
 static void nftnl_batch_build_hdr(char *buf, uint16_t type, uint32_t seq)
@@ -242,3 +364,88 @@ err:
 	return -1;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_batch_is_supported, nft_batch_is_supported);
+
+void nftnl_parse_stream_init(struct nftnl_parse_stream *s, FILE *fp)
+{
+	s->fp = fp;
+	s->pos = s->len = 0;
+	s->line = 1;
+	s->column = 0;
+	s->val = NULL;
+	s->val_len = s->val_size = 0;
+	s->val_line = s->val_column = 0;
+}
+
+void nftnl_parse_stream_fini(struct nftnl_parse_stream *s)
+{
+	xfree(s->val);
+}
+
+int nftnl_parse_stream_getc(struct nftnl_parse_stream *s)
+{
+	int c;
+
+	if (s->pos == s->len) {
+		s->len = fread(s->buf, 1, sizeof(s->buf), s->fp);
+		s->pos = 0;
+		if (s->len == 0)
+			return EOF;
+	}
+
+	c = (unsigned char)s->buf[s->pos++];
+	if (c == '\n') {
+		s->line++;
+		s->column = 0;
+	} else {
+		s->column++;
+	}
+
+	return c;
+}
+
+/* Only valid right after nftnl_parse_stream_getc() returned c != '\n' */
+void nftnl_parse_stream_ungetc(struct nftnl_parse_stream *s)
+{
+	s->pos--;
+	s->column--;
+}
+
+int nftnl_parse_stream_next(struct nftnl_parse_stream *s)
+{
+	int c;
+
+	do {
+		c = nftnl_parse_stream_getc(s);
+	} while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+
+	return c;
+}
+
+int nftnl_parse_stream_error(const struct nftnl_parse_stream *s,
+			     struct nftnl_parse_err *err)
+{
+	err->error = NFTNL_PARSE_EBADINPUT;
+	err->line = s->line;
+	err->column = s->column;
+	errno = EINVAL;
+	return -1;
+}
+
+int nftnl_parse_stream_store(struct nftnl_parse_stream *s, int c)
+{
+	size_t size;
+	char *val;
+
+	if (s->val_len == s->val_size) {
+		size = s->val_size ? s->val_size * 2 : sizeof(s->buf);
+		val = realloc(s->val, size);
+		if (val == NULL)
+			return -1;
+
+		s->val = val;
+		s->val_size = size;
+	}
+	s->val[s->val_len++] = c;
+
+	return 0;
+}
@@ -0,0 +1,383 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#define _GNU_SOURCE	/* recvmmsg */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netlink.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/gen.h>
+#include <libnftnl/trace.h>
+#include <libnftnl/event.h>
+
+#include "set.h"
+
+struct nftnl_event_handler {
+	nftnl_event_cb		cb;
+	void			*data;
+	void			*obj;
+};
+
+/*
+ * Datagrams of one recvmmsg() call stay in the buffers until all of them
+ * are dispatched, so a handler stopping the loop does not lose the rest.
+ */
+struct nftnl_event_loop {
+	int			fd;
+	unsigned int		nbufs;
+	size_t			bufsiz;
+	char			*bufs;
+	struct iovec		*iov;
+	struct sockaddr_nl	*addr;
+	struct mmsghdr		*msgs;
+	unsigned int		count;
+	unsigned int		next;
+	size_t			off;
+	uint64_t		overruns;
+	struct nftnl_event_handler handler[__NFTNL_EVENT_MAX];
+};
+
+struct nftnl_event_loop *nftnl_event_loop_alloc(int fd, unsigned int nbufs,
+						size_t bufsiz)
+{
+	struct nftnl_event_loop *l;
+
+	if (nbufs == 0) {
+		errno = EINVAL;
+		return NULL;
+	}
+	if (bufsiz == 0)
+		bufsiz = MNL_SOCKET_BUFFER_SIZE;
+
+	l = calloc(1, sizeof(struct nftnl_event_loop));
+	if (l == NULL)
+		return NULL;
+
+	l->fd = fd;
+	l->nbufs = nbufs;
+	l->bufsiz = bufsiz;
+
+	l->bufs = malloc(nbufs * bufsiz);
+	if (l->bufs == NULL)
+		goto err;
+	l->iov = calloc(nbufs, sizeof(struct iovec));
+	if (l->iov == NULL)
+		goto err;
+	l->addr = calloc(nbufs, sizeof(struct sockaddr_nl));
+	if (l->addr == NULL)
+		goto err;
+	l->msgs = calloc(nbufs, sizeof(struct mmsghdr));
+	if (l->msgs == NULL)
+		goto err;
+
+	return l;
+err:
+	nftnl_event_loop_free(l);
+	return NULL;
+}
+EXPORT_SYMBOL(nftnl_event_loop_alloc);
+
+static void nftnl_event_obj_free(enum nftnl_event_type type, void *obj)
+{
+	if (obj == NULL)
+		return;
+
+	switch (type) {
+	case NFTNL_EVENT_TABLE:
+		nftnl_table_free(obj);
+		break;
+	case NFTNL_EVENT_CHAIN:
+		nftnl_chain_free(obj);
+		break;
+	case NFTNL_EVENT_RULE:
+		nftnl_rule_free(obj);
+		break;
+	case NFTNL_EVENT_SET:
+	case NFTNL_EVENT_SETELEM:
+		nftnl_set_free(obj);
+		break;
+	case NFTNL_EVENT_GEN:
+		nftnl_gen_free(obj);
+		break;
+	case NFTNL_EVENT_TRACE:
+		nftnl_trace_free(obj);
+		break;
+	case __NFTNL_EVENT_MAX:
+		break;
+	}
+}
+
+void nftnl_event_loop_free(struct nftnl_event_loop *l)
+{
+	int i;
+
+	for (i = 0; i <= NFTNL_EVENT_MAX; i++)
+		nftnl_event_obj_free(i, l->handler[i].obj);
+
+	xfree(l->msgs);
+	xfree(l->addr);
+	xfree(l->iov);
+	xfree(l->bufs);
+	xfree(l);
+}
+EXPORT_SYMBOL(nftnl_event_loop_free);
+
+static void *nftnl_event_obj_alloc(enum nftnl_event_type type)
+{
+	switch (type) {
+	case NFTNL_EVENT_TABLE:
+		return nftnl_table_alloc();
+	case NFTNL_EVENT_CHAIN:
+		return nftnl_chain_alloc();
+	case NFTNL_EVENT_RULE:
+		return nftnl_rule_alloc();
+	case NFTNL_EVENT_SET:
+	case NFTNL_EVENT_SETELEM:
+		return nftnl_set_alloc();
+	case NFTNL_EVENT_GEN:
+		return nftnl_gen_alloc();
+	case NFTNL_EVENT_TRACE:
+		return nftnl_trace_alloc();
+	case __NFTNL_EVENT_MAX:
+		break;
+	}
+
+	errno = EINVAL;
+	return NULL;
+}
+
+/* Passing a NULL callback unregisters the handler */
+int nftnl_event_loop_register(struct nftnl_event_loop *l,
+			      enum nftnl_event_type type,
+			      nftnl_event_cb cb, void *data)
+{
+	struct nftnl_event_handler *h;
+
+	if (type > NFTNL_EVENT_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	h = &l->handler[type];
+
+	if (cb != NULL && h->obj == NULL) {
+		h->obj = nftnl_event_obj_alloc(type);
+		if (h->obj == NULL)
+			return -1;
+	}
+	h->cb = cb;
+	h->data = data;
+
+	return 0;
+}
+EXPORT_SYMBOL(nftnl_event_loop_register);
+
+uint64_t nftnl_event_loop_overruns(const struct nftnl_event_loop *l)
+{
+	return l->overruns;
+}
+EXPORT_SYMBOL(nftnl_event_loop_overruns);
+
+static int nftnl_event_msg_type(uint32_t event)
+{
+	switch (event) {
+	case NFT_MSG_NEWTABLE:
+	case NFT_MSG_DELTABLE:
+		return NFTNL_EVENT_TABLE;
+	case NFT_MSG_NEWCHAIN:
+	case NFT_MSG_DELCHAIN:
+		return NFTNL_EVENT_CHAIN;
+	case NFT_MSG_NEWRULE:
+	case NFT_MSG_DELRULE:
+		return NFTNL_EVENT_RULE;
+	case NFT_MSG_NEWSET:
+	case NFT_MSG_DELSET:
+		return NFTNL_EVENT_SET;
+	case NFT_MSG_NEWSETELEM:
+	case NFT_MSG_DELSETELEM:
+		return NFTNL_EVENT_SETELEM;
+	case NFT_MSG_NEWGEN:
+		return NFTNL_EVENT_GEN;
+	case NFT_MSG_TRACE:
+		return NFTNL_EVENT_TRACE;
+	}
+
+	return -1;
+}
+
+static void nftnl_event_gen_reset(struct nftnl_gen *gen)
+{
+	uint16_t attr;
+
+	for (attr = 0; attr <= NFTNL_GEN_MAX; attr++)
+		nftnl_gen_unset(gen, attr);
+}
+
+/* Objects are reset first, parsing accumulates attributes and lists */
+static int nftnl_event_parse(const struct nlmsghdr *nlh, int type, void *obj)
+{
+	switch (type) {
+	case NFTNL_EVENT_TABLE:
+		nftnl_table_reset(obj);
+		return nftnl_table_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_CHAIN:
+		nftnl_chain_reset(obj);
+		return nftnl_chain_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_RULE:
+		nftnl_rule_reset(obj);
+		return nftnl_rule_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_SET:
+		nftnl_set_reset(obj);
+		return nftnl_set_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_SETELEM:
+		nftnl_set_reset(obj);
+		return nftnl_set_elems_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_GEN:
+		nftnl_event_gen_reset(obj);
+		return nftnl_gen_nlmsg_parse(nlh, obj);
+	case NFTNL_EVENT_TRACE:
+		/* Only valid until the buffers are refilled */
+		return nftnl_trace_nlmsg_parse_view(nlh, obj);
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int nftnl_event_msg(struct nftnl_event_loop *l,
+			   const struct nlmsghdr *nlh)
+{
+	struct nftnl_event_handler *h;
+	uint32_t event;
+	int type;
+
+	if (nlh->nlmsg_type == NLMSG_ERROR) {
+		const struct nlmsgerr *err = mnl_nlmsg_get_payload(nlh);
+
+		if (nlh->nlmsg_len < mnl_nlmsg_size(sizeof(*err))) {
+			errno = EBADMSG;
+			return MNL_CB_ERROR;
+		}
+		if (err->error == 0)
+			return MNL_CB_OK;
+
+		errno = err->error < 0 ? -err->error : err->error;
+		return MNL_CB_ERROR;
+	}
+
+	if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES)
+		return MNL_CB_OK;
+
+	event = NFNL_MSG_TYPE(nlh->nlmsg_type);
+	type = nftnl_event_msg_type(event);
+	if (type < 0)
+		return MNL_CB_OK;
+
+	h = &l->handler[type];
+	if (h->cb == NULL)
+		return MNL_CB_OK;
+
+	if (nftnl_event_parse(nlh, type, h->obj) < 0)
+		return MNL_CB_ERROR;
+
+	return h->cb(nlh, event, h->obj, h->data);
+}
+
+static int nftnl_event_loop_dispatch(struct nftnl_event_loop *l)
+{
+	const struct nlmsghdr *nlh;
+	struct mmsghdr *msg;
+	int len, ret;
+
+	for (; l->next < l->count; l->next++, l->off = 0) {
+		msg = &l->msgs[l->next];
+
+		/* Ignore datagrams that do not come from the kernel */
+		if (msg->msg_hdr.msg_namelen == sizeof(struct sockaddr_nl) &&
+		    l->addr[l->next].nl_pid != 0)
+			continue;
+
+		if ((msg->msg_hdr.msg_flags & MSG_TRUNC) && l->off == 0) {
+			l->off = msg->msg_len;
+			errno = ENOSPC;
+			return MNL_CB_ERROR;
+		}
+
+		len = msg->msg_len - l->off;
+		nlh = (struct nlmsghdr *)(l->bufs + l->next * l->bufsiz +
+					  l->off);
+		while (mnl_nlmsg_ok(nlh, len)) {
+			ret = nftnl_event_msg(l, nlh);
+			nlh = mnl_nlmsg_next(nlh, &len);
+			l->off = msg->msg_len - len;
+			if (ret <= MNL_CB_STOP)
+				return ret;
+		}
+	}
+
+	return MNL_CB_OK;
+}
+
+/*
+ * nftnl_event_loop_run - receive and dispatch one batch of events
+ *
+ * Blocks until at least one datagram is available, then picks up as many
+ * as the loop has buffers for in a single recvmmsg() call and hands every
+ * message to its handler. Datagrams left over because a handler returned
+ * MNL_CB_STOP or a message failed to parse are dispatched on the next call
+ * instead of reading the socket.
+ *
+ * Returns MNL_CB_OK, MNL_CB_STOP if a handler asked to stop, or -1 with
+ * errno set. ENOBUFS means the kernel dropped events because the socket
+ * receive buffer overran, the caller has to dump its state again.
+ */
+int nftnl_event_loop_run(struct nftnl_event_loop *l)
+{
+	unsigned int i;
+	int n;
+
+	if (l->next < l->count)
+		return nftnl_event_loop_dispatch(l);
+
+	for (i = 0; i < l->nbufs; i++) {
+		l->iov[i].iov_base = l->bufs + i * l->bufsiz;
+		l->iov[i].iov_len = l->bufsiz;
+		l->msgs[i].msg_hdr.msg_name = &l->addr[i];
+		l->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_nl);
+		l->msgs[i].msg_hdr.msg_iov = &l->iov[i];
+		l->msgs[i].msg_hdr.msg_iovlen = 1;
+		l->msgs[i].msg_hdr.msg_control = NULL;
+		l->msgs[i].msg_hdr.msg_controllen = 0;
+		l->msgs[i].msg_hdr.msg_flags = 0;
+	}
+
+	l->count = l->next = 0;
+	l->off = 0;
+
+	n = recvmmsg(l->fd, l->msgs, l->nbufs, MSG_WAITFORONE, NULL);
+	if (n < 0) {
+		if (errno == ENOBUFS)
+			l->overruns++;
+		return -1;
+	}
+	l->count = n;
+
+	return nftnl_event_loop_dispatch(l);
+}
+EXPORT_SYMBOL(nftnl_event_loop_run);
@@ -40,6 +40,7 @@ struct nftnl_expr *nftnl_expr_alloc(const char *name)
 	/* Manually set expression name attribute */
 	expr->flags |= (1 << NFTNL_EXPR_NAME);
 	expr->ops = ops;
+	nftnl_stats_obj_add(NFTNL_STATS_EXPR, NFTNL_STATS_OBJ_ALLOC, 1);
 
 	return expr;
 }
@@ -50,10 +51,28 @@ void nftnl_expr_free(struct nftnl_expr *expr)
 	if (expr->ops->free)
 		expr->ops->free(expr);
 
+	nftnl_stats_obj_add(NFTNL_STATS_EXPR, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(expr);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_expr_free, nft_rule_expr_free);
 
+/*
+ * nftnl_expr_memsize - heap memory held by an expression
+ *
+ * Like all *_memsize() functions, this sums up the sizes requested from the
+ * allocator, not what the allocator adds on top of them.
+ */
+EXPORT_SYMBOL(nftnl_expr_memsize);
+size_t nftnl_expr_memsize(const struct nftnl_expr *expr)
+{
+	size_t size = sizeof(struct nftnl_expr) + expr->ops->alloc_len;
+
+	if (expr->ops->memsize)
+		size += expr->ops->memsize(expr);
+
+	return size;
+}
+
 bool nftnl_expr_is_set(const struct nftnl_expr *expr, uint16_t type)
 {
 	return expr->flags & (1 << type);
@@ -207,12 +226,15 @@ void
 nftnl_expr_build_payload(struct nlmsghdr *nlh, struct nftnl_expr *expr)
 {
 	struct nlattr *nest;
+	uint64_t start;
 
 	mnl_attr_put_strz(nlh, NFTA_EXPR_NAME, expr->ops->name);
 
+	start = nftnl_stats_now();
 	nest = mnl_attr_nest_start(nlh, NFTA_EXPR_DATA);
 	expr->ops->build(nlh, expr);
 	mnl_attr_nest_end(nlh, nest);
+	nftnl_stats_expr(expr->ops, NFTNL_STATS_EXPR_BUILD_CALLS, start);
 }
 
 static int nftnl_rule_parse_expr_cb(const struct nlattr *attr, void *data)
@@ -242,6 +264,10 @@ struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr)
 {
 	struct nlattr *tb[NFTA_EXPR_MAX+1] = {};
 	struct nftnl_expr *expr;
+	uint64_t start;
+	int ret;
+
+	NFTNL_PROBE1(expr_parse_entry, mnl_attr_get_payload_len(attr));
 
 	if (mnl_attr_parse_nested(attr, nftnl_rule_parse_expr_cb, tb) < 0)
 		goto err1;
@@ -250,18 +276,51 @@ struct nftnl_expr *nftnl_expr_parse(struct nlattr *attr)
 	if (expr == NULL)
 		goto err1;
 
-	if (tb[NFTA_EXPR_DATA] &&
-	    expr->ops->parse(expr, tb[NFTA_EXPR_DATA]) < 0)
-		goto err2;
+	if (tb[NFTA_EXPR_DATA]) {
+		start = nftnl_stats_now();
+		ret = expr->ops->parse(expr, tb[NFTA_EXPR_DATA]);
+		nftnl_stats_expr(expr->ops, NFTNL_STATS_EXPR_PARSE_CALLS,
+				 start);
+		if (ret < 0)
+			goto err2;
+	}
 
+	NFTNL_PROBE2(expr_parse_return, expr, 0);
 	return expr;
 
 err2:
+	nftnl_stats_obj_add(NFTNL_STATS_EXPR, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(expr);
 err1:
+	NFTNL_PROBE2(expr_parse_return, NULL, -1);
 	return NULL;
 }
 
+/*
+ * Expression data is copied as it is, expression types that own strings or
+ * blobs replace them by copies of their own in their clone hook. If that
+ * fails, they leave NULL behind, so the copy can be freed as usual.
+ */
+struct nftnl_expr *nftnl_expr_clone(const struct nftnl_expr *expr)
+{
+	struct nftnl_expr *newexpr;
+
+	newexpr = malloc(sizeof(struct nftnl_expr) + expr->ops->alloc_len);
+	if (newexpr == NULL)
+		return NULL;
+
+	memcpy(newexpr, expr, sizeof(struct nftnl_expr) + expr->ops->alloc_len);
+	INIT_LIST_HEAD(&newexpr->head);
+	nftnl_stats_obj_add(NFTNL_STATS_EXPR, NFTNL_STATS_OBJ_ALLOC, 1);
+
+	if (expr->ops->clone && expr->ops->clone(newexpr) < 0) {
+		nftnl_expr_free(newexpr);
+		return NULL;
+	}
+
+	return newexpr;
+}
+
 int nftnl_expr_snprintf(char *buf, size_t size, struct nftnl_expr *expr,
 			   uint32_t type, uint32_t flags)
 {
@@ -184,14 +184,83 @@ err:
 }
 #endif
 
+/* Values up to four words cover ports, marks and IPv4/IPv6 addresses. Their
+ * longest rendering is XML, 25 bytes per word plus 37 bytes of framing.
+ */
+#define NFTNL_DATA_REG_FAST_WORDS	4
+#define NFTNL_DATA_REG_FAST_STRLEN	160
+
+#define nftnl_data_reg_lit(p, str)				\
+	(memcpy(p, str, sizeof(str) - 1), (p) + sizeof(str) - 1)
+
+static char *nftnl_data_reg_hex32(char *p, uint32_t value)
+{
+	p = nftnl_data_reg_lit(p, "0x");
+	nftnl_fmt_hex32(p, 9, value);
+
+	return p + 8;
+}
+
+/* Format small values into a local buffer without any truncation checks,
+ * and copy the result out in one go.
+ */
+static int
+nftnl_data_reg_value_snprintf_fast(char *buf, size_t size,
+				   union nftnl_data_reg *reg,
+				   uint32_t output_format)
+{
+	char tmp[NFTNL_DATA_REG_FAST_STRLEN], *p = tmp;
+	int i, words = div_round_up(reg->len, sizeof(uint32_t));
+
+	switch (output_format) {
+	case NFTNL_OUTPUT_DEFAULT:
+		for (i = 0; i < words; i++) {
+			p = nftnl_data_reg_hex32(p, reg->val[i]);
+			*p++ = ' ';
+		}
+		break;
+	case NFTNL_OUTPUT_XML:
+		p = nftnl_data_reg_lit(p, "<reg type=\"value\"><len>");
+		p += nftnl_fmt_u64(p, 3, reg->len);
+		p = nftnl_data_reg_lit(p, "</len>");
+		for (i = 0; i < words; i++) {
+			p = nftnl_data_reg_lit(p, "<data");
+			*p++ = '0' + i;
+			*p++ = '>';
+			p = nftnl_data_reg_hex32(p, reg->val[i]);
+			p = nftnl_data_reg_lit(p, "</data");
+			*p++ = '0' + i;
+			*p++ = '>';
+		}
+		p = nftnl_data_reg_lit(p, "</reg>");
+		break;
+	case NFTNL_OUTPUT_JSON:
+		p = nftnl_data_reg_lit(p, "\"reg\":{\"type\":\"value\",\"len\":");
+		p += nftnl_fmt_u64(p, 3, reg->len);
+		*p++ = ',';
+		for (i = 0; i < words; i++) {
+			p = nftnl_data_reg_lit(p, "\"data");
+			*p++ = '0' + i;
+			p = nftnl_data_reg_lit(p, "\":\"");
+			p = nftnl_data_reg_hex32(p, reg->val[i]);
+			p = nftnl_data_reg_lit(p, "\",");
+		}
+		/* Replace the trailing comma */
+		p[-1] = '}';
+		break;
+	default:
+		return -1;
+	}
+
+	return nftnl_fmt_mem(buf, size, tmp, p - tmp);
+}
+
 static int
 nftnl_data_reg_value_snprintf_json(char *buf, size_t size,
 					   union nftnl_data_reg *reg,
 					   uint32_t flags)
 {
-	int len = size, offset = 0, ret, i, j;
-	uint32_t utemp;
-	uint8_t *tmp;
+	int len = size, offset = 0, ret, i;
 
 	ret = snprintf(buf, len, "\"reg\":{\"type\":\"value\",");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -200,18 +269,19 @@ nftnl_data_reg_value_snprintf_json(char *buf, size_t size,
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
 	for (i = 0; i < div_round_up(reg->len, sizeof(uint32_t)); i++) {
-		ret = snprintf(buf+offset, len, "\"data%d\":\"0x", i);
+		ret = nftnl_fmt_str(buf+offset, len, "\"data");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		utemp = htonl(reg->val[i]);
-		tmp = (uint8_t *)&utemp;
+		ret = nftnl_fmt_u64(buf+offset, len, i);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		for (j = 0; j<sizeof(uint32_t); j++) {
-			ret = snprintf(buf+offset, len, "%.02x", tmp[j]);
-			SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
-		}
+		ret = nftnl_fmt_str(buf+offset, len, "\":\"0x");
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		ret = snprintf(buf+offset, len, "\",");
+		ret = nftnl_fmt_hex32(buf+offset, len, reg->val[i]);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_str(buf+offset, len, "\",");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 	offset--;
@@ -225,9 +295,7 @@ static
 int nftnl_data_reg_value_snprintf_xml(char *buf, size_t size,
 				    union nftnl_data_reg *reg, uint32_t flags)
 {
-	int len = size, offset = 0, ret, i, j;
-	uint32_t be;
-	uint8_t *tmp;
+	int len = size, offset = 0, ret, i;
 
 	ret = snprintf(buf, len, "<reg type=\"value\">");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -236,18 +304,25 @@ int nftnl_data_reg_value_snprintf_xml(char *buf, size_t size,
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
 	for (i = 0; i < div_round_up(reg->len, sizeof(uint32_t)); i++) {
-		ret = snprintf(buf+offset, len, "<data%d>0x", i);
+		ret = nftnl_fmt_str(buf+offset, len, "<data");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		be = htonl(reg->val[i]);
-		tmp = (uint8_t *)&be;
+		ret = nftnl_fmt_u64(buf+offset, len, i);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		for (j = 0; j < sizeof(uint32_t); j++) {
-			ret = snprintf(buf+offset, len, "%.02x", tmp[j]);
-			SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
-		}
+		ret = nftnl_fmt_str(buf+offset, len, ">0x");
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-		ret = snprintf(buf+offset, len, "</data%d>", i);
+		ret = nftnl_fmt_hex32(buf+offset, len, reg->val[i]);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_str(buf+offset, len, "</data");
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_u64(buf+offset, len, i);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_str(buf+offset, len, ">");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
@@ -264,7 +339,13 @@ nftnl_data_reg_value_snprintf_default(char *buf, size_t size,
 	int len = size, offset = 0, ret, i;
 
 	for (i = 0; i < div_round_up(reg->len, sizeof(uint32_t)); i++) {
-		ret = snprintf(buf+offset, len, "0x%.8x ", reg->val[i]);
+		ret = nftnl_fmt_str(buf+offset, len, "0x");
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_hex32(buf+offset, len, reg->val[i]);
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+		ret = nftnl_fmt_str(buf+offset, len, " ");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
@@ -332,11 +413,137 @@ nftnl_data_reg_verdict_snprintf_json(char *buf, size_t size,
 	return offset;
 }
 
+static int
+nftnl_data_reg_verdict_snprintf(char *buf, size_t size,
+				union nftnl_data_reg *reg,
+				uint32_t output_format, uint32_t flags)
+{
+	switch(output_format) {
+	case NFTNL_OUTPUT_DEFAULT:
+		return nftnl_data_reg_verdict_snprintf_def(buf, size,
+							 reg, flags);
+	case NFTNL_OUTPUT_XML:
+		return nftnl_data_reg_verdict_snprintf_xml(buf, size,
+							 reg, flags);
+	case NFTNL_OUTPUT_JSON:
+		return nftnl_data_reg_verdict_snprintf_json(buf, size,
+							  reg, flags);
+	default:
+		break;
+	}
+
+	return -1;
+}
+
+#define NFTNL_DATA_REG_MEMO_SLOTS	64
+#define NFTNL_DATA_REG_MEMO_STRLEN	128
+
+struct nftnl_data_reg_memo_slot {
+	uint32_t	hash;
+	uint32_t	output_format;
+	int		verdict;
+	bool		has_chain;
+	char		chain[NFT_CHAIN_MAXNAMELEN];
+	uint16_t	len;
+	char		str[NFTNL_DATA_REG_MEMO_STRLEN];
+};
+
+/* Verdict maps usually jump to a handful of chains, so the rendering of
+ * each verdict and chain pair is kept around for the rest of the export.
+ */
+struct nftnl_data_reg_memo {
+	struct nftnl_data_reg_memo_slot	slot[NFTNL_DATA_REG_MEMO_SLOTS];
+};
+
+static __thread struct nftnl_data_reg_memo *nftnl_data_reg_memo_cur;
+
+struct nftnl_data_reg_memo *nftnl_data_reg_memo_alloc(void)
+{
+	return calloc(1, sizeof(struct nftnl_data_reg_memo));
+}
+
+void nftnl_data_reg_memo_free(struct nftnl_data_reg_memo *memo)
+{
+	xfree(memo);
+}
+
+/* Make memo the cache for this thread, returns the one it replaces. */
+struct nftnl_data_reg_memo *
+nftnl_data_reg_memo_swap(struct nftnl_data_reg_memo *memo)
+{
+	struct nftnl_data_reg_memo *prev = nftnl_data_reg_memo_cur;
+
+	nftnl_data_reg_memo_cur = memo;
+	return prev;
+}
+
+static uint32_t nftnl_data_reg_memo_hash(uint32_t output_format, int verdict,
+					 const char *chain, size_t len)
+{
+	uint32_t hash = 2166136261U;
+	size_t i;
+
+	hash = (hash ^ output_format) * 16777619U;
+	hash = (hash ^ (uint32_t)verdict) * 16777619U;
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (uint8_t)chain[i]) * 16777619U;
+
+	return hash;
+}
+
+static int
+nftnl_data_reg_verdict_snprintf_memo(char *buf, size_t size,
+				     union nftnl_data_reg *reg,
+				     uint32_t output_format, uint32_t flags)
+{
+	struct nftnl_data_reg_memo *memo = nftnl_data_reg_memo_cur;
+	struct nftnl_data_reg_memo_slot *slot;
+	const char *chain = reg->chain ? reg->chain : "";
+	size_t len = strlen(chain);
+	uint32_t hash;
+	int ret;
+
+	if (memo == NULL || len >= NFT_CHAIN_MAXNAMELEN)
+		return nftnl_data_reg_verdict_snprintf(buf, size, reg,
+						       output_format, flags);
+
+	hash = nftnl_data_reg_memo_hash(output_format, reg->verdict,
+					chain, len);
+	slot = &memo->slot[hash % NFTNL_DATA_REG_MEMO_SLOTS];
+	if (slot->len > 0 && slot->hash == hash &&
+	    slot->output_format == output_format &&
+	    slot->verdict == reg->verdict &&
+	    slot->has_chain == (reg->chain != NULL) &&
+	    memcmp(slot->chain, chain, len + 1) == 0)
+		return nftnl_fmt_mem(buf, size, slot->str, slot->len);
+
+	ret = nftnl_data_reg_verdict_snprintf(slot->str, sizeof(slot->str),
+					      reg, output_format, flags);
+	if (ret <= 0 || ret >= sizeof(slot->str)) {
+		slot->len = 0;
+		return nftnl_data_reg_verdict_snprintf(buf, size, reg,
+						       output_format, flags);
+	}
+
+	slot->hash = hash;
+	slot->output_format = output_format;
+	slot->verdict = reg->verdict;
+	slot->has_chain = reg->chain != NULL;
+	memcpy(slot->chain, chain, len + 1);
+	slot->len = ret;
+
+	return nftnl_fmt_mem(buf, size, slot->str, ret);
+}
+
 int nftnl_data_reg_snprintf(char *buf, size_t size, union nftnl_data_reg *reg,
 			  uint32_t output_format, uint32_t flags, int reg_type)
 {
 	switch(reg_type) {
 	case DATA_VALUE:
+		if (reg->len <= NFTNL_DATA_REG_FAST_WORDS * sizeof(uint32_t))
+			return nftnl_data_reg_value_snprintf_fast(buf, size,
+							reg, output_format);
+
 		switch(output_format) {
 		case NFTNL_OUTPUT_DEFAULT:
 			return nftnl_data_reg_value_snprintf_default(buf, size,
@@ -352,19 +559,9 @@ int nftnl_data_reg_snprintf(char *buf, size_t size, union nftnl_data_reg *reg,
 		}
 	case DATA_VERDICT:
 	case DATA_CHAIN:
-		switch(output_format) {
-		case NFTNL_OUTPUT_DEFAULT:
-			return nftnl_data_reg_verdict_snprintf_def(buf, size,
-								 reg, flags);
-		case NFTNL_OUTPUT_XML:
-			return nftnl_data_reg_verdict_snprintf_xml(buf, size,
-								 reg, flags);
-		case NFTNL_OUTPUT_JSON:
-			return nftnl_data_reg_verdict_snprintf_json(buf, size,
-								  reg, flags);
-		default:
-			break;
-		}
+		return nftnl_data_reg_verdict_snprintf_memo(buf, size, reg,
+							    output_format,
+							    flags);
 	default:
 		break;
 	}
@@ -510,3 +707,30 @@ void nftnl_free_verdict(union nftnl_data_reg *data)
 		break;
 	}
 }
+
+size_t nftnl_verdict_memsize(const union nftnl_data_reg *data)
+{
+	switch(data->verdict) {
+	case NFT_JUMP:
+	case NFT_GOTO:
+		return nftnl_strsize(data->chain);
+	default:
+		return 0;
+	}
+}
+
+/* Give a copied verdict a chain name of its own */
+int nftnl_verdict_clone(union nftnl_data_reg *data)
+{
+	switch(data->verdict) {
+	case NFT_JUMP:
+	case NFT_GOTO:
+		if (data->chain == NULL)
+			return 0;
+
+		data->chain = strdup(data->chain);
+		return data->chain ? 0 : -1;
+	default:
+		return 0;
+	}
+}
@@ -317,11 +317,33 @@ static void nftnl_expr_immediate_free(struct nftnl_expr *e)
 		nftnl_free_verdict(&imm->data);
 }
 
+static size_t nftnl_expr_immediate_memsize(const struct nftnl_expr *e)
+{
+	struct nftnl_expr_immediate *imm = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_IMM_VERDICT))
+		return nftnl_verdict_memsize(&imm->data);
+
+	return 0;
+}
+
+static int nftnl_expr_immediate_clone(struct nftnl_expr *e)
+{
+	struct nftnl_expr_immediate *imm = nftnl_expr_data(e);
+
+	if (e->flags & (1 << NFTNL_EXPR_IMM_VERDICT))
+		return nftnl_verdict_clone(&imm->data);
+
+	return 0;
+}
+
 struct expr_ops expr_ops_immediate = {
 	.name		= "immediate",
 	.alloc_len	= sizeof(struct nftnl_expr_immediate),
 	.max_attr	= NFTA_IMMEDIATE_MAX,
 	.free		= nftnl_expr_immediate_free,
+	.memsize	= nftnl_expr_immediate_memsize,
+	.clone		= nftnl_expr_immediate_clone,
 	.set		= nftnl_expr_immediate_set,
 	.get		= nftnl_expr_immediate_get,
 	.parse		= nftnl_expr_immediate_parse,
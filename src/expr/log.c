@@ -332,11 +332,31 @@ static void nftnl_expr_log_free(struct nftnl_expr *e)
 	xfree(log->prefix);
 }
 
+static size_t nftnl_expr_log_memsize(const struct nftnl_expr *e)
+{
+	struct nftnl_expr_log *log = nftnl_expr_data(e);
+
+	return nftnl_strsize(log->prefix);
+}
+
+static int nftnl_expr_log_clone(struct nftnl_expr *e)
+{
+	struct nftnl_expr_log *log = nftnl_expr_data(e);
+
+	if (log->prefix == NULL)
+		return 0;
+
+	log->prefix = strdup(log->prefix);
+	return log->prefix ? 0 : -1;
+}
+
 struct expr_ops expr_ops_log = {
 	.name		= "log",
 	.alloc_len	= sizeof(struct nftnl_expr_log),
 	.max_attr	= NFTA_LOG_MAX,
 	.free		= nftnl_expr_log_free,
+	.memsize	= nftnl_expr_log_memsize,
+	.clone		= nftnl_expr_log_clone,
 	.set		= nftnl_expr_log_set,
 	.get		= nftnl_expr_log_get,
 	.parse		= nftnl_expr_log_parse,
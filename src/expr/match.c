@@ -240,11 +240,36 @@ static void nftnl_expr_match_free(struct nftnl_expr *e)
 	xfree(match->data);
 }
 
+static size_t nftnl_expr_match_memsize(const struct nftnl_expr *e)
+{
+	struct nftnl_expr_match *match = nftnl_expr_data(e);
+
+	return match->data ? match->data_len : 0;
+}
+
+static int nftnl_expr_match_clone(struct nftnl_expr *e)
+{
+	struct nftnl_expr_match *match = nftnl_expr_data(e);
+	void *data;
+
+	if (match->data == NULL)
+		return 0;
+
+	data = malloc(match->data_len);
+	if (data != NULL)
+		memcpy(data, match->data, match->data_len);
+
+	match->data = data;
+	return data ? 0 : -1;
+}
+
 struct expr_ops expr_ops_match = {
 	.name		= "match",
 	.alloc_len	= sizeof(struct nftnl_expr_match),
 	.max_attr	= NFTA_MATCH_MAX,
 	.free		= nftnl_expr_match_free,
+	.memsize	= nftnl_expr_match_memsize,
+	.clone		= nftnl_expr_match_clone,
 	.set		= nftnl_expr_match_set,
 	.get		= nftnl_expr_match_get,
 	.parse		= nftnl_expr_match_parse,
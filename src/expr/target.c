@@ -241,11 +241,36 @@ static void nftnl_expr_target_free(struct nftnl_expr *e)
 	xfree(target->data);
 }
 
+static size_t nftnl_expr_target_memsize(const struct nftnl_expr *e)
+{
+	struct nftnl_expr_target *target = nftnl_expr_data(e);
+
+	return target->data ? target->data_len : 0;
+}
+
+static int nftnl_expr_target_clone(struct nftnl_expr *e)
+{
+	struct nftnl_expr_target *target = nftnl_expr_data(e);
+	void *data;
+
+	if (target->data == NULL)
+		return 0;
+
+	data = malloc(target->data_len);
+	if (data != NULL)
+		memcpy(data, target->data, target->data_len);
+
+	target->data = data;
+	return data ? 0 : -1;
+}
+
 struct expr_ops expr_ops_target = {
 	.name		= "target",
 	.alloc_len	= sizeof(struct nftnl_expr_target),
 	.max_attr	= NFTA_TARGET_MAX,
 	.free		= nftnl_expr_target_free,
+	.memsize	= nftnl_expr_target_memsize,
+	.clone		= nftnl_expr_target_clone,
 	.set		= nftnl_expr_target_set,
 	.get		= nftnl_expr_target_get,
 	.parse		= nftnl_expr_target_parse,
@@ -65,3 +65,26 @@ struct expr_ops *nftnl_expr_ops_lookup(const char *name)
 	}
 	return NULL;
 }
+
+/* Position of @ops in the table above, -1 if it is not registered there */
+int nftnl_expr_ops_index(const struct expr_ops *ops)
+{
+	int i;
+
+	for (i = 0; expr_ops[i] != NULL; i++) {
+		if (expr_ops[i] == ops)
+			return i;
+	}
+	return -1;
+}
+
+struct expr_ops *nftnl_expr_ops_get(unsigned int index)
+{
+	unsigned int i;
+
+	for (i = 0; expr_ops[i] != NULL; i++) {
+		if (i == index)
+			return expr_ops[i];
+	}
+	return NULL;
+}
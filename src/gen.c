@@ -18,6 +18,7 @@
 #include <errno.h>
 
 #include <libmnl/libmnl.h>
+#include <linux/netlink.h>
 #include <linux/netfilter/nfnetlink.h>
 #include <linux/netfilter/nf_tables.h>
 
@@ -31,12 +32,19 @@ struct nftnl_gen {
 
 struct nftnl_gen *nftnl_gen_alloc(void)
 {
-	return calloc(1, sizeof(struct nftnl_gen));
+	struct nftnl_gen *gen;
+
+	gen = calloc(1, sizeof(struct nftnl_gen));
+	if (gen != NULL)
+		nftnl_stats_obj_add(NFTNL_STATS_GEN, NFTNL_STATS_OBJ_ALLOC, 1);
+
+	return gen;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_gen_alloc, nft_gen_alloc);
 
 void nftnl_gen_free(struct nftnl_gen *gen)
 {
+	nftnl_stats_obj_add(NFTNL_STATS_GEN, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(gen);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_gen_free, nft_gen_free);
@@ -145,6 +153,9 @@ int nftnl_gen_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_gen *gen)
 	struct nlattr *tb[NFTA_GEN_MAX + 1] = {};
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
 
+	nftnl_stats_obj_msg(NFTNL_STATS_GEN, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
 	if (mnl_attr_parse(nlh, sizeof(*nfg), nftnl_gen_parse_attr_cb, tb) < 0)
 		return -1;
 
@@ -206,3 +217,277 @@ int nftnl_gen_fprintf(FILE *fp, struct nftnl_gen *gen, uint32_t type,
 			   nftnl_gen_do_snprintf);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_gen_fprintf, nft_gen_fprintf);
+
+EXPORT_SYMBOL(nftnl_gen_export);
+int nftnl_gen_export(struct nftnl_sink *s, struct nftnl_gen *gen, uint32_t type,
+		     uint32_t flags)
+{
+	return nftnl_sink_printf(s, gen, NFTNL_CMD_UNSPEC, type, flags,
+				 nftnl_gen_do_snprintf);
+}
+
+/* Maximum number of times the dump is restarted if the generation changes
+ * while we are still dumping.
+ */
+#define NFTNL_GEN_DUMP_RETRIES	8
+
+/* The generation is requested before and after the object dumps */
+enum {
+	NFTNL_GEN_DUMP_GEN_BEFORE	= 0,
+	NFTNL_GEN_DUMP_TABLES,
+	NFTNL_GEN_DUMP_CHAINS,
+	NFTNL_GEN_DUMP_SETS,
+	NFTNL_GEN_DUMP_RULES,
+	NFTNL_GEN_DUMP_GEN_AFTER,
+};
+
+static const uint16_t nftnl_gen_dump_cmds[] = {
+	[NFTNL_GEN_DUMP_GEN_BEFORE]	= NFT_MSG_GETGEN,
+	[NFTNL_GEN_DUMP_TABLES]		= NFT_MSG_GETTABLE,
+	[NFTNL_GEN_DUMP_CHAINS]		= NFT_MSG_GETCHAIN,
+	[NFTNL_GEN_DUMP_SETS]		= NFT_MSG_GETSET,
+	[NFTNL_GEN_DUMP_RULES]		= NFT_MSG_GETRULE,
+	[NFTNL_GEN_DUMP_GEN_AFTER]	= NFT_MSG_GETGEN,
+};
+
+struct nftnl_gen_dump_ctx {
+	uint16_t		family;
+	struct nftnl_gen	*gen;
+	int			(*cb)(const struct nlmsghdr *nlh, void *data);
+	void			(*restart_cb)(void *data);
+	void			*data;
+
+	struct nftnl_gen	before;
+	struct nftnl_gen	after;
+	uint32_t		seq;
+	int			stage;
+	int			retries;
+	bool			draining;
+};
+
+static void __nftnl_gen_dump_ctx_init(struct nftnl_gen_dump_ctx *ctx,
+				      uint16_t family, struct nftnl_gen *gen,
+				      int (*cb)(const struct nlmsghdr *nlh,
+						void *data),
+				      void (*restart_cb)(void *data),
+				      void *data)
+{
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->family = family;
+	ctx->gen = gen;
+	ctx->cb = cb;
+	ctx->restart_cb = restart_cb;
+	ctx->data = data;
+}
+
+EXPORT_SYMBOL(nftnl_gen_dump_ctx_alloc);
+struct nftnl_gen_dump_ctx *
+nftnl_gen_dump_ctx_alloc(uint16_t family, struct nftnl_gen *gen,
+			 int (*cb)(const struct nlmsghdr *nlh, void *data),
+			 void (*restart_cb)(void *data), void *data)
+{
+	struct nftnl_gen_dump_ctx *ctx;
+
+	ctx = malloc(sizeof(struct nftnl_gen_dump_ctx));
+	if (ctx == NULL)
+		return NULL;
+
+	__nftnl_gen_dump_ctx_init(ctx, family, gen, cb, restart_cb, data);
+	return ctx;
+}
+
+EXPORT_SYMBOL(nftnl_gen_dump_ctx_free);
+void nftnl_gen_dump_ctx_free(struct nftnl_gen_dump_ctx *ctx)
+{
+	xfree(ctx);
+}
+
+EXPORT_SYMBOL(nftnl_gen_dump_ctx_request);
+struct nlmsghdr *nftnl_gen_dump_ctx_request(struct nftnl_gen_dump_ctx *ctx,
+					    char *buf, uint32_t seq)
+{
+	uint16_t cmd = nftnl_gen_dump_cmds[ctx->stage];
+
+	ctx->seq = seq;
+
+	switch (ctx->stage) {
+	case NFTNL_GEN_DUMP_GEN_BEFORE:
+		ctx->before.flags = 0;
+		return nftnl_nlmsg_build_hdr(buf, cmd, AF_UNSPEC, 0, seq);
+	case NFTNL_GEN_DUMP_GEN_AFTER:
+		ctx->after.flags = 0;
+		return nftnl_nlmsg_build_hdr(buf, cmd, AF_UNSPEC, 0, seq);
+	default:
+		return nftnl_nlmsg_build_hdr(buf, cmd, ctx->family,
+					     NLM_F_DUMP, seq);
+	}
+}
+
+static int nftnl_gen_dump_getgen_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_gen *gen = data;
+
+	if (nftnl_gen_nlmsg_parse(nlh, gen) < 0)
+		return MNL_CB_ERROR;
+
+	return MNL_CB_STOP;
+}
+
+static bool nftnl_gen_dump_done(const void *buf, size_t size)
+{
+	const struct nlmsghdr *nlh = buf;
+	int len = size;
+
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (nlh->nlmsg_type == NLMSG_DONE ||
+		    nlh->nlmsg_type == NLMSG_ERROR)
+			return true;
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+	return false;
+}
+
+static int nftnl_gen_dump_restart(struct nftnl_gen_dump_ctx *ctx)
+{
+	if (++ctx->retries >= NFTNL_GEN_DUMP_RETRIES) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	if (ctx->restart_cb)
+		ctx->restart_cb(ctx->data);
+
+	ctx->stage = NFTNL_GEN_DUMP_GEN_BEFORE;
+	return NFTNL_GEN_DUMP_SEND;
+}
+
+static int nftnl_gen_dump_next(struct nftnl_gen_dump_ctx *ctx)
+{
+	switch (ctx->stage) {
+	case NFTNL_GEN_DUMP_GEN_BEFORE:
+		if (!(ctx->before.flags & (1 << NFTNL_GEN_ID))) {
+			errno = EPROTO;
+			return -1;
+		}
+		if (ctx->retries == 0 &&
+		    (ctx->gen->flags & (1 << NFTNL_GEN_ID)) &&
+		    ctx->gen->id == ctx->before.id)
+			return NFTNL_GEN_DUMP_UNCHANGED;
+		break;
+	case NFTNL_GEN_DUMP_GEN_AFTER:
+		if (!(ctx->after.flags & (1 << NFTNL_GEN_ID))) {
+			errno = EPROTO;
+			return -1;
+		}
+		if (ctx->before.id != ctx->after.id)
+			return nftnl_gen_dump_restart(ctx);
+
+		ctx->gen->id = ctx->after.id;
+		ctx->gen->flags |= (1 << NFTNL_GEN_ID);
+		return NFTNL_GEN_DUMP_UPDATED;
+	}
+
+	ctx->stage++;
+	return NFTNL_GEN_DUMP_SEND;
+}
+
+EXPORT_SYMBOL(nftnl_gen_dump_ctx_recv);
+int nftnl_gen_dump_ctx_recv(struct nftnl_gen_dump_ctx *ctx, const void *buf,
+			    size_t len, uint32_t portid)
+{
+	int ret;
+
+	/* Wait for the end of an interrupted dump, so that the next request
+	 * does not get the rest of it.
+	 */
+	if (ctx->draining) {
+		if (!nftnl_gen_dump_done(buf, len))
+			return NFTNL_GEN_DUMP_RECV;
+
+		ctx->draining = false;
+		return nftnl_gen_dump_restart(ctx);
+	}
+
+	switch (ctx->stage) {
+	case NFTNL_GEN_DUMP_GEN_BEFORE:
+		ret = mnl_cb_run(buf, len, ctx->seq, portid,
+				 nftnl_gen_dump_getgen_cb, &ctx->before);
+		break;
+	case NFTNL_GEN_DUMP_GEN_AFTER:
+		ret = mnl_cb_run(buf, len, ctx->seq, portid,
+				 nftnl_gen_dump_getgen_cb, &ctx->after);
+		break;
+	default:
+		ret = mnl_cb_run(buf, len, ctx->seq, portid, ctx->cb,
+				 ctx->data);
+
+		/* The kernel tells us that the ruleset has been updated while
+		 * dumping, libmnl bails out before the callback sees that
+		 * message. No point in dumping the remaining objects.
+		 */
+		if (ret < 0 && errno == EINTR) {
+			if (!nftnl_gen_dump_done(buf, len)) {
+				ctx->draining = true;
+				return NFTNL_GEN_DUMP_RECV;
+			}
+			return nftnl_gen_dump_restart(ctx);
+		}
+		break;
+	}
+
+	if (ret < 0)
+		return -1;
+	if (ret == MNL_CB_OK)
+		return NFTNL_GEN_DUMP_RECV;
+
+	return nftnl_gen_dump_next(ctx);
+}
+
+/*
+ * nftnl_gen_dump - dump tables, chains, sets and rules if the ruleset changed
+ *
+ * If @gen already holds a generation ID and the kernel still reports the
+ * same one, nothing is dumped and NFTNL_GEN_DUMP_UNCHANGED is returned.
+ * Otherwise, every NEW* message of the table, chain, set and rule dumps is
+ * passed to @cb, @gen is updated and NFTNL_GEN_DUMP_UPDATED is returned.
+ *
+ * If the generation changes while dumping, the whole dump is restarted and
+ * @restart_cb (if any) is called so the caller can discard the objects that
+ * it has collected so far. This function returns -1 and sets errno on
+ * failure, including EAGAIN if the ruleset keeps changing under our feet.
+ *
+ * Callers that run their own netlink I/O can drive the same steps through
+ * nftnl_gen_dump_ctx_request() and nftnl_gen_dump_ctx_recv().
+ */
+EXPORT_SYMBOL(nftnl_gen_dump);
+int nftnl_gen_dump(struct mnl_socket *nl, uint16_t family,
+		   struct nftnl_gen *gen,
+		   int (*cb)(const struct nlmsghdr *nlh, void *data),
+		   void (*restart_cb)(void *data), void *data)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_gen_dump_ctx ctx;
+	uint32_t seq = time(NULL);
+	struct nlmsghdr *nlh;
+	ssize_t len;
+	int ret;
+
+	__nftnl_gen_dump_ctx_init(&ctx, family, gen, cb, restart_cb, data);
+
+	do {
+		nlh = nftnl_gen_dump_ctx_request(&ctx, buf, seq++);
+		if (mnl_socket_sendto(nl, nlh, nlh->nlmsg_len) < 0)
+			return -1;
+
+		do {
+			len = mnl_socket_recvfrom(nl, buf, sizeof(buf));
+			if (len < 0)
+				return -1;
+
+			ret = nftnl_gen_dump_ctx_recv(&ctx, buf, len,
+						mnl_socket_get_portid(nl));
+		} while (ret == NFTNL_GEN_DUMP_RECV);
+	} while (ret == NFTNL_GEN_DUMP_SEND);
+
+	return ret;
+}
@@ -140,6 +140,158 @@ void nftnl_jansson_free_root(json_t *root)
 	json_decref(root);
 }
 
+/* Read the rest of a string whose opening quote was already consumed. Keys
+ * that do not fit are returned empty, none of them is valid anyway.
+ */
+int nftnl_jansson_stream_key(struct nftnl_parse_stream *s, char *key,
+			     size_t size)
+{
+	size_t len = 0;
+	int c;
+
+	for (;;) {
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF)
+			return -1;
+		if (c == '"')
+			break;
+		if (c == '\\') {
+			c = nftnl_parse_stream_getc(s);
+			if (c == EOF)
+				return -1;
+		}
+		if (len < size)
+			key[len] = c;
+		len++;
+	}
+
+	if (len >= size)
+		len = 0;
+	key[len] = '\0';
+
+	return 0;
+}
+
+/* Consume the value that starts with c, the caller has already read it. The
+ * value is only checked to be balanced, jansson validates it later on.
+ */
+static int nftnl_jansson_stream_value(struct nftnl_parse_stream *s, int c,
+				      bool store)
+{
+	bool string = false, escape = false;
+	int depth = 0;
+
+	for (;;) {
+		if (c == EOF) {
+			errno = EINVAL;
+			return -1;
+		}
+		if (store && nftnl_parse_stream_store(s, c) < 0)
+			return -1;
+
+		if (string) {
+			if (escape)
+				escape = false;
+			else if (c == '\\')
+				escape = true;
+			else if (c == '"') {
+				string = false;
+				if (depth == 0)
+					return 0;
+			}
+		} else {
+			switch (c) {
+			case '"':
+				string = true;
+				break;
+			case '{':
+			case '[':
+				depth++;
+				break;
+			case '}':
+			case ']':
+				if (--depth < 0) {
+					errno = EINVAL;
+					return -1;
+				}
+				if (depth == 0)
+					return 0;
+				break;
+			}
+		}
+
+		c = nftnl_parse_stream_getc(s);
+		if (depth > 0 || string)
+			continue;
+
+		/* Scalars end at the next delimiter, which is not ours */
+		switch (c) {
+		case ',':
+		case '}':
+		case ']':
+		case ' ':
+		case '\t':
+		case '\r':
+			nftnl_parse_stream_ungetc(s);
+			return 0;
+		case '\n':
+		case EOF:
+			return 0;
+		}
+	}
+}
+
+int nftnl_jansson_stream_skip(struct nftnl_parse_stream *s, int c)
+{
+	return nftnl_jansson_stream_value(s, c, false);
+}
+
+/* Copy the value that starts with c into the stream buffer, it is loaded
+ * later on through nftnl_jansson_load_slice().
+ */
+int nftnl_jansson_stream_slice(struct nftnl_parse_stream *s, int c,
+			       struct nftnl_parse_err *err)
+{
+	s->val_line = s->line;
+	s->val_column = s->column;
+	s->val_len = 0;
+	if (nftnl_jansson_stream_value(s, c, true) < 0) {
+		if (errno == EINVAL)
+			nftnl_parse_stream_error(s, err);
+		return -1;
+	}
+
+	return 0;
+}
+
+json_t *nftnl_jansson_load_slice(const char *buf, size_t len, int line,
+				 int column, struct nftnl_parse_err *err)
+{
+	json_error_t error;
+	json_t *root;
+
+	root = json_loadb(buf, len, 0, &error);
+	if (root == NULL) {
+		err->error = NFTNL_PARSE_EBADINPUT;
+		err->line = line + error.line - 1;
+		err->column = error.line == 1 ? column + error.column - 1 :
+						error.column;
+		errno = EINVAL;
+	}
+
+	return root;
+}
+
+json_t *nftnl_jansson_stream_load(struct nftnl_parse_stream *s, int c,
+				  struct nftnl_parse_err *err)
+{
+	if (nftnl_jansson_stream_slice(s, c, err) < 0)
+		return NULL;
+
+	return nftnl_jansson_load_slice(s->val, s->val_len, s->val_line,
+					s->val_column, err);
+}
+
 int nftnl_jansson_parse_family(json_t *root, void *out, struct nftnl_parse_err *err)
 {
 	const char *str;
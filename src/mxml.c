@@ -13,6 +13,9 @@
 
 #include <stdint.h>
 #include <limits.h>
+#include <ctype.h>
+#include <errno.h>
+#include <string.h>
 
 #include <linux/netfilter/nf_tables.h>
 #include <libnftnl/table.h>
@@ -229,4 +232,202 @@ int nftnl_mxml_family_parse(mxml_node_t *tree, const char *node_name,
 
 	return family;
 }
+
+/* Consume everything up to and including end, which must not be empty */
+static int nftnl_mxml_stream_until(struct nftnl_parse_stream *s,
+				   const char *end)
+{
+	size_t len = strlen(end), match = 0, run;
+	int c;
+
+	/* How much of end can still be matched after a repeated first char */
+	for (run = 1; end[run] == end[0]; run++)
+		;
+
+	while (match < len) {
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF) {
+			errno = EINVAL;
+			return -1;
+		}
+		if (nftnl_parse_stream_store(s, c) < 0)
+			return -1;
+
+		if (c == end[match])
+			match++;
+		else if (c == end[0])
+			match = match + 1 < run ? match + 1 : run;
+		else
+			match = 0;
+	}
+
+	return 0;
+}
+
+/* Read the rest of a markup whose '<' was already consumed. Element names
+ * that do not fit are returned empty, none of them is valid anyway.
+ */
+static int nftnl_mxml_stream_markup(struct nftnl_parse_stream *s, char *name,
+				    size_t size)
+{
+	int c, prev = 0, quote = 0, tag = NFTNL_MXML_TAG_OPEN;
+	size_t len = 0;
+
+	c = nftnl_parse_stream_getc(s);
+	if (c == EOF || nftnl_parse_stream_store(s, c) < 0)
+		goto err;
+
+	switch (c) {
+	case '!':
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF || nftnl_parse_stream_store(s, c) < 0)
+			goto err;
+		if (c == '-')
+			return nftnl_mxml_stream_until(s, "-->") < 0 ?
+			       -1 : NFTNL_MXML_TAG_OTHER;
+		if (c == '[')
+			return nftnl_mxml_stream_until(s, "]]>") < 0 ?
+			       -1 : NFTNL_MXML_TAG_OTHER;
+		return nftnl_mxml_stream_until(s, ">") < 0 ?
+		       -1 : NFTNL_MXML_TAG_OTHER;
+	case '?':
+		return nftnl_mxml_stream_until(s, "?>") < 0 ?
+		       -1 : NFTNL_MXML_TAG_OTHER;
+	case '/':
+		tag = NFTNL_MXML_TAG_CLOSE;
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF || nftnl_parse_stream_store(s, c) < 0)
+			goto err;
+		break;
+	}
+
+	while (!isspace(c) && c != '>' && c != '/') {
+		if (name != NULL && len < size)
+			name[len] = c;
+		len++;
+
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF || nftnl_parse_stream_store(s, c) < 0)
+			goto err;
+	}
+	if (len == 0)
+		goto err;
+	if (name != NULL)
+		name[len < size ? len : 0] = '\0';
+
+	/* Skip the attributes, the parsers never look at them */
+	while (c != '>' || quote) {
+		if (quote) {
+			if (c == quote)
+				quote = 0;
+		} else if (c == '"' || c == '\'') {
+			quote = c;
+		}
+		prev = c;
+
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF || nftnl_parse_stream_store(s, c) < 0)
+			goto err;
+	}
+
+	if (tag == NFTNL_MXML_TAG_OPEN && prev == '/')
+		tag = NFTNL_MXML_TAG_EMPTY;
+
+	return tag;
+err:
+	if (c == EOF)
+		errno = EINVAL;
+	return -1;
+}
+
+/* Returns the next element tag, comments and processing instructions are
+ * skipped. Only whitespace is allowed between tags.
+ */
+int nftnl_mxml_stream_tag(struct nftnl_parse_stream *s, char *name,
+			  size_t size)
+{
+	int c, tag;
+
+	do {
+		c = nftnl_parse_stream_next(s);
+		if (c == EOF)
+			return NFTNL_MXML_TAG_EOF;
+		if (c != '<') {
+			errno = EINVAL;
+			return -1;
+		}
+
+		s->val_len = 0;
+		if (nftnl_parse_stream_store(s, c) < 0)
+			return -1;
+
+		tag = nftnl_mxml_stream_markup(s, name, size);
+	} while (tag == NFTNL_MXML_TAG_OTHER);
+
+	return tag;
+}
+
+/* Copy the element whose opening tag was just returned by
+ * nftnl_mxml_stream_tag() into the stream buffer, NUL terminated.
+ */
+int nftnl_mxml_stream_slice(struct nftnl_parse_stream *s, int tag,
+			    struct nftnl_parse_err *err)
+{
+	int c, depth = tag == NFTNL_MXML_TAG_OPEN ? 1 : 0;
+
+	s->val_line = s->line;
+	s->val_column = s->column;
+	while (depth > 0) {
+		c = nftnl_parse_stream_getc(s);
+		if (c == EOF)
+			return nftnl_parse_stream_error(s, err);
+		if (nftnl_parse_stream_store(s, c) < 0)
+			return -1;
+		if (c != '<')
+			continue;
+
+		switch (nftnl_mxml_stream_markup(s, NULL, 0)) {
+		case NFTNL_MXML_TAG_OPEN:
+			depth++;
+			break;
+		case NFTNL_MXML_TAG_CLOSE:
+			depth--;
+			break;
+		case -1:
+			if (errno == EINVAL)
+				nftnl_parse_stream_error(s, err);
+			return -1;
+		}
+	}
+
+	return nftnl_parse_stream_store(s, '\0');
+}
+
+mxml_node_t *nftnl_mxml_load_slice(const char *buf, int line, int column,
+				   struct nftnl_parse_err *err)
+{
+	mxml_node_t *tree;
+
+	tree = mxmlLoadString(NULL, buf, MXML_OPAQUE_CALLBACK);
+	if (tree == NULL) {
+		err->error = NFTNL_PARSE_EBADINPUT;
+		err->line = line;
+		err->column = column;
+		errno = EINVAL;
+	}
+
+	return tree;
+}
+
+/* Load the element whose opening tag was just returned by
+ * nftnl_mxml_stream_tag() as a tree of its own.
+ */
+mxml_node_t *nftnl_mxml_stream_load(struct nftnl_parse_stream *s, int tag,
+				    struct nftnl_parse_err *err)
+{
+	if (nftnl_mxml_stream_slice(s, tag, err) < 0)
+		return NULL;
+
+	return nftnl_mxml_load_slice(s->val, s->val_line, s->val_column, err);
+}
 #endif
@@ -0,0 +1,202 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+#include <errno.h>
+#include <pthread.h>
+
+struct nftnl_pool_slot {
+	void	*job;
+	bool	done;
+};
+
+/* Jobs are queued on a ring. Workers pick them up at next, the caller takes
+ * them back from head onwards, either strictly in order or as soon as any of
+ * them is done. Slots that have been taken back out of order stay on the
+ * ring until head moves past them.
+ */
+struct nftnl_pool {
+	pthread_mutex_t		lock;
+	pthread_cond_t		work_cond;
+	pthread_cond_t		done_cond;
+	void			(*work)(void *job);
+	struct nftnl_pool_slot	*ring;
+	unsigned int		mask;
+	unsigned int		head;
+	unsigned int		next;
+	unsigned int		tail;
+	bool			stop;
+	unsigned int		nthreads;
+	pthread_t		threads[];
+};
+
+static void *nftnl_pool_worker(void *data)
+{
+	struct nftnl_pool *pool = data;
+	struct nftnl_pool_slot *slot;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (pool->next == pool->tail && !pool->stop)
+			pthread_cond_wait(&pool->work_cond, &pool->lock);
+		if (pool->next == pool->tail)
+			break;
+
+		slot = &pool->ring[pool->next++ & pool->mask];
+		pthread_mutex_unlock(&pool->lock);
+
+		pool->work(slot->job);
+
+		pthread_mutex_lock(&pool->lock);
+		slot->done = true;
+		pthread_cond_signal(&pool->done_cond);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+static void nftnl_pool_stop(struct nftnl_pool *pool)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = true;
+	pthread_cond_broadcast(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->nthreads; i++)
+		pthread_join(pool->threads[i], NULL);
+}
+
+struct nftnl_pool *nftnl_pool_alloc(unsigned int nthreads, unsigned int size,
+				    void (*work)(void *job))
+{
+	struct nftnl_pool *pool;
+	unsigned int slots = 1;
+	int ret;
+
+	/* The ring is indexed with free running counters */
+	while (slots < size)
+		slots <<= 1;
+
+	pool = calloc(1, sizeof(*pool) + nthreads * sizeof(pthread_t));
+	if (pool == NULL)
+		return NULL;
+
+	pool->ring = calloc(slots, sizeof(struct nftnl_pool_slot));
+	if (pool->ring == NULL)
+		goto err1;
+
+	pool->mask = slots - 1;
+	pool->work = work;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_cond, NULL);
+	pthread_cond_init(&pool->done_cond, NULL);
+
+	for (; pool->nthreads < nthreads; pool->nthreads++) {
+		ret = pthread_create(&pool->threads[pool->nthreads], NULL,
+				     nftnl_pool_worker, pool);
+		if (ret != 0) {
+			errno = ret;
+			goto err2;
+		}
+	}
+
+	return pool;
+err2:
+	nftnl_pool_stop(pool);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+	xfree(pool->ring);
+err1:
+	xfree(pool);
+	return NULL;
+}
+
+/* Jobs that are still queued are run before the workers exit */
+void nftnl_pool_free(struct nftnl_pool *pool)
+{
+	nftnl_pool_stop(pool);
+	pthread_cond_destroy(&pool->done_cond);
+	pthread_cond_destroy(&pool->work_cond);
+	pthread_mutex_destroy(&pool->lock);
+	xfree(pool->ring);
+	xfree(pool);
+}
+
+bool nftnl_pool_full(struct nftnl_pool *pool)
+{
+	bool full;
+
+	pthread_mutex_lock(&pool->lock);
+	full = pool->tail - pool->head > pool->mask;
+	pthread_mutex_unlock(&pool->lock);
+
+	return full;
+}
+
+int nftnl_pool_submit(struct nftnl_pool *pool, void *job)
+{
+	struct nftnl_pool_slot *slot;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->tail - pool->head > pool->mask) {
+		pthread_mutex_unlock(&pool->lock);
+		errno = ENOBUFS;
+		return -1;
+	}
+
+	slot = &pool->ring[pool->tail++ & pool->mask];
+	slot->job = job;
+	slot->done = false;
+	pthread_cond_signal(&pool->work_cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+static struct nftnl_pool_slot *nftnl_pool_done(struct nftnl_pool *pool,
+					       bool ordered)
+{
+	struct nftnl_pool_slot *slot;
+	unsigned int i;
+
+	for (i = pool->head; i != pool->next; i++) {
+		slot = &pool->ring[i & pool->mask];
+		if (slot->job != NULL && slot->done)
+			return slot;
+		if (ordered)
+			break;
+	}
+
+	return NULL;
+}
+
+/* Wait for a job to finish and hand it back, NULL if nothing is queued. */
+void *nftnl_pool_complete(struct nftnl_pool *pool, bool ordered)
+{
+	struct nftnl_pool_slot *slot;
+	void *job = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->head == pool->tail)
+		goto out;
+
+	while ((slot = nftnl_pool_done(pool, ordered)) == NULL)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+
+	job = slot->job;
+	slot->job = NULL;
+	while (pool->head != pool->tail &&
+	       pool->ring[pool->head & pool->mask].job == NULL)
+		pool->head++;
+out:
+	pthread_mutex_unlock(&pool->lock);
+
+	return job;
+}
@@ -41,15 +41,66 @@ struct nftnl_rule {
 	struct {
 			void		*data;
 			uint32_t	len;
+			bool		alloc;	/* by parsing, freed with the rule */
 	} user;
 	struct {
 			uint32_t	flags;
 			uint32_t	proto;
 	} compat;
 
-	struct list_head expr_list;
+	struct nftnl_shared_list *exprs;
 };
 
+/* Expressions of this rule, they may be shared with clones of this rule */
+static struct list_head *nftnl_rule_exprs(const struct nftnl_rule *r)
+{
+	if (r->exprs == NULL)
+		return &nftnl_shared_list_empty;
+
+	return &r->exprs->list;
+}
+
+static void nftnl_rule_exprs_put(struct nftnl_shared_list *exprs)
+{
+	struct nftnl_expr *e, *tmp;
+
+	if (!nftnl_shared_list_put(exprs))
+		return;
+
+	list_for_each_entry_safe(e, tmp, &exprs->list, head)
+		nftnl_expr_free(e);
+	xfree(exprs);
+}
+
+/* Get an expression list of our own before modifying it */
+static int nftnl_rule_exprs_unshare(struct nftnl_rule *r)
+{
+	struct nftnl_expr *expr, *newexpr;
+	struct nftnl_shared_list *exprs;
+
+	if (r->exprs && nftnl_shared_list_refs(r->exprs) == 1)
+		return 0;
+
+	exprs = nftnl_shared_list_alloc();
+	if (exprs == NULL)
+		return -1;
+
+	list_for_each_entry(expr, nftnl_rule_exprs(r), head) {
+		newexpr = nftnl_expr_clone(expr);
+		if (newexpr == NULL) {
+			nftnl_rule_exprs_put(exprs);
+			return -1;
+		}
+		list_add_tail(&newexpr->head, &exprs->list);
+	}
+
+	if (r->exprs)
+		nftnl_rule_exprs_put(r->exprs);
+	r->exprs = exprs;
+
+	return 0;
+}
+
 struct nftnl_rule *nftnl_rule_alloc(void)
 {
 	struct nftnl_rule *r;
@@ -58,7 +109,7 @@ struct nftnl_rule *nftnl_rule_alloc(void)
 	if (r == NULL)
 		return NULL;
 
-	INIT_LIST_HEAD(&r->expr_list);
+	nftnl_stats_obj_add(NFTNL_STATS_RULE, NFTNL_STATS_OBJ_ALLOC, 1);
 
 	return r;
 }
@@ -66,20 +117,125 @@ EXPORT_SYMBOL_ALIAS(nftnl_rule_alloc, nft_rule_alloc);
 
 void nftnl_rule_free(struct nftnl_rule *r)
 {
-	struct nftnl_expr *e, *tmp;
-
-	list_for_each_entry_safe(e, tmp, &r->expr_list, head)
-		nftnl_expr_free(e);
+	if (r->exprs != NULL)
+		nftnl_rule_exprs_put(r->exprs);
 
 	if (r->table != NULL)
 		xfree(r->table);
 	if (r->chain != NULL)
 		xfree(r->chain);
+	if (r->user.alloc)
+		xfree(r->user.data);
 
+	nftnl_stats_obj_add(NFTNL_STATS_RULE, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(r);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_rule_free, nft_rule_free);
 
+/*
+ * Expressions shared with clones are split evenly between all of them, so
+ * that summing up a list of clones counts them once.
+ */
+EXPORT_SYMBOL(nftnl_rule_memsize);
+size_t nftnl_rule_memsize(const struct nftnl_rule *r)
+{
+	size_t size = 0;
+	struct nftnl_expr *e;
+
+	list_for_each_entry(e, nftnl_rule_exprs(r), head)
+		size += nftnl_expr_memsize(e);
+
+	if (r->exprs) {
+		size += sizeof(struct nftnl_shared_list);
+		size /= nftnl_shared_list_refs(r->exprs);
+	}
+
+	size += sizeof(struct nftnl_rule) + nftnl_strsize(r->table) +
+		nftnl_strsize(r->chain);
+	/* Userdata set by the caller is borrowed, only parsed one is ours */
+	if (r->flags & (1 << NFTNL_RULE_USERDATA) && r->user.alloc)
+		size += r->user.len;
+
+	return size;
+}
+
+/* Drop all attributes and expressions so the rule can be parsed into again,
+ * a list that is not shared is kept for the next expressions.
+ */
+void nftnl_rule_reset(struct nftnl_rule *r)
+{
+	struct nftnl_expr *e, *tmp;
+	uint16_t attr;
+
+	if (r->exprs != NULL && nftnl_shared_list_refs(r->exprs) == 1) {
+		list_for_each_entry_safe(e, tmp, &r->exprs->list, head) {
+			list_del(&e->head);
+			nftnl_expr_free(e);
+		}
+	} else if (r->exprs != NULL) {
+		nftnl_rule_exprs_put(r->exprs);
+		r->exprs = NULL;
+	}
+
+	for (attr = 0; attr <= NFTNL_RULE_MAX; attr++)
+		nftnl_rule_unset(r, attr);
+}
+
+/*
+ * nftnl_rule_clone - copy a rule, sharing its expressions
+ *
+ * The expression list is shared by the original rule and its clones until
+ * one of them adds or parses expressions, or hands them out through
+ * nftnl_expr_foreach() or an iterator, then that rule gets its own copy.
+ * The original is only read, userdata that came from parsing is copied.
+ */
+EXPORT_SYMBOL(nftnl_rule_clone);
+struct nftnl_rule *nftnl_rule_clone(const struct nftnl_rule *r)
+{
+	struct nftnl_rule *newr;
+
+	newr = nftnl_rule_alloc();
+	if (newr == NULL)
+		return NULL;
+
+	newr->flags = r->flags;
+	newr->family = r->family;
+	newr->handle = r->handle;
+	newr->position = r->position;
+	newr->user = r->user;
+	newr->user.alloc = false;
+	newr->compat = r->compat;
+
+	if (r->user.alloc) {
+		newr->user.data = malloc(r->user.len);
+		if (newr->user.data == NULL)
+			goto err;
+		memcpy(newr->user.data, r->user.data, r->user.len);
+		newr->user.alloc = true;
+	}
+
+	if (r->flags & (1 << NFTNL_RULE_TABLE)) {
+		newr->table = strdup(r->table);
+		if (newr->table == NULL)
+			goto err;
+	}
+	if (r->flags & (1 << NFTNL_RULE_CHAIN)) {
+		newr->chain = strdup(r->chain);
+		if (newr->chain == NULL)
+			goto err;
+	}
+
+	if (r->exprs != NULL) {
+		nftnl_shared_list_get(r->exprs);
+		newr->exprs = r->exprs;
+	}
+
+	return newr;
+err:
+	nftnl_rule_free(newr);
+	return NULL;
+}
+
 bool nftnl_rule_is_set(const struct nftnl_rule *r, uint16_t attr)
 {
 	return r->flags & (1 << attr);
@@ -110,6 +266,11 @@ void nftnl_rule_unset(struct nftnl_rule *r, uint16_t attr)
 	case NFTNL_RULE_POSITION:
 	case NFTNL_RULE_FAMILY:
 	case NFTNL_RULE_USERDATA:
+		if (r->user.alloc) {
+			xfree(r->user.data);
+			r->user.data = NULL;
+			r->user.alloc = false;
+		}
 		break;
 	}
 
@@ -162,8 +323,12 @@ void nftnl_rule_set_data(struct nftnl_rule *r, uint16_t attr,
 		r->position = *((uint64_t *)data);
 		break;
 	case NFTNL_RULE_USERDATA:
+		if (r->user.alloc)
+			xfree(r->user.data);
+
 		r->user.data = (void *)data;
 		r->user.len = data_len;
+		r->user.alloc = false;
 		break;
 	}
 	r->flags |= (1 << attr);
@@ -278,6 +443,9 @@ void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
 {
 	struct nftnl_expr *expr;
 	struct nlattr *nest, *nest2;
+	uint32_t nexprs = 0;
+
+	NFTNL_PROBE2(rule_build_entry, r, nlh->nlmsg_len);
 
 	if (r->flags & (1 << NFTNL_RULE_TABLE))
 		mnl_attr_put_strz(nlh, NFTA_RULE_TABLE, r->table);
@@ -292,12 +460,13 @@ void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
 			     r->user.data);
 	}
 
-	if (!list_empty(&r->expr_list)) {
+	if (!list_empty(nftnl_rule_exprs(r))) {
 		nest = mnl_attr_nest_start(nlh, NFTA_RULE_EXPRESSIONS);
-		list_for_each_entry(expr, &r->expr_list, head) {
+		list_for_each_entry(expr, nftnl_rule_exprs(r), head) {
 			nest2 = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
 			nftnl_expr_build_payload(nlh, expr);
 			mnl_attr_nest_end(nlh, nest2);
+			nexprs++;
 		}
 		mnl_attr_nest_end(nlh, nest);
 	}
@@ -312,12 +481,22 @@ void nftnl_rule_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_rule *r)
 				 htonl(r->compat.flags));
 		mnl_attr_nest_end(nlh, nest);
 	}
+
+	nftnl_stats_obj_msg(NFTNL_STATS_RULE, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
+	NFTNL_PROBE3(rule_build_return, r, nexprs, nlh->nlmsg_len);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_rule_nlmsg_build_payload, nft_rule_nlmsg_build_payload);
 
+/* Out of memory to unshare the expressions, the expression is released */
 void nftnl_rule_add_expr(struct nftnl_rule *r, struct nftnl_expr *expr)
 {
-	list_add_tail(&expr->head, &r->expr_list);
+	if (nftnl_rule_exprs_unshare(r) < 0) {
+		nftnl_expr_free(expr);
+		return;
+	}
+
+	list_add_tail(&expr->head, &r->exprs->list);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_rule_add_expr, nft_rule_add_expr);
 
@@ -357,11 +536,15 @@ static int nftnl_rule_parse_attr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
-static int nftnl_rule_parse_expr(struct nlattr *nest, struct nftnl_rule *r)
+static int nftnl_rule_parse_expr(struct nlattr *nest, struct nftnl_rule *r,
+				 uint32_t *nexprs)
 {
 	struct nftnl_expr *expr;
 	struct nlattr *attr;
 
+	if (nftnl_rule_exprs_unshare(r) < 0)
+		return -1;
+
 	mnl_attr_for_each_nested(attr, nest) {
 		if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM)
 			return -1;
@@ -370,7 +553,8 @@ static int nftnl_rule_parse_expr(struct nlattr *nest, struct nftnl_rule *r)
 		if (expr == NULL)
 			return -1;
 
-		list_add_tail(&expr->head, &r->expr_list);
+		list_add_tail(&expr->head, &r->exprs->list);
+		(*nexprs)++;
 	}
 	return 0;
 }
@@ -415,7 +599,8 @@ static int nftnl_rule_parse_compat(struct nlattr *nest, struct nftnl_rule *r)
 	return 0;
 }
 
-int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
+static int __nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh,
+				    struct nftnl_rule *r, uint32_t *nexprs)
 {
 	struct nlattr *tb[NFTA_RULE_MAX+1] = {};
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
@@ -439,7 +624,8 @@ int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
 		r->flags |= (1 << NFTNL_RULE_HANDLE);
 	}
 	if (tb[NFTA_RULE_EXPRESSIONS])
-		ret = nftnl_rule_parse_expr(tb[NFTA_RULE_EXPRESSIONS], r);
+		ret = nftnl_rule_parse_expr(tb[NFTA_RULE_EXPRESSIONS], r,
+					    nexprs);
 	if (tb[NFTA_RULE_COMPAT])
 		ret = nftnl_rule_parse_compat(tb[NFTA_RULE_COMPAT], r);
 	if (tb[NFTA_RULE_POSITION]) {
@@ -450,12 +636,13 @@ int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
 		const void *udata =
 			mnl_attr_get_payload(tb[NFTA_RULE_USERDATA]);
 
-		if (r->user.data)
+		if (r->user.alloc)
 			xfree(r->user.data);
 
 		r->user.len = mnl_attr_get_payload_len(tb[NFTA_RULE_USERDATA]);
 
 		r->user.data = malloc(r->user.len);
+		r->user.alloc = r->user.data != NULL;
 		if (r->user.data == NULL)
 			return -1;
 
@@ -468,8 +655,133 @@ int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
 
 	return ret;
 }
+
+int nftnl_rule_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_rule *r)
+{
+	uint32_t nexprs = 0;
+	int ret;
+
+	NFTNL_PROBE2(rule_parse_entry, r, nlh->nlmsg_len);
+	nftnl_stats_obj_msg(NFTNL_STATS_RULE, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
+	ret = __nftnl_rule_nlmsg_parse(nlh, r, &nexprs);
+
+	NFTNL_PROBE3(rule_parse_return, r, nexprs, ret);
+	return ret;
+}
 EXPORT_SYMBOL_ALIAS(nftnl_rule_nlmsg_parse, nft_rule_nlmsg_parse);
 
+static int nftnl_rule_counter_data_cb(const struct nlattr *attr, void *data)
+{
+	const struct nlattr **tb = data;
+	int type = mnl_attr_get_type(attr);
+
+	if (mnl_attr_type_valid(attr, NFTA_COUNTER_MAX) < 0)
+		return MNL_CB_OK;
+
+	switch(type) {
+	case NFTA_COUNTER_BYTES:
+	case NFTA_COUNTER_PACKETS:
+		if (mnl_attr_validate(attr, MNL_TYPE_U64) < 0)
+			abi_breakage();
+		break;
+	}
+
+	tb[type] = attr;
+	return MNL_CB_OK;
+}
+
+static int nftnl_rule_counter_parse(const struct nlattr *elem, uint64_t handle,
+				    struct nftnl_counter_sample *sample)
+{
+	struct nlattr *tb[NFTA_COUNTER_MAX+1] = {};
+	const struct nlattr *attr, *data = NULL;
+	const char *name = NULL;
+
+	mnl_attr_for_each_nested(attr, elem) {
+		switch (mnl_attr_get_type(attr)) {
+		case NFTA_EXPR_NAME:
+			if (mnl_attr_validate(attr, MNL_TYPE_STRING) < 0)
+				abi_breakage();
+			name = mnl_attr_get_str(attr);
+			break;
+		case NFTA_EXPR_DATA:
+			data = attr;
+			break;
+		}
+	}
+
+	if (name == NULL || data == NULL || strcmp(name, "counter") != 0)
+		return 0;
+
+	if (mnl_attr_parse_nested(data, nftnl_rule_counter_data_cb, tb) < 0)
+		return -1;
+
+	sample->handle = handle;
+	sample->packets = tb[NFTA_COUNTER_PACKETS] ?
+		be64toh(mnl_attr_get_u64(tb[NFTA_COUNTER_PACKETS])) : 0;
+	sample->bytes = tb[NFTA_COUNTER_BYTES] ?
+		be64toh(mnl_attr_get_u64(tb[NFTA_COUNTER_BYTES])) : 0;
+
+	return 1;
+}
+
+/*
+ * nftnl_rule_nlmsg_counters - harvest counters from a rule message
+ *
+ * Stores one (handle, packets, bytes) sample per counter expression found
+ * in the rule into @samples, without allocating the rule and without
+ * parsing any other expression. Returns the number of samples stored, or
+ * -1 and sets errno to ENOSPC if @max is too small.
+ */
+EXPORT_SYMBOL(nftnl_rule_nlmsg_counters);
+int nftnl_rule_nlmsg_counters(const struct nlmsghdr *nlh,
+			      struct nftnl_counter_sample *samples,
+			      uint32_t max)
+{
+	const struct nlattr *attr, *exprs = NULL;
+	uint64_t handle = 0;
+	uint32_t n = 0;
+	int ret;
+
+	mnl_attr_for_each(attr, nlh, sizeof(struct nfgenmsg)) {
+		switch (mnl_attr_get_type(attr)) {
+		case NFTA_RULE_HANDLE:
+			if (mnl_attr_validate(attr, MNL_TYPE_U64) < 0)
+				abi_breakage();
+			handle = be64toh(mnl_attr_get_u64(attr));
+			break;
+		case NFTA_RULE_EXPRESSIONS:
+			exprs = attr;
+			break;
+		}
+	}
+
+	if (exprs == NULL)
+		return 0;
+
+	mnl_attr_for_each_nested(attr, exprs) {
+		struct nftnl_counter_sample sample;
+
+		if (mnl_attr_get_type(attr) != NFTA_LIST_ELEM)
+			return -1;
+
+		ret = nftnl_rule_counter_parse(attr, handle, &sample);
+		if (ret < 0)
+			return -1;
+		if (ret == 0)
+			continue;
+
+		if (n >= max) {
+			errno = ENOSPC;
+			return -1;
+		}
+		samples[n++] = sample;
+	}
+	return n;
+}
+
 #ifdef JSON_PARSING
 int nftnl_jansson_parse_rule(struct nftnl_rule *r, json_t *tree,
 			   struct nftnl_parse_err *err,
@@ -760,22 +1072,25 @@ static int nftnl_rule_snprintf_json(char *buf, size_t size, struct nftnl_rule *r
 	ret = snprintf(buf+offset, len, "\"expr\":[");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-	list_for_each_entry(expr, &r->expr_list, head) {
+	list_for_each_entry(expr, nftnl_rule_exprs(r), head) {
 		ret = snprintf(buf+offset, len,
 			       "{\"type\":\"%s\",", expr->ops->name);
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
 		ret = expr->ops->snprintf(buf+offset, len, type, flags, expr);
-		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
 		/*
 		 * Remove comma from the first element if there is type
 		 * key-value pair only. Example: "expr":[{"type":"log"}]
+		 * This has to look at the unclamped length, a truncated
+		 * expression is not an empty one.
 		 */
 		if (ret == 0) {
 			offset--;
-			len--;
+			if (len > 0)
+				len++;
 		}
+		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
 		ret = snprintf(buf+offset, len, "},");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -836,7 +1151,7 @@ static int nftnl_rule_snprintf_xml(char *buf, size_t size, struct nftnl_rule *r,
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
-	list_for_each_entry(expr, &r->expr_list, head) {
+	list_for_each_entry(expr, nftnl_rule_exprs(r), head) {
 		ret = snprintf(buf+offset, len,
 				"<expr type=\"%s\">", expr->ops->name);
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -893,7 +1208,7 @@ static int nftnl_rule_snprintf_default(char *buf, size_t size, struct nftnl_rule
 	ret = snprintf(buf+offset, len, "\n");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-	list_for_each_entry(expr, &r->expr_list, head) {
+	list_for_each_entry(expr, nftnl_rule_exprs(r), head) {
 		ret = snprintf(buf+offset, len, "  [ %s ", expr->ops->name);
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
@@ -984,6 +1299,14 @@ int nftnl_rule_fprintf(FILE *fp, struct nftnl_rule *r, uint32_t type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_rule_fprintf, nft_rule_fprintf);
 
+EXPORT_SYMBOL(nftnl_rule_export);
+int nftnl_rule_export(struct nftnl_sink *s, struct nftnl_rule *r,
+		      uint32_t type, uint32_t flags)
+{
+	return nftnl_sink_printf(s, r, NFTNL_CMD_UNSPEC, type, flags,
+				 nftnl_rule_do_snprintf);
+}
+
 int nftnl_expr_foreach(struct nftnl_rule *r,
                           int (*cb)(struct nftnl_expr *e, void *data),
                           void *data)
@@ -991,7 +1314,11 @@ int nftnl_expr_foreach(struct nftnl_rule *r,
        struct nftnl_expr *cur, *tmp;
        int ret;
 
-       list_for_each_entry_safe(cur, tmp, &r->expr_list, head) {
+       /* The callback may modify the expressions, clones must not see it */
+       if (r->exprs != NULL && nftnl_rule_exprs_unshare(r) < 0)
+               return -1;
+
+       list_for_each_entry_safe(cur, tmp, nftnl_rule_exprs(r), head) {
                ret = cb(cur, data);
                if (ret < 0)
                        return ret;
@@ -1000,12 +1327,30 @@ int nftnl_expr_foreach(struct nftnl_rule *r,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_expr_foreach, nft_rule_expr_foreach);
 
+/* Expressions may be shared with clones, the rule keeps them as they are */
+EXPORT_SYMBOL(nftnl_expr_foreach_ro);
+int nftnl_expr_foreach_ro(const struct nftnl_rule *r,
+			  int (*cb)(const struct nftnl_expr *e, void *data),
+			  void *data)
+{
+	struct nftnl_expr *cur;
+	int ret;
+
+	list_for_each_entry(cur, nftnl_rule_exprs(r), head) {
+		ret = cb(cur, data);
+		if (ret < 0)
+			return ret;
+	}
+	return 0;
+}
+
 struct nftnl_expr_iter {
-	struct nftnl_rule		*r;
+	const struct nftnl_rule	*r;
 	struct nftnl_expr	*cur;
 };
 
-struct nftnl_expr_iter *nftnl_expr_iter_create(struct nftnl_rule *r)
+static struct nftnl_expr_iter *
+__nftnl_expr_iter_create(const struct nftnl_rule *r)
 {
 	struct nftnl_expr_iter *iter;
 
@@ -1014,16 +1359,32 @@ struct nftnl_expr_iter *nftnl_expr_iter_create(struct nftnl_rule *r)
 		return NULL;
 
 	iter->r = r;
-	if (list_empty(&r->expr_list))
+	if (list_empty(nftnl_rule_exprs(r)))
 		iter->cur = NULL;
 	else
-		iter->cur = list_entry(r->expr_list.next, struct nftnl_expr,
-				       head);
+		iter->cur = list_entry(nftnl_rule_exprs(r)->next,
+				       struct nftnl_expr, head);
 
 	return iter;
 }
+
+struct nftnl_expr_iter *nftnl_expr_iter_create(struct nftnl_rule *r)
+{
+	/* Same as nftnl_expr_foreach(), iterators hand out writable pointers */
+	if (r->exprs != NULL && nftnl_rule_exprs_unshare(r) < 0)
+		return NULL;
+
+	return __nftnl_expr_iter_create(r);
+}
 EXPORT_SYMBOL_ALIAS(nftnl_expr_iter_create, nft_rule_expr_iter_create);
 
+/* Same as nftnl_expr_foreach_ro(), expressions must not be modified */
+EXPORT_SYMBOL(nftnl_expr_iter_create_ro);
+struct nftnl_expr_iter *nftnl_expr_iter_create_ro(const struct nftnl_rule *r)
+{
+	return __nftnl_expr_iter_create(r);
+}
+
 struct nftnl_expr *nftnl_expr_iter_next(struct nftnl_expr_iter *iter)
 {
 	struct nftnl_expr *expr = iter->cur;
@@ -1033,7 +1394,7 @@ struct nftnl_expr *nftnl_expr_iter_next(struct nftnl_expr_iter *iter)
 
 	/* get next expression, if any */
 	iter->cur = list_entry(iter->cur->head.next, struct nftnl_expr, head);
-	if (&iter->cur->head == iter->r->expr_list.next)
+	if (&iter->cur->head == nftnl_rule_exprs(iter->r)->next)
 		return NULL;
 
 	return expr;
@@ -1046,6 +1407,228 @@ void nftnl_expr_iter_destroy(struct nftnl_expr_iter *iter)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_expr_iter_destroy, nft_rule_expr_iter_destroy);
 
+/*
+ * Rule templates
+ *
+ * The rule is built once into the template. Stamping a new message copies
+ * the template and only rebuilds the expressions registered as parameters,
+ * whose values may have changed in the meantime, then fixes up the length
+ * of the enclosing attributes.
+ */
+
+/* Room for the headers, table, chain, userdata and a full expression list */
+#define NFTNL_RULE_TMPL_BUFSIZ	(2 * (UINT16_MAX + 1))
+
+struct nftnl_rule_tmpl_param {
+	struct nftnl_expr	*expr;
+	uint32_t		off;
+	uint32_t		len;
+};
+
+struct nftnl_rule_tmpl {
+	const struct nftnl_rule		*rule;
+	uint16_t			cmd;
+	uint16_t			family;
+	uint16_t			flags;
+	bool				compiled;
+	char				*buf;
+	uint32_t			exprs_off;
+	uint32_t			num_params;
+	uint32_t			max_params;
+	struct nftnl_rule_tmpl_param	*params;
+};
+
+EXPORT_SYMBOL(nftnl_rule_tmpl_alloc);
+struct nftnl_rule_tmpl *nftnl_rule_tmpl_alloc(const struct nftnl_rule *r,
+					      uint16_t cmd, uint16_t family,
+					      uint16_t flags)
+{
+	struct nftnl_rule_tmpl *t;
+
+	t = calloc(1, sizeof(struct nftnl_rule_tmpl));
+	if (t == NULL)
+		return NULL;
+
+	t->rule = r;
+	t->cmd = cmd;
+	t->family = family;
+	t->flags = flags;
+
+	return t;
+}
+
+EXPORT_SYMBOL(nftnl_rule_tmpl_free);
+void nftnl_rule_tmpl_free(struct nftnl_rule_tmpl *t)
+{
+	xfree(t->buf);
+	xfree(t->params);
+	xfree(t);
+}
+
+/*
+ * nftnl_rule_tmpl_add_param - mark an expression of the rule as parameter
+ *
+ * The expression can be updated through nftnl_expr_set*() between calls to
+ * nftnl_rule_tmpl_nlmsg_build(), the other expressions must not change.
+ */
+EXPORT_SYMBOL(nftnl_rule_tmpl_add_param);
+int nftnl_rule_tmpl_add_param(struct nftnl_rule_tmpl *t,
+			      struct nftnl_expr *expr)
+{
+	struct nftnl_rule_tmpl_param *params;
+	struct nftnl_expr *cur;
+	uint32_t i;
+
+	list_for_each_entry(cur, nftnl_rule_exprs(t->rule), head) {
+		if (cur == expr)
+			break;
+	}
+	if (cur != expr) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	for (i = 0; i < t->num_params; i++) {
+		if (t->params[i].expr == expr)
+			return 0;
+	}
+
+	if (t->num_params == t->max_params) {
+		params = realloc(t->params, (t->max_params + 4) *
+					    sizeof(struct nftnl_rule_tmpl_param));
+		if (params == NULL)
+			return -1;
+
+		t->params = params;
+		t->max_params += 4;
+	}
+	t->params[t->num_params++].expr = expr;
+	t->compiled = false;
+
+	return 0;
+}
+
+static struct nftnl_rule_tmpl_param *
+nftnl_rule_tmpl_param_lookup(struct nftnl_rule_tmpl *t, struct nftnl_expr *e)
+{
+	uint32_t i;
+
+	for (i = 0; i < t->num_params; i++) {
+		if (t->params[i].expr == e)
+			return &t->params[i];
+	}
+	return NULL;
+}
+
+static int nftnl_rule_tmpl_param_cmp(const void *a, const void *b)
+{
+	const struct nftnl_rule_tmpl_param *pa = a, *pb = b;
+
+	return pa->off < pb->off ? -1 : pa->off > pb->off;
+}
+
+static int nftnl_rule_tmpl_compile(struct nftnl_rule_tmpl *t)
+{
+	struct nftnl_rule_tmpl_param *param;
+	const struct nlattr *attr, *elem;
+	struct nftnl_expr *expr;
+	struct nlmsghdr *nlh;
+	char *buf;
+
+	/* Zeroed, so the attribute padding that we copy is not random */
+	buf = calloc(1, NFTNL_RULE_TMPL_BUFSIZ);
+	if (buf == NULL)
+		return -1;
+
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, t->cmd, t->family, t->flags, 0);
+	nftnl_rule_nlmsg_build_payload(nlh, (struct nftnl_rule *)t->rule);
+
+	t->exprs_off = 0;
+	mnl_attr_for_each(attr, nlh, sizeof(struct nfgenmsg)) {
+		if (mnl_attr_get_type(attr) == NFTA_RULE_EXPRESSIONS) {
+			t->exprs_off = (const char *)attr - buf;
+			break;
+		}
+	}
+
+	if (t->num_params > 0) {
+		if (t->exprs_off == 0)
+			goto err;
+
+		/* Expressions are encoded in the same order as in the list */
+		expr = list_entry(nftnl_rule_exprs(t->rule)->next,
+				  struct nftnl_expr, head);
+		mnl_attr_for_each_nested(elem, attr) {
+			param = nftnl_rule_tmpl_param_lookup(t, expr);
+			if (param != NULL) {
+				param->off = (const char *)elem - buf;
+				param->len = MNL_ALIGN(elem->nla_len);
+			}
+			expr = list_entry(expr->head.next, struct nftnl_expr,
+					  head);
+		}
+		qsort(t->params, t->num_params,
+		      sizeof(struct nftnl_rule_tmpl_param),
+		      nftnl_rule_tmpl_param_cmp);
+	}
+
+	xfree(t->buf);
+	t->buf = realloc(buf, nlh->nlmsg_len);
+	if (t->buf == NULL)
+		t->buf = buf;
+
+	t->compiled = true;
+	return 0;
+err:
+	errno = EINVAL;
+	xfree(buf);
+	return -1;
+}
+
+/*
+ * nftnl_rule_tmpl_nlmsg_build - build a new message out of the template
+ *
+ * @buf must have room for the rule, as for nftnl_rule_nlmsg_build_payload().
+ * Returns NULL and sets errno on failure.
+ */
+EXPORT_SYMBOL(nftnl_rule_tmpl_nlmsg_build);
+struct nlmsghdr *nftnl_rule_tmpl_nlmsg_build(struct nftnl_rule_tmpl *t,
+					     char *buf, uint32_t seq)
+{
+	const struct nlmsghdr *tmpl;
+	struct nlmsghdr *nlh = (struct nlmsghdr *)buf;
+	struct nlattr *nest;
+	uint32_t i, off = 0, len = 0;
+
+	if (!t->compiled && nftnl_rule_tmpl_compile(t) < 0)
+		return NULL;
+
+	tmpl = (const struct nlmsghdr *)t->buf;
+
+	for (i = 0; i < t->num_params; i++) {
+		memcpy(buf + len, t->buf + off, t->params[i].off - off);
+		len += t->params[i].off - off;
+		off = t->params[i].off + t->params[i].len;
+
+		nlh->nlmsg_len = len;
+		nest = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+		nftnl_expr_build_payload(nlh, t->params[i].expr);
+		mnl_attr_nest_end(nlh, nest);
+		len = nlh->nlmsg_len;
+	}
+	memcpy(buf + len, t->buf + off, tmpl->nlmsg_len - off);
+	len += tmpl->nlmsg_len - off;
+
+	if (t->num_params > 0) {
+		nest = (struct nlattr *)(buf + t->exprs_off);
+		nest->nla_len += len - tmpl->nlmsg_len;
+	}
+	nlh->nlmsg_len = len;
+	nlh->nlmsg_seq = seq;
+
+	return nlh;
+}
+
 struct nftnl_rule_list {
 	struct list_head list;
 };
@@ -1076,6 +1659,18 @@ void nftnl_rule_list_free(struct nftnl_rule_list *list)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_rule_list_free, nft_rule_list_free);
 
+EXPORT_SYMBOL(nftnl_rule_list_memsize);
+size_t nftnl_rule_list_memsize(const struct nftnl_rule_list *list)
+{
+	size_t size = sizeof(struct nftnl_rule_list);
+	struct nftnl_rule *r;
+
+	list_for_each_entry(r, &list->list, head)
+		size += nftnl_rule_memsize(r);
+
+	return size;
+}
+
 int nftnl_rule_list_is_empty(struct nftnl_rule_list *list)
 {
 	return list_empty(&list->list);
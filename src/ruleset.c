@@ -22,6 +22,12 @@
 #include <libnftnl/chain.h>
 #include <libnftnl/set.h>
 #include <libnftnl/rule.h>
+#include <libnftnl/batch.h>
+
+#include <unistd.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
 
 struct nftnl_ruleset {
 	struct nftnl_table_list	*table_list;
@@ -32,6 +38,14 @@ struct nftnl_ruleset {
 	uint16_t		flags;
 };
 
+/* Objects that every table, chain, set and rule is parsed into in turn */
+struct nftnl_ruleset_objs {
+	struct nftnl_table	*table;
+	struct nftnl_chain	*chain;
+	struct nftnl_set	*set;
+	struct nftnl_rule	*rule;
+};
+
 struct nftnl_parse_ctx {
 	enum nftnl_cmd_type cmd;
 	enum nftnl_ruleset_type type;
@@ -53,6 +67,8 @@ struct nftnl_parse_ctx {
 	uint32_t format;
 	uint32_t set_id;
 	struct nftnl_set_list *set_list;
+	struct nftnl_ruleset_mt *mt;
+	struct nftnl_ruleset_objs *objs;
 
 	int (*cb)(const struct nftnl_parse_ctx *ctx);
 	uint16_t flags;
@@ -78,6 +94,29 @@ void nftnl_ruleset_free(struct nftnl_ruleset *r)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_free, nft_ruleset_free);
 
+/*
+ * nftnl_ruleset_memsize - heap memory held by a ruleset and all its lists
+ *
+ * Strings, expressions, set elements and user data are included. The
+ * allocator's own overhead per allocation is not.
+ */
+EXPORT_SYMBOL(nftnl_ruleset_memsize);
+size_t nftnl_ruleset_memsize(const struct nftnl_ruleset *r)
+{
+	size_t size = sizeof(struct nftnl_ruleset);
+
+	if (r->flags & (1 << NFTNL_RULESET_TABLELIST))
+		size += nftnl_table_list_memsize(r->table_list);
+	if (r->flags & (1 << NFTNL_RULESET_CHAINLIST))
+		size += nftnl_chain_list_memsize(r->chain_list);
+	if (r->flags & (1 << NFTNL_RULESET_SETLIST))
+		size += nftnl_set_list_memsize(r->set_list);
+	if (r->flags & (1 << NFTNL_RULESET_RULELIST))
+		size += nftnl_rule_list_memsize(r->rule_list);
+
+	return size;
+}
+
 bool nftnl_ruleset_is_set(const struct nftnl_ruleset *r, uint16_t attr)
 {
 	return r->flags & (1 << attr);
@@ -255,14 +294,43 @@ static void nftnl_ruleset_ctx_set_u32(struct nftnl_parse_ctx *ctx, uint16_t attr
 	nftnl_ruleset_ctx_set(ctx, attr, &val);
 }
 
+static int nftnl_ruleset_ctx_set_cmd(const char *cmd,
+				     struct nftnl_parse_err *err,
+				     struct nftnl_parse_ctx *ctx)
+{
+	uint32_t cmdnum;
+
+	cmdnum = nftnl_str2cmd(cmd);
+	if (cmdnum == NFTNL_CMD_UNSPEC) {
+		err->error = NFTNL_PARSE_EMISSINGNODE;
+		err->node_name = strdup(cmd);
+		return -1;
+	}
+
+	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_CMD, cmdnum);
+	return 0;
+}
+
+static int nftnl_ruleset_parse_flush(struct nftnl_parse_ctx *ctx)
+{
+	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE,
+				NFTNL_RULESET_RULESET);
+	return ctx->cb(ctx);
+}
+
 static int nftnl_ruleset_parse_tables(struct nftnl_parse_ctx *ctx,
 				    struct nftnl_parse_err *err)
 {
 	struct nftnl_table *table;
 
-	table = nftnl_table_alloc();
-	if (table == NULL)
-		return -1;
+	if (ctx->objs != NULL) {
+		table = ctx->objs->table;
+		nftnl_table_reset(table);
+	} else {
+		table = nftnl_table_alloc();
+		if (table == NULL)
+			return -1;
+	}
 
 	switch (ctx->format) {
 	case NFTNL_OUTPUT_JSON:
@@ -284,12 +352,11 @@ static int nftnl_ruleset_parse_tables(struct nftnl_parse_ctx *ctx,
 
 	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE, NFTNL_RULESET_TABLE);
 	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_TABLE, table);
-	if (ctx->cb(ctx) < 0)
-		goto err;
 
 	return 0;
 err:
-	nftnl_table_free(table);
+	if (ctx->objs == NULL)
+		nftnl_table_free(table);
 	return -1;
 }
 
@@ -298,9 +365,14 @@ static int nftnl_ruleset_parse_chains(struct nftnl_parse_ctx *ctx,
 {
 	struct nftnl_chain *chain;
 
-	chain = nftnl_chain_alloc();
-	if (chain == NULL)
-		return -1;
+	if (ctx->objs != NULL) {
+		chain = ctx->objs->chain;
+		nftnl_chain_reset(chain);
+	} else {
+		chain = nftnl_chain_alloc();
+		if (chain == NULL)
+			return -1;
+	}
 
 	switch (ctx->format) {
 	case NFTNL_OUTPUT_JSON:
@@ -322,36 +394,11 @@ static int nftnl_ruleset_parse_chains(struct nftnl_parse_ctx *ctx,
 
 	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE, NFTNL_RULESET_CHAIN);
 	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_CHAIN, chain);
-	if (ctx->cb(ctx) < 0)
-		goto err;
-
-	return 0;
-err:
-	nftnl_chain_free(chain);
-	return -1;
-}
-
-static int nftnl_ruleset_parse_set(struct nftnl_parse_ctx *ctx,
-				 struct nftnl_set *set, uint32_t type,
-				 struct nftnl_parse_err *err)
-{
-	struct nftnl_set *newset;
-
-	nftnl_set_set_u32(set, NFTNL_SET_ID, ctx->set_id++);
-
-	newset = nftnl_set_clone(set);
-	if (newset == NULL)
-		goto err;
-
-	nftnl_set_list_add_tail(newset, ctx->set_list);
-
-	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE, type);
-	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_SET, set);
-	if (ctx->cb(ctx) < 0)
-		goto err;
 
 	return 0;
 err:
+	if (ctx->objs == NULL)
+		nftnl_chain_free(chain);
 	return -1;
 }
 
@@ -360,9 +407,14 @@ static int nftnl_ruleset_parse_set_elems(struct nftnl_parse_ctx *ctx,
 {
 	struct nftnl_set *set;
 
-	set = nftnl_set_alloc();
-	if (set == NULL)
-		return -1;
+	if (ctx->objs != NULL) {
+		set = ctx->objs->set;
+		nftnl_set_reset(set);
+	} else {
+		set = nftnl_set_alloc();
+		if (set == NULL)
+			return -1;
+	}
 
 	switch (ctx->format) {
 	case NFTNL_OUTPUT_JSON:
@@ -382,12 +434,14 @@ static int nftnl_ruleset_parse_set_elems(struct nftnl_parse_ctx *ctx,
 		goto err;
 	}
 
-	if (nftnl_ruleset_parse_set(ctx, set, NFTNL_RULESET_SET_ELEMS, err) < 0)
-		goto err;
+	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE,
+				  NFTNL_RULESET_SET_ELEMS);
+	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_SET, set);
 
 	return 0;
 err:
-	nftnl_set_free(set);
+	if (ctx->objs == NULL)
+		nftnl_set_free(set);
 	return -1;
 }
 
@@ -396,9 +450,14 @@ static int nftnl_ruleset_parse_sets(struct nftnl_parse_ctx *ctx,
 {
 	struct nftnl_set *set;
 
-	set = nftnl_set_alloc();
-	if (set == NULL)
-		return -1;
+	if (ctx->objs != NULL) {
+		set = ctx->objs->set;
+		nftnl_set_reset(set);
+	} else {
+		set = nftnl_set_alloc();
+		if (set == NULL)
+			return -1;
+	}
 
 	switch (ctx->format) {
 	case NFTNL_OUTPUT_JSON:
@@ -418,12 +477,13 @@ static int nftnl_ruleset_parse_sets(struct nftnl_parse_ctx *ctx,
 		goto err;
 	}
 
-	if (nftnl_ruleset_parse_set(ctx, set, NFTNL_RULESET_SET, err) < 0)
-		goto err;
+	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE, NFTNL_RULESET_SET);
+	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_SET, set);
 
 	return 0;
 err:
-	nftnl_set_free(set);
+	if (ctx->objs == NULL)
+		nftnl_set_free(set);
 	return -1;
 }
 
@@ -432,9 +492,14 @@ static int nftnl_ruleset_parse_rules(struct nftnl_parse_ctx *ctx,
 {
 	struct nftnl_rule *rule;
 
-	rule = nftnl_rule_alloc();
-	if (rule == NULL)
-		return -1;
+	if (ctx->objs != NULL) {
+		rule = ctx->objs->rule;
+		nftnl_rule_reset(rule);
+	} else {
+		rule = nftnl_rule_alloc();
+		if (rule == NULL)
+			return -1;
+	}
 
 	switch (ctx->format) {
 	case NFTNL_OUTPUT_JSON:
@@ -457,17 +522,389 @@ static int nftnl_ruleset_parse_rules(struct nftnl_parse_ctx *ctx,
 
 	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE, NFTNL_RULESET_RULE);
 	nftnl_ruleset_ctx_set(ctx, NFTNL_RULESET_CTX_RULE, rule);
+
+	return 0;
+err:
+	if (ctx->objs == NULL)
+		nftnl_rule_free(rule);
+	return -1;
+}
+
+static uint32_t nftnl_ruleset_type_by_name(const char *name)
+{
+	if (strcmp(name, "table") == 0)
+		return NFTNL_RULESET_TABLE;
+	else if (strcmp(name, "chain") == 0)
+		return NFTNL_RULESET_CHAIN;
+	else if (strcmp(name, "set") == 0)
+		return NFTNL_RULESET_SET;
+	else if (strcmp(name, "rule") == 0)
+		return NFTNL_RULESET_RULE;
+	else if (strcmp(name, "element") == 0)
+		return NFTNL_RULESET_SET_ELEMS;
+
+	return NFTNL_RULESET_UNSPEC;
+}
+
+#ifdef JSON_PARSING
+static uint32_t nftnl_ruleset_json_node_type(json_t *node)
+{
+	if (nftnl_jansson_node_exist(node, "table"))
+		return NFTNL_RULESET_TABLE;
+	else if (nftnl_jansson_node_exist(node, "chain"))
+		return NFTNL_RULESET_CHAIN;
+	else if (nftnl_jansson_node_exist(node, "set"))
+		return NFTNL_RULESET_SET;
+	else if (nftnl_jansson_node_exist(node, "rule"))
+		return NFTNL_RULESET_RULE;
+	else if (nftnl_jansson_node_exist(node, "element"))
+		return NFTNL_RULESET_SET_ELEMS;
+
+	return NFTNL_RULESET_UNSPEC;
+}
+#endif
+
+/* Decode the object in ctx->json or ctx->xml, the callback is not called */
+static int nftnl_ruleset_parse_obj(struct nftnl_parse_ctx *ctx, uint32_t type,
+				   struct nftnl_parse_err *err)
+{
+	switch (type) {
+	case NFTNL_RULESET_TABLE:
+		return nftnl_ruleset_parse_tables(ctx, err);
+	case NFTNL_RULESET_CHAIN:
+		return nftnl_ruleset_parse_chains(ctx, err);
+	case NFTNL_RULESET_SET:
+		return nftnl_ruleset_parse_sets(ctx, err);
+	case NFTNL_RULESET_RULE:
+		return nftnl_ruleset_parse_rules(ctx, err);
+	case NFTNL_RULESET_SET_ELEMS:
+		return nftnl_ruleset_parse_set_elems(ctx, err);
+	}
+
+	return -1;
+}
+
+/* Hand a decoded object over to the callback. Sets are recorded first so
+ * that the rules coming after them can refer to them by name. Lookups only
+ * need the name and the ID, elements and the rest are not kept around.
+ */
+static int nftnl_ruleset_parse_deliver(struct nftnl_parse_ctx *ctx,
+				       uint32_t *set_id)
+{
+	struct nftnl_set *newset;
+
+	switch (ctx->type) {
+	case NFTNL_RULESET_SET:
+	case NFTNL_RULESET_SET_ELEMS:
+		nftnl_set_set_u32(ctx->set, NFTNL_SET_ID, *set_id);
+		if (!nftnl_set_is_set(ctx->set, NFTNL_SET_NAME)) {
+			(*set_id)++;
+			break;
+		}
+
+		newset = nftnl_set_alloc();
+		if (newset == NULL)
+			goto err;
+
+		nftnl_set_set_str(newset, NFTNL_SET_NAME,
+				  nftnl_set_get_str(ctx->set, NFTNL_SET_NAME));
+		nftnl_set_set_u32(newset, NFTNL_SET_ID, (*set_id)++);
+		nftnl_set_list_add_tail(newset, ctx->set_list);
+		break;
+	default:
+		break;
+	}
+
 	if (ctx->cb(ctx) < 0)
 		goto err;
 
 	return 0;
 err:
-	nftnl_rule_free(rule);
+	if (ctx->objs == NULL)
+		nftnl_ruleset_ctx_free(ctx);
 	return -1;
 }
+
+/*
+ * Parallel import: the stream is split into objects on the caller thread,
+ * which are decoded by a pool of workers and delivered back on the caller
+ * thread. Rules look up sets by name while they are decoded, so they are
+ * never decoded while sets that precede them are still in flight.
+ */
+enum {
+	NFTNL_RULESET_JOB_READS_SETS	= (1 << 0),
+	NFTNL_RULESET_JOB_WRITES_SETS	= (1 << 1),
+};
+
+struct nftnl_ruleset_job {
+	struct nftnl_parse_ctx	ctx;
+	struct nftnl_parse_err	err;
+	uint32_t		deps;
+	char			*buf;
+	size_t			len;
+	size_t			size;
+	int			line;
+	int			column;
+	int			ret;
+	int			errnum;
+};
+
+struct nftnl_ruleset_mt {
+	struct nftnl_pool		*pool;
+	struct nftnl_ruleset_job	*jobs;
+	struct nftnl_ruleset_job	**free_jobs;
+	unsigned int			num_jobs;
+	unsigned int			num_free;
+	unsigned int			reads;
+	unsigned int			writes;
+	uint32_t			flags;
+	bool				failed;
+};
+
+static void nftnl_ruleset_job_work(void *data)
+{
+	struct nftnl_ruleset_job *job = data;
+	struct nftnl_parse_ctx *ctx = &job->ctx;
+
+	job->ret = -1;
+	switch (ctx->format) {
+#ifdef JSON_PARSING
+	case NFTNL_OUTPUT_JSON:
+		ctx->json = nftnl_jansson_load_slice(job->buf, job->len,
+						     job->line, job->column,
+						     &job->err);
+		if (ctx->json == NULL)
+			break;
+
+		job->ret = nftnl_ruleset_parse_obj(ctx,
+				nftnl_ruleset_json_node_type(ctx->json),
+				&job->err);
+		nftnl_jansson_free_root(ctx->json);
+		break;
+#endif
+#ifdef XML_PARSING
+	case NFTNL_OUTPUT_XML:
+		ctx->xml = nftnl_mxml_load_slice(job->buf, job->line,
+						 job->column, &job->err);
+		if (ctx->xml == NULL)
+			break;
+
+		job->ret = nftnl_ruleset_parse_obj(ctx,
+				nftnl_ruleset_type_by_name(ctx->xml->value.opaque),
+				&job->err);
+		mxmlDelete(ctx->xml);
+		break;
+#endif
+	}
+	job->errnum = errno;
+}
+
+static struct nftnl_ruleset_mt *nftnl_ruleset_mt_alloc(unsigned int nthreads,
+						       uint32_t flags)
+{
+	struct nftnl_ruleset_mt *mt;
+	unsigned int i;
+
+	if (nthreads == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = n > 0 ? n : 1;
+	}
+
+	mt = calloc(1, sizeof(struct nftnl_ruleset_mt));
+	if (mt == NULL)
+		return NULL;
+
+	/* A few objects per worker keep them busy while we deliver */
+	mt->num_jobs = nthreads * 4;
+	mt->flags = flags;
+
+	mt->jobs = calloc(mt->num_jobs, sizeof(struct nftnl_ruleset_job));
+	if (mt->jobs == NULL)
+		goto err1;
+
+	mt->free_jobs = calloc(mt->num_jobs, sizeof(struct nftnl_ruleset_job *));
+	if (mt->free_jobs == NULL)
+		goto err2;
+
+	for (i = 0; i < mt->num_jobs; i++)
+		mt->free_jobs[mt->num_free++] = &mt->jobs[i];
+
+	mt->pool = nftnl_pool_alloc(nthreads, mt->num_jobs,
+				    nftnl_ruleset_job_work);
+	if (mt->pool == NULL)
+		goto err3;
+
+	return mt;
+err3:
+	xfree(mt->free_jobs);
+err2:
+	xfree(mt->jobs);
+err1:
+	xfree(mt);
+	return NULL;
+}
+
+static void nftnl_ruleset_mt_free(struct nftnl_ruleset_mt *mt)
+{
+	unsigned int i;
+
+	nftnl_pool_free(mt->pool);
+	for (i = 0; i < mt->num_jobs; i++)
+		xfree(mt->jobs[i].buf);
+	xfree(mt->free_jobs);
+	xfree(mt->jobs);
+	xfree(mt);
+}
+
+/* Take one decoded object back from the pool and deliver it. Once anything
+ * went wrong, the remaining objects are only released.
+ */
+static int nftnl_ruleset_mt_complete(struct nftnl_parse_ctx *ctx,
+				     struct nftnl_parse_err *err)
+{
+	struct nftnl_ruleset_mt *mt = ctx->mt;
+	struct nftnl_ruleset_job *job;
+	int ret = 0;
+
+	job = nftnl_pool_complete(mt->pool,
+				  !(mt->flags & NFTNL_PARSE_F_UNORDERED));
+	if (job == NULL)
+		return 0;
+
+	if (job->deps & NFTNL_RULESET_JOB_READS_SETS)
+		mt->reads--;
+	if (job->deps & NFTNL_RULESET_JOB_WRITES_SETS)
+		mt->writes--;
+
+	if (job->ret < 0) {
+		if (!mt->failed) {
+			*err = job->err;
+			errno = job->errnum;
+			ret = -1;
+		}
+	} else if (mt->failed) {
+		nftnl_ruleset_ctx_free(&job->ctx);
+	} else {
+		ret = nftnl_ruleset_parse_deliver(&job->ctx, &ctx->set_id);
+	}
+
+	if (ret < 0)
+		mt->failed = true;
+	mt->free_jobs[mt->num_free++] = job;
+
+	return ret;
+}
+
+static int nftnl_ruleset_mt_drain(struct nftnl_parse_ctx *ctx,
+				  struct nftnl_parse_err *err)
+{
+	struct nftnl_ruleset_mt *mt = ctx->mt;
+
+	while (mt->num_free < mt->num_jobs)
+		nftnl_ruleset_mt_complete(ctx, err);
+
+	return mt->failed ? -1 : 0;
+}
+
+/* Queue the object that the stream has just sliced off */
+static int nftnl_ruleset_mt_submit(struct nftnl_parse_ctx *ctx, uint32_t type,
+				   const struct nftnl_parse_stream *s,
+				   struct nftnl_parse_err *err)
+{
+	struct nftnl_ruleset_mt *mt = ctx->mt;
+	struct nftnl_ruleset_job *job;
+	uint32_t deps;
+	char *buf;
+
+	switch (type) {
+	case NFTNL_RULESET_TABLE:
+	case NFTNL_RULESET_CHAIN:
+		deps = 0;
+		break;
+	case NFTNL_RULESET_RULE:
+		deps = NFTNL_RULESET_JOB_READS_SETS;
+		break;
+	case NFTNL_RULESET_SET:
+	case NFTNL_RULESET_SET_ELEMS:
+		deps = NFTNL_RULESET_JOB_WRITES_SETS;
+		break;
+	default:
+		/* Not known until decoded, assume the worst */
+		deps = NFTNL_RULESET_JOB_READS_SETS |
+		       NFTNL_RULESET_JOB_WRITES_SETS;
+		break;
+	}
+
+	while (mt->num_free == 0 || nftnl_pool_full(mt->pool) ||
+	       ((deps & NFTNL_RULESET_JOB_READS_SETS) && mt->writes > 0) ||
+	       ((deps & NFTNL_RULESET_JOB_WRITES_SETS) && mt->reads > 0)) {
+		if (nftnl_ruleset_mt_complete(ctx, err) < 0)
+			return -1;
+	}
+
+	job = mt->free_jobs[mt->num_free - 1];
+	if (job->size < s->val_len + 1) {
+		buf = realloc(job->buf, s->val_len + 1);
+		if (buf == NULL)
+			return -1;
+
+		job->buf = buf;
+		job->size = s->val_len + 1;
+	}
+	mt->num_free--;
+
+	memcpy(job->buf, s->val, s->val_len);
+	job->buf[s->val_len] = '\0';
+	job->len = s->val_len;
+	job->line = s->val_line;
+	job->column = s->val_column;
+	job->ctx = *ctx;
+	job->err = *err;
+	job->deps = deps;
+
+	if (deps & NFTNL_RULESET_JOB_READS_SETS)
+		mt->reads++;
+	if (deps & NFTNL_RULESET_JOB_WRITES_SETS)
+		mt->writes++;
+
+	return nftnl_pool_submit(mt->pool, job);
+}
+
+/* Deliver whatever is still in flight, unless the import already failed */
+static int nftnl_ruleset_mt_finish(struct nftnl_parse_ctx *ctx,
+				   struct nftnl_parse_err *err, int ret)
+{
+	if (ret < 0)
+		ctx->mt->failed = true;
+
+	return nftnl_ruleset_mt_drain(ctx, err);
+}
+
+/* Everything before a flush has to reach the callback first */
+static int nftnl_ruleset_stream_flush(struct nftnl_parse_ctx *ctx,
+				      struct nftnl_parse_err *err)
+{
+	if (ctx->mt != NULL && nftnl_ruleset_mt_drain(ctx, err) < 0)
+		return -1;
+
+	return nftnl_ruleset_parse_flush(ctx);
+}
 #endif
 
 #ifdef JSON_PARSING
+static int nftnl_ruleset_json_parse_node(struct nftnl_parse_ctx *ctx,
+					 json_t *node,
+					 struct nftnl_parse_err *err)
+{
+	ctx->json = node;
+	if (nftnl_ruleset_parse_obj(ctx, nftnl_ruleset_json_node_type(node),
+				    err) < 0)
+		return -1;
+
+	return nftnl_ruleset_parse_deliver(ctx, &ctx->set_id);
+}
+
 static int nftnl_ruleset_json_parse_ruleset(struct nftnl_parse_ctx *ctx,
 					  struct nftnl_parse_err *err)
 {
@@ -482,30 +919,14 @@ static int nftnl_ruleset_json_parse_ruleset(struct nftnl_parse_ctx *ctx,
 			return -1;
 		}
 
-		ctx->json = node;
-		if (nftnl_jansson_node_exist(node, "table"))
-			ret = nftnl_ruleset_parse_tables(ctx, err);
-		else if (nftnl_jansson_node_exist(node, "chain"))
-			ret = nftnl_ruleset_parse_chains(ctx, err);
-		else if (nftnl_jansson_node_exist(node, "set"))
-			ret = nftnl_ruleset_parse_sets(ctx, err);
-		else if (nftnl_jansson_node_exist(node, "rule"))
-			ret = nftnl_ruleset_parse_rules(ctx, err);
-		else if (nftnl_jansson_node_exist(node, "element"))
-			ret = nftnl_ruleset_parse_set_elems(ctx, err);
-		else
-			return -1;
-
+		ret = nftnl_ruleset_json_parse_node(ctx, node, err);
 		if (ret < 0)
 			return ret;
 	}
 
-	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH) {
-		nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE,
-					NFTNL_RULESET_RULESET);
-		if (ctx->cb(ctx) < 0)
-			return -1;
-	}
+	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH &&
+	    nftnl_ruleset_parse_flush(ctx) < 0)
+		return -1;
 
 	return 0;
 }
@@ -514,17 +935,10 @@ static int nftnl_ruleset_json_parse_cmd(const char *cmd,
 				      struct nftnl_parse_err *err,
 				      struct nftnl_parse_ctx *ctx)
 {
-	uint32_t cmdnum;
 	json_t *nodecmd;
 
-	cmdnum = nftnl_str2cmd(cmd);
-	if (cmdnum == NFTNL_CMD_UNSPEC) {
-		err->error = NFTNL_PARSE_EMISSINGNODE;
-		err->node_name = strdup(cmd);
+	if (nftnl_ruleset_ctx_set_cmd(cmd, err, ctx) < 0)
 		return -1;
-	}
-
-	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_CMD, cmdnum);
 
 	nodecmd = json_object_get(ctx->json, cmd);
 	if (nodecmd == NULL)
@@ -538,22 +952,211 @@ static int nftnl_ruleset_json_parse_cmd(const char *cmd,
 err:
 	return -1;
 }
+
+/* The type of a sliced object, from its first key */
+static uint32_t nftnl_ruleset_json_peek_type(const char *buf, size_t len)
+{
+	char key[NFTNL_JSON_KEY_MAX];
+	size_t i = 0, n = 0;
+
+	if (len == 0 || buf[i++] != '{')
+		return NFTNL_RULESET_UNSPEC;
+
+	while (i < len && (buf[i] == ' ' || buf[i] == '\t' ||
+			   buf[i] == '\n' || buf[i] == '\r'))
+		i++;
+	if (i == len || buf[i++] != '"')
+		return NFTNL_RULESET_UNSPEC;
+
+	while (i < len && buf[i] != '"' && n < sizeof(key) - 1)
+		key[n++] = buf[i++];
+	if (i == len || buf[i] != '"')
+		return NFTNL_RULESET_UNSPEC;
+	key[n] = '\0';
+
+	return nftnl_ruleset_type_by_name(key);
+}
+
+/*
+ * Files are parsed as a stream: only the skeleton of the document is walked
+ * here, every object inside the command arrays is handed to jansson on its
+ * own and released once the callback has seen it. This bounds memory usage
+ * to the largest object rather than to the whole ruleset.
+ */
+static int nftnl_ruleset_json_stream_cmd(struct nftnl_parse_stream *s,
+					 const char *cmd,
+					 struct nftnl_parse_err *err,
+					 struct nftnl_parse_ctx *ctx)
+{
+	json_t *node;
+	int c, len = 0, ret;
+
+	if (nftnl_ruleset_ctx_set_cmd(cmd, err, ctx) < 0)
+		return -1;
+
+	if (nftnl_parse_stream_next(s) != '[')
+		return nftnl_parse_stream_error(s, err);
+
+	c = nftnl_parse_stream_next(s);
+	while (c != ']') {
+		if (ctx->mt != NULL) {
+			if (nftnl_jansson_stream_slice(s, c, err) < 0)
+				return -1;
+
+			ret = nftnl_ruleset_mt_submit(ctx,
+				nftnl_ruleset_json_peek_type(s->val, s->val_len),
+				s, err);
+		} else {
+			node = nftnl_jansson_stream_load(s, c, err);
+			if (node == NULL)
+				return -1;
+
+			ret = nftnl_ruleset_json_parse_node(ctx, node, err);
+			nftnl_jansson_free_root(node);
+		}
+		if (ret < 0)
+			return ret;
+		len++;
+
+		c = nftnl_parse_stream_next(s);
+		if (c == ',')
+			c = nftnl_parse_stream_next(s);
+		else if (c != ']')
+			return nftnl_parse_stream_error(s, err);
+	}
+
+	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH &&
+	    nftnl_ruleset_stream_flush(ctx, err) < 0)
+		return -1;
+
+	return 0;
+}
+
+/* Like the tree based parser, only the first key of each command counts */
+static int nftnl_ruleset_json_stream_cmds(struct nftnl_parse_stream *s,
+					  struct nftnl_parse_err *err,
+					  struct nftnl_parse_ctx *ctx)
+{
+	char key[NFTNL_JSON_KEY_MAX];
+	int c, i;
+
+	if (nftnl_parse_stream_next(s) != '[')
+		return nftnl_parse_stream_error(s, err);
+
+	c = nftnl_parse_stream_next(s);
+	while (c != ']') {
+		if (c != '{' || nftnl_parse_stream_next(s) != '"')
+			return nftnl_parse_stream_error(s, err);
+
+		for (i = 0; ; i++) {
+			if (nftnl_jansson_stream_key(s, key, sizeof(key)) < 0 ||
+			    nftnl_parse_stream_next(s) != ':')
+				return nftnl_parse_stream_error(s, err);
+
+			if (i == 0) {
+				if (nftnl_ruleset_json_stream_cmd(s, key, err,
+								  ctx) < 0)
+					return -1;
+			} else if (nftnl_jansson_stream_skip(s,
+					nftnl_parse_stream_next(s)) < 0) {
+				return nftnl_parse_stream_error(s, err);
+			}
+
+			c = nftnl_parse_stream_next(s);
+			if (c == '}')
+				break;
+			if (c != ',' || nftnl_parse_stream_next(s) != '"')
+				return nftnl_parse_stream_error(s, err);
+		}
+
+		c = nftnl_parse_stream_next(s);
+		if (c == ',')
+			c = nftnl_parse_stream_next(s);
+		else if (c != ']')
+			return nftnl_parse_stream_error(s, err);
+	}
+
+	return 0;
+}
+
+static int nftnl_ruleset_json_stream(FILE *fp, struct nftnl_parse_err *err,
+				     struct nftnl_parse_ctx *ctx)
+{
+	struct nftnl_parse_stream s;
+	char key[NFTNL_JSON_KEY_MAX];
+	bool found = false;
+	int c, ret = -1;
+
+	nftnl_parse_stream_init(&s, fp);
+
+	if (nftnl_parse_stream_next(&s) != '{') {
+		nftnl_parse_stream_error(&s, err);
+		goto out;
+	}
+
+	c = nftnl_parse_stream_next(&s);
+	while (c != '}') {
+		if (c != '"' ||
+		    nftnl_jansson_stream_key(&s, key, sizeof(key)) < 0 ||
+		    nftnl_parse_stream_next(&s) != ':') {
+			nftnl_parse_stream_error(&s, err);
+			goto out;
+		}
+
+		if (strcmp(key, "nftables") == 0 && !found) {
+			if (nftnl_ruleset_json_stream_cmds(&s, err, ctx) < 0)
+				goto out;
+			found = true;
+		} else if (nftnl_jansson_stream_skip(&s,
+				nftnl_parse_stream_next(&s)) < 0) {
+			nftnl_parse_stream_error(&s, err);
+			goto out;
+		}
+
+		c = nftnl_parse_stream_next(&s);
+		if (c == ',')
+			c = nftnl_parse_stream_next(&s);
+		else if (c != '}') {
+			nftnl_parse_stream_error(&s, err);
+			goto out;
+		}
+	}
+
+	if (nftnl_parse_stream_next(&s) != EOF) {
+		nftnl_parse_stream_error(&s, err);
+		goto out;
+	}
+
+	if (!found) {
+		errno = EINVAL;
+		goto out;
+	}
+
+	ret = 0;
+out:
+	nftnl_parse_stream_fini(&s);
+	return ret;
+}
 #endif
 
 static int nftnl_ruleset_json_parse(const void *json,
 				  struct nftnl_parse_err *err,
 				  enum nftnl_parse_input input,
 				  enum nftnl_parse_type type, void *arg,
-				  int (*cb)(const struct nftnl_parse_ctx *ctx))
+				  int (*cb)(const struct nftnl_parse_ctx *ctx),
+				  struct nftnl_ruleset_mt *mt,
+				  struct nftnl_ruleset_objs *objs)
 {
 #ifdef JSON_PARSING
 	json_t *root, *array, *node;
 	json_error_t error;
-	int i, len;
+	int i, len, ret;
 	const char *key;
-	struct nftnl_parse_ctx ctx;
+	struct nftnl_parse_ctx ctx = {};
 
 	ctx.cb = cb;
+	ctx.mt = mt;
+	ctx.objs = objs;
 	ctx.format = type;
 
 	ctx.set_list = nftnl_set_list_alloc();
@@ -563,6 +1166,15 @@ static int nftnl_ruleset_json_parse(const void *json,
 	if (arg != NULL)
 		nftnl_ruleset_ctx_set(&ctx, NFTNL_RULESET_CTX_DATA, arg);
 
+	if (input == NFTNL_PARSE_FILE) {
+		ret = nftnl_ruleset_json_stream((FILE *)json, err, &ctx);
+		if (mt != NULL)
+			ret = nftnl_ruleset_mt_finish(&ctx, err, ret);
+
+		nftnl_set_list_free(ctx.set_list);
+		return ret;
+	}
+
 	root = nftnl_jansson_create_root(json, &error, err, input);
 	if (root == NULL)
 		goto err1;
@@ -604,87 +1216,182 @@ err1:
 }
 
 #ifdef XML_PARSING
+static int nftnl_ruleset_xml_parse_node(struct nftnl_parse_ctx *ctx,
+					mxml_node_t *node,
+					struct nftnl_parse_err *err)
+{
+	ctx->xml = node;
+	if (nftnl_ruleset_parse_obj(ctx,
+				    nftnl_ruleset_type_by_name(node->value.opaque),
+				    err) < 0)
+		return -1;
+
+	return nftnl_ruleset_parse_deliver(ctx, &ctx->set_id);
+}
+
 static int nftnl_ruleset_xml_parse_ruleset(struct nftnl_parse_ctx *ctx,
 					 struct nftnl_parse_err *err)
 {
-	const char *node_type;
-	mxml_node_t *node, *array = ctx->xml;
+	mxml_node_t *node, *array = ctx->xml;
+	int len = 0, ret;
+
+	for (node = mxmlFindElement(array, array, NULL, NULL, NULL,
+				    MXML_DESCEND_FIRST);
+	     node != NULL;
+	     node = mxmlFindElement(node, array, NULL, NULL, NULL,
+				    MXML_NO_DESCEND)) {
+		len++;
+		ret = nftnl_ruleset_xml_parse_node(ctx, node, err);
+		if (ret < 0)
+			return ret;
+	}
+
+	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH &&
+	    nftnl_ruleset_parse_flush(ctx) < 0)
+		return -1;
+
+	return 0;
+}
+
+static int nftnl_ruleset_xml_parse_cmd(const char *cmd, struct nftnl_parse_err *err,
+				     struct nftnl_parse_ctx *ctx)
+{
+	mxml_node_t *nodecmd;
+
+	if (nftnl_ruleset_ctx_set_cmd(cmd, err, ctx) < 0)
+		return -1;
+
+	nodecmd = mxmlFindElement(ctx->xml, ctx->xml, cmd, NULL, NULL,
+				  MXML_DESCEND_FIRST);
+
+	ctx->xml = nodecmd;
+
+	if (nftnl_ruleset_xml_parse_ruleset(ctx, err) != 0)
+		goto err;
+
+	return 0;
+err:
+	return -1;
+}
+
+/*
+ * Files are parsed as a stream like JSON ones above. Each
+ * element inside a command is loaded as a tree of its own.
+ */
+static int nftnl_ruleset_xml_stream_cmd(struct nftnl_parse_stream *s,
+					const char *cmd, int tag,
+					struct nftnl_parse_err *err,
+					struct nftnl_parse_ctx *ctx)
+{
+	char name[NFTNL_XML_NAME_MAX];
+	mxml_node_t *node;
 	int len = 0, ret;
 
-	for (node = mxmlFindElement(array, array, NULL, NULL, NULL,
-				    MXML_DESCEND_FIRST);
-	     node != NULL;
-	     node = mxmlFindElement(node, array, NULL, NULL, NULL,
-				    MXML_NO_DESCEND)) {
-		len++;
-		node_type = node->value.opaque;
-		ctx->xml = node;
-		if (strcmp(node_type, "table") == 0)
-			ret = nftnl_ruleset_parse_tables(ctx, err);
-		else if (strcmp(node_type, "chain") == 0)
-			ret = nftnl_ruleset_parse_chains(ctx, err);
-		else if (strcmp(node_type, "set") == 0)
-			ret = nftnl_ruleset_parse_sets(ctx, err);
-		else if (strcmp(node_type, "rule") == 0)
-			ret = nftnl_ruleset_parse_rules(ctx, err);
-		else if (strcmp(node_type, "element") == 0)
-			ret = nftnl_ruleset_parse_set_elems(ctx, err);
-		else
-			return -1;
+	if (nftnl_ruleset_ctx_set_cmd(cmd, err, ctx) < 0)
+		return -1;
+
+	while (tag == NFTNL_MXML_TAG_OPEN) {
+		tag = nftnl_mxml_stream_tag(s, name, sizeof(name));
+		if (tag == NFTNL_MXML_TAG_CLOSE && strcmp(name, cmd) == 0)
+			break;
+		if (tag != NFTNL_MXML_TAG_OPEN && tag != NFTNL_MXML_TAG_EMPTY)
+			return nftnl_parse_stream_error(s, err);
+
+		if (ctx->mt != NULL) {
+			if (nftnl_mxml_stream_slice(s, tag, err) < 0)
+				return -1;
 
+			ret = nftnl_ruleset_mt_submit(ctx,
+				nftnl_ruleset_type_by_name(name), s, err);
+		} else {
+			node = nftnl_mxml_stream_load(s, tag, err);
+			if (node == NULL)
+				return -1;
+
+			ret = nftnl_ruleset_xml_parse_node(ctx, node, err);
+			mxmlDelete(node);
+		}
 		if (ret < 0)
 			return ret;
-	}
 
-	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH) {
-		nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_TYPE,
-					NFTNL_RULESET_RULESET);
-		if (ctx->cb(ctx) < 0)
-			return -1;
+		len++;
+		tag = NFTNL_MXML_TAG_OPEN;
 	}
 
+	if (len == 0 && ctx->cmd == NFTNL_CMD_FLUSH &&
+	    nftnl_ruleset_stream_flush(ctx, err) < 0)
+		return -1;
+
 	return 0;
 }
 
-static int nftnl_ruleset_xml_parse_cmd(const char *cmd, struct nftnl_parse_err *err,
-				     struct nftnl_parse_ctx *ctx)
+static int nftnl_ruleset_xml_stream(FILE *fp, struct nftnl_parse_err *err,
+				    struct nftnl_parse_ctx *ctx)
 {
-	uint32_t cmdnum;
-	mxml_node_t *nodecmd;
+	char name[NFTNL_XML_NAME_MAX];
+	struct nftnl_parse_stream s;
+	int tag, ret = -1;
 
-	cmdnum = nftnl_str2cmd(cmd);
-	if (cmdnum == NFTNL_CMD_UNSPEC) {
+	nftnl_parse_stream_init(&s, fp);
+
+	tag = nftnl_mxml_stream_tag(&s, name, sizeof(name));
+	if (tag < 0) {
+		nftnl_parse_stream_error(&s, err);
+		goto out;
+	}
+	if ((tag != NFTNL_MXML_TAG_OPEN && tag != NFTNL_MXML_TAG_EMPTY) ||
+	    strcmp(name, "nftables") != 0) {
 		err->error = NFTNL_PARSE_EMISSINGNODE;
-		err->node_name = strdup(cmd);
-		return -1;
+		err->node_name = "nftables";
+		errno = EINVAL;
+		goto out;
 	}
 
-	nodecmd = mxmlFindElement(ctx->xml, ctx->xml, cmd, NULL, NULL,
-				  MXML_DESCEND_FIRST);
+	while (tag == NFTNL_MXML_TAG_OPEN) {
+		tag = nftnl_mxml_stream_tag(&s, name, sizeof(name));
+		if (tag == NFTNL_MXML_TAG_CLOSE &&
+		    strcmp(name, "nftables") == 0)
+			break;
+		if (tag != NFTNL_MXML_TAG_OPEN && tag != NFTNL_MXML_TAG_EMPTY) {
+			nftnl_parse_stream_error(&s, err);
+			goto out;
+		}
 
-	ctx->xml = nodecmd;
-	nftnl_ruleset_ctx_set_u32(ctx, NFTNL_RULESET_CTX_CMD, cmdnum);
+		if (nftnl_ruleset_xml_stream_cmd(&s, name, tag, err, ctx) < 0)
+			goto out;
 
-	if (nftnl_ruleset_xml_parse_ruleset(ctx, err) != 0)
-		goto err;
+		tag = NFTNL_MXML_TAG_OPEN;
+	}
 
-	return 0;
-err:
-	return -1;
+	if (nftnl_mxml_stream_tag(&s, name, sizeof(name)) !=
+	    NFTNL_MXML_TAG_EOF) {
+		nftnl_parse_stream_error(&s, err);
+		goto out;
+	}
+
+	ret = 0;
+out:
+	nftnl_parse_stream_fini(&s);
+	return ret;
 }
 #endif
 
 static int nftnl_ruleset_xml_parse(const void *xml, struct nftnl_parse_err *err,
 				 enum nftnl_parse_input input,
 				 enum nftnl_parse_type type, void *arg,
-				 int (*cb)(const struct nftnl_parse_ctx *ctx))
+				 int (*cb)(const struct nftnl_parse_ctx *ctx),
+				 struct nftnl_ruleset_mt *mt,
+				 struct nftnl_ruleset_objs *objs)
 {
 #ifdef XML_PARSING
 	mxml_node_t *tree, *nodecmd = NULL;
 	char *cmd;
-	struct nftnl_parse_ctx ctx;
+	struct nftnl_parse_ctx ctx = {};
+	int ret;
 
 	ctx.cb = cb;
+	ctx.mt = mt;
+	ctx.objs = objs;
 	ctx.format = type;
 
 	ctx.set_list = nftnl_set_list_alloc();
@@ -694,6 +1401,15 @@ static int nftnl_ruleset_xml_parse(const void *xml, struct nftnl_parse_err *err,
 	if (arg != NULL)
 		nftnl_ruleset_ctx_set(&ctx, NFTNL_RULESET_CTX_DATA, arg);
 
+	if (input == NFTNL_PARSE_FILE) {
+		ret = nftnl_ruleset_xml_stream((FILE *)xml, err, &ctx);
+		if (mt != NULL)
+			ret = nftnl_ruleset_mt_finish(&ctx, err, ret);
+
+		nftnl_set_list_free(ctx.set_list);
+		return ret;
+	}
+
 	tree = nftnl_mxml_build_tree(xml, "nftables", err, input);
 	if (tree == NULL)
 		goto err1;
@@ -722,19 +1438,26 @@ err1:
 #endif
 }
 
+/* With @objs, objects are parsed into these and the callback must not free
+ * them. Parallel imports need an object per job, they cannot use them.
+ */
 static int
 nftnl_ruleset_do_parse(enum nftnl_parse_type type, const void *data,
 		     struct nftnl_parse_err *err, enum nftnl_parse_input input,
-		     void *arg, int (*cb)(const struct nftnl_parse_ctx *ctx))
+		     void *arg, int (*cb)(const struct nftnl_parse_ctx *ctx),
+		     struct nftnl_ruleset_mt *mt,
+		     struct nftnl_ruleset_objs *objs)
 {
 	int ret;
 
 	switch (type) {
 	case NFTNL_PARSE_XML:
-		ret = nftnl_ruleset_xml_parse(data, err, input, type, arg, cb);
+		ret = nftnl_ruleset_xml_parse(data, err, input, type, arg, cb,
+					      mt, objs);
 		break;
 	case NFTNL_PARSE_JSON:
-		ret = nftnl_ruleset_json_parse(data, err, input, type, arg, cb);
+		ret = nftnl_ruleset_json_parse(data, err, input, type, arg, cb,
+					       mt, objs);
 		break;
 	default:
 		ret = -1;
@@ -749,16 +1472,43 @@ int nftnl_ruleset_parse_file_cb(enum nftnl_parse_type type, FILE *fp,
 			      struct nftnl_parse_err *err, void *data,
 			      int (*cb)(const struct nftnl_parse_ctx *ctx))
 {
-	return nftnl_ruleset_do_parse(type, fp, err, NFTNL_PARSE_FILE, data, cb);
+	return nftnl_ruleset_do_parse(type, fp, err, NFTNL_PARSE_FILE, data, cb,
+				      NULL, NULL);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_parse_file_cb, nft_ruleset_parse_file_cb);
 
+EXPORT_SYMBOL(nftnl_ruleset_parse_file_cb_parallel);
+int nftnl_ruleset_parse_file_cb_parallel(enum nftnl_parse_type type, FILE *fp,
+					 struct nftnl_parse_err *err,
+					 void *data,
+					 int (*cb)(const struct nftnl_parse_ctx *ctx),
+					 unsigned int nthreads, uint32_t flags)
+{
+#if defined(JSON_PARSING) || defined(XML_PARSING)
+	struct nftnl_ruleset_mt *mt;
+	int ret;
+
+	mt = nftnl_ruleset_mt_alloc(nthreads, flags);
+	if (mt == NULL)
+		return -1;
+
+	ret = nftnl_ruleset_do_parse(type, fp, err, NFTNL_PARSE_FILE, data, cb,
+				     mt, NULL);
+	nftnl_ruleset_mt_free(mt);
+
+	return ret;
+#else
+	errno = EOPNOTSUPP;
+	return -1;
+#endif
+}
+
 int nftnl_ruleset_parse_buffer_cb(enum nftnl_parse_type type, const char *buffer,
 				struct nftnl_parse_err *err, void *data,
 				int (*cb)(const struct nftnl_parse_ctx *ctx))
 {
 	return nftnl_ruleset_do_parse(type, buffer, err, NFTNL_PARSE_BUFFER, data,
-				    cb);
+				    cb, NULL, NULL);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_parse_buffer_cb, nft_ruleset_parse_buffer_cb);
 
@@ -837,6 +1587,304 @@ int nftnl_ruleset_parse_file(struct nftnl_ruleset *rs, enum nftnl_parse_type typ
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_parse_file, nft_ruleset_parse_file);
 
+/*
+ * Compiling turns every object into netlink messages right after it has
+ * been parsed, the ruleset is never held in memory. There is one object of
+ * each type that is reset and parsed into again for every object of the
+ * document, and messages are built right into the batch. The batch has to
+ * take messages as large as the element lists of sets, as nft allocates it.
+ */
+#define NFTNL_RULESET_MSG_MAX	(UINT16_MAX + 4096)
+
+struct nftnl_ruleset_compiler {
+	struct nftnl_batch	*batch;
+	uint32_t		*seq;
+};
+
+static struct nlmsghdr *
+nftnl_ruleset_compile_hdr(struct nftnl_ruleset_compiler *c, uint16_t cmd,
+			  uint16_t family, uint16_t flags)
+{
+	return nftnl_nlmsg_build_hdr(nftnl_batch_buffer(c->batch), cmd, family,
+				     NLM_F_ACK | flags, *c->seq);
+}
+
+static int nftnl_ruleset_compile_add(struct nftnl_ruleset_compiler *c,
+				     struct nlmsghdr *nlh)
+{
+	if (nlh->nlmsg_len > nftnl_batch_msg_max(c->batch)) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+	(*c->seq)++;
+
+	return nftnl_batch_update(c->batch);
+}
+
+static int nftnl_ruleset_compile_table(struct nftnl_ruleset_compiler *c,
+				       uint32_t cmd, struct nftnl_table *t)
+{
+	uint16_t family = nftnl_table_get_u32(t, NFTNL_TABLE_FAMILY);
+	struct nlmsghdr *nlh;
+
+	switch (cmd) {
+	case NFTNL_CMD_ADD:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWTABLE, family,
+						NLM_F_CREATE);
+		nftnl_table_nlmsg_build_payload(nlh, t);
+		break;
+	case NFTNL_CMD_DELETE:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELTABLE, family, 0);
+		nftnl_table_nlmsg_build_payload(nlh, t);
+		break;
+	case NFTNL_CMD_FLUSH:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELRULE, family, 0);
+		mnl_attr_put_strz(nlh, NFTA_RULE_TABLE,
+				  nftnl_table_get_str(t, NFTNL_TABLE_NAME));
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	return nftnl_ruleset_compile_add(c, nlh);
+}
+
+static int nftnl_ruleset_compile_chain(struct nftnl_ruleset_compiler *c,
+				       uint32_t cmd, struct nftnl_chain *ch)
+{
+	uint16_t family = nftnl_chain_get_u32(ch, NFTNL_CHAIN_FAMILY);
+	struct nlmsghdr *nlh;
+
+	switch (cmd) {
+	case NFTNL_CMD_ADD:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWCHAIN, family,
+						NLM_F_CREATE);
+		nftnl_chain_nlmsg_build_payload(nlh, ch);
+		break;
+	case NFTNL_CMD_DELETE:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELCHAIN, family, 0);
+		nftnl_chain_nlmsg_build_payload(nlh, ch);
+		break;
+	case NFTNL_CMD_FLUSH:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELRULE, family, 0);
+		mnl_attr_put_strz(nlh, NFTA_RULE_TABLE,
+				  nftnl_chain_get_str(ch, NFTNL_CHAIN_TABLE));
+		mnl_attr_put_strz(nlh, NFTA_RULE_CHAIN,
+				  nftnl_chain_get_str(ch, NFTNL_CHAIN_NAME));
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	return nftnl_ruleset_compile_add(c, nlh);
+}
+
+/* Large sets are split, the elements attribute is limited to 64KB */
+static int nftnl_ruleset_compile_elems(struct nftnl_ruleset_compiler *c,
+				       uint16_t cmd, uint16_t flags,
+				       struct nftnl_set *s)
+{
+	uint16_t family = nftnl_set_get_u32(s, NFTNL_SET_FAMILY);
+	struct nftnl_set_elems_iter *iter;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	/* No messages for sets without elements, nor an iterator */
+	if (list_empty(nftnl_set_elems(s)))
+		return 0;
+
+	iter = nftnl_set_elems_iter_create_ro(s);
+	if (iter == NULL)
+		return -1;
+
+	do {
+		nlh = nftnl_ruleset_compile_hdr(c, cmd, family, flags);
+		ret = nftnl_set_elems_nlmsg_build_payload_iter(nlh, iter);
+		if (nftnl_ruleset_compile_add(c, nlh) < 0)
+			ret = -1;
+	} while (ret > 0);
+	nftnl_set_elems_iter_destroy(iter);
+
+	return ret;
+}
+
+static int nftnl_ruleset_compile_set(struct nftnl_ruleset_compiler *c,
+				     uint32_t cmd, struct nftnl_set *s)
+{
+	uint16_t family = nftnl_set_get_u32(s, NFTNL_SET_FAMILY);
+	struct nlmsghdr *nlh;
+
+	switch (cmd) {
+	case NFTNL_CMD_ADD:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWSET, family,
+						NLM_F_CREATE);
+		nftnl_set_nlmsg_build_payload(nlh, s);
+		if (nftnl_ruleset_compile_add(c, nlh) < 0)
+			return -1;
+
+		return nftnl_ruleset_compile_elems(c, NFT_MSG_NEWSETELEM,
+						   NLM_F_CREATE, s);
+	case NFTNL_CMD_DELETE:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELSET, family, 0);
+		nftnl_set_nlmsg_build_payload(nlh, s);
+		break;
+	case NFTNL_CMD_FLUSH:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELSETELEM, family, 0);
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE,
+				  nftnl_set_get_str(s, NFTNL_SET_TABLE));
+		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET,
+				  nftnl_set_get_str(s, NFTNL_SET_NAME));
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	return nftnl_ruleset_compile_add(c, nlh);
+}
+
+static int nftnl_ruleset_compile_set_elems(struct nftnl_ruleset_compiler *c,
+					   uint32_t cmd, struct nftnl_set *s)
+{
+	switch (cmd) {
+	case NFTNL_CMD_ADD:
+		return nftnl_ruleset_compile_elems(c, NFT_MSG_NEWSETELEM,
+						   NLM_F_CREATE, s);
+	case NFTNL_CMD_DELETE:
+		return nftnl_ruleset_compile_elems(c, NFT_MSG_DELSETELEM, 0, s);
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
+
+static int nftnl_ruleset_compile_rule(struct nftnl_ruleset_compiler *c,
+				      uint32_t cmd, struct nftnl_rule *r)
+{
+	uint16_t family = nftnl_rule_get_u32(r, NFTNL_RULE_FAMILY);
+	struct nlmsghdr *nlh;
+
+	switch (cmd) {
+	case NFTNL_CMD_ADD:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWRULE, family,
+						NLM_F_CREATE | NLM_F_APPEND);
+		break;
+	case NFTNL_CMD_INSERT:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWRULE, family,
+						NLM_F_CREATE);
+		break;
+	case NFTNL_CMD_REPLACE:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_NEWRULE, family,
+						NLM_F_REPLACE);
+		break;
+	case NFTNL_CMD_DELETE:
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELRULE, family, 0);
+		break;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+
+	return nftnl_ruleset_compile_add(c, nlh);
+}
+
+/* The objects belong to the compiler, they are reused for the next ones */
+static int nftnl_ruleset_compile_cb(const struct nftnl_parse_ctx *ctx)
+{
+	struct nftnl_ruleset_compiler *c = ctx->data;
+	struct nlmsghdr *nlh;
+
+	switch (ctx->type) {
+	case NFTNL_RULESET_TABLE:
+		return nftnl_ruleset_compile_table(c, ctx->cmd, ctx->table);
+	case NFTNL_RULESET_CHAIN:
+		return nftnl_ruleset_compile_chain(c, ctx->cmd, ctx->chain);
+	case NFTNL_RULESET_SET:
+		return nftnl_ruleset_compile_set(c, ctx->cmd, ctx->set);
+	case NFTNL_RULESET_SET_ELEMS:
+		return nftnl_ruleset_compile_set_elems(c, ctx->cmd, ctx->set);
+	case NFTNL_RULESET_RULE:
+		return nftnl_ruleset_compile_rule(c, ctx->cmd, ctx->rule);
+	case NFTNL_RULESET_RULESET:
+		if (ctx->cmd != NFTNL_CMD_FLUSH) {
+			errno = EOPNOTSUPP;
+			return -1;
+		}
+		/* Tables of all families, with everything inside them */
+		nlh = nftnl_ruleset_compile_hdr(c, NFT_MSG_DELTABLE,
+						NFPROTO_UNSPEC, 0);
+		return nftnl_ruleset_compile_add(c, nlh);
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+}
+
+static int nftnl_ruleset_compile(enum nftnl_parse_type type, const void *data,
+				 enum nftnl_parse_input input,
+				 struct nftnl_batch *batch, uint32_t *seq,
+				 struct nftnl_parse_err *err)
+{
+	struct nftnl_ruleset_compiler c = {
+		.batch	= batch,
+		.seq	= seq,
+	};
+	struct nftnl_ruleset_objs objs = {};
+	int ret = -1;
+
+	if (nftnl_batch_msg_max(batch) < NFTNL_RULESET_MSG_MAX) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	objs.table = nftnl_table_alloc();
+	if (objs.table == NULL)
+		goto err1;
+	objs.chain = nftnl_chain_alloc();
+	if (objs.chain == NULL)
+		goto err2;
+	objs.set = nftnl_set_alloc();
+	if (objs.set == NULL)
+		goto err3;
+	objs.rule = nftnl_rule_alloc();
+	if (objs.rule == NULL)
+		goto err4;
+
+	ret = nftnl_ruleset_do_parse(type, data, err, input, &c,
+				     nftnl_ruleset_compile_cb, NULL, &objs);
+
+	nftnl_rule_free(objs.rule);
+err4:
+	nftnl_set_free(objs.set);
+err3:
+	nftnl_chain_free(objs.chain);
+err2:
+	nftnl_table_free(objs.table);
+err1:
+	return ret;
+}
+
+EXPORT_SYMBOL(nftnl_ruleset_compile_buffer);
+int nftnl_ruleset_compile_buffer(enum nftnl_parse_type type,
+				 const char *buffer, struct nftnl_batch *batch,
+				 uint32_t *seq, struct nftnl_parse_err *err)
+{
+	return nftnl_ruleset_compile(type, buffer, NFTNL_PARSE_BUFFER, batch,
+				     seq, err);
+}
+
+EXPORT_SYMBOL(nftnl_ruleset_compile_file);
+int nftnl_ruleset_compile_file(enum nftnl_parse_type type, FILE *fp,
+			       struct nftnl_batch *batch, uint32_t *seq,
+			       struct nftnl_parse_err *err)
+{
+	return nftnl_ruleset_compile(type, fp, NFTNL_PARSE_FILE, batch, seq,
+				     err);
+}
+
 static const char *nftnl_ruleset_o_opentag(uint32_t type)
 {
 	switch (type) {
@@ -1099,222 +2147,236 @@ int nftnl_ruleset_snprintf(char *buf, size_t size, const struct nftnl_ruleset *r
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_snprintf, nft_ruleset_snprintf);
 
-static int nftnl_ruleset_fprintf_tables(FILE *fp, const struct nftnl_ruleset *rs,
-				      uint32_t type, uint32_t flags)
+static int nftnl_ruleset_export_tables(struct nftnl_sink *sink,
+				       const struct nftnl_ruleset *rs,
+				       uint32_t type, uint32_t flags)
 {
-	int len = 0, ret = 0;
 	struct nftnl_table *t;
-	struct nftnl_table_list_iter *ti;
+	struct nftnl_table_list_iter *it;
 
-	ti = nftnl_table_list_iter_create(rs->table_list);
-	if (ti == NULL)
+	it = nftnl_table_list_iter_create(rs->table_list);
+	if (it == NULL)
 		return -1;
 
-	t = nftnl_table_list_iter_next(ti);
+	t = nftnl_table_list_iter_next(it);
 	while (t != NULL) {
-		ret = nftnl_table_fprintf(fp, t, type, flags);
-		if (ret < 0)
+		if (nftnl_table_export(sink, t, type, flags) < 0)
 			goto err;
 
-		len += ret;
-
-		t = nftnl_table_list_iter_next(ti);
+		t = nftnl_table_list_iter_next(it);
 
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(t, type));
-		if (ret < 0)
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(t, type)) < 0)
 			goto err;
-
-		len += ret;
 	}
-	nftnl_table_list_iter_destroy(ti);
+	nftnl_table_list_iter_destroy(it);
 
-	return len;
+	return 0;
 err:
-	nftnl_table_list_iter_destroy(ti);
+	nftnl_table_list_iter_destroy(it);
 	return -1;
 }
 
-static int nftnl_ruleset_fprintf_chains(FILE *fp, const struct nftnl_ruleset *rs,
-				      uint32_t type, uint32_t flags)
+static int nftnl_ruleset_export_chains(struct nftnl_sink *sink,
+				       const struct nftnl_ruleset *rs,
+				       uint32_t type, uint32_t flags)
 {
-	int len = 0, ret = 0;
-	struct nftnl_chain *o;
-	struct nftnl_chain_list_iter *i;
+	struct nftnl_chain *c;
+	struct nftnl_chain_list_iter *it;
 
-	i = nftnl_chain_list_iter_create(rs->chain_list);
-	if (i == NULL)
+	it = nftnl_chain_list_iter_create(rs->chain_list);
+	if (it == NULL)
 		return -1;
 
-	o = nftnl_chain_list_iter_next(i);
-	while (o != NULL) {
-		ret = nftnl_chain_fprintf(fp, o, type, flags);
-		if (ret < 0)
+	c = nftnl_chain_list_iter_next(it);
+	while (c != NULL) {
+		if (nftnl_chain_export(sink, c, type, flags) < 0)
 			goto err;
 
-		len += ret;
+		c = nftnl_chain_list_iter_next(it);
 
-		o = nftnl_chain_list_iter_next(i);
-
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(o, type));
-		if (ret < 0)
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(c, type)) < 0)
 			goto err;
-
-		len += ret;
 	}
-	nftnl_chain_list_iter_destroy(i);
+	nftnl_chain_list_iter_destroy(it);
 
-	return len;
+	return 0;
 err:
-	nftnl_chain_list_iter_destroy(i);
+	nftnl_chain_list_iter_destroy(it);
 	return -1;
 }
 
-static int nftnl_ruleset_fprintf_sets(FILE *fp, const struct nftnl_ruleset *rs,
-				    uint32_t type, uint32_t flags)
+static int nftnl_ruleset_export_sets(struct nftnl_sink *sink,
+				     const struct nftnl_ruleset *rs,
+				     uint32_t type, uint32_t flags)
 {
-	int len = 0, ret = 0;
-	struct nftnl_set *o;
-	struct nftnl_set_list_iter *i;
+	struct nftnl_set *s;
+	struct nftnl_set_list_iter *it;
 
-	i = nftnl_set_list_iter_create(rs->set_list);
-	if (i == NULL)
+	it = nftnl_set_list_iter_create(rs->set_list);
+	if (it == NULL)
 		return -1;
 
-	o = nftnl_set_list_iter_next(i);
-	while (o != NULL) {
-		ret = nftnl_set_fprintf(fp, o, type, flags);
-		if (ret < 0)
+	s = nftnl_set_list_iter_next(it);
+	while (s != NULL) {
+		if (nftnl_set_export(sink, s, type, flags) < 0)
 			goto err;
 
-		len += ret;
+		s = nftnl_set_list_iter_next(it);
 
-		o = nftnl_set_list_iter_next(i);
-
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(o, type));
-		if (ret < 0)
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(s, type)) < 0)
 			goto err;
-
-		len += ret;
 	}
-	nftnl_set_list_iter_destroy(i);
+	nftnl_set_list_iter_destroy(it);
 
-	return len;
+	return 0;
 err:
-	nftnl_set_list_iter_destroy(i);
+	nftnl_set_list_iter_destroy(it);
 	return -1;
 }
 
-static int nftnl_ruleset_fprintf_rules(FILE *fp, const struct nftnl_ruleset *rs,
-				    uint32_t type, uint32_t flags)
+static int nftnl_ruleset_export_rules(struct nftnl_sink *sink,
+				      const struct nftnl_ruleset *rs,
+				      uint32_t type, uint32_t flags)
 {
-	int len = 0, ret = 0;
-	struct nftnl_rule *o;
-	struct nftnl_rule_list_iter *i;
+	struct nftnl_rule *r;
+	struct nftnl_rule_list_iter *it;
 
-	i = nftnl_rule_list_iter_create(rs->rule_list);
-	if (i == NULL)
+	it = nftnl_rule_list_iter_create(rs->rule_list);
+	if (it == NULL)
 		return -1;
 
-	o = nftnl_rule_list_iter_next(i);
-	while (o != NULL) {
-		ret = nftnl_rule_fprintf(fp, o, type, flags);
-		if (ret < 0)
+	r = nftnl_rule_list_iter_next(it);
+	while (r != NULL) {
+		if (nftnl_rule_export(sink, r, type, flags) < 0)
 			goto err;
 
-		len += ret;
-
-		o = nftnl_rule_list_iter_next(i);
+		r = nftnl_rule_list_iter_next(it);
 
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(o, type));
-		if (ret < 0)
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(r, type)) < 0)
 			goto err;
-
-		len += ret;
 	}
-	nftnl_rule_list_iter_destroy(i);
+	nftnl_rule_list_iter_destroy(it);
 
-	return len;
+	return 0;
 err:
-	nftnl_rule_list_iter_destroy(i);
+	nftnl_rule_list_iter_destroy(it);
 	return -1;
 }
 
-#define NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len)	\
-	if (ret < 0)				\
-		return -1;			\
-	len += ret;
-
-static int nftnl_ruleset_cmd_fprintf(FILE *fp, const struct nftnl_ruleset *rs,
-				   uint32_t cmd, uint32_t type, uint32_t flags)
+static int nftnl_ruleset_cmd_export(struct nftnl_sink *sink,
+				    const struct nftnl_ruleset *rs,
+				    uint32_t cmd, uint32_t type, uint32_t flags)
 {
-	int len = 0, ret = 0;
-	void *prev = NULL;
 	uint32_t inner_flags = flags;
+	uint64_t total;
+	void *prev = NULL;
 
 	/* dont pass events flags to child calls of _snprintf() */
 	inner_flags &= ~NFTNL_OF_EVENT_ANY;
 
-	ret = fprintf(fp, "%s", nftnl_ruleset_o_opentag(type));
-	NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
-
-	ret = nftnl_cmd_header_fprintf(fp, cmd, type, flags);
-	NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+	if (nftnl_sink_puts(sink, nftnl_ruleset_o_opentag(type)) < 0 ||
+	    nftnl_cmd_header_export(sink, cmd, type, flags) < 0)
+		return -1;
 
 	if ((nftnl_ruleset_is_set(rs, NFTNL_RULESET_TABLELIST)) &&
 	    (!nftnl_table_list_is_empty(rs->table_list))) {
-		ret = nftnl_ruleset_fprintf_tables(fp, rs, type, inner_flags);
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		total = sink->total;
+		if (nftnl_ruleset_export_tables(sink, rs, type, inner_flags) < 0)
+			return -1;
 
-		if (ret > 0)
+		if (sink->total > total)
 			prev = rs->table_list;
 	}
 
 	if ((nftnl_ruleset_is_set(rs, NFTNL_RULESET_CHAINLIST)) &&
 	    (!nftnl_chain_list_is_empty(rs->chain_list))) {
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(prev, type));
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(prev, type)) < 0)
+			return -1;
 
-		ret = nftnl_ruleset_fprintf_chains(fp, rs, type, inner_flags);
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		total = sink->total;
+		if (nftnl_ruleset_export_chains(sink, rs, type, inner_flags) < 0)
+			return -1;
 
-		if (ret > 0)
+		if (sink->total > total)
 			prev = rs->chain_list;
 	}
 
 	if ((nftnl_ruleset_is_set(rs, NFTNL_RULESET_SETLIST)) &&
 	    (!nftnl_set_list_is_empty(rs->set_list))) {
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(prev, type));
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(prev, type)) < 0)
+			return -1;
 
-		ret = nftnl_ruleset_fprintf_sets(fp, rs, type, inner_flags);
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		total = sink->total;
+		if (nftnl_ruleset_export_sets(sink, rs, type, inner_flags) < 0)
+			return -1;
 
-		if (ret > 0)
+		if (sink->total > total)
 			prev = rs->set_list;
 	}
 
 	if ((nftnl_ruleset_is_set(rs, NFTNL_RULESET_RULELIST)) &&
 	    (!nftnl_rule_list_is_empty(rs->rule_list))) {
-		ret = fprintf(fp, "%s", nftnl_ruleset_o_separator(prev, type));
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		if (nftnl_sink_puts(sink,
+				    nftnl_ruleset_o_separator(prev, type)) < 0)
+			return -1;
 
-		ret = nftnl_ruleset_fprintf_rules(fp, rs, type, inner_flags);
-		NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+		if (nftnl_ruleset_export_rules(sink, rs, type, inner_flags) < 0)
+			return -1;
 	}
 
-	ret = nftnl_cmd_footer_fprintf(fp, cmd, type, flags);
-	NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+	if (nftnl_cmd_footer_export(sink, cmd, type, flags) < 0 ||
+	    nftnl_sink_puts(sink, nftnl_ruleset_o_closetag(type)) < 0)
+		return -1;
+
+	return 0;
+}
 
-	ret = fprintf(fp, "%s", nftnl_ruleset_o_closetag(type));
-	NFTNL_FPRINTF_RETURN_OR_FIXLEN(ret, len);
+EXPORT_SYMBOL(nftnl_ruleset_export);
+int nftnl_ruleset_export(struct nftnl_sink *sink, const struct nftnl_ruleset *rs,
+			 uint32_t type, uint32_t flags)
+{
+	switch (type) {
+	case NFTNL_OUTPUT_DEFAULT:
+	case NFTNL_OUTPUT_XML:
+	case NFTNL_OUTPUT_JSON:
+		return nftnl_ruleset_cmd_export(sink, rs, nftnl_flag2cmd(flags),
+						type, flags);
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
 
-	return len;
+static ssize_t nftnl_ruleset_fprintf_cb(void *data, const void *buf,
+					size_t len)
+{
+	return fwrite(buf, 1, len, data);
 }
 
 int nftnl_ruleset_fprintf(FILE *fp, const struct nftnl_ruleset *rs, uint32_t type,
 			uint32_t flags)
 {
-	return nftnl_ruleset_cmd_fprintf(fp, rs, nftnl_flag2cmd(flags), type,
+	struct nftnl_sink *sink;
+	int ret;
+
+	sink = nftnl_sink_alloc_cb(0, nftnl_ruleset_fprintf_cb, fp);
+	if (sink == NULL)
+		return -1;
+
+	ret = nftnl_ruleset_cmd_export(sink, rs, nftnl_flag2cmd(flags), type,
 				       flags);
+	if (ret == 0)
+		ret = nftnl_sink_flush(sink);
+	if (ret == 0)
+		ret = nftnl_sink_total(sink);
+
+	nftnl_sink_free(sink);
+	return ret;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_ruleset_fprintf, nft_ruleset_fprintf);
@@ -35,28 +35,80 @@ struct nftnl_set *nftnl_set_alloc(void)
 	if (s == NULL)
 		return NULL;
 
-	INIT_LIST_HEAD(&s->element_list);
+	nftnl_stats_obj_add(NFTNL_STATS_SET, NFTNL_STATS_OBJ_ALLOC, 1);
 	return s;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_alloc, nft_set_alloc);
 
-void nftnl_set_free(struct nftnl_set *s)
+static void nftnl_set_elems_put(struct nftnl_shared_list *elems)
 {
 	struct nftnl_set_elem *elem, *tmp;
 
+	if (!nftnl_shared_list_put(elems))
+		return;
+
+	list_for_each_entry_safe(elem, tmp, &elems->list, head) {
+		list_del(&elem->head);
+		nftnl_set_elem_free(elem);
+	}
+	xfree(elems);
+}
+
+void nftnl_set_free(struct nftnl_set *s)
+{
 	if (s->table != NULL)
 		xfree(s->table);
 	if (s->name != NULL)
 		xfree(s->name);
+	if (s->elems != NULL)
+		nftnl_set_elems_put(s->elems);
 
-	list_for_each_entry_safe(elem, tmp, &s->element_list, head) {
-		list_del(&elem->head);
-		nftnl_set_elem_free(elem);
-	}
+	nftnl_stats_obj_add(NFTNL_STATS_SET, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(s);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_free, nft_set_free);
 
+/* Elements shared with clones are split evenly between all of them */
+EXPORT_SYMBOL(nftnl_set_memsize);
+size_t nftnl_set_memsize(const struct nftnl_set *s)
+{
+	struct nftnl_set_elem *elem;
+	size_t size = 0;
+
+	list_for_each_entry(elem, nftnl_set_elems(s), head)
+		size += nftnl_set_elem_memsize(elem);
+
+	if (s->elems) {
+		size += sizeof(struct nftnl_shared_list);
+		size /= nftnl_shared_list_refs(s->elems);
+	}
+
+	return size + sizeof(struct nftnl_set) + nftnl_strsize(s->table) +
+	       nftnl_strsize(s->name);
+}
+
+/* Drop all attributes and elements so the set can be parsed into again,
+ * a list that is not shared is kept for the next elements.
+ */
+void nftnl_set_reset(struct nftnl_set *s)
+{
+	struct nftnl_set_elem *elem, *tmp;
+	uint16_t attr;
+
+	if (s->elems != NULL && nftnl_shared_list_refs(s->elems) == 1) {
+		list_for_each_entry_safe(elem, tmp, &s->elems->list, head) {
+			list_del(&elem->head);
+			nftnl_set_elem_free(elem);
+		}
+	} else if (s->elems != NULL) {
+		nftnl_set_elems_put(s->elems);
+		s->elems = NULL;
+	}
+
+	for (attr = 0; attr <= NFTNL_SET_MAX; attr++)
+		nftnl_set_unset(s, attr);
+}
+
 bool nftnl_set_is_set(const struct nftnl_set *s, uint16_t attr)
 {
 	return s->flags & (1 << attr);
@@ -280,29 +332,67 @@ uint64_t nftnl_set_get_u64(struct nftnl_set *s, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_get_u64, nft_set_attr_get_u64);
 
+/* Get an element list of our own before modifying it */
+int nftnl_set_elems_unshare(struct nftnl_set *s)
+{
+	struct nftnl_set_elem *elem, *newelem;
+	struct nftnl_shared_list *elems;
+
+	if (s->elems && nftnl_shared_list_refs(s->elems) == 1)
+		return 0;
+
+	elems = nftnl_shared_list_alloc();
+	if (elems == NULL)
+		return -1;
+
+	list_for_each_entry(elem, nftnl_set_elems(s), head) {
+		newelem = nftnl_set_elem_clone(elem);
+		if (newelem == NULL) {
+			nftnl_set_elems_put(elems);
+			return -1;
+		}
+		list_add_tail(&newelem->head, &elems->list);
+	}
+
+	if (s->elems)
+		nftnl_set_elems_put(s->elems);
+	s->elems = elems;
+
+	return 0;
+}
+
+/*
+ * nftnl_set_clone - copy a set, sharing its elements
+ *
+ * The element list is shared by the original set and its clones until one
+ * of them adds or parses elements, or hands them out through
+ * nftnl_set_elem_foreach() or an iterator, then that set gets its own copy.
+ * The original is only read.
+ */
+EXPORT_SYMBOL(nftnl_set_clone);
 struct nftnl_set *nftnl_set_clone(const struct nftnl_set *set)
 {
 	struct nftnl_set *newset;
-	struct nftnl_set_elem *elem, *newelem;
 
 	newset = nftnl_set_alloc();
 	if (newset == NULL)
 		return NULL;
 
 	memcpy(newset, set, sizeof(*set));
+	newset->table = newset->name = NULL;
 
-	if (set->flags & (1 << NFTNL_SET_TABLE))
+	if (set->elems != NULL)
+		nftnl_shared_list_get(set->elems);
+
+	if (set->flags & (1 << NFTNL_SET_TABLE)) {
 		newset->table = strdup(set->table);
-	if (set->flags & (1 << NFTNL_SET_NAME))
+		if (newset->table == NULL)
+			goto err;
+	}
+	if (set->flags & (1 << NFTNL_SET_NAME)) {
 		newset->name = strdup(set->name);
-
-	INIT_LIST_HEAD(&newset->element_list);
-	list_for_each_entry(elem, &set->element_list, head) {
-		newelem = nftnl_set_elem_clone(elem);
-		if (newelem == NULL)
+		if (newset->name == NULL)
 			goto err;
-
-		list_add_tail(&newelem->head, &newset->element_list);
 	}
 
 	return newset;
@@ -348,6 +438,9 @@ void nftnl_set_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_set *s)
 		mnl_attr_put_u64(nlh, NFTA_SET_TIMEOUT, htobe64(s->timeout));
 	if (s->flags & (1 << NFTNL_SET_GC_INTERVAL))
 		mnl_attr_put_u32(nlh, NFTA_SET_GC_INTERVAL, htonl(s->gc_interval));
+
+	nftnl_stats_obj_msg(NFTNL_STATS_SET, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_nlmsg_build_payload, nft_set_nlmsg_build_payload);
 
@@ -431,6 +524,9 @@ int nftnl_set_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
 	int ret = 0;
 
+	nftnl_stats_obj_msg(NFTNL_STATS_SET, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
 	if (mnl_attr_parse(nlh, sizeof(*nfg), nftnl_set_parse_attr_cb, tb) < 0)
 		return -1;
 
@@ -573,7 +669,12 @@ static int nftnl_jansson_parse_set_info(struct nftnl_set *s, json_t *tree,
 						       json_elem, err) < 0)
 				return -1;
 
-			list_add_tail(&elem->head, &s->element_list);
+			if (nftnl_set_elems_unshare(s) < 0) {
+				nftnl_set_elem_free(elem);
+				return -1;
+			}
+
+			list_add_tail(&elem->head, &s->elems->list);
 		}
 
 	}
@@ -706,7 +807,12 @@ int nftnl_mxml_set_parse(mxml_node_t *tree, struct nftnl_set *s,
 		if (nftnl_mxml_set_elem_parse(node, elem, err) < 0)
 			return -1;
 
-		list_add_tail(&elem->head, &s->element_list);
+		if (nftnl_set_elems_unshare(s) < 0) {
+			nftnl_set_elem_free(elem);
+			return -1;
+		}
+
+		list_add_tail(&elem->head, &s->elems->list);
 	}
 
 	return 0;
@@ -771,11 +877,10 @@ int nftnl_set_parse_file(struct nftnl_set *s, enum nftnl_parse_type type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_parse_file, nft_set_parse_file);
 
-static int nftnl_set_snprintf_json(char *buf, size_t size, struct nftnl_set *s,
-				  uint32_t type, uint32_t flags)
+static int nftnl_set_snprintf_json_hdr(char *buf, size_t size,
+				      struct nftnl_set *s)
 {
 	int len = size, offset = 0, ret;
-	struct nftnl_set_elem *elem;
 
 	ret = snprintf(buf, len, "{\"set\":{");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -832,8 +937,20 @@ static int nftnl_set_snprintf_json(char *buf, size_t size, struct nftnl_set *s,
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
+	return offset;
+}
+
+static int nftnl_set_snprintf_json(char *buf, size_t size, struct nftnl_set *s,
+				  uint32_t type, uint32_t flags)
+{
+	int len = size, offset = 0, ret;
+	struct nftnl_set_elem *elem;
+
+	ret = nftnl_set_snprintf_json_hdr(buf, len, s);
+	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
 	/* Empty set? Skip printinf of elements */
-	if (list_empty(&s->element_list)){
+	if (list_empty(nftnl_set_elems(s))){
 		ret = snprintf(buf + offset, len, "}}");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 		return offset;
@@ -842,7 +959,7 @@ static int nftnl_set_snprintf_json(char *buf, size_t size, struct nftnl_set *s,
 	ret = snprintf(buf + offset, len, ",\"set_elem\":[");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-	list_for_each_entry(elem, &s->element_list, head) {
+	list_for_each_entry(elem, nftnl_set_elems(s), head) {
 		ret = snprintf(buf + offset, len, "{");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
@@ -862,12 +979,11 @@ static int nftnl_set_snprintf_json(char *buf, size_t size, struct nftnl_set *s,
 	return offset;
 }
 
-static int nftnl_set_snprintf_default(char *buf, size_t size, struct nftnl_set *s,
-				    uint32_t type, uint32_t flags)
+static int nftnl_set_snprintf_default_hdr(char *buf, size_t size,
+					 struct nftnl_set *s)
 {
 	int ret;
 	int len = size, offset = 0;
-	struct nftnl_set_elem *elem;
 
 	ret = snprintf(buf, len, "%s %s %x",
 			s->name, s->table, s->set_flags);
@@ -895,14 +1011,27 @@ static int nftnl_set_snprintf_default(char *buf, size_t size, struct nftnl_set *
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
+	return offset;
+}
+
+static int nftnl_set_snprintf_default(char *buf, size_t size, struct nftnl_set *s,
+				    uint32_t type, uint32_t flags)
+{
+	int ret;
+	int len = size, offset = 0;
+	struct nftnl_set_elem *elem;
+
+	ret = nftnl_set_snprintf_default_hdr(buf, len, s);
+	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
 	/* Empty set? Skip printinf of elements */
-	if (list_empty(&s->element_list))
+	if (list_empty(nftnl_set_elems(s)))
 		return offset;
 
 	ret = snprintf(buf+offset, len, "\n");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
-	list_for_each_entry(elem, &s->element_list, head) {
+	list_for_each_entry(elem, nftnl_set_elems(s), head) {
 		ret = snprintf(buf+offset, len, "\t");
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 
@@ -913,12 +1042,11 @@ static int nftnl_set_snprintf_default(char *buf, size_t size, struct nftnl_set *
 	return offset;
 }
 
-static int nftnl_set_snprintf_xml(char *buf, size_t size, struct nftnl_set *s,
-				uint32_t flags)
+static int nftnl_set_snprintf_xml_hdr(char *buf, size_t size,
+				     struct nftnl_set *s)
 {
 	int ret;
 	int len = size, offset = 0;
-	struct nftnl_set_elem *elem;
 
 	ret = snprintf(buf, len, "<set>");
 	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -980,8 +1108,21 @@ static int nftnl_set_snprintf_xml(char *buf, size_t size, struct nftnl_set *s,
 		SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
 	}
 
-	if (!list_empty(&s->element_list)) {
-		list_for_each_entry(elem, &s->element_list, head) {
+	return offset;
+}
+
+static int nftnl_set_snprintf_xml(char *buf, size_t size, struct nftnl_set *s,
+				uint32_t flags)
+{
+	int ret;
+	int len = size, offset = 0;
+	struct nftnl_set_elem *elem;
+
+	ret = nftnl_set_snprintf_xml_hdr(buf, len, s);
+	SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
+
+	if (!list_empty(nftnl_set_elems(s))) {
+		list_for_each_entry(elem, nftnl_set_elems(s), head) {
 			ret = nftnl_set_elem_snprintf(buf + offset, len, elem,
 						    NFTNL_OUTPUT_XML, flags);
 			SNPRINTF_BUFFER_SIZE(ret, size, len, offset);
@@ -1053,9 +1194,118 @@ int nftnl_set_fprintf(FILE *fp, struct nftnl_set *s, uint32_t type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_fprintf, nft_set_fprintf);
 
+static int nftnl_set_hdr_snprintf(char *buf, size_t size, void *s,
+				  uint32_t cmd, uint32_t type, uint32_t flags)
+{
+	switch (type) {
+	case NFTNL_OUTPUT_DEFAULT:
+		return nftnl_set_snprintf_default_hdr(buf, size, s);
+	case NFTNL_OUTPUT_XML:
+		return nftnl_set_snprintf_xml_hdr(buf, size, s);
+	case NFTNL_OUTPUT_JSON:
+		return nftnl_set_snprintf_json_hdr(buf, size, s);
+	default:
+		return -1;
+	}
+}
+
+struct nftnl_set_o_elems {
+	const char	*open;
+	const char	*elem_open;
+	const char	*elem_sep;
+	const char	*elem_close;
+	const char	*close;
+	const char	*empty;
+};
+
+/* Same layout as the nftnl_set_snprintf_*() functions above */
+static const struct nftnl_set_o_elems nftnl_set_o_elems[] = {
+	[NFTNL_OUTPUT_DEFAULT] = {
+		.open		= "\n",
+		.elem_open	= "\t",
+		.elem_sep	= "",
+		.elem_close	= "",
+		.close		= "",
+		.empty		= "",
+	},
+	[NFTNL_OUTPUT_XML] = {
+		.open		= "",
+		.elem_open	= "",
+		.elem_sep	= "",
+		.elem_close	= "",
+		.close		= "</set>",
+		.empty		= "</set>",
+	},
+	[NFTNL_OUTPUT_JSON] = {
+		.open		= ",\"set_elem\":[",
+		.elem_open	= "{",
+		.elem_sep	= ",",
+		.elem_close	= "}",
+		.close		= "]}}",
+		.empty		= "}}",
+	},
+};
+
+/* Elements are exported one by one, so a streaming sink never holds more
+ * than one chunk plus one element regardless of the size of the set.
+ */
+EXPORT_SYMBOL(nftnl_set_export);
+int nftnl_set_export(struct nftnl_sink *sink, struct nftnl_set *s,
+		     uint32_t type, uint32_t flags)
+{
+	const struct nftnl_set_o_elems *o;
+	struct nftnl_set_elem *elem;
+	uint32_t cmd = nftnl_flag2cmd(flags);
+	uint32_t inner_flags = flags;
+
+	if (type > NFTNL_OUTPUT_JSON)
+		return -1;
+
+	o = &nftnl_set_o_elems[type];
+
+	/* prevent set_elems to print as events */
+	inner_flags &= ~NFTNL_OF_EVENT_ANY;
+
+	if (nftnl_cmd_header_export(sink, cmd, type, flags) < 0 ||
+	    nftnl_sink_printf(sink, s, cmd, type, inner_flags,
+			      nftnl_set_hdr_snprintf) < 0)
+		return -1;
+
+	if (list_empty(nftnl_set_elems(s))) {
+		if (nftnl_sink_puts(sink, o->empty) < 0)
+			return -1;
+	} else {
+		if (nftnl_sink_puts(sink, o->open) < 0)
+			return -1;
+
+		list_for_each_entry(elem, nftnl_set_elems(s), head) {
+			if (elem->head.prev != nftnl_set_elems(s) &&
+			    nftnl_sink_puts(sink, o->elem_sep) < 0)
+				return -1;
+
+			if (nftnl_sink_puts(sink, o->elem_open) < 0 ||
+			    nftnl_set_elem_export(sink, elem, type,
+						  inner_flags) < 0 ||
+			    nftnl_sink_puts(sink, o->elem_close) < 0)
+				return -1;
+		}
+
+		if (nftnl_sink_puts(sink, o->close) < 0)
+			return -1;
+	}
+
+	return nftnl_cmd_footer_export(sink, cmd, type, flags);
+}
+
+/* Out of memory to unshare the elements, the element is released */
 void nftnl_set_elem_add(struct nftnl_set *s, struct nftnl_set_elem *elem)
 {
-	list_add_tail(&elem->head, &s->element_list);
+	if (nftnl_set_elems_unshare(s) < 0) {
+		nftnl_set_elem_free(elem);
+		return;
+	}
+
+	list_add_tail(&elem->head, &s->elems->list);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_add, nft_set_elem_add);
 
@@ -1089,6 +1339,18 @@ void nftnl_set_list_free(struct nftnl_set_list *list)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_list_free, nft_set_list_free);
 
+EXPORT_SYMBOL(nftnl_set_list_memsize);
+size_t nftnl_set_list_memsize(const struct nftnl_set_list *list)
+{
+	size_t size = sizeof(struct nftnl_set_list);
+	struct nftnl_set *s;
+
+	list_for_each_entry(s, &list->list, head)
+		size += nftnl_set_memsize(s);
+
+	return size;
+}
+
 int nftnl_set_list_is_empty(struct nftnl_set_list *list)
 {
 	return list_empty(&list->list);
@@ -0,0 +1,395 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/set.h>
+
+#include "set.h"
+#include "set_elem.h"
+
+#define NFTNL_SET_DELTA_HASH_MIN	64
+
+/* Net change of one element: the element it replaces and the new one */
+struct nftnl_set_delta_elem {
+	struct hlist_node	hnode;
+	struct list_head	list;
+	uint32_t		hash;
+	struct nftnl_set_elem	*del;
+	struct nftnl_set_elem	*add;
+};
+
+/* Elements are kept in the order they were first seen in */
+struct nftnl_set_delta_set {
+	struct list_head	list;
+	uint32_t		family;
+	char			*table;
+	char			*name;
+	struct list_head	elems;
+	struct hlist_head	*hash;
+	unsigned int		hash_size;
+	unsigned int		num_elems;
+};
+
+struct nftnl_set_delta {
+	struct list_head	sets;
+	struct nftnl_set	*msg;
+	int			(*cb)(struct nftnl_set *added,
+				      struct nftnl_set *deleted, void *data);
+	void			*data;
+};
+
+struct nftnl_set_delta *
+nftnl_set_delta_alloc(int (*cb)(struct nftnl_set *added,
+				struct nftnl_set *deleted, void *data),
+		      void *data)
+{
+	struct nftnl_set_delta *d;
+
+	d = calloc(1, sizeof(struct nftnl_set_delta));
+	if (d == NULL)
+		return NULL;
+
+	d->msg = nftnl_set_alloc();
+	if (d->msg == NULL) {
+		xfree(d);
+		return NULL;
+	}
+	INIT_LIST_HEAD(&d->sets);
+	d->cb = cb;
+	d->data = data;
+
+	return d;
+}
+EXPORT_SYMBOL(nftnl_set_delta_alloc);
+
+static void nftnl_set_delta_elem_free(struct nftnl_set_delta_elem *de)
+{
+	if (de->del != NULL)
+		nftnl_set_elem_free(de->del);
+	if (de->add != NULL)
+		nftnl_set_elem_free(de->add);
+	xfree(de);
+}
+
+static void nftnl_set_delta_set_free(struct nftnl_set_delta_set *ds)
+{
+	struct nftnl_set_delta_elem *de, *tmp;
+
+	list_for_each_entry_safe(de, tmp, &ds->elems, list)
+		nftnl_set_delta_elem_free(de);
+
+	xfree(ds->hash);
+	xfree(ds->table);
+	xfree(ds->name);
+	xfree(ds);
+}
+
+void nftnl_set_delta_free(struct nftnl_set_delta *d)
+{
+	struct nftnl_set_delta_set *ds, *tmp;
+
+	list_for_each_entry_safe(ds, tmp, &d->sets, list)
+		nftnl_set_delta_set_free(ds);
+
+	nftnl_set_free(d->msg);
+	xfree(d);
+}
+EXPORT_SYMBOL(nftnl_set_delta_free);
+
+static struct nftnl_set_delta_set *
+nftnl_set_delta_set_get(struct nftnl_set_delta *d, const struct nftnl_set *s)
+{
+	struct nftnl_set_delta_set *ds;
+
+	if (!(s->flags & (1 << NFTNL_SET_TABLE)) ||
+	    !(s->flags & (1 << NFTNL_SET_NAME))) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* A transaction rarely touches more than a handful of sets */
+	list_for_each_entry(ds, &d->sets, list) {
+		if (ds->family == s->family &&
+		    strcmp(ds->name, s->name) == 0 &&
+		    strcmp(ds->table, s->table) == 0)
+			return ds;
+	}
+
+	ds = calloc(1, sizeof(struct nftnl_set_delta_set));
+	if (ds == NULL)
+		return NULL;
+
+	ds->hash = calloc(NFTNL_SET_DELTA_HASH_MIN, sizeof(struct hlist_head));
+	ds->table = strdup(s->table);
+	ds->name = strdup(s->name);
+	if (ds->hash == NULL || ds->table == NULL || ds->name == NULL) {
+		xfree(ds->hash);
+		xfree(ds->table);
+		xfree(ds->name);
+		xfree(ds);
+		return NULL;
+	}
+	ds->hash_size = NFTNL_SET_DELTA_HASH_MIN;
+	ds->family = s->family;
+	INIT_LIST_HEAD(&ds->elems);
+	list_add_tail(&ds->list, &d->sets);
+
+	return ds;
+}
+
+static uint32_t nftnl_set_delta_hash(const struct nftnl_set_elem *e)
+{
+	const uint8_t *p = (const uint8_t *)e->key.val;
+	uint32_t i, h = 2166136261U;
+
+	for (i = 0; i < e->key.len; i++) {
+		h ^= p[i];
+		h *= 16777619U;
+	}
+
+	return h;
+}
+
+static bool nftnl_set_delta_key_eq(const struct nftnl_set_elem *a,
+				   const struct nftnl_set_elem *b)
+{
+	return a->key.len == b->key.len &&
+	       memcmp(a->key.val, b->key.val, a->key.len) == 0;
+}
+
+static void nftnl_set_delta_rehash(struct nftnl_set_delta_set *ds)
+{
+	struct nftnl_set_delta_elem *de;
+	struct hlist_head *hash;
+	unsigned int size = ds->hash_size * 2;
+
+	/* Lookups just get slower if the table cannot grow */
+	hash = calloc(size, sizeof(struct hlist_head));
+	if (hash == NULL)
+		return;
+
+	list_for_each_entry(de, &ds->elems, list)
+		hlist_add_head(&de->hnode, &hash[de->hash & (size - 1)]);
+
+	xfree(ds->hash);
+	ds->hash = hash;
+	ds->hash_size = size;
+}
+
+static struct nftnl_set_delta_elem *
+nftnl_set_delta_lookup(struct nftnl_set_delta_set *ds,
+		       const struct nftnl_set_elem *e, uint32_t hash)
+{
+	struct nftnl_set_delta_elem *de;
+	struct hlist_node *n;
+
+	hlist_for_each_entry(de, n, &ds->hash[hash & (ds->hash_size - 1)],
+			     hnode) {
+		if (de->hash != hash)
+			continue;
+		if (nftnl_set_delta_key_eq(de->add ? de->add : de->del, e))
+			return de;
+	}
+
+	return NULL;
+}
+
+static void nftnl_set_delta_unlink(struct nftnl_set_delta_set *ds,
+				   struct nftnl_set_delta_elem *de)
+{
+	hlist_del(&de->hnode);
+	list_del(&de->list);
+	ds->num_elems--;
+	xfree(de);
+}
+
+/*
+ * Takes ownership of @e. An element added and deleted again within the
+ * same generation leaves no trace, one deleted and added again is
+ * reported on both sides so its new data is not lost.
+ */
+static int nftnl_set_delta_elem_add(struct nftnl_set_delta_set *ds,
+				    uint32_t event, struct nftnl_set_elem *e)
+{
+	struct nftnl_set_delta_elem *de;
+	uint32_t hash;
+
+	hash = nftnl_set_delta_hash(e);
+	de = nftnl_set_delta_lookup(ds, e, hash);
+	if (de == NULL) {
+		de = calloc(1, sizeof(struct nftnl_set_delta_elem));
+		if (de == NULL) {
+			nftnl_set_elem_free(e);
+			return -1;
+		}
+		de->hash = hash;
+		hlist_add_head(&de->hnode,
+			       &ds->hash[hash & (ds->hash_size - 1)]);
+		list_add_tail(&de->list, &ds->elems);
+		if (++ds->num_elems > ds->hash_size * 2)
+			nftnl_set_delta_rehash(ds);
+	}
+
+	if (event == NFT_MSG_NEWSETELEM) {
+		if (de->add != NULL)
+			nftnl_set_elem_free(de->add);
+		de->add = e;
+		return 0;
+	}
+
+	if (de->add != NULL) {
+		nftnl_set_elem_free(de->add);
+		de->add = NULL;
+		nftnl_set_elem_free(e);
+		if (de->del == NULL)
+			nftnl_set_delta_unlink(ds, de);
+	} else if (de->del != NULL) {
+		nftnl_set_elem_free(e);
+	} else {
+		de->del = e;
+	}
+
+	return 0;
+}
+
+/*
+ * nftnl_set_delta_add - buffer the elements of a setelem event
+ *
+ * @event is NFT_MSG_NEWSETELEM or NFT_MSG_DELSETELEM. The elements are
+ * moved out of @s, which is left holding none, so a set reused for
+ * parsing events does not need to be emptied before the next one.
+ */
+int nftnl_set_delta_add(struct nftnl_set_delta *d, uint32_t event,
+			struct nftnl_set *s)
+{
+	struct nftnl_set_elem *e, *tmp;
+	struct nftnl_set_delta_set *ds;
+	int ret = 0;
+
+	if (event != NFT_MSG_NEWSETELEM && event != NFT_MSG_DELSETELEM) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ds = nftnl_set_delta_set_get(d, s);
+	if (ds == NULL)
+		return -1;
+
+	if (nftnl_set_elems_unshare(s) < 0)
+		return -1;
+
+	list_for_each_entry_safe(e, tmp, nftnl_set_elems(s), head) {
+		list_del(&e->head);
+		if (nftnl_set_delta_elem_add(ds, event, e) < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(nftnl_set_delta_add);
+
+static int nftnl_set_delta_deliver(struct nftnl_set_delta *d,
+				   struct nftnl_set_delta_set *ds)
+{
+	struct nftnl_set_delta_elem *de, *tmp;
+	struct nftnl_set *added, *deleted;
+	int ret = -1;
+
+	added = nftnl_set_alloc();
+	deleted = nftnl_set_alloc();
+	if (added == NULL || deleted == NULL)
+		goto out;
+
+	nftnl_set_set_u32(added, NFTNL_SET_FAMILY, ds->family);
+	nftnl_set_set_str(added, NFTNL_SET_TABLE, ds->table);
+	nftnl_set_set_str(added, NFTNL_SET_NAME, ds->name);
+	nftnl_set_set_u32(deleted, NFTNL_SET_FAMILY, ds->family);
+	nftnl_set_set_str(deleted, NFTNL_SET_TABLE, ds->table);
+	nftnl_set_set_str(deleted, NFTNL_SET_NAME, ds->name);
+
+	list_for_each_entry_safe(de, tmp, &ds->elems, list) {
+		if (de->del != NULL)
+			nftnl_set_elem_add(deleted, de->del);
+		if (de->add != NULL)
+			nftnl_set_elem_add(added, de->add);
+		de->del = de->add = NULL;
+	}
+
+	ret = d->cb(added, deleted, d->data);
+out:
+	if (added != NULL)
+		nftnl_set_free(added);
+	if (deleted != NULL)
+		nftnl_set_free(deleted);
+	return ret;
+}
+
+/*
+ * nftnl_set_delta_flush - deliver the net change of every set
+ *
+ * The callback is run once per set that has pending elements, with one set
+ * holding the elements that were added and another one holding those that
+ * were deleted; deletions are to be applied first. Both sets are released
+ * once the callback returns. Everything buffered so far is dropped, even
+ * if a callback fails.
+ */
+int nftnl_set_delta_flush(struct nftnl_set_delta *d)
+{
+	struct nftnl_set_delta_set *ds, *tmp;
+	int ret = 0;
+
+	list_for_each_entry_safe(ds, tmp, &d->sets, list) {
+		if (ds->num_elems > 0 && nftnl_set_delta_deliver(d, ds) < 0)
+			ret = -1;
+
+		list_del(&ds->list);
+		nftnl_set_delta_set_free(ds);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(nftnl_set_delta_flush);
+
+/*
+ * nftnl_set_delta_nlmsg - feed a notification
+ *
+ * Setelem events are buffered and NFT_MSG_NEWGEN, which the kernel sends
+ * once a transaction is committed, flushes them. Other messages are
+ * ignored, so this can be handed every message read from the socket.
+ */
+int nftnl_set_delta_nlmsg(struct nftnl_set_delta *d,
+			  const struct nlmsghdr *nlh)
+{
+	uint32_t event;
+
+	if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES)
+		return 0;
+
+	event = NFNL_MSG_TYPE(nlh->nlmsg_type);
+	switch (event) {
+	case NFT_MSG_NEWSETELEM:
+	case NFT_MSG_DELSETELEM:
+		nftnl_set_reset(d->msg);
+		if (nftnl_set_elems_nlmsg_parse(nlh, d->msg) < 0)
+			return -1;
+		return nftnl_set_delta_add(d, event, d->msg);
+	case NFT_MSG_NEWGEN:
+		return nftnl_set_delta_flush(d);
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL(nftnl_set_delta_nlmsg);
@@ -35,6 +35,7 @@ struct nftnl_set_elem *nftnl_set_elem_alloc(void)
 	if (s == NULL)
 		return NULL;
 
+	nftnl_stats_obj_add(NFTNL_STATS_SET_ELEM, NFTNL_STATS_OBJ_ALLOC, 1);
 	return s;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_alloc, nft_set_elem_alloc);
@@ -51,10 +52,24 @@ void nftnl_set_elem_free(struct nftnl_set_elem *s)
 	if (s->flags & (1 << NFTNL_SET_ELEM_EXPR))
 		nftnl_expr_free(s->expr);
 
+	nftnl_stats_obj_add(NFTNL_STATS_SET_ELEM, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(s);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_free, nft_set_elem_free);
 
+EXPORT_SYMBOL(nftnl_set_elem_memsize);
+size_t nftnl_set_elem_memsize(const struct nftnl_set_elem *s)
+{
+	size_t size = sizeof(struct nftnl_set_elem);
+
+	if (s->flags & (1 << NFTNL_SET_ELEM_CHAIN))
+		size += nftnl_strsize(s->data.chain);
+	if (s->flags & (1 << NFTNL_SET_ELEM_EXPR))
+		size += nftnl_expr_memsize(s->expr);
+
+	return size;
+}
+
 bool nftnl_set_elem_is_set(const struct nftnl_set_elem *s, uint16_t attr)
 {
 	return s->flags & (1 << attr);
@@ -150,7 +165,7 @@ void nftnl_set_elem_set_str(struct nftnl_set_elem *s, uint16_t attr, const char
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_set_str, nft_set_elem_attr_set_str);
 
-const void *nftnl_set_elem_get(struct nftnl_set_elem *s, uint16_t attr, uint32_t *data_len)
+const void *nftnl_set_elem_get(const struct nftnl_set_elem *s, uint16_t attr, uint32_t *data_len)
 {
 	if (!(s->flags & (1 << attr)))
 		return NULL;
@@ -182,7 +197,7 @@ const void *nftnl_set_elem_get(struct nftnl_set_elem *s, uint16_t attr, uint32_t
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_get, nft_set_elem_attr_get);
 
-const char *nftnl_set_elem_get_str(struct nftnl_set_elem *s, uint16_t attr)
+const char *nftnl_set_elem_get_str(const struct nftnl_set_elem *s, uint16_t attr)
 {
 	uint32_t size;
 
@@ -190,7 +205,7 @@ const char *nftnl_set_elem_get_str(struct nftnl_set_elem *s, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_get_str, nft_set_elem_attr_get_str);
 
-uint32_t nftnl_set_elem_get_u32(struct nftnl_set_elem *s, uint16_t attr)
+uint32_t nftnl_set_elem_get_u32(const struct nftnl_set_elem *s, uint16_t attr)
 {
 	uint32_t size;
 	uint32_t val = *((uint32_t *)nftnl_set_elem_get(s, attr, &size));
@@ -198,7 +213,7 @@ uint32_t nftnl_set_elem_get_u32(struct nftnl_set_elem *s, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_get_u32, nft_set_elem_attr_get_u32);
 
-uint64_t nftnl_set_elem_get_u64(struct nftnl_set_elem *s, uint16_t attr)
+uint64_t nftnl_set_elem_get_u64(const struct nftnl_set_elem *s, uint16_t attr)
 {
 	uint32_t size;
 	uint64_t val = *((uint64_t *)nftnl_set_elem_get(s, attr, &size));
@@ -206,6 +221,7 @@ uint64_t nftnl_set_elem_get_u64(struct nftnl_set_elem *s, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_get_u64, nft_set_elem_attr_get_u64);
 
+EXPORT_SYMBOL(nftnl_set_elem_clone);
 struct nftnl_set_elem *nftnl_set_elem_clone(struct nftnl_set_elem *elem)
 {
 	struct nftnl_set_elem *newelem;
@@ -215,11 +231,26 @@ struct nftnl_set_elem *nftnl_set_elem_clone(struct nftnl_set_elem *elem)
 		return NULL;
 
 	memcpy(newelem, elem, sizeof(*elem));
+	newelem->flags &= ~(1 << NFTNL_SET_ELEM_EXPR);
+	newelem->expr = NULL;
 
-	if (elem->flags & (1 << NFTNL_SET_ELEM_CHAIN))
+	if (elem->flags & (1 << NFTNL_SET_ELEM_CHAIN)) {
 		newelem->data.chain = strdup(elem->data.chain);
+		if (newelem->data.chain == NULL)
+			goto err;
+	}
+	if (elem->flags & (1 << NFTNL_SET_ELEM_EXPR)) {
+		newelem->expr = nftnl_expr_clone(elem->expr);
+		if (newelem->expr == NULL)
+			goto err;
+
+		newelem->flags |= (1 << NFTNL_SET_ELEM_EXPR);
+	}
 
 	return newelem;
+err:
+	nftnl_set_elem_free(newelem);
+	return NULL;
 }
 
 void nftnl_set_elem_nlmsg_build_payload(struct nlmsghdr *nlh,
@@ -260,7 +291,7 @@ void nftnl_set_elem_nlmsg_build_payload(struct nlmsghdr *nlh,
 }
 
 static void nftnl_set_elem_nlmsg_build_def(struct nlmsghdr *nlh,
-					 struct nftnl_set *s)
+					 const struct nftnl_set *s)
 {
 	if (s->flags & (1 << NFTNL_SET_NAME))
 		mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, s->name);
@@ -291,10 +322,13 @@ void nftnl_set_elems_nlmsg_build_payload(struct nlmsghdr *nlh, struct nftnl_set
 	nftnl_set_elem_nlmsg_build_def(nlh, s);
 
 	nest1 = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
-	list_for_each_entry(elem, &s->element_list, head)
+	list_for_each_entry(elem, nftnl_set_elems(s), head)
 		nftnl_set_elem_build(nlh, elem, ++i);
 
 	mnl_attr_nest_end(nlh, nest1);
+
+	nftnl_stats_obj_msg(NFTNL_STATS_SET_ELEM, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elems_nlmsg_build_payload, nft_set_elems_nlmsg_build_payload);
 
@@ -407,7 +441,11 @@ err:
 	}
 
 	/* Add this new element to this set */
-	list_add_tail(&e->head, &s->element_list);
+	if (nftnl_set_elems_unshare(s) < 0) {
+		nftnl_set_elem_free(e);
+		return -1;
+	}
+	list_add_tail(&e->head, &s->elems->list);
 
 	return ret;
 }
@@ -437,7 +475,8 @@ nftnl_set_elem_list_parse_attr_cb(const struct nlattr *attr, void *data)
 	return MNL_CB_OK;
 }
 
-static int nftnl_set_elems_parse(struct nftnl_set *s, const struct nlattr *nest)
+static int nftnl_set_elems_parse(struct nftnl_set *s, const struct nlattr *nest,
+				 uint32_t *nelems)
 {
 	struct nlattr *attr;
 	int ret = 0;
@@ -447,11 +486,14 @@ static int nftnl_set_elems_parse(struct nftnl_set *s, const struct nlattr *nest)
 			return -1;
 
 		ret = nftnl_set_elems_parse2(s, attr);
+		if (ret == 0)
+			(*nelems)++;
 	}
 	return ret;
 }
 
-int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
+static int __nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh,
+					 struct nftnl_set *s, uint32_t *nelems)
 {
 	struct nlattr *tb[NFTA_SET_ELEM_LIST_MAX+1] = {};
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
@@ -478,13 +520,29 @@ int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
 		s->flags |= (1 << NFTNL_SET_ID);
 	}
         if (tb[NFTA_SET_ELEM_LIST_ELEMENTS])
-	 	ret = nftnl_set_elems_parse(s, tb[NFTA_SET_ELEM_LIST_ELEMENTS]);
+	 	ret = nftnl_set_elems_parse(s, tb[NFTA_SET_ELEM_LIST_ELEMENTS],
+					    nelems);
 
 	s->family = nfg->nfgen_family;
 	s->flags |= (1 << NFTNL_SET_FAMILY);
 
 	return ret;
 }
+
+int nftnl_set_elems_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_set *s)
+{
+	uint32_t nelems = 0;
+	int ret;
+
+	NFTNL_PROBE2(set_elems_parse_entry, s, nlh->nlmsg_len);
+	nftnl_stats_obj_msg(NFTNL_STATS_SET_ELEM, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
+	ret = __nftnl_set_elems_nlmsg_parse(nlh, s, &nelems);
+
+	NFTNL_PROBE3(set_elems_parse_return, s, nelems, ret);
+	return ret;
+}
 EXPORT_SYMBOL_ALIAS(nftnl_set_elems_nlmsg_parse, nft_set_elems_nlmsg_parse);
 
 #ifdef XML_PARSING
@@ -788,6 +846,14 @@ int nftnl_set_elem_fprintf(FILE *fp, struct nftnl_set_elem *se, uint32_t type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_fprintf, nft_set_elem_fprintf);
 
+EXPORT_SYMBOL(nftnl_set_elem_export);
+int nftnl_set_elem_export(struct nftnl_sink *s, struct nftnl_set_elem *se,
+			  uint32_t type, uint32_t flags)
+{
+	return nftnl_sink_printf(s, se, NFTNL_CMD_UNSPEC, type, flags,
+				 nftnl_set_elem_do_snprintf);
+}
+
 int nftnl_set_elem_foreach(struct nftnl_set *s,
 			 int (*cb)(struct nftnl_set_elem *e, void *data),
 			 void *data)
@@ -795,7 +861,11 @@ int nftnl_set_elem_foreach(struct nftnl_set *s,
 	struct nftnl_set_elem *elem;
 	int ret;
 
-	list_for_each_entry(elem, &s->element_list, head) {
+	/* The callback may modify the elements, clones must not see it */
+	if (s->elems != NULL && nftnl_set_elems_unshare(s) < 0)
+		return -1;
+
+	list_for_each_entry(elem, nftnl_set_elems(s), head) {
 		ret = cb(elem, data);
 		if (ret < 0)
 			return ret;
@@ -804,13 +874,34 @@ int nftnl_set_elem_foreach(struct nftnl_set *s,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elem_foreach, nft_set_elem_foreach);
 
+/* Elements may be shared with clones, the set keeps them as they are */
+EXPORT_SYMBOL(nftnl_set_elem_foreach_ro);
+int nftnl_set_elem_foreach_ro(const struct nftnl_set *s,
+			      int (*cb)(const struct nftnl_set_elem *e,
+					void *data),
+			      void *data)
+{
+	struct nftnl_set_elem *elem;
+	int ret;
+
+	list_for_each_entry(elem, nftnl_set_elems(s), head) {
+		ret = cb(elem, data);
+		if (ret < 0)
+			return ret;
+	}
+	return 0;
+}
+
 struct nftnl_set_elems_iter {
-	struct nftnl_set			*set;
+	const struct nftnl_set		*set;
 	struct list_head		*list;
 	struct nftnl_set_elem		*cur;
 };
 
-struct nftnl_set_elems_iter *nftnl_set_elems_iter_create(struct nftnl_set *s)
+/* Same as nftnl_set_elem_foreach_ro(), elements must not be modified */
+EXPORT_SYMBOL(nftnl_set_elems_iter_create_ro);
+struct nftnl_set_elems_iter *
+nftnl_set_elems_iter_create_ro(const struct nftnl_set *s)
 {
 	struct nftnl_set_elems_iter *iter;
 
@@ -819,15 +910,24 @@ struct nftnl_set_elems_iter *nftnl_set_elems_iter_create(struct nftnl_set *s)
 		return NULL;
 
 	iter->set = s;
-	iter->list = &s->element_list;
-	if (list_empty(&s->element_list))
+	iter->list = nftnl_set_elems(s);
+	if (list_empty(iter->list))
 		iter->cur = NULL;
 	else
-		iter->cur = list_entry(s->element_list.next,
+		iter->cur = list_entry(iter->list->next,
 				       struct nftnl_set_elem, head);
 
 	return iter;
 }
+
+struct nftnl_set_elems_iter *nftnl_set_elems_iter_create(struct nftnl_set *s)
+{
+	/* Same as nftnl_set_elem_foreach(), iterators hand out writable pointers */
+	if (s->elems != NULL && nftnl_set_elems_unshare(s) < 0)
+		return NULL;
+
+	return nftnl_set_elems_iter_create_ro(s);
+}
 EXPORT_SYMBOL_ALIAS(nftnl_set_elems_iter_create, nft_set_elems_iter_create);
 
 struct nftnl_set_elem *nftnl_set_elems_iter_cur(struct nftnl_set_elems_iter *iter)
@@ -898,6 +998,9 @@ int nftnl_set_elems_nlmsg_build_payload_iter(struct nlmsghdr *nlh,
 	}
 	mnl_attr_nest_end(nlh, nest1);
 
+	nftnl_stats_obj_msg(NFTNL_STATS_SET_ELEM, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
+
 	return ret;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_set_elems_nlmsg_build_payload_iter, nft_set_elems_nlmsg_build_payload_iter);
@@ -0,0 +1,531 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/snapshot.h>
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/batch.h>
+
+/*
+ * A snapshot is a header followed by NFT_MSG_NEW* netlink messages, exactly
+ * as they are sent to the kernel, in host byte order. Loading it is a
+ * matter of mapping the file and copying the messages into a batch.
+ */
+#define NFTNL_SNAPSHOT_MAGIC	0x4e465453	/* "NFTS" */
+#define NFTNL_SNAPSHOT_VERSION	1
+
+struct nftnl_snapshot_hdr {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	count;
+	uint32_t	pad;
+	uint64_t	len;
+};
+
+/* Netlink attribute length is 16 bits wide, one message never needs more */
+#define NFTNL_SNAPSHOT_MSG_MAX	(2 * 65536)
+#define NFTNL_SNAPSHOT_BUFSIZ	(8 * NFTNL_SNAPSHOT_MSG_MAX)
+
+struct nftnl_snapshot_writer {
+	int			fd;
+	char			*buf;
+	size_t			len;
+	struct nftnl_snapshot_hdr hdr;
+};
+
+static int nftnl_snapshot_write_all(int fd, const char *buf, size_t len)
+{
+	ssize_t ret;
+
+	while (len > 0) {
+		ret = write(fd, buf, len);
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int nftnl_snapshot_flush(struct nftnl_snapshot_writer *w)
+{
+	if (nftnl_snapshot_write_all(w->fd, w->buf, w->len) < 0)
+		return -1;
+
+	w->len = 0;
+	return 0;
+}
+
+static struct nlmsghdr *
+nftnl_snapshot_msg_start(struct nftnl_snapshot_writer *w, uint16_t cmd,
+			 uint16_t family, uint16_t flags)
+{
+	if (NFTNL_SNAPSHOT_BUFSIZ - w->len < NFTNL_SNAPSHOT_MSG_MAX &&
+	    nftnl_snapshot_flush(w) < 0)
+		return NULL;
+
+	return nftnl_nlmsg_build_hdr(w->buf + w->len, cmd, family,
+				     NLM_F_CREATE | NLM_F_ACK | flags, 0);
+}
+
+/* Handles only make sense to the ruleset they were dumped from */
+static bool nftnl_snapshot_attr_skip(uint16_t cmd, uint16_t type)
+{
+	switch (cmd) {
+	case NFT_MSG_NEWCHAIN:
+		return type == NFTA_CHAIN_HANDLE;
+	case NFT_MSG_NEWRULE:
+		return type == NFTA_RULE_HANDLE || type == NFTA_RULE_POSITION;
+	default:
+		return false;
+	}
+}
+
+static void nftnl_snapshot_strip(struct nlmsghdr *nlh)
+{
+	uint16_t cmd = NFNL_MSG_TYPE(nlh->nlmsg_type);
+	char *end = (char *)nlh + nlh->nlmsg_len;
+	char *pos = mnl_nlmsg_get_payload_offset(nlh, sizeof(struct nfgenmsg));
+	struct nlattr *attr = (struct nlattr *)pos;
+	size_t attr_len;
+
+	while ((char *)attr < end) {
+		attr_len = MNL_ALIGN(attr->nla_len);
+
+		if (!nftnl_snapshot_attr_skip(cmd, mnl_attr_get_type(attr))) {
+			memmove(pos, attr, attr_len);
+			pos += attr_len;
+		}
+		attr = (struct nlattr *)((char *)attr + attr_len);
+	}
+	nlh->nlmsg_len = pos - (char *)nlh;
+}
+
+static void nftnl_snapshot_msg_end(struct nftnl_snapshot_writer *w,
+				   struct nlmsghdr *nlh)
+{
+	nftnl_snapshot_strip(nlh);
+
+	w->len += nlh->nlmsg_len;
+	w->hdr.len += nlh->nlmsg_len;
+	w->hdr.count++;
+}
+
+static int nftnl_snapshot_table(struct nftnl_table *t, void *data)
+{
+	struct nftnl_snapshot_writer *w = data;
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_snapshot_msg_start(w, NFT_MSG_NEWTABLE,
+				       nftnl_table_get_u32(t, NFTNL_TABLE_FAMILY),
+				       0);
+	if (nlh == NULL)
+		return -1;
+
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	nftnl_snapshot_msg_end(w, nlh);
+
+	return 0;
+}
+
+static int nftnl_snapshot_chain(struct nftnl_chain *c, void *data)
+{
+	struct nftnl_snapshot_writer *w = data;
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_snapshot_msg_start(w, NFT_MSG_NEWCHAIN,
+				       nftnl_chain_get_u32(c, NFTNL_CHAIN_FAMILY),
+				       0);
+	if (nlh == NULL)
+		return -1;
+
+	nftnl_chain_nlmsg_build_payload(nlh, c);
+	nftnl_snapshot_msg_end(w, nlh);
+
+	return 0;
+}
+
+static int nftnl_snapshot_set(struct nftnl_set *s, void *data)
+{
+	struct nftnl_snapshot_writer *w = data;
+	uint16_t family = nftnl_set_get_u32(s, NFTNL_SET_FAMILY);
+	struct nftnl_set_elems_iter *iter;
+	struct nlmsghdr *nlh;
+	int ret;
+
+	nlh = nftnl_snapshot_msg_start(w, NFT_MSG_NEWSET, family, 0);
+	if (nlh == NULL)
+		return -1;
+
+	nftnl_set_nlmsg_build_payload(nlh, s);
+	nftnl_snapshot_msg_end(w, nlh);
+
+	iter = nftnl_set_elems_iter_create_ro(s);
+	if (iter == NULL)
+		return -1;
+
+	/* Large sets are split, the elements attribute is limited to 64KB */
+	ret = nftnl_set_elems_iter_cur(iter) != NULL;
+	while (ret > 0) {
+		nlh = nftnl_snapshot_msg_start(w, NFT_MSG_NEWSETELEM, family,
+					       0);
+		if (nlh == NULL) {
+			ret = -1;
+			break;
+		}
+
+		ret = nftnl_set_elems_nlmsg_build_payload_iter(nlh, iter);
+		nftnl_snapshot_msg_end(w, nlh);
+	}
+	nftnl_set_elems_iter_destroy(iter);
+
+	return ret;
+}
+
+static int nftnl_snapshot_rule(struct nftnl_rule *r, void *data)
+{
+	struct nftnl_snapshot_writer *w = data;
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_snapshot_msg_start(w, NFT_MSG_NEWRULE,
+				       nftnl_rule_get_u32(r, NFTNL_RULE_FAMILY),
+				       NLM_F_APPEND);
+	if (nlh == NULL)
+		return -1;
+
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	nftnl_snapshot_msg_end(w, nlh);
+
+	return 0;
+}
+
+static int nftnl_snapshot_write_ruleset(struct nftnl_snapshot_writer *w,
+					const struct nftnl_ruleset *rs)
+{
+	if (nftnl_ruleset_is_set(rs, NFTNL_RULESET_TABLELIST) &&
+	    nftnl_table_list_foreach(nftnl_ruleset_get(rs,
+						       NFTNL_RULESET_TABLELIST),
+				     nftnl_snapshot_table, w) < 0)
+		return -1;
+
+	if (nftnl_ruleset_is_set(rs, NFTNL_RULESET_CHAINLIST) &&
+	    nftnl_chain_list_foreach(nftnl_ruleset_get(rs,
+						       NFTNL_RULESET_CHAINLIST),
+				     nftnl_snapshot_chain, w) < 0)
+		return -1;
+
+	if (nftnl_ruleset_is_set(rs, NFTNL_RULESET_SETLIST) &&
+	    nftnl_set_list_foreach(nftnl_ruleset_get(rs,
+						     NFTNL_RULESET_SETLIST),
+				   nftnl_snapshot_set, w) < 0)
+		return -1;
+
+	if (nftnl_ruleset_is_set(rs, NFTNL_RULESET_RULELIST) &&
+	    nftnl_rule_list_foreach(nftnl_ruleset_get(rs,
+						      NFTNL_RULESET_RULELIST),
+				    nftnl_snapshot_rule, w) < 0)
+		return -1;
+
+	return nftnl_snapshot_flush(w);
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_write);
+int nftnl_snapshot_write(int fd, const struct nftnl_ruleset *rs)
+{
+	struct nftnl_snapshot_writer w = {
+		.fd	= fd,
+	};
+	int ret = -1;
+
+	/* The snapshot is the whole file, that is what nftnl_snapshot_map()
+	 * expects, whatever was there before and wherever the offset was.
+	 */
+	if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0)
+		return -1;
+
+	w.buf = malloc(NFTNL_SNAPSHOT_BUFSIZ);
+	if (w.buf == NULL)
+		return -1;
+
+	/* The header is written last, an interrupted snapshot has no magic */
+	if (nftnl_snapshot_write_all(fd, (const char *)&w.hdr,
+				     sizeof(w.hdr)) < 0 ||
+	    nftnl_snapshot_write_ruleset(&w, rs) < 0)
+		goto out;
+
+	w.hdr.magic = NFTNL_SNAPSHOT_MAGIC;
+	w.hdr.version = NFTNL_SNAPSHOT_VERSION;
+	if (pwrite(fd, &w.hdr, sizeof(w.hdr), 0) != sizeof(w.hdr))
+		goto out;
+
+	ret = 0;
+out:
+	xfree(w.buf);
+	return ret;
+}
+
+struct nftnl_snapshot {
+	void				*map;
+	size_t				map_len;
+	const struct nftnl_snapshot_hdr	*hdr;
+	const struct nlmsghdr		*msgs;
+};
+
+static int nftnl_snapshot_validate(const struct nftnl_snapshot *snap)
+{
+	const struct nftnl_snapshot_hdr *hdr = snap->hdr;
+	const struct nlmsghdr *nlh = snap->msgs;
+	int len = hdr->len;
+	uint32_t count = 0;
+
+	if (hdr->magic != NFTNL_SNAPSHOT_MAGIC ||
+	    hdr->len != snap->map_len - sizeof(*hdr) || hdr->len > INT_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+	if (hdr->version != NFTNL_SNAPSHOT_VERSION) {
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+
+	while (mnl_nlmsg_ok(nlh, len)) {
+		if (NFNL_SUBSYS_ID(nlh->nlmsg_type) != NFNL_SUBSYS_NFTABLES ||
+		    nlh->nlmsg_len < MNL_NLMSG_HDRLEN +
+				     MNL_ALIGN(sizeof(struct nfgenmsg)))
+			break;
+
+		count++;
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+
+	if (len != 0 || count != hdr->count) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_map);
+struct nftnl_snapshot *nftnl_snapshot_map(int fd)
+{
+	struct nftnl_snapshot *snap;
+	struct stat st;
+
+	if (fstat(fd, &st) < 0)
+		return NULL;
+
+	if (st.st_size < sizeof(struct nftnl_snapshot_hdr)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	snap = calloc(1, sizeof(struct nftnl_snapshot));
+	if (snap == NULL)
+		return NULL;
+
+	snap->map_len = st.st_size;
+	snap->map = mmap(NULL, snap->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (snap->map == MAP_FAILED)
+		goto err1;
+
+	snap->hdr = snap->map;
+	snap->msgs = (const struct nlmsghdr *)(snap->hdr + 1);
+
+	if (nftnl_snapshot_validate(snap) < 0)
+		goto err2;
+
+	return snap;
+err2:
+	munmap(snap->map, snap->map_len);
+err1:
+	xfree(snap);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_unmap);
+void nftnl_snapshot_unmap(struct nftnl_snapshot *snap)
+{
+	munmap(snap->map, snap->map_len);
+	xfree(snap);
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_count);
+uint32_t nftnl_snapshot_count(const struct nftnl_snapshot *snap)
+{
+	return snap->hdr->count;
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_foreach);
+int nftnl_snapshot_foreach(const struct nftnl_snapshot *snap,
+			   int (*cb)(const struct nlmsghdr *nlh, void *data),
+			   void *data)
+{
+	const struct nlmsghdr *nlh = snap->msgs;
+	int len = snap->hdr->len;
+	int ret;
+
+	/* Messages were validated when the snapshot was mapped */
+	while (mnl_nlmsg_ok(nlh, len)) {
+		ret = cb(nlh, data);
+		if (ret < 0)
+			return ret;
+
+		nlh = mnl_nlmsg_next(nlh, &len);
+	}
+
+	return 0;
+}
+
+struct nftnl_snapshot_batch_ctx {
+	struct nftnl_batch	*batch;
+	uint32_t		*seq;
+};
+
+static int nftnl_snapshot_batch_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_snapshot_batch_ctx *ctx = data;
+
+	return nftnl_batch_add_nlmsg(ctx->batch, nlh, (*ctx->seq)++);
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_batch);
+int nftnl_snapshot_batch(const struct nftnl_snapshot *snap,
+			 struct nftnl_batch *batch, uint32_t *seq)
+{
+	struct nftnl_snapshot_batch_ctx ctx = {
+		.batch	= batch,
+		.seq	= seq,
+	};
+
+	return nftnl_snapshot_foreach(snap, nftnl_snapshot_batch_cb, &ctx);
+}
+
+/*
+ * Dumps are recorded as they are received from the kernel, the messages
+ * already have the NFT_MSG_NEW* types and the attributes that are needed
+ * to load them again.
+ */
+static bool nftnl_snapshot_dump_msg(const struct nlmsghdr *nlh)
+{
+	return NFNL_SUBSYS_ID(nlh->nlmsg_type) == NFNL_SUBSYS_NFTABLES &&
+	       nlh->nlmsg_len >= MNL_NLMSG_HDRLEN +
+				 MNL_ALIGN(sizeof(struct nfgenmsg));
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_dump_record);
+int nftnl_snapshot_dump_record(int fd, const void *buf, size_t len)
+{
+	const struct nlmsghdr *nlh = buf;
+	const char *run = buf;
+	int remain = len;
+
+	if (len > INT_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* Write contiguous runs of messages, leaving out NLMSG_DONE */
+	while (mnl_nlmsg_ok(nlh, remain)) {
+		if (!nftnl_snapshot_dump_msg(nlh)) {
+			if (nftnl_snapshot_write_all(fd, run,
+						     (const char *)nlh - run) < 0)
+				return -1;
+			run = (const char *)nlh + MNL_ALIGN(nlh->nlmsg_len);
+		}
+		nlh = mnl_nlmsg_next(nlh, &remain);
+	}
+
+	return nftnl_snapshot_write_all(fd, run, (const char *)nlh - run);
+}
+
+EXPORT_SYMBOL(nftnl_snapshot_dump_replay);
+int nftnl_snapshot_dump_replay(const void *buf, size_t len,
+			       struct nftnl_batch *batch, uint32_t *seq)
+{
+	const struct nlmsghdr *nlh = buf;
+	struct nlmsghdr *dst;
+	struct nfgenmsg *nfg;
+	int remain = len;
+	uint16_t flags;
+
+	if (len > INT_MAX) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	while (mnl_nlmsg_ok(nlh, remain)) {
+		if (nlh->nlmsg_type == NLMSG_DONE)
+			goto next;
+		if (!nftnl_snapshot_dump_msg(nlh)) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+		case NFT_MSG_NEWTABLE:
+		case NFT_MSG_NEWCHAIN:
+		case NFT_MSG_NEWSET:
+		case NFT_MSG_NEWSETELEM:
+			flags = NLM_F_CREATE | NLM_F_ACK;
+			break;
+		case NFT_MSG_NEWRULE:
+			flags = NLM_F_CREATE | NLM_F_ACK | NLM_F_APPEND;
+			break;
+		case NFT_MSG_NEWGEN:
+			goto next;
+		default:
+			errno = EINVAL;
+			return -1;
+		}
+
+		dst = nftnl_batch_copy_nlmsg(batch, nlh);
+		if (dst == NULL)
+			return -1;
+
+		/* Turn the dump reply into a request, NLM_F_MULTI goes away */
+		dst->nlmsg_flags = NLM_F_REQUEST | flags;
+		dst->nlmsg_seq = (*seq)++;
+		dst->nlmsg_pid = 0;
+		nfg = mnl_nlmsg_get_payload(dst);
+		nfg->res_id = 0;
+		nftnl_snapshot_strip(dst);
+
+		if (nftnl_batch_update(batch) < 0)
+			return -1;
+next:
+		nlh = mnl_nlmsg_next(nlh, &remain);
+	}
+
+	if (remain != 0) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
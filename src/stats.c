@@ -0,0 +1,234 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <libnftnl/stats.h>
+
+/*
+ * Every thread counts into a block of its own, so updates are plain stores
+ * that never bounce a cache line between threads. Blocks are never freed:
+ * when a thread exits its block is handed to the next new thread, which
+ * keeps adding to the same totals. Snapshots sum up all blocks.
+ */
+struct nftnl_stats_block {
+	struct nftnl_stats_block	*next;
+	int				in_use;
+	uint64_t			counter[NFTNL_STATS_NUM_COUNTERS];
+};
+
+struct nftnl_stats {
+	uint64_t	counter[NFTNL_STATS_NUM_COUNTERS];
+};
+
+int nftnl_stats_on;
+
+static struct nftnl_stats_block *nftnl_stats_blocks;
+static __thread struct nftnl_stats_block *nftnl_stats_cur;
+static pthread_once_t nftnl_stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t nftnl_stats_key;
+static bool nftnl_stats_key_ok;
+
+static void nftnl_stats_release(void *data)
+{
+	struct nftnl_stats_block *b = data;
+
+	__atomic_store_n(&b->in_use, 0, __ATOMIC_RELEASE);
+}
+
+static void nftnl_stats_init(void)
+{
+	nftnl_stats_key_ok =
+		pthread_key_create(&nftnl_stats_key, nftnl_stats_release) == 0;
+}
+
+/* Threads exiting after the library is unloaded must not run the destructor */
+static void __attribute__((destructor)) nftnl_stats_fini(void)
+{
+	if (nftnl_stats_key_ok)
+		pthread_key_delete(nftnl_stats_key);
+}
+
+static struct nftnl_stats_block *nftnl_stats_block_get(void)
+{
+	struct nftnl_stats_block *b;
+	int unused = 0;
+
+	pthread_once(&nftnl_stats_once, nftnl_stats_init);
+	if (!nftnl_stats_key_ok)
+		return NULL;
+
+	for (b = __atomic_load_n(&nftnl_stats_blocks, __ATOMIC_ACQUIRE);
+	     b != NULL; b = b->next) {
+		if (__atomic_compare_exchange_n(&b->in_use, &unused, 1, false,
+						__ATOMIC_ACQUIRE,
+						__ATOMIC_RELAXED))
+			goto out;
+		unused = 0;
+	}
+
+	b = calloc(1, sizeof(struct nftnl_stats_block));
+	if (b == NULL)
+		return NULL;
+	b->in_use = 1;
+	b->next = __atomic_load_n(&nftnl_stats_blocks, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&nftnl_stats_blocks, &b->next, b,
+					    true, __ATOMIC_RELEASE,
+					    __ATOMIC_RELAXED))
+		;
+out:
+	if (pthread_setspecific(nftnl_stats_key, b) != 0) {
+		nftnl_stats_release(b);
+		return NULL;
+	}
+	nftnl_stats_cur = b;
+	return b;
+}
+
+void __nftnl_stats_add(unsigned int counter, uint64_t val)
+{
+	struct nftnl_stats_block *b = nftnl_stats_cur;
+
+	if (b == NULL) {
+		b = nftnl_stats_block_get();
+		if (b == NULL)
+			return;
+	}
+
+	/* Only this thread writes to its block, snapshots read it atomically */
+	__atomic_store_n(&b->counter[counter], b->counter[counter] + val,
+			 __ATOMIC_RELAXED);
+}
+
+uint64_t __nftnl_stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void __nftnl_stats_expr(const struct expr_ops *ops, uint16_t attr,
+			uint64_t start)
+{
+	unsigned int counter;
+	uint64_t end;
+	int index;
+
+	end = __nftnl_stats_now();
+
+	index = nftnl_expr_ops_index(ops);
+	if (index < 0 || index >= NFTNL_STATS_EXPR_OPS_MAX)
+		return;
+
+	counter = NFTNL_STATS_EXPR_BASE +
+		  index * __NFTNL_STATS_EXPR_ATTR_MAX + attr;
+	__nftnl_stats_add(counter, 1);
+	__nftnl_stats_add(counter + 1, end - start);
+}
+
+/*
+ * nftnl_stats_enable - turn statistics on or off for all threads
+ *
+ * Counters are left as they are when statistics are turned off, so they
+ * pick up where they left off once turned on again.
+ */
+void nftnl_stats_enable(bool enable)
+{
+	__atomic_store_n(&nftnl_stats_on, enable, __ATOMIC_RELAXED);
+}
+EXPORT_SYMBOL(nftnl_stats_enable);
+
+/* Totals of all threads since the library was loaded */
+struct nftnl_stats *nftnl_stats_snapshot(void)
+{
+	struct nftnl_stats_block *b;
+	struct nftnl_stats *s;
+	int i;
+
+	s = calloc(1, sizeof(struct nftnl_stats));
+	if (s == NULL)
+		return NULL;
+
+	for (b = __atomic_load_n(&nftnl_stats_blocks, __ATOMIC_ACQUIRE);
+	     b != NULL; b = b->next) {
+		for (i = 0; i < NFTNL_STATS_NUM_COUNTERS; i++)
+			s->counter[i] += __atomic_load_n(&b->counter[i],
+							 __ATOMIC_RELAXED);
+	}
+
+	return s;
+}
+EXPORT_SYMBOL(nftnl_stats_snapshot);
+
+void nftnl_stats_free(struct nftnl_stats *s)
+{
+	xfree(s);
+}
+EXPORT_SYMBOL(nftnl_stats_free);
+
+uint64_t nftnl_stats_get(const struct nftnl_stats *s, uint16_t attr)
+{
+	if (attr > NFTNL_STATS_MAX)
+		return 0;
+
+	return s->counter[attr];
+}
+EXPORT_SYMBOL(nftnl_stats_get);
+
+uint64_t nftnl_stats_obj_get(const struct nftnl_stats *s, uint16_t obj,
+			     uint16_t attr)
+{
+	if (obj > NFTNL_STATS_OBJ_MAX || attr > NFTNL_STATS_OBJ_ATTR_MAX)
+		return 0;
+
+	return s->counter[NFTNL_STATS_OBJ_BASE +
+			  obj * __NFTNL_STATS_OBJ_ATTR_MAX + attr];
+}
+EXPORT_SYMBOL(nftnl_stats_obj_get);
+
+/* Names of the expression types counters are kept for, NULL at the end */
+const char *nftnl_stats_expr_name(const struct nftnl_stats *s,
+				  unsigned int index)
+{
+	struct expr_ops *ops;
+
+	if (index >= NFTNL_STATS_EXPR_OPS_MAX)
+		return NULL;
+
+	ops = nftnl_expr_ops_get(index);
+	return ops ? ops->name : NULL;
+}
+EXPORT_SYMBOL(nftnl_stats_expr_name);
+
+uint64_t nftnl_stats_expr_get(const struct nftnl_stats *s, const char *name,
+			      uint16_t attr)
+{
+	struct expr_ops *ops;
+	int index;
+
+	if (attr > NFTNL_STATS_EXPR_ATTR_MAX)
+		return 0;
+
+	ops = nftnl_expr_ops_lookup(name);
+	if (ops == NULL)
+		return 0;
+
+	index = nftnl_expr_ops_index(ops);
+	if (index < 0 || index >= NFTNL_STATS_EXPR_OPS_MAX)
+		return 0;
+
+	return s->counter[NFTNL_STATS_EXPR_BASE +
+			  index * __NFTNL_STATS_EXPR_ATTR_MAX + attr];
+}
+EXPORT_SYMBOL(nftnl_stats_expr_get);
@@ -38,7 +38,13 @@ struct nftnl_table {
 
 struct nftnl_table *nftnl_table_alloc(void)
 {
-	return calloc(1, sizeof(struct nftnl_table));
+	struct nftnl_table *t;
+
+	t = calloc(1, sizeof(struct nftnl_table));
+	if (t != NULL)
+		nftnl_stats_obj_add(NFTNL_STATS_TABLE, NFTNL_STATS_OBJ_ALLOC, 1);
+
+	return t;
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_alloc, nft_table_alloc);
 
@@ -47,10 +53,22 @@ void nftnl_table_free(struct nftnl_table *t)
 	if (t->flags & (1 << NFTNL_TABLE_NAME))
 		xfree(t->name);
 
+	nftnl_stats_obj_add(NFTNL_STATS_TABLE, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(t);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_free, nft_table_free);
 
+EXPORT_SYMBOL(nftnl_table_memsize);
+size_t nftnl_table_memsize(const struct nftnl_table *t)
+{
+	size_t size = sizeof(struct nftnl_table);
+
+	if (t->flags & (1 << NFTNL_TABLE_NAME))
+		size += nftnl_strsize(t->name);
+
+	return size;
+}
+
 bool nftnl_table_is_set(const struct nftnl_table *t, uint16_t attr)
 {
 	return t->flags & (1 << attr);
@@ -79,6 +97,15 @@ void nftnl_table_unset(struct nftnl_table *t, uint16_t attr)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_unset, nft_table_attr_unset);
 
+/* Drop all attributes so the table can be parsed into again */
+void nftnl_table_reset(struct nftnl_table *t)
+{
+	uint16_t attr;
+
+	for (attr = 0; attr <= NFTNL_TABLE_MAX; attr++)
+		nftnl_table_unset(t, attr);
+}
+
 static uint32_t nftnl_table_validate[NFTNL_TABLE_MAX + 1] = {
 	[NFTNL_TABLE_FLAGS]	= sizeof(uint32_t),
 	[NFTNL_TABLE_FAMILY]	= sizeof(uint32_t),
@@ -193,6 +220,9 @@ void nftnl_table_nlmsg_build_payload(struct nlmsghdr *nlh, const struct nftnl_ta
 		mnl_attr_put_strz(nlh, NFTA_TABLE_NAME, t->name);
 	if (t->flags & (1 << NFTNL_TABLE_FLAGS))
 		mnl_attr_put_u32(nlh, NFTA_TABLE_FLAGS, htonl(t->table_flags));
+
+	nftnl_stats_obj_msg(NFTNL_STATS_TABLE, NFTNL_STATS_OBJ_BUILD_MSGS,
+			    nlh->nlmsg_len);
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_nlmsg_build_payload, nft_table_nlmsg_build_payload);
 
@@ -225,6 +255,9 @@ int nftnl_table_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_table *t)
 	struct nlattr *tb[NFTA_TABLE_MAX+1] = {};
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
 
+	nftnl_stats_obj_msg(NFTNL_STATS_TABLE, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
 	if (mnl_attr_parse(nlh, sizeof(*nfg), nftnl_table_parse_attr_cb, tb) < 0)
 		return -1;
 
@@ -393,8 +426,8 @@ int nftnl_table_parse_file(struct nftnl_table *t, enum nftnl_parse_type type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_parse_file, nft_table_parse_file);
 
-static int nftnl_table_export(char *buf, size_t size, struct nftnl_table *t,
-			    int type)
+static int nftnl_table_snprintf_export(char *buf, size_t size,
+				       struct nftnl_table *t, int type)
 {
 	NFTNL_BUF_INIT(b, buf, size);
 
@@ -434,7 +467,7 @@ static int nftnl_table_cmd_snprintf(char *buf, size_t size, struct nftnl_table *
 		break;
 	case NFTNL_OUTPUT_XML:
 	case NFTNL_OUTPUT_JSON:
-		ret = nftnl_table_export(buf+offset, len, t, type);
+		ret = nftnl_table_snprintf_export(buf+offset, len, t, type);
 		break;
 	default:
 		return -1;
@@ -470,6 +503,14 @@ int nftnl_table_fprintf(FILE *fp, struct nftnl_table *t, uint32_t type,
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_fprintf, nft_table_fprintf);
 
+EXPORT_SYMBOL(nftnl_table_export);
+int nftnl_table_export(struct nftnl_sink *s, struct nftnl_table *t,
+		       uint32_t type, uint32_t flags)
+{
+	return nftnl_sink_printf(s, t, NFTNL_CMD_UNSPEC, type, flags,
+				 nftnl_table_do_snprintf);
+}
+
 struct nftnl_table_list {
 	struct list_head list;
 };
@@ -500,6 +541,18 @@ void nftnl_table_list_free(struct nftnl_table_list *list)
 }
 EXPORT_SYMBOL_ALIAS(nftnl_table_list_free, nft_table_list_free);
 
+EXPORT_SYMBOL(nftnl_table_list_memsize);
+size_t nftnl_table_list_memsize(const struct nftnl_table_list *list)
+{
+	size_t size = sizeof(struct nftnl_table_list);
+	struct nftnl_table *t;
+
+	list_for_each_entry(t, &list->list, head)
+		size += nftnl_table_memsize(t);
+
+	return size;
+}
+
 int nftnl_table_list_is_empty(struct nftnl_table_list *list)
 {
 	return list_empty(&list->list);
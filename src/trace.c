@@ -50,23 +50,46 @@ struct nftnl_trace {
 	uint16_t oiftype;
 
 	uint32_t flags;
+	/* strings and headers point into the last parsed message */
+	bool view;
 };
 
 EXPORT_SYMBOL(nftnl_trace_alloc);
 struct nftnl_trace *nftnl_trace_alloc(void)
 {
-	return calloc(1, sizeof(struct nftnl_trace));
+	struct nftnl_trace *t;
+
+	t = calloc(1, sizeof(struct nftnl_trace));
+	if (t != NULL)
+		nftnl_stats_obj_add(NFTNL_STATS_TRACE, NFTNL_STATS_OBJ_ALLOC, 1);
+
+	return t;
+}
+
+static void nftnl_trace_release(struct nftnl_trace *t)
+{
+	if (!t->view) {
+		xfree(t->chain);
+		xfree(t->table);
+		xfree(t->jump_target);
+		xfree(t->ll.data);
+		xfree(t->nh.data);
+		xfree(t->th.data);
+	}
+
+	t->chain = NULL;
+	t->table = NULL;
+	t->jump_target = NULL;
+	t->ll.data = NULL;
+	t->nh.data = NULL;
+	t->th.data = NULL;
 }
 
 EXPORT_SYMBOL(nftnl_trace_free);
 void nftnl_trace_free(struct nftnl_trace *t)
 {
-	xfree(t->chain);
-	xfree(t->table);
-	xfree(t->jump_target);
-	xfree(t->ll.data);
-	xfree(t->nh.data);
-	xfree(t->th.data);
+	nftnl_trace_release(t);
+	nftnl_stats_obj_add(NFTNL_STATS_TRACE, NFTNL_STATS_OBJ_FREE, 1);
 	xfree(t);
 }
 
@@ -252,7 +275,17 @@ uint64_t nftnl_trace_get_u64(const struct nftnl_trace *trace, uint16_t type)
 	return 0;
 }
 
-static bool nftnl_trace_nlmsg_parse_hdrdata(struct nlattr *attr,
+static char *nftnl_trace_nlmsg_parse_str(const struct nftnl_trace *t,
+					 const struct nlattr *attr)
+{
+	if (t->view)
+		return (char *)mnl_attr_get_str(attr);
+
+	return strdup(mnl_attr_get_str(attr));
+}
+
+static bool nftnl_trace_nlmsg_parse_hdrdata(const struct nftnl_trace *t,
+					    struct nlattr *attr,
 					    struct nftnl_header_data *header)
 {
 	uint32_t len;
@@ -262,6 +295,12 @@ static bool nftnl_trace_nlmsg_parse_hdrdata(struct nlattr *attr,
 
 	len = mnl_attr_get_payload_len(attr);
 
+	if (t->view) {
+		header->data = mnl_attr_get_payload(attr);
+		header->len = len;
+		return true;
+	}
+
 	header->data = malloc(len);
 	if (header->data) {
 		memcpy(header->data, mnl_attr_get_payload(attr), len);
@@ -311,19 +350,30 @@ nftnl_trace_parse_verdict(const struct nlattr *attr, struct nftnl_trace *t)
 	case NFT_JUMP:
 		if (!tb[NFTA_VERDICT_CHAIN])
 			abi_breakage();
-		t->jump_target = strdup(mnl_attr_get_str(tb[NFTA_VERDICT_CHAIN]));
+		t->jump_target = nftnl_trace_nlmsg_parse_str(t,
+						tb[NFTA_VERDICT_CHAIN]);
 		if (t->jump_target)
 			t->flags |= (1 << NFTNL_TRACE_JUMP_TARGET);
 		break;
 	}
 }
 
-EXPORT_SYMBOL(nftnl_trace_nlmsg_parse);
-int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t)
+static int nftnl_trace_nlmsg_do_parse(const struct nlmsghdr *nlh,
+				      struct nftnl_trace *t, bool view)
 {
 	struct nfgenmsg *nfg = mnl_nlmsg_get_payload(nlh);
 	struct nlattr *tb[NFTA_TRACE_MAX+1] = {};
 
+	/* A view never carries anything over from the previous event */
+	if (view || t->view) {
+		nftnl_trace_release(t);
+		t->flags = 0;
+	}
+	t->view = view;
+
+	nftnl_stats_obj_msg(NFTNL_STATS_TRACE, NFTNL_STATS_OBJ_PARSE_MSGS,
+			    nlh->nlmsg_len);
+
 	if (mnl_attr_parse(nlh, sizeof(*nfg), nftnl_trace_parse_attr_cb, tb) < 0)
 		return -1;
 
@@ -343,12 +393,12 @@ int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t)
 	t->flags |= (1 << NFTNL_TRACE_ID);
 
 	if (tb[NFTA_TRACE_TABLE]) {
-		t->table = strdup(mnl_attr_get_str(tb[NFTA_TRACE_TABLE]));
+		t->table = nftnl_trace_nlmsg_parse_str(t, tb[NFTA_TRACE_TABLE]);
 		t->flags |= (1 << NFTNL_TRACE_TABLE);
 	}
 
 	if (tb[NFTA_TRACE_CHAIN]) {
-		t->chain = strdup(mnl_attr_get_str(tb[NFTA_TRACE_CHAIN]));
+		t->chain = nftnl_trace_nlmsg_parse_str(t, tb[NFTA_TRACE_CHAIN]);
 		t->flags |= (1 << NFTNL_TRACE_CHAIN);
 	}
 
@@ -385,22 +435,25 @@ int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t)
 	if (tb[NFTA_TRACE_VERDICT])
 		nftnl_trace_parse_verdict(tb[NFTA_TRACE_VERDICT], t);
 
-	if (nftnl_trace_nlmsg_parse_hdrdata(tb[NFTA_TRACE_LL_HEADER], &t->ll))
+	if (nftnl_trace_nlmsg_parse_hdrdata(t, tb[NFTA_TRACE_LL_HEADER],
+					    &t->ll))
 		t->flags |= (1 << NFTNL_TRACE_LL_HEADER);
 
-	if (nftnl_trace_nlmsg_parse_hdrdata(tb[NFTA_TRACE_NETWORK_HEADER], &t->nh))
+	if (nftnl_trace_nlmsg_parse_hdrdata(t, tb[NFTA_TRACE_NETWORK_HEADER],
+					    &t->nh))
 		t->flags |= (1 << NFTNL_TRACE_NETWORK_HEADER);
 
-	if (nftnl_trace_nlmsg_parse_hdrdata(tb[NFTA_TRACE_TRANSPORT_HEADER], &t->th))
+	if (nftnl_trace_nlmsg_parse_hdrdata(t, tb[NFTA_TRACE_TRANSPORT_HEADER],
+					    &t->th))
 		t->flags |= (1 << NFTNL_TRACE_TRANSPORT_HEADER);
 
 	if (tb[NFTA_TRACE_NFPROTO]) {
-		t->nfproto = ntohs(mnl_attr_get_u16(tb[NFTA_TRACE_NFPROTO]));
+		t->nfproto = ntohl(mnl_attr_get_u32(tb[NFTA_TRACE_NFPROTO]));
 		t->flags |= (1 << NFTNL_TRACE_NFPROTO);
 	}
 
 	if (tb[NFTA_TRACE_POLICY]) {
-		t->policy = ntohs(mnl_attr_get_u16(tb[NFTA_TRACE_POLICY]));
+		t->policy = ntohl(mnl_attr_get_u32(tb[NFTA_TRACE_POLICY]));
 		t->flags |= (1 << NFTNL_TRACE_POLICY);
 	}
 
@@ -411,3 +464,21 @@ int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t)
 
 	return 0;
 }
+
+EXPORT_SYMBOL(nftnl_trace_nlmsg_parse);
+int nftnl_trace_nlmsg_parse(const struct nlmsghdr *nlh, struct nftnl_trace *t)
+{
+	return nftnl_trace_nlmsg_do_parse(nlh, t, false);
+}
+
+/* Same as nftnl_trace_nlmsg_parse() but nothing is copied: strings and
+ * headers point into nlh and are only valid as long as the message buffer
+ * is, i.e. until the next receive. The trace object can be reused for
+ * every event without allocating.
+ */
+EXPORT_SYMBOL(nftnl_trace_nlmsg_parse_view);
+int nftnl_trace_nlmsg_parse_view(const struct nlmsghdr *nlh,
+				 struct nftnl_trace *t)
+{
+	return nftnl_trace_nlmsg_do_parse(nlh, t, true);
+}
@@ -0,0 +1,442 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/trace.h>
+
+struct nftnl_trace_step {
+	uint32_t	flags;
+	uint32_t	type;
+	uint32_t	verdict;
+	uint32_t	policy;
+	uint64_t	rule_handle;
+	char		table[NFT_TABLE_MAXNAMELEN];
+	char		chain[NFT_CHAIN_MAXNAMELEN];
+	char		jump_target[NFT_CHAIN_MAXNAMELEN];
+};
+
+struct nftnl_trace_path {
+	struct hlist_node	hnode;
+	struct list_head	list;
+	uint32_t		id;
+	uint32_t		family;
+	uint32_t		verdict;
+	bool			complete;
+	uint64_t		last;
+	unsigned int		num_steps;
+	unsigned int		num_dropped;
+	struct nftnl_trace_step	*steps;
+};
+
+/* Paths and their steps are allocated up front. Pending paths are kept on
+ * the active list in the order they were last updated, so the ones that
+ * time out are always at its head.
+ */
+struct nftnl_trace_corr {
+	struct hlist_head	*hash;
+	unsigned int		hash_shift;
+	struct list_head	active;
+	struct list_head	free;
+	uint64_t		timeout;
+	unsigned int		max_steps;
+	int			(*cb)(const struct nftnl_trace_path *p,
+				      void *data);
+	void			*data;
+	struct nftnl_trace_path	*paths;
+	struct nftnl_trace_step	*steps;
+};
+
+EXPORT_SYMBOL(nftnl_trace_corr_alloc);
+struct nftnl_trace_corr *
+nftnl_trace_corr_alloc(unsigned int max_paths, unsigned int max_steps,
+		       uint64_t timeout,
+		       int (*cb)(const struct nftnl_trace_path *p, void *data),
+		       void *data)
+{
+	struct nftnl_trace_corr *c;
+	unsigned int i, bits = 1;
+
+	if (max_paths == 0 || max_steps == 0 || cb == NULL) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	while (bits < 31 && (1U << bits) < max_paths)
+		bits++;
+
+	c = calloc(1, sizeof(struct nftnl_trace_corr));
+	if (c == NULL)
+		return NULL;
+
+	c->hash = calloc(1U << bits, sizeof(struct hlist_head));
+	if (c->hash == NULL)
+		goto err1;
+
+	c->paths = calloc(max_paths, sizeof(struct nftnl_trace_path));
+	if (c->paths == NULL)
+		goto err2;
+
+	c->steps = calloc((size_t)max_paths * max_steps,
+			  sizeof(struct nftnl_trace_step));
+	if (c->steps == NULL)
+		goto err3;
+
+	c->hash_shift = 32 - bits;
+	c->timeout = timeout;
+	c->max_steps = max_steps;
+	c->cb = cb;
+	c->data = data;
+	INIT_LIST_HEAD(&c->active);
+	INIT_LIST_HEAD(&c->free);
+	for (i = 0; i < max_paths; i++) {
+		c->paths[i].steps = &c->steps[(size_t)i * max_steps];
+		list_add_tail(&c->paths[i].list, &c->free);
+	}
+
+	return c;
+err3:
+	xfree(c->paths);
+err2:
+	xfree(c->hash);
+err1:
+	xfree(c);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_trace_corr_free);
+void nftnl_trace_corr_free(struct nftnl_trace_corr *c)
+{
+	xfree(c->steps);
+	xfree(c->paths);
+	xfree(c->hash);
+	xfree(c);
+}
+
+static struct hlist_head *nftnl_trace_corr_bucket(struct nftnl_trace_corr *c,
+						  uint32_t id)
+{
+	return &c->hash[(id * 0x9e3779b1U) >> c->hash_shift];
+}
+
+static struct nftnl_trace_path *
+nftnl_trace_corr_lookup(struct nftnl_trace_corr *c, uint32_t id)
+{
+	struct nftnl_trace_path *p;
+	struct hlist_node *n;
+
+	hlist_for_each_entry(p, n, nftnl_trace_corr_bucket(c, id), hnode) {
+		if (p->id == id)
+			return p;
+	}
+
+	return NULL;
+}
+
+/* Hand the path over to the callback and put it back on the free list */
+static int nftnl_trace_corr_deliver(struct nftnl_trace_corr *c,
+				    struct nftnl_trace_path *p)
+{
+	int ret;
+
+	ret = c->cb(p, c->data);
+
+	hlist_del(&p->hnode);
+	list_move_tail(&p->list, &c->free);
+
+	return ret < 0 ? -1 : 0;
+}
+
+static struct nftnl_trace_path *
+nftnl_trace_corr_get(struct nftnl_trace_corr *c, uint32_t id, int *ret)
+{
+	struct nftnl_trace_path *p;
+
+	p = nftnl_trace_corr_lookup(c, id);
+	if (p != NULL)
+		return p;
+
+	/* Out of paths, give up on the one that waited longest */
+	if (list_empty(&c->free)) {
+		p = list_entry(c->active.next, struct nftnl_trace_path, list);
+		if (nftnl_trace_corr_deliver(c, p) < 0)
+			*ret = -1;
+	}
+
+	p = list_entry(c->free.next, struct nftnl_trace_path, list);
+	p->id = id;
+	p->family = 0;
+	p->verdict = 0;
+	p->complete = false;
+	p->num_steps = 0;
+	p->num_dropped = 0;
+	hlist_add_head(&p->hnode, nftnl_trace_corr_bucket(c, id));
+
+	return p;
+}
+
+static void nftnl_trace_step_str(char *dst, size_t size,
+				 const struct nftnl_trace *t, uint16_t attr)
+{
+	const char *str;
+	uint32_t len;
+
+	str = nftnl_trace_get_data(t, attr, &len);
+	if (len >= size)
+		len = size - 1;
+
+	memcpy(dst, str, len);
+	dst[len] = '\0';
+}
+
+static void nftnl_trace_step_set(struct nftnl_trace_step *s,
+				 const struct nftnl_trace *t)
+{
+	s->flags = 0;
+
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_TYPE)) {
+		s->type = nftnl_trace_get_u32(t, NFTNL_TRACE_TYPE);
+		s->flags |= (1 << NFTNL_TRACE_TYPE);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_VERDICT)) {
+		s->verdict = nftnl_trace_get_u32(t, NFTNL_TRACE_VERDICT);
+		s->flags |= (1 << NFTNL_TRACE_VERDICT);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_POLICY)) {
+		s->policy = nftnl_trace_get_u32(t, NFTNL_TRACE_POLICY);
+		s->flags |= (1 << NFTNL_TRACE_POLICY);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_RULE_HANDLE)) {
+		s->rule_handle = nftnl_trace_get_u64(t, NFTNL_TRACE_RULE_HANDLE);
+		s->flags |= (1 << NFTNL_TRACE_RULE_HANDLE);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_TABLE)) {
+		nftnl_trace_step_str(s->table, sizeof(s->table), t,
+				     NFTNL_TRACE_TABLE);
+		s->flags |= (1 << NFTNL_TRACE_TABLE);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_CHAIN)) {
+		nftnl_trace_step_str(s->chain, sizeof(s->chain), t,
+				     NFTNL_TRACE_CHAIN);
+		s->flags |= (1 << NFTNL_TRACE_CHAIN);
+	}
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_JUMP_TARGET)) {
+		nftnl_trace_step_str(s->jump_target, sizeof(s->jump_target), t,
+				     NFTNL_TRACE_JUMP_TARGET);
+		s->flags |= (1 << NFTNL_TRACE_JUMP_TARGET);
+	}
+}
+
+/* A packet is done with a hook once a rule issues an absolute verdict or
+ * the base chain policy applies. Jumps, gotos, returns and continues only
+ * move it along the same path.
+ */
+static bool nftnl_trace_step_final(const struct nftnl_trace_step *s,
+				   uint32_t *verdict)
+{
+	switch (s->type) {
+	case NFT_TRACETYPE_POLICY:
+		*verdict = s->flags & (1 << NFTNL_TRACE_POLICY) ?
+			   s->policy : s->verdict;
+		return true;
+	case NFT_TRACETYPE_RULE:
+		if (!(s->flags & (1 << NFTNL_TRACE_VERDICT)) ||
+		    (int32_t)s->verdict < 0)
+			return false;
+		*verdict = s->verdict;
+		return true;
+	}
+
+	return false;
+}
+
+/* Expire paths that saw no event for longer than the timeout. */
+EXPORT_SYMBOL(nftnl_trace_corr_expire);
+int nftnl_trace_corr_expire(struct nftnl_trace_corr *c, uint64_t now)
+{
+	struct nftnl_trace_path *p;
+	int ret = 0;
+
+	while (!list_empty(&c->active)) {
+		p = list_entry(c->active.next, struct nftnl_trace_path, list);
+		if (now - p->last < c->timeout)
+			break;
+
+		if (nftnl_trace_corr_deliver(c, p) < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+/* Add one trace event, now is the time it was received in whatever unit the
+ * timeout was given. The callback is called for the path if this event
+ * completes it, for paths that time out and for the oldest path if there
+ * is no room for a new one. Returns -1 if any of these callbacks failed.
+ */
+EXPORT_SYMBOL(nftnl_trace_corr_add);
+int nftnl_trace_corr_add(struct nftnl_trace_corr *c,
+			 const struct nftnl_trace *t, uint64_t now)
+{
+	struct nftnl_trace_path *p;
+	struct nftnl_trace_step *s;
+	int ret;
+
+	if (!nftnl_trace_is_set(t, NFTNL_TRACE_ID)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	ret = nftnl_trace_corr_expire(c, now);
+
+	p = nftnl_trace_corr_get(c, nftnl_trace_get_u32(t, NFTNL_TRACE_ID),
+				 &ret);
+	p->last = now;
+	list_move_tail(&p->list, &c->active);
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_FAMILY))
+		p->family = nftnl_trace_get_u32(t, NFTNL_TRACE_FAMILY);
+
+	/* Once the steps are used up, only the final verdict is kept */
+	if (p->num_steps < c->max_steps) {
+		s = &p->steps[p->num_steps++];
+	} else {
+		s = &p->steps[p->num_steps - 1];
+		p->num_dropped++;
+	}
+	nftnl_trace_step_set(s, t);
+
+	if (nftnl_trace_step_final(s, &p->verdict)) {
+		p->complete = true;
+		if (nftnl_trace_corr_deliver(c, p) < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+/* Deliver all pending paths as incomplete, e.g. when tracing stops. */
+EXPORT_SYMBOL(nftnl_trace_corr_flush);
+int nftnl_trace_corr_flush(struct nftnl_trace_corr *c)
+{
+	struct nftnl_trace_path *p;
+	int ret = 0;
+
+	while (!list_empty(&c->active)) {
+		p = list_entry(c->active.next, struct nftnl_trace_path, list);
+		if (nftnl_trace_corr_deliver(c, p) < 0)
+			ret = -1;
+	}
+
+	return ret;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_is_complete);
+bool nftnl_trace_path_is_complete(const struct nftnl_trace_path *p)
+{
+	return p->complete;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_id);
+uint32_t nftnl_trace_path_id(const struct nftnl_trace_path *p)
+{
+	return p->id;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_family);
+uint32_t nftnl_trace_path_family(const struct nftnl_trace_path *p)
+{
+	return p->family;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_verdict);
+uint32_t nftnl_trace_path_verdict(const struct nftnl_trace_path *p)
+{
+	return p->verdict;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_num_steps);
+unsigned int nftnl_trace_path_num_steps(const struct nftnl_trace_path *p)
+{
+	return p->num_steps;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_num_dropped);
+unsigned int nftnl_trace_path_num_dropped(const struct nftnl_trace_path *p)
+{
+	return p->num_dropped;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_step_is_set);
+bool nftnl_trace_path_step_is_set(const struct nftnl_trace_path *p,
+				  unsigned int step, uint16_t attr)
+{
+	if (step >= p->num_steps || attr > NFTNL_TRACE_MAX)
+		return false;
+
+	return p->steps[step].flags & (1 << attr);
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_step_get_u32);
+uint32_t nftnl_trace_path_step_get_u32(const struct nftnl_trace_path *p,
+				       unsigned int step, uint16_t attr)
+{
+	if (!nftnl_trace_path_step_is_set(p, step, attr))
+		return 0;
+
+	switch (attr) {
+	case NFTNL_TRACE_TYPE:
+		return p->steps[step].type;
+	case NFTNL_TRACE_VERDICT:
+		return p->steps[step].verdict;
+	case NFTNL_TRACE_POLICY:
+		return p->steps[step].policy;
+	}
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_step_get_u64);
+uint64_t nftnl_trace_path_step_get_u64(const struct nftnl_trace_path *p,
+				       unsigned int step, uint16_t attr)
+{
+	if (!nftnl_trace_path_step_is_set(p, step, attr))
+		return 0;
+
+	switch (attr) {
+	case NFTNL_TRACE_RULE_HANDLE:
+		return p->steps[step].rule_handle;
+	}
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_trace_path_step_get_str);
+const char *nftnl_trace_path_step_get_str(const struct nftnl_trace_path *p,
+					  unsigned int step, uint16_t attr)
+{
+	if (!nftnl_trace_path_step_is_set(p, step, attr))
+		return NULL;
+
+	switch (attr) {
+	case NFTNL_TRACE_TABLE:
+		return p->steps[step].table;
+	case NFTNL_TRACE_CHAIN:
+		return p->steps[step].chain;
+	case NFTNL_TRACE_JUMP_TARGET:
+		return p->steps[step].jump_target;
+	}
+
+	return NULL;
+}
@@ -0,0 +1,683 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ */
+#include "internal.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/trace.h>
+
+/* NF_DROP to NF_STOP, then NFT_CONTINUE down to NFT_RETURN */
+#define NFTNL_TRACE_HIST_VERDICTS	(NF_MAX_VERDICT + 1 - NFT_RETURN)
+#define NFTNL_TRACE_HIST_IFACES		256
+
+struct nftnl_trace_hist_rule {
+	uint32_t	used;
+	uint32_t	hash;
+	uint32_t	family;
+	uint64_t	handle;
+	uint64_t	hits;
+	char		table[NFT_TABLE_MAXNAMELEN];
+	char		chain[NFT_CHAIN_MAXNAMELEN];
+};
+
+struct nftnl_trace_hist_iface {
+	uint32_t	used;
+	uint32_t	ifindex;
+	uint64_t	hits;
+};
+
+/* Each shard has a single writer. Counters are bumped with relaxed atomic
+ * stores and new entries are published last with a release store, so a
+ * snapshot can be taken from another thread at any time without locking.
+ */
+struct nftnl_trace_hist_shard {
+	struct nftnl_trace_hist_rule	*rules;
+	unsigned int			num_rules;
+	struct nftnl_trace_hist_iface	iface[2][NFTNL_TRACE_HIST_IFACES];
+	unsigned int			num_ifaces[2];
+	uint64_t			verdicts[NFTNL_TRACE_HIST_VERDICTS];
+	uint64_t			overflow;
+	struct nftnl_trace		*trace;
+};
+
+struct nftnl_trace_hist {
+	unsigned int			nshards;
+	unsigned int			max_rules;
+	unsigned int			mask;
+	struct nftnl_trace_hist_shard	*shards[];
+};
+
+struct nftnl_trace_hist_snap {
+	struct nftnl_trace_hist_rule	*rules;
+	unsigned int			num_rules;
+	struct nftnl_trace_hist_iface	*iface[2];
+	unsigned int			num_ifaces[2];
+	uint64_t			verdicts[NFTNL_TRACE_HIST_VERDICTS];
+	uint64_t			overflow;
+};
+
+static void nftnl_trace_hist_shard_free(struct nftnl_trace_hist_shard *s)
+{
+	if (s->trace)
+		nftnl_trace_free(s->trace);
+	xfree(s->rules);
+	xfree(s);
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_alloc);
+struct nftnl_trace_hist *nftnl_trace_hist_alloc(unsigned int nshards,
+						unsigned int max_rules)
+{
+	struct nftnl_trace_hist *h;
+	struct nftnl_trace_hist_shard *s;
+	unsigned int slots = 1;
+
+	if (nshards == 0 || max_rules == 0 || max_rules > UINT32_MAX / 4) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	/* Keep the rule tables at most half full */
+	while (slots < 2 * max_rules)
+		slots <<= 1;
+
+	h = calloc(1, sizeof(*h) + nshards * sizeof(h->shards[0]));
+	if (h == NULL)
+		return NULL;
+
+	h->max_rules = max_rules;
+	h->mask = slots - 1;
+
+	/* Shards are allocated apart so writers do not share cache lines */
+	for (; h->nshards < nshards; h->nshards++) {
+		s = calloc(1, sizeof(struct nftnl_trace_hist_shard));
+		if (s == NULL)
+			goto err;
+		h->shards[h->nshards] = s;
+
+		s->rules = calloc(slots, sizeof(struct nftnl_trace_hist_rule));
+		s->trace = nftnl_trace_alloc();
+		if (s->rules == NULL || s->trace == NULL) {
+			h->nshards++;
+			goto err;
+		}
+	}
+
+	return h;
+err:
+	nftnl_trace_hist_free(h);
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_free);
+void nftnl_trace_hist_free(struct nftnl_trace_hist *h)
+{
+	unsigned int i;
+
+	for (i = 0; i < h->nshards; i++)
+		nftnl_trace_hist_shard_free(h->shards[i]);
+	xfree(h);
+}
+
+static void nftnl_trace_hist_inc(uint64_t *counter)
+{
+	__atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+static uint64_t nftnl_trace_hist_read(const uint64_t *counter)
+{
+	return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static bool nftnl_trace_hist_used(const uint32_t *used)
+{
+	return __atomic_load_n(used, __ATOMIC_ACQUIRE);
+}
+
+static void nftnl_trace_hist_publish(uint32_t *used)
+{
+	__atomic_store_n(used, 1, __ATOMIC_RELEASE);
+}
+
+static int nftnl_trace_hist_verdict_idx(uint32_t verdict)
+{
+	int32_t v = verdict;
+
+	if (v < 0)
+		return v >= NFT_RETURN ? NF_MAX_VERDICT - v : -1;
+
+	v &= NF_VERDICT_MASK;
+	return v <= NF_MAX_VERDICT ? v : -1;
+}
+
+static uint32_t nftnl_trace_hist_hash(uint32_t family, uint64_t handle,
+				      const char *table, const char *chain)
+{
+	uint32_t hash = 2166136261U;
+
+	hash = (hash ^ family) * 16777619U;
+	hash = (hash ^ (uint32_t)handle) * 16777619U;
+	hash = (hash ^ (uint32_t)(handle >> 32)) * 16777619U;
+	for (; *table; table++)
+		hash = (hash ^ (uint8_t)*table) * 16777619U;
+	hash = (hash ^ '/') * 16777619U;
+	for (; *chain; chain++)
+		hash = (hash ^ (uint8_t)*chain) * 16777619U;
+
+	return hash;
+}
+
+static bool nftnl_trace_hist_rule_match(const struct nftnl_trace_hist_rule *r,
+					uint32_t hash, uint32_t family,
+					uint64_t handle, const char *table,
+					const char *chain)
+{
+	return r->hash == hash && r->family == family && r->handle == handle &&
+	       strcmp(r->table, table) == 0 && strcmp(r->chain, chain) == 0;
+}
+
+static void nftnl_trace_hist_add_rule(struct nftnl_trace_hist *h,
+				      struct nftnl_trace_hist_shard *s,
+				      const struct nftnl_trace *t)
+{
+	const char *table = nftnl_trace_get_str(t, NFTNL_TRACE_TABLE);
+	const char *chain = nftnl_trace_get_str(t, NFTNL_TRACE_CHAIN);
+	uint64_t handle = nftnl_trace_get_u64(t, NFTNL_TRACE_RULE_HANDLE);
+	uint32_t family = nftnl_trace_get_u32(t, NFTNL_TRACE_FAMILY);
+	struct nftnl_trace_hist_rule *r;
+	uint32_t hash, i;
+
+	if (table == NULL || chain == NULL ||
+	    strlen(table) >= NFT_TABLE_MAXNAMELEN ||
+	    strlen(chain) >= NFT_CHAIN_MAXNAMELEN) {
+		nftnl_trace_hist_inc(&s->overflow);
+		return;
+	}
+
+	hash = nftnl_trace_hist_hash(family, handle, table, chain);
+	for (i = hash & h->mask; ; i = (i + 1) & h->mask) {
+		r = &s->rules[i];
+		if (!r->used)
+			break;
+		if (nftnl_trace_hist_rule_match(r, hash, family, handle,
+						table, chain)) {
+			nftnl_trace_hist_inc(&r->hits);
+			return;
+		}
+	}
+
+	if (s->num_rules == h->max_rules) {
+		nftnl_trace_hist_inc(&s->overflow);
+		return;
+	}
+
+	r->hash = hash;
+	r->family = family;
+	r->handle = handle;
+	r->hits = 1;
+	strcpy(r->table, table);
+	strcpy(r->chain, chain);
+	s->num_rules++;
+	nftnl_trace_hist_publish(&r->used);
+}
+
+static void nftnl_trace_hist_add_iface(struct nftnl_trace_hist_shard *s,
+				       int dir, uint32_t ifindex)
+{
+	struct nftnl_trace_hist_iface *iface = s->iface[dir];
+	unsigned int i;
+
+	for (i = 0; i < s->num_ifaces[dir]; i++) {
+		if (iface[i].ifindex == ifindex) {
+			nftnl_trace_hist_inc(&iface[i].hits);
+			return;
+		}
+	}
+
+	if (i == NFTNL_TRACE_HIST_IFACES) {
+		nftnl_trace_hist_inc(&s->overflow);
+		return;
+	}
+
+	iface[i].ifindex = ifindex;
+	iface[i].hits = 1;
+	s->num_ifaces[dir]++;
+	nftnl_trace_hist_publish(&iface[i].used);
+}
+
+/* Account one trace event. Each shard must only be fed by one thread at a
+ * time, e.g. one shard per thread or per CPU the events are read on.
+ */
+EXPORT_SYMBOL(nftnl_trace_hist_add);
+int nftnl_trace_hist_add(struct nftnl_trace_hist *h, unsigned int shard,
+			 const struct nftnl_trace *t)
+{
+	struct nftnl_trace_hist_shard *s;
+	uint32_t type, verdict;
+	int idx;
+
+	if (shard >= h->nshards) {
+		errno = EINVAL;
+		return -1;
+	}
+	s = h->shards[shard];
+
+	type = nftnl_trace_get_u32(t, NFTNL_TRACE_TYPE);
+	switch (type) {
+	case NFT_TRACETYPE_RULE:
+		if (nftnl_trace_is_set(t, NFTNL_TRACE_RULE_HANDLE))
+			nftnl_trace_hist_add_rule(h, s, t);
+		if (!nftnl_trace_is_set(t, NFTNL_TRACE_VERDICT))
+			return 0;
+		verdict = nftnl_trace_get_u32(t, NFTNL_TRACE_VERDICT);
+		break;
+	case NFT_TRACETYPE_POLICY:
+		if (!nftnl_trace_is_set(t, NFTNL_TRACE_POLICY))
+			return 0;
+		verdict = nftnl_trace_get_u32(t, NFTNL_TRACE_POLICY);
+		break;
+	default:
+		return 0;
+	}
+
+	idx = nftnl_trace_hist_verdict_idx(verdict);
+	if (idx >= 0)
+		nftnl_trace_hist_inc(&s->verdicts[idx]);
+
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_IIF))
+		nftnl_trace_hist_add_iface(s, 0,
+				nftnl_trace_get_u32(t, NFTNL_TRACE_IIF));
+	if (nftnl_trace_is_set(t, NFTNL_TRACE_OIF))
+		nftnl_trace_hist_add_iface(s, 1,
+				nftnl_trace_get_u32(t, NFTNL_TRACE_OIF));
+
+	return 0;
+}
+
+/* Same as nftnl_trace_hist_add(), straight from the netlink message */
+EXPORT_SYMBOL(nftnl_trace_hist_add_nlmsg);
+int nftnl_trace_hist_add_nlmsg(struct nftnl_trace_hist *h, unsigned int shard,
+			       const struct nlmsghdr *nlh)
+{
+	struct nftnl_trace *t;
+
+	if (shard >= h->nshards) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	t = h->shards[shard]->trace;
+	if (nftnl_trace_nlmsg_parse_view(nlh, t) < 0)
+		return -1;
+
+	return nftnl_trace_hist_add(h, shard, t);
+}
+
+static int nftnl_trace_hist_rule_cmp_key(const void *a, const void *b)
+{
+	const struct nftnl_trace_hist_rule *ra = a, *rb = b;
+	int ret;
+
+	if (ra->family != rb->family)
+		return ra->family < rb->family ? -1 : 1;
+	ret = strcmp(ra->table, rb->table);
+	if (ret != 0)
+		return ret;
+	ret = strcmp(ra->chain, rb->chain);
+	if (ret != 0)
+		return ret;
+	if (ra->handle != rb->handle)
+		return ra->handle < rb->handle ? -1 : 1;
+
+	return 0;
+}
+
+static int nftnl_trace_hist_rule_cmp_hits(const void *a, const void *b)
+{
+	const struct nftnl_trace_hist_rule *ra = a, *rb = b;
+
+	if (ra->hits != rb->hits)
+		return ra->hits > rb->hits ? -1 : 1;
+
+	return nftnl_trace_hist_rule_cmp_key(a, b);
+}
+
+static int nftnl_trace_hist_iface_cmp_key(const void *a, const void *b)
+{
+	const struct nftnl_trace_hist_iface *ia = a, *ib = b;
+
+	if (ia->ifindex != ib->ifindex)
+		return ia->ifindex < ib->ifindex ? -1 : 1;
+
+	return 0;
+}
+
+static int nftnl_trace_hist_iface_cmp_hits(const void *a, const void *b)
+{
+	const struct nftnl_trace_hist_iface *ia = a, *ib = b;
+
+	if (ia->hits != ib->hits)
+		return ia->hits > ib->hits ? -1 : 1;
+
+	return nftnl_trace_hist_iface_cmp_key(a, b);
+}
+
+/* Fold entries with the same key, hottest ones first */
+static void nftnl_trace_hist_snap_sort(struct nftnl_trace_hist_snap *snap)
+{
+	unsigned int i, j, n;
+
+	qsort(snap->rules, snap->num_rules, sizeof(snap->rules[0]),
+	      nftnl_trace_hist_rule_cmp_key);
+	for (i = 0, n = 0; i < snap->num_rules; i = j) {
+		snap->rules[n] = snap->rules[i];
+		for (j = i + 1; j < snap->num_rules &&
+		     nftnl_trace_hist_rule_cmp_key(&snap->rules[i],
+						   &snap->rules[j]) == 0; j++)
+			snap->rules[n].hits += snap->rules[j].hits;
+		n++;
+	}
+	snap->num_rules = n;
+	qsort(snap->rules, snap->num_rules, sizeof(snap->rules[0]),
+	      nftnl_trace_hist_rule_cmp_hits);
+
+	for (i = 0; i < 2; i++) {
+		struct nftnl_trace_hist_iface *iface = snap->iface[i];
+		unsigned int k;
+
+		qsort(iface, snap->num_ifaces[i], sizeof(iface[0]),
+		      nftnl_trace_hist_iface_cmp_key);
+		for (j = 0, n = 0; j < snap->num_ifaces[i]; j = k) {
+			iface[n] = iface[j];
+			for (k = j + 1; k < snap->num_ifaces[i] &&
+			     iface[k].ifindex == iface[j].ifindex; k++)
+				iface[n].hits += iface[k].hits;
+			n++;
+		}
+		snap->num_ifaces[i] = n;
+		qsort(iface, snap->num_ifaces[i], sizeof(iface[0]),
+		      nftnl_trace_hist_iface_cmp_hits);
+	}
+}
+
+static struct nftnl_trace_hist_snap *
+nftnl_trace_hist_snap_alloc(unsigned int num_rules, unsigned int num_iif,
+			    unsigned int num_oif)
+{
+	struct nftnl_trace_hist_snap *snap;
+
+	snap = calloc(1, sizeof(struct nftnl_trace_hist_snap));
+	if (snap == NULL)
+		return NULL;
+
+	/* Never zero sized, so a NULL return always means ENOMEM */
+	snap->rules = calloc(num_rules + 1, sizeof(snap->rules[0]));
+	snap->iface[0] = calloc(num_iif + 1, sizeof(snap->iface[0][0]));
+	snap->iface[1] = calloc(num_oif + 1, sizeof(snap->iface[1][0]));
+	if (snap->rules == NULL ||
+	    snap->iface[0] == NULL || snap->iface[1] == NULL) {
+		nftnl_trace_hist_snap_free(snap);
+		return NULL;
+	}
+
+	return snap;
+}
+
+/* Sum up all shards. Writers may keep going meanwhile, then the snapshot
+ * includes some of the events that raced with it.
+ */
+EXPORT_SYMBOL(nftnl_trace_hist_snapshot);
+struct nftnl_trace_hist_snap *
+nftnl_trace_hist_snapshot(const struct nftnl_trace_hist *h)
+{
+	struct nftnl_trace_hist_snap *snap;
+	struct nftnl_trace_hist_shard *s;
+	struct nftnl_trace_hist_rule *r, *rule;
+	struct nftnl_trace_hist_iface *iface;
+	unsigned int i, j, dir;
+
+	snap = nftnl_trace_hist_snap_alloc(h->nshards * h->max_rules,
+			h->nshards * NFTNL_TRACE_HIST_IFACES,
+			h->nshards * NFTNL_TRACE_HIST_IFACES);
+	if (snap == NULL)
+		return NULL;
+
+	for (i = 0; i < h->nshards; i++) {
+		s = h->shards[i];
+
+		for (j = 0; j <= h->mask; j++) {
+			r = &s->rules[j];
+			if (!nftnl_trace_hist_used(&r->used) ||
+			    snap->num_rules == h->nshards * h->max_rules)
+				continue;
+
+			/* Only the counter changes once an entry is published */
+			rule = &snap->rules[snap->num_rules++];
+			rule->family = r->family;
+			rule->handle = r->handle;
+			rule->hits = nftnl_trace_hist_read(&r->hits);
+			strcpy(rule->table, r->table);
+			strcpy(rule->chain, r->chain);
+		}
+
+		for (dir = 0; dir < 2; dir++) {
+			for (j = 0; j < NFTNL_TRACE_HIST_IFACES; j++) {
+				iface = &s->iface[dir][j];
+				if (!nftnl_trace_hist_used(&iface->used))
+					break;
+
+				snap->iface[dir][snap->num_ifaces[dir]].ifindex =
+					iface->ifindex;
+				snap->iface[dir][snap->num_ifaces[dir]].hits =
+					nftnl_trace_hist_read(&iface->hits);
+				snap->num_ifaces[dir]++;
+			}
+		}
+
+		for (j = 0; j < NFTNL_TRACE_HIST_VERDICTS; j++)
+			snap->verdicts[j] += nftnl_trace_hist_read(&s->verdicts[j]);
+		snap->overflow += nftnl_trace_hist_read(&s->overflow);
+	}
+
+	nftnl_trace_hist_snap_sort(snap);
+
+	return snap;
+}
+
+/* Add the counters of src to dst, e.g. to combine several histograms or
+ * snapshots taken before a histogram was reset.
+ */
+EXPORT_SYMBOL(nftnl_trace_hist_snap_merge);
+int nftnl_trace_hist_snap_merge(struct nftnl_trace_hist_snap *dst,
+				const struct nftnl_trace_hist_snap *src)
+{
+	struct nftnl_trace_hist_snap *tmp;
+	unsigned int i;
+
+	tmp = nftnl_trace_hist_snap_alloc(dst->num_rules + src->num_rules,
+			dst->num_ifaces[0] + src->num_ifaces[0],
+			dst->num_ifaces[1] + src->num_ifaces[1]);
+	if (tmp == NULL)
+		return -1;
+
+	memcpy(tmp->rules, dst->rules, dst->num_rules * sizeof(dst->rules[0]));
+	memcpy(tmp->rules + dst->num_rules, src->rules,
+	       src->num_rules * sizeof(src->rules[0]));
+	tmp->num_rules = dst->num_rules + src->num_rules;
+
+	for (i = 0; i < 2; i++) {
+		memcpy(tmp->iface[i], dst->iface[i],
+		       dst->num_ifaces[i] * sizeof(dst->iface[i][0]));
+		memcpy(tmp->iface[i] + dst->num_ifaces[i], src->iface[i],
+		       src->num_ifaces[i] * sizeof(src->iface[i][0]));
+		tmp->num_ifaces[i] = dst->num_ifaces[i] + src->num_ifaces[i];
+	}
+
+	for (i = 0; i < NFTNL_TRACE_HIST_VERDICTS; i++)
+		tmp->verdicts[i] = dst->verdicts[i] + src->verdicts[i];
+	tmp->overflow = dst->overflow + src->overflow;
+
+	nftnl_trace_hist_snap_sort(tmp);
+
+	/* Swap the contents so dst stays valid for the caller */
+	xfree(dst->rules);
+	xfree(dst->iface[0]);
+	xfree(dst->iface[1]);
+	*dst = *tmp;
+	xfree(tmp);
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_free);
+void nftnl_trace_hist_snap_free(struct nftnl_trace_hist_snap *snap)
+{
+	xfree(snap->rules);
+	xfree(snap->iface[0]);
+	xfree(snap->iface[1]);
+	xfree(snap);
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_num_rules);
+unsigned int
+nftnl_trace_hist_snap_num_rules(const struct nftnl_trace_hist_snap *snap)
+{
+	return snap->num_rules;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_rule_hits);
+uint64_t nftnl_trace_hist_snap_rule_hits(const struct nftnl_trace_hist_snap *snap,
+					 unsigned int i)
+{
+	if (i >= snap->num_rules)
+		return 0;
+
+	return snap->rules[i].hits;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_rule_get_u32);
+uint32_t
+nftnl_trace_hist_snap_rule_get_u32(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr)
+{
+	if (i >= snap->num_rules)
+		return 0;
+
+	switch (attr) {
+	case NFTNL_TRACE_FAMILY:
+		return snap->rules[i].family;
+	}
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_rule_get_u64);
+uint64_t
+nftnl_trace_hist_snap_rule_get_u64(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr)
+{
+	if (i >= snap->num_rules)
+		return 0;
+
+	switch (attr) {
+	case NFTNL_TRACE_RULE_HANDLE:
+		return snap->rules[i].handle;
+	}
+
+	return 0;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_rule_get_str);
+const char *
+nftnl_trace_hist_snap_rule_get_str(const struct nftnl_trace_hist_snap *snap,
+				   unsigned int i, uint16_t attr)
+{
+	if (i >= snap->num_rules)
+		return NULL;
+
+	switch (attr) {
+	case NFTNL_TRACE_TABLE:
+		return snap->rules[i].table;
+	case NFTNL_TRACE_CHAIN:
+		return snap->rules[i].chain;
+	}
+
+	return NULL;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_verdict);
+uint64_t nftnl_trace_hist_snap_verdict(const struct nftnl_trace_hist_snap *snap,
+				       uint32_t verdict)
+{
+	int idx = nftnl_trace_hist_verdict_idx(verdict);
+
+	return idx < 0 ? 0 : snap->verdicts[idx];
+}
+
+static int nftnl_trace_hist_dir(uint16_t attr)
+{
+	switch (attr) {
+	case NFTNL_TRACE_IIF:
+		return 0;
+	case NFTNL_TRACE_OIF:
+		return 1;
+	}
+
+	return -1;
+}
+
+/* attr is NFTNL_TRACE_IIF or NFTNL_TRACE_OIF */
+EXPORT_SYMBOL(nftnl_trace_hist_snap_num_ifaces);
+unsigned int
+nftnl_trace_hist_snap_num_ifaces(const struct nftnl_trace_hist_snap *snap,
+				 uint16_t attr)
+{
+	int dir = nftnl_trace_hist_dir(attr);
+
+	return dir < 0 ? 0 : snap->num_ifaces[dir];
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_iface_index);
+uint32_t
+nftnl_trace_hist_snap_iface_index(const struct nftnl_trace_hist_snap *snap,
+				  uint16_t attr, unsigned int i)
+{
+	int dir = nftnl_trace_hist_dir(attr);
+
+	if (dir < 0 || i >= snap->num_ifaces[dir])
+		return 0;
+
+	return snap->iface[dir][i].ifindex;
+}
+
+EXPORT_SYMBOL(nftnl_trace_hist_snap_iface_hits);
+uint64_t
+nftnl_trace_hist_snap_iface_hits(const struct nftnl_trace_hist_snap *snap,
+				 uint16_t attr, unsigned int i)
+{
+	int dir = nftnl_trace_hist_dir(attr);
+
+	if (dir < 0 || i >= snap->num_ifaces[dir])
+		return 0;
+
+	return snap->iface[dir][i].hits;
+}
+
+/* Events that were not accounted per rule or interface for lack of room */
+EXPORT_SYMBOL(nftnl_trace_hist_snap_overflow);
+uint64_t
+nftnl_trace_hist_snap_overflow(const struct nftnl_trace_hist_snap *snap)
+{
+	return snap->overflow;
+}
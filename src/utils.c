@@ -31,6 +31,23 @@ static const char *const nftnl_family_str[NFPROTO_NUMPROTO] = {
 	[NFPROTO_IPV6]		= "ip6",
 };
 
+struct list_head nftnl_shared_list_empty =
+	LIST_HEAD_INIT(nftnl_shared_list_empty);
+
+struct nftnl_shared_list *nftnl_shared_list_alloc(void)
+{
+	struct nftnl_shared_list *l;
+
+	l = calloc(1, sizeof(struct nftnl_shared_list));
+	if (l == NULL)
+		return NULL;
+
+	INIT_LIST_HEAD(&l->list);
+	l->refcnt = 1;
+
+	return l;
+}
+
 const char *nftnl_family2str(uint32_t family)
 {
 	if (nftnl_family_str[family] == NULL)
@@ -247,6 +264,7 @@ int nftnl_fprintf(FILE *fp, void *obj, uint32_t cmd, uint32_t type, uint32_t fla
 		goto out;
 
 	if (ret >= NFTNL_SNPRINTF_BUFSIZ) {
+		nftnl_stats_add(NFTNL_STATS_SNPRINTF_RETRIES, 1);
 		bufsiz = ret + 1;
 
 		buf = malloc(bufsiz);
@@ -69,6 +69,7 @@ int main(int argc, char *argv[])
 	struct nftnl_chain *a, *b;
 	char buf[4096];
 	struct nlmsghdr *nlh;
+	struct nftnl_counter_sample sample;
 
 	a = nftnl_chain_alloc();
 	b = nftnl_chain_alloc();
@@ -98,6 +99,13 @@ int main(int argc, char *argv[])
 
 	cmp_nftnl_chain(a, b);
 
+	if (nftnl_chain_nlmsg_counters(nlh, &sample) != 1)
+		print_err("Chain counters not found");
+	if (sample.handle != 0x1234567812345678 ||
+	    sample.packets != 0x1234567812345678 ||
+	    sample.bytes != 0x1234567812345678)
+		print_err("Chain counter sample mismatches");
+
 	nftnl_chain_free(a);
 	nftnl_chain_free(b);
 
@@ -0,0 +1,282 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/table.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/gen.h>
+#include <libnftnl/trace.h>
+#include <libnftnl/event.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static int num_events[__NFTNL_EVENT_MAX];
+static int stop_at_rule;
+
+static int table_cb(const struct nlmsghdr *nlh, uint32_t event, void *obj,
+		    void *data)
+{
+	num_events[NFTNL_EVENT_TABLE]++;
+	if (event != NFT_MSG_NEWTABLE ||
+	    strcmp(nftnl_table_get_str(obj, NFTNL_TABLE_NAME), "filter") != 0)
+		print_err("Unexpected table event");
+
+	return MNL_CB_OK;
+}
+
+static int rule_cb(const struct nlmsghdr *nlh, uint32_t event, void *obj,
+		   void *data)
+{
+	struct nftnl_expr_iter *iter;
+	int n = 0;
+
+	num_events[NFTNL_EVENT_RULE]++;
+
+	iter = nftnl_expr_iter_create(obj);
+	while (nftnl_expr_iter_next(iter) != NULL)
+		n++;
+	nftnl_expr_iter_destroy(iter);
+
+	/* Expressions of the previous rule must not be carried over */
+	if (event != NFT_MSG_NEWRULE || n != 1 ||
+	    strcmp(nftnl_rule_get_str(obj, NFTNL_RULE_CHAIN), "input") != 0)
+		print_err("Unexpected rule event");
+
+	return num_events[NFTNL_EVENT_RULE] == stop_at_rule ?
+	       MNL_CB_STOP : MNL_CB_OK;
+}
+
+static int setelem_cb(const struct nlmsghdr *nlh, uint32_t event, void *obj,
+		      void *data)
+{
+	struct nftnl_set_elems_iter *iter;
+	int n = 0;
+
+	num_events[NFTNL_EVENT_SETELEM]++;
+
+	iter = nftnl_set_elems_iter_create(obj);
+	while (nftnl_set_elems_iter_next(iter) != NULL)
+		n++;
+	nftnl_set_elems_iter_destroy(iter);
+
+	if (event != NFT_MSG_NEWSETELEM || n != 2 ||
+	    strcmp(nftnl_set_get_str(obj, NFTNL_SET_NAME), "set0") != 0)
+		print_err("Unexpected setelem event");
+
+	return MNL_CB_OK;
+}
+
+static int gen_cb(const struct nlmsghdr *nlh, uint32_t event, void *obj,
+		  void *data)
+{
+	num_events[NFTNL_EVENT_GEN]++;
+	if (event != NFT_MSG_NEWGEN)
+		print_err("Unexpected generation");
+
+	return MNL_CB_OK;
+}
+
+static int trace_cb(const struct nlmsghdr *nlh, uint32_t event, void *obj,
+		    void *data)
+{
+	num_events[NFTNL_EVENT_TRACE]++;
+	if (nftnl_trace_get_u32(obj, NFTNL_TRACE_ID) != 7)
+		print_err("Unexpected trace");
+
+	return MNL_CB_OK;
+}
+
+static struct nlmsghdr *build_table(char *buf)
+{
+	struct nftnl_table *t;
+	struct nlmsghdr *nlh;
+
+	t = nftnl_table_alloc();
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nlh = nftnl_table_nlmsg_build_hdr(buf, NFT_MSG_NEWTABLE, NFPROTO_IPV4,
+					  0, 1);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	nftnl_table_free(t);
+
+	return nlh;
+}
+
+static struct nlmsghdr *build_rule(char *buf)
+{
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	r = nftnl_rule_alloc();
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, NFPROTO_IPV4,
+					 0, 1);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	nftnl_rule_free(r);
+
+	return nlh;
+}
+
+/* Elements are put as the kernel does, all of them as NFTA_LIST_ELEM */
+static struct nlmsghdr *build_setelem(char *buf)
+{
+	struct nlattr *list, *elem, *key;
+	struct nlmsghdr *nlh;
+	uint32_t i;
+
+	nlh = nftnl_set_elem_nlmsg_build_hdr(buf, NFT_MSG_NEWSETELEM,
+					     NFPROTO_IPV4, 0, 1);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, "set0");
+	list = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+	for (i = 1; i <= 2; i++) {
+		elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+		key = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY);
+		mnl_attr_put_u32(nlh, NFTA_DATA_VALUE, i);
+		mnl_attr_nest_end(nlh, key);
+		mnl_attr_nest_end(nlh, elem);
+	}
+	mnl_attr_nest_end(nlh, list);
+
+	return nlh;
+}
+
+static struct nlmsghdr *build_gen(char *buf)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_gen_nlmsg_build_hdr(buf, NFT_MSG_NEWGEN, AF_UNSPEC, 0, 1);
+	mnl_attr_put_u32(nlh, NFTA_GEN_ID, htonl(42));
+
+	return nlh;
+}
+
+static struct nlmsghdr *build_trace(char *buf)
+{
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfg;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_TRACE;
+	nfg = mnl_nlmsg_put_extra_header(nlh, sizeof(*nfg));
+	nfg->nfgen_family = NFPROTO_IPV4;
+	mnl_attr_put_u32(nlh, NFTA_TRACE_ID, htonl(7));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_TYPE, htonl(NFT_TRACETYPE_RULE));
+
+	return nlh;
+}
+
+static void send_msg(int fd, struct nlmsghdr *nlh, size_t len)
+{
+	if (send(fd, nlh, len, 0) < 0)
+		print_err("Sending message failed");
+}
+
+int main(int argc, char *argv[])
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_event_loop *l;
+	struct nlmsghdr *nlh;
+	size_t len;
+	int fd[2];
+
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fd) < 0 ||
+	    fcntl(fd[0], F_SETFL, O_NONBLOCK) < 0) {
+		print_err("Cannot create sockets");
+		exit(EXIT_FAILURE);
+	}
+
+	l = nftnl_event_loop_alloc(fd[0], 4, 0);
+	if (l == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_event_loop_register(l, NFTNL_EVENT_TABLE, table_cb, NULL) < 0 ||
+	    nftnl_event_loop_register(l, NFTNL_EVENT_RULE, rule_cb, NULL) < 0 ||
+	    nftnl_event_loop_register(l, NFTNL_EVENT_SETELEM, setelem_cb,
+				      NULL) < 0 ||
+	    nftnl_event_loop_register(l, NFTNL_EVENT_GEN, gen_cb, NULL) < 0 ||
+	    nftnl_event_loop_register(l, NFTNL_EVENT_TRACE, trace_cb,
+				      NULL) < 0)
+		print_err("Registering handlers failed");
+	if (nftnl_event_loop_register(l, __NFTNL_EVENT_MAX, gen_cb, NULL) == 0)
+		print_err("Unknown event type accepted");
+
+	/* A datagram carrying two rules, then one per other event type */
+	nlh = build_rule(buf);
+	len = nlh->nlmsg_len;
+	nlh = build_rule(buf + len);
+	send_msg(fd[1], (struct nlmsghdr *)buf, len + nlh->nlmsg_len);
+
+	nlh = build_table(buf);
+	send_msg(fd[1], nlh, nlh->nlmsg_len);
+	nlh = build_setelem(buf);
+	send_msg(fd[1], nlh, nlh->nlmsg_len);
+	nlh = build_gen(buf);
+	send_msg(fd[1], nlh, nlh->nlmsg_len);
+	nlh = build_trace(buf);
+	send_msg(fd[1], nlh, nlh->nlmsg_len);
+
+	/* Stop after the first rule, the rest is kept for the next run */
+	stop_at_rule = 1;
+	if (nftnl_event_loop_run(l) != MNL_CB_STOP ||
+	    num_events[NFTNL_EVENT_RULE] != 1 ||
+	    num_events[NFTNL_EVENT_TABLE] != 0)
+		print_err("Handler could not stop the loop");
+
+	if (nftnl_event_loop_run(l) != MNL_CB_OK ||
+	    num_events[NFTNL_EVENT_RULE] != 2 ||
+	    num_events[NFTNL_EVENT_TABLE] != 1 ||
+	    num_events[NFTNL_EVENT_SETELEM] != 1 ||
+	    num_events[NFTNL_EVENT_GEN] != 1 ||
+	    num_events[NFTNL_EVENT_TRACE] != 0)
+		print_err("Pending messages were not dispatched");
+
+	/* The trace datagram did not fit into the first batch */
+	if (nftnl_event_loop_run(l) != MNL_CB_OK ||
+	    num_events[NFTNL_EVENT_TRACE] != 1)
+		print_err("Events were not dispatched");
+
+	if (nftnl_event_loop_run(l) != -1 || errno != EAGAIN)
+		print_err("Empty socket not reported");
+	if (nftnl_event_loop_overruns(l) != 0)
+		print_err("Unexpected overrun");
+
+	nftnl_event_loop_free(l);
+	close(fd[0]);
+	close(fd[1]);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
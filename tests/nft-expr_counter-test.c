@@ -44,6 +44,7 @@ int main(int argc, char *argv[])
 	struct nftnl_expr *ex;
 	struct nlmsghdr *nlh;
 	char buf[4096];
+	struct nftnl_counter_sample samples[2];
 	struct nftnl_expr_iter *iter_a, *iter_b;
 	struct nftnl_expr *rule_a, *rule_b;
 
@@ -59,6 +60,7 @@ int main(int argc, char *argv[])
 	nftnl_expr_set_u64(ex, NFTNL_EXPR_CTR_BYTES, 0x123456789abcdef0);
 	nftnl_expr_set_u64(ex, NFTNL_EXPR_CTR_PACKETS, 0x123456789abcdef0);
 	nftnl_rule_add_expr(a, ex);
+	nftnl_rule_set_u64(a, NFTNL_RULE_HANDLE, 0x1234);
 
 	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, AF_INET, 0, 1234);
 	nftnl_rule_nlmsg_build_payload(nlh, a);
@@ -66,6 +68,17 @@ int main(int argc, char *argv[])
 	if (nftnl_rule_nlmsg_parse(nlh, b) < 0)
 		print_err("parsing problems");
 
+	if (nftnl_rule_nlmsg_counters(nlh, samples, 2) != 1)
+		print_err("wrong number of counter samples");
+	if (samples[0].handle != 0x1234)
+		print_err("Counter sample handle mismatches");
+	if (samples[0].bytes != 0x123456789abcdef0)
+		print_err("Counter sample bytes mismatches");
+	if (samples[0].packets != 0x123456789abcdef0)
+		print_err("Counter sample packets mismatches");
+	if (nftnl_rule_nlmsg_counters(nlh, samples, 0) != -1)
+		print_err("Counter samples overrun");
+
 	iter_a = nftnl_expr_iter_create(a);
 	iter_b = nftnl_expr_iter_create(b);
 	if (iter_a == NULL || iter_b == NULL)
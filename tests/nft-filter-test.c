@@ -0,0 +1,111 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter/nf_tables.h>
+#include <libmnl/libmnl.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nlmsghdr *build_rule(char *buf, const char *table,
+				   const char *chain)
+{
+	struct nlmsghdr *nlh;
+	struct nftnl_rule *r;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		print_err("OOM");
+
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, table);
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, chain);
+	nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, 0x1234);
+
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, AF_INET, 0,
+					 1234);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	nftnl_rule_free(r);
+
+	return nlh;
+}
+
+int main(int argc, char *argv[])
+{
+	char buf[4096];
+	struct nlmsghdr *nlh;
+	struct nftnl_rule *r;
+	struct nftnl_set *s;
+
+	nlh = build_rule(buf, "filter", "input");
+	if (!nftnl_nlmsg_filter(nlh, NULL, NULL))
+		print_err("wildcard filter does not match");
+	if (!nftnl_nlmsg_filter(nlh, "filter", NULL))
+		print_err("table filter does not match");
+	if (!nftnl_nlmsg_filter(nlh, "filter", "input"))
+		print_err("chain filter does not match");
+	if (nftnl_nlmsg_filter(nlh, "filter", "output"))
+		print_err("chain filter matches other chain");
+	if (nftnl_nlmsg_filter(nlh, "filte", "input"))
+		print_err("table filter matches prefix");
+	if (nftnl_nlmsg_filter(nlh, "nat", NULL))
+		print_err("table filter matches other table");
+
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_GETRULE, AF_INET,
+					 NLM_F_DUMP, 1234);
+	if (nftnl_nlmsg_build_filter(nlh, "filter", "input") < 0)
+		print_err("cannot build rule dump filter");
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		print_err("OOM");
+	if (nftnl_rule_nlmsg_parse(nlh, r) < 0)
+		print_err("parsing problems");
+	if (strcmp(nftnl_rule_get_str(r, NFTNL_RULE_TABLE), "filter") != 0)
+		print_err("rule dump table mismatches");
+	if (strcmp(nftnl_rule_get_str(r, NFTNL_RULE_CHAIN), "input") != 0)
+		print_err("rule dump chain mismatches");
+	nftnl_rule_free(r);
+
+	nlh = nftnl_set_nlmsg_build_hdr(buf, NFT_MSG_GETSET, AF_INET,
+					NLM_F_DUMP, 1234);
+	if (nftnl_nlmsg_build_filter(nlh, "filter", "blacklist") < 0)
+		print_err("cannot build set dump filter");
+
+	s = nftnl_set_alloc();
+	if (s == NULL)
+		print_err("OOM");
+	if (nftnl_set_nlmsg_parse(nlh, s) < 0)
+		print_err("parsing problems");
+	if (strcmp(nftnl_set_get_str(s, NFTNL_SET_TABLE), "filter") != 0)
+		print_err("set dump table mismatches");
+	if (strcmp(nftnl_set_get_str(s, NFTNL_SET_NAME), "blacklist") != 0)
+		print_err("set dump name mismatches");
+	if (!nftnl_nlmsg_filter(nlh, "filter", "blacklist"))
+		print_err("set filter does not match");
+	if (nftnl_nlmsg_filter(nlh, "filter", "whitelist"))
+		print_err("set filter matches other set");
+	nftnl_set_free(s);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
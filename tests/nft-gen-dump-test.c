@@ -0,0 +1,258 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/table.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/gen.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static int num_tables, num_rules, num_restarts;
+
+static int dump_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct nftnl_table *t;
+
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWTABLE:
+		t = nftnl_table_alloc();
+		if (t == NULL || nftnl_table_nlmsg_parse(nlh, t) < 0)
+			print_err("Parsing table failed");
+		else if (strcmp(nftnl_table_get_str(t, NFTNL_TABLE_NAME),
+				"filter") != 0)
+			print_err("Objects of the interrupted dump passed on");
+		if (t != NULL)
+			nftnl_table_free(t);
+		num_tables++;
+		break;
+	case NFT_MSG_NEWRULE:
+		num_rules++;
+		break;
+	default:
+		print_err("Unexpected message type");
+		break;
+	}
+	return MNL_CB_OK;
+}
+
+static void restart_cb(void *data)
+{
+	num_restarts++;
+	num_tables = num_rules = 0;
+}
+
+static uint32_t seq;
+
+static struct nlmsghdr *build_gen(char *buf, uint32_t id)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_NEWGEN, AF_UNSPEC, 0, seq);
+	mnl_attr_put_u32(nlh, NFTA_GEN_ID, htonl(id));
+	return nlh;
+}
+
+static struct nlmsghdr *build_table(char *buf, const char *name,
+				    uint16_t flags)
+{
+	struct nftnl_table *t;
+	struct nlmsghdr *nlh;
+
+	t = nftnl_table_alloc();
+	if (t == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, name);
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_NEWTABLE, NFPROTO_IPV4,
+				    NLM_F_MULTI | flags, seq);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	nftnl_table_free(t);
+	return nlh;
+}
+
+static struct nlmsghdr *build_rule(char *buf)
+{
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, NFPROTO_IPV4,
+				    NLM_F_MULTI, seq);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	nftnl_rule_free(r);
+	return nlh;
+}
+
+static struct nlmsghdr *build_done(char *buf, uint16_t flags)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = NLMSG_DONE;
+	nlh->nlmsg_flags = NLM_F_MULTI | flags;
+	nlh->nlmsg_seq = seq;
+	return nlh;
+}
+
+static struct nlmsghdr *build_filter(char *buf)
+{
+	return build_table(buf, "filter", 0);
+}
+
+/* Ask the context for its next request, which has to be @cmd */
+static void request(struct nftnl_gen_dump_ctx *ctx, uint16_t cmd)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_gen_dump_ctx_request(ctx, buf, ++seq);
+	if (NFNL_MSG_TYPE(nlh->nlmsg_type) != cmd)
+		print_err("Unexpected request");
+	if ((cmd == NFT_MSG_GETGEN) != !(nlh->nlmsg_flags & NLM_F_DUMP))
+		print_err("Unexpected request flags");
+}
+
+static int recv_gen(struct nftnl_gen_dump_ctx *ctx, uint32_t id)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nlmsghdr *nlh;
+
+	nlh = build_gen(buf, id);
+	return nftnl_gen_dump_ctx_recv(ctx, buf, nlh->nlmsg_len, 0);
+}
+
+/* A dump reply with at most one object, then NLMSG_DONE */
+static int recv_dump(struct nftnl_gen_dump_ctx *ctx,
+		     struct nlmsghdr *(*build)(char *buf))
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	size_t len = 0;
+
+	if (build != NULL)
+		len = build(buf)->nlmsg_len;
+	len += build_done(buf + len, 0)->nlmsg_len;
+	return nftnl_gen_dump_ctx_recv(ctx, buf, len, 0);
+}
+
+/* A full dump of generation @id that gets through */
+static int dump(struct nftnl_gen_dump_ctx *ctx, uint32_t id, uint32_t after)
+{
+	request(ctx, NFT_MSG_GETGEN);
+	if (recv_gen(ctx, id) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not go on after the generation");
+	request(ctx, NFT_MSG_GETTABLE);
+	if (recv_dump(ctx, build_filter) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not go on after tables");
+	request(ctx, NFT_MSG_GETCHAIN);
+	if (recv_dump(ctx, NULL) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not go on after chains");
+	request(ctx, NFT_MSG_GETSET);
+	if (recv_dump(ctx, NULL) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not go on after sets");
+	request(ctx, NFT_MSG_GETRULE);
+	if (recv_dump(ctx, build_rule) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not go on after rules");
+	request(ctx, NFT_MSG_GETGEN);
+	return recv_gen(ctx, after);
+}
+
+int main(int argc, char *argv[])
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_gen_dump_ctx *ctx;
+	struct nftnl_gen *gen;
+	size_t len;
+	int i, ret;
+
+	gen = nftnl_gen_alloc();
+	ctx = nftnl_gen_dump_ctx_alloc(NFPROTO_UNSPEC, gen, dump_cb,
+				       restart_cb, NULL);
+	if (gen == NULL || ctx == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	/* The first table dump is interrupted and spans two datagrams, the
+	 * rest of it is read before the dump is restarted.
+	 */
+	request(ctx, NFT_MSG_GETGEN);
+	if (recv_gen(ctx, 1) != NFTNL_GEN_DUMP_SEND)
+		print_err("Dump did not start");
+	request(ctx, NFT_MSG_GETTABLE);
+	len = build_table(buf, "stale", NLM_F_DUMP_INTR)->nlmsg_len;
+	if (nftnl_gen_dump_ctx_recv(ctx, buf, len, 0) != NFTNL_GEN_DUMP_RECV)
+		print_err("Interrupted dump was not drained");
+	len = build_table(buf, "stale", NLM_F_DUMP_INTR)->nlmsg_len;
+	len += build_done(buf + len, NLM_F_DUMP_INTR)->nlmsg_len;
+	if (nftnl_gen_dump_ctx_recv(ctx, buf, len, 0) != NFTNL_GEN_DUMP_SEND ||
+	    num_restarts != 1)
+		print_err("Interrupted dump was not restarted");
+
+	/* The generation changes between the start and the end of the dump */
+	if (dump(ctx, 2, 3) != NFTNL_GEN_DUMP_SEND || num_restarts != 2)
+		print_err("Dump of a changed generation was not restarted");
+
+	if (dump(ctx, 3, 3) != NFTNL_GEN_DUMP_UPDATED)
+		print_err("Dump was not completed");
+	if (num_tables != 1 || num_rules != 1)
+		print_err("Unexpected objects after restart");
+	nftnl_gen_dump_ctx_free(ctx);
+
+	/* The generation was updated, nothing is dumped while it stays */
+	ctx = nftnl_gen_dump_ctx_alloc(NFPROTO_UNSPEC, gen, dump_cb,
+				       restart_cb, NULL);
+	if (ctx == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	request(ctx, NFT_MSG_GETGEN);
+	if (recv_gen(ctx, 3) != NFTNL_GEN_DUMP_UNCHANGED)
+		print_err("Unchanged generation was dumped");
+
+	/* Give up if the ruleset keeps changing */
+	for (i = 0, ret = 0; i < 16; i++) {
+		ret = dump(ctx, 4 + i, 5 + i);
+		if (ret != NFTNL_GEN_DUMP_SEND)
+			break;
+	}
+	if (ret != -1 || errno != EAGAIN)
+		print_err("Dump of a changing ruleset did not give up");
+	nftnl_gen_dump_ctx_free(ctx);
+
+	nftnl_gen_free(gen);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
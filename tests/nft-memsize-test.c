@@ -0,0 +1,216 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+
+#define NUM_ELEMS	100
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static void *must(void *ptr)
+{
+	if (ptr == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	return ptr;
+}
+
+static size_t expr_sum;
+
+static int expr_sum_cb(struct nftnl_expr *e, void *data)
+{
+	expr_sum += nftnl_expr_memsize(e);
+	return 0;
+}
+
+static size_t elem_sum;
+
+static int elem_sum_cb(struct nftnl_set_elem *e, void *data)
+{
+	elem_sum += nftnl_set_elem_memsize(e);
+	return 0;
+}
+
+static struct nftnl_rule *test_rule(void)
+{
+	struct nftnl_rule *r, *empty, *clone, *parsed;
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nlmsghdr *nlh;
+	struct nftnl_expr *e;
+	size_t size, with_prefix, base;
+
+	/* Rules with expressions also hold the list that they are kept in */
+	empty = must(nftnl_rule_alloc());
+	e = must(nftnl_expr_alloc("counter"));
+	nftnl_rule_add_expr(empty, e);
+	base = nftnl_rule_memsize(empty) - nftnl_expr_memsize(e);
+
+	r = must(nftnl_rule_alloc());
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	nftnl_rule_set_data(r, NFTNL_RULE_USERDATA, "comment", 8);
+
+	e = must(nftnl_expr_alloc("log"));
+	size = nftnl_expr_memsize(e);
+	nftnl_expr_set_str(e, NFTNL_EXPR_LOG_PREFIX, "dropped: ");
+	with_prefix = nftnl_expr_memsize(e);
+	if (with_prefix != size + strlen("dropped: ") + 1)
+		print_err("Log prefix not accounted");
+	nftnl_rule_add_expr(r, e);
+	nftnl_rule_add_expr(r, must(nftnl_expr_alloc("counter")));
+
+	nftnl_expr_foreach(r, expr_sum_cb, NULL);
+	if (nftnl_rule_memsize(r) != base + strlen("filter") + 1 +
+				     strlen("input") + 1 + expr_sum)
+		print_err("Rule size does not add up");
+
+	/* Userdata is only counted once the rule owns it */
+	nlh = nftnl_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, NFPROTO_IPV4, 0, 0);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	parsed = must(nftnl_rule_alloc());
+	if (nftnl_rule_nlmsg_parse(nlh, parsed) < 0 ||
+	    nftnl_rule_memsize(parsed) != nftnl_rule_memsize(r) + 8)
+		print_err("Parsed userdata not accounted");
+	nftnl_rule_free(parsed);
+
+	/* Clones share expressions, together they take less than twice */
+	size = nftnl_rule_memsize(r);
+	clone = must(nftnl_rule_clone(r));
+	if (nftnl_rule_memsize(r) + nftnl_rule_memsize(clone) >= 2 * size ||
+	    nftnl_rule_memsize(clone) >= size)
+		print_err("Shared expressions counted twice");
+	nftnl_rule_free(clone);
+
+	nftnl_rule_free(empty);
+	return r;
+}
+
+static struct nftnl_set *test_set(void)
+{
+	struct nftnl_set *s, *empty;
+	struct nftnl_set_elem *e;
+	uint32_t i;
+	size_t base;
+
+	empty = must(nftnl_set_alloc());
+	e = must(nftnl_set_elem_alloc());
+	nftnl_set_elem_add(empty, e);
+	base = nftnl_set_memsize(empty) - nftnl_set_elem_memsize(e);
+
+	s = must(nftnl_set_alloc());
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "vmap");
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS, NFT_SET_MAP);
+
+	for (i = 0; i < NUM_ELEMS; i++) {
+		e = must(nftnl_set_elem_alloc());
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &i, sizeof(i));
+		nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_VERDICT, NFT_JUMP);
+		nftnl_set_elem_set_str(e, NFTNL_SET_ELEM_CHAIN, "chain0");
+		nftnl_set_elem_add(s, e);
+	}
+
+	nftnl_set_elem_foreach(s, elem_sum_cb, NULL);
+	if (nftnl_set_memsize(s) != base + strlen("filter") + 1 +
+				    strlen("vmap") + 1 + elem_sum)
+		print_err("Set size does not add up");
+	if (elem_sum < NUM_ELEMS * (strlen("chain0") + 1))
+		print_err("Element chain names not accounted");
+
+	/* Element userdata is never owned by the element */
+	e = must(nftnl_set_elem_alloc());
+	base = nftnl_set_elem_memsize(e);
+	nftnl_set_elem_set(e, NFTNL_SET_ELEM_USERDATA, "comment", 8);
+	if (nftnl_set_elem_memsize(e) != base)
+		print_err("Borrowed element userdata counted");
+	nftnl_set_elem_free(e);
+
+	nftnl_set_free(empty);
+	return s;
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_ruleset *rs, *empty;
+	struct nftnl_table_list *tl;
+	struct nftnl_chain_list *cl;
+	struct nftnl_rule_list *rl;
+	struct nftnl_set_list *sl;
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	struct nftnl_rule *r;
+	struct nftnl_set *s;
+	size_t lists;
+
+	t = must(nftnl_table_alloc());
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	c = must(nftnl_chain_alloc());
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, "input");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TYPE, "filter");
+	r = test_rule();
+	s = test_set();
+
+	tl = must(nftnl_table_list_alloc());
+	cl = must(nftnl_chain_list_alloc());
+	rl = must(nftnl_rule_list_alloc());
+	sl = must(nftnl_set_list_alloc());
+	nftnl_table_list_add_tail(t, tl);
+	nftnl_chain_list_add_tail(c, cl);
+	nftnl_rule_list_add_tail(r, rl);
+	nftnl_set_list_add_tail(s, sl);
+
+	if (nftnl_rule_list_memsize(rl) <= nftnl_rule_memsize(r) ||
+	    nftnl_set_list_memsize(sl) <= nftnl_set_memsize(s) ||
+	    nftnl_chain_list_memsize(cl) <= nftnl_chain_memsize(c) ||
+	    nftnl_table_list_memsize(tl) <= nftnl_table_memsize(t))
+		print_err("List size does not cover its objects");
+
+	lists = nftnl_table_list_memsize(tl) + nftnl_chain_list_memsize(cl) +
+		nftnl_rule_list_memsize(rl) + nftnl_set_list_memsize(sl);
+
+	rs = must(nftnl_ruleset_alloc());
+	empty = must(nftnl_ruleset_alloc());
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, cl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sl);
+
+	if (nftnl_ruleset_memsize(rs) != nftnl_ruleset_memsize(empty) + lists)
+		print_err("Ruleset size does not add up");
+
+	nftnl_ruleset_free(empty);
+	nftnl_ruleset_free(rs);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -11,10 +11,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
 #include <netinet/in.h>
 #include <linux/netfilter/nf_tables.h>
 #include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
 
 static int test_ok = 1;
 
@@ -49,11 +51,120 @@ static void cmp_nftnl_rule(struct nftnl_rule *a, struct nftnl_rule *b)
 		print_err("Rule compat_position mismatches");
 }
 
+static int count_expr_cb(struct nftnl_expr *e, void *data)
+{
+	(*(int *)data)++;
+	return 0;
+}
+
+static int check_strings_cb(const struct nftnl_expr *e, void *data)
+{
+	const char *name = nftnl_expr_get_str(e, NFTNL_EXPR_NAME);
+
+	if (strcmp(name, "log") == 0 &&
+	    strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_LOG_PREFIX), "drop: ") != 0)
+		print_err("Rule clone log prefix mismatches");
+	if (strcmp(name, "immediate") == 0 &&
+	    strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_IMM_CHAIN), "target") != 0)
+		print_err("Rule clone jump target mismatches");
+
+	(*(int *)data)++;
+	return 0;
+}
+
+/* Whether both rules hold the very same expressions */
+static bool same_exprs(const struct nftnl_rule *a, const struct nftnl_rule *b)
+{
+	struct nftnl_expr_iter *ia, *ib;
+	struct nftnl_expr *ea, *eb;
+	bool same = true;
+
+	ia = nftnl_expr_iter_create_ro(a);
+	ib = nftnl_expr_iter_create_ro(b);
+	if (ia == NULL || ib == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	do {
+		ea = nftnl_expr_iter_next(ia);
+		eb = nftnl_expr_iter_next(ib);
+		if (ea != eb)
+			same = false;
+	} while (ea != NULL && eb != NULL);
+
+	nftnl_expr_iter_destroy(ia);
+	nftnl_expr_iter_destroy(ib);
+	return same;
+}
+
+static void test_clone_strings(void)
+{
+	struct nftnl_rule *r, *c;
+	struct nftnl_expr *e;
+	int n = 0;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL)
+		print_err("OOM");
+	e = nftnl_expr_alloc("log");
+	nftnl_expr_set_str(e, NFTNL_EXPR_LOG_PREFIX, "drop: ");
+	nftnl_rule_add_expr(r, e);
+	e = nftnl_expr_alloc("immediate");
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(e, NFTNL_EXPR_IMM_VERDICT, NFT_JUMP);
+	nftnl_expr_set_str(e, NFTNL_EXPR_IMM_CHAIN, "target");
+	nftnl_rule_add_expr(r, e);
+
+	c = nftnl_rule_clone(r);
+	if (c == NULL)
+		print_err("OOM");
+
+	/* Reading does not copy anything */
+	nftnl_expr_foreach_ro(c, check_strings_cb, &n);
+	if (n != 2 || !same_exprs(r, c))
+		print_err("Read-only walk copied the rule clone");
+
+	/* Changes may follow, the clone gets strings of its own */
+	nftnl_expr_foreach(c, count_expr_cb, &n);
+	if (same_exprs(r, c))
+		print_err("Rule clone expressions are shared after a write walk");
+	nftnl_rule_free(r);
+
+	n = 0;
+	nftnl_expr_foreach_ro(c, check_strings_cb, &n);
+	if (n != 2)
+		print_err("Rule clone lost expressions");
+	nftnl_rule_free(c);
+}
+
+static int count_exprs(struct nftnl_rule *r)
+{
+	int n = 0;
+
+	nftnl_expr_foreach(r, count_expr_cb, &n);
+	return n;
+}
+
+static int set_packets_cb(struct nftnl_expr *e, void *data)
+{
+	nftnl_expr_set_u64(e, NFTNL_EXPR_CTR_PACKETS, *(uint64_t *)data);
+	return 0;
+}
+
+static int get_packets_cb(struct nftnl_expr *e, void *data)
+{
+	*(uint64_t *)data = nftnl_expr_get_u64(e, NFTNL_EXPR_CTR_PACKETS);
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
-	struct nftnl_rule *a, *b;
+	struct nftnl_rule *a, *b, *c, *d;
+	uint64_t packets = 10;
+	const void *udata;
 	char buf[4096];
 	struct nlmsghdr *nlh;
+	uint32_t len;
 
 	a = nftnl_rule_alloc();
 	b = nftnl_rule_alloc();
@@ -67,6 +178,7 @@ int main(int argc, char *argv[])
 	nftnl_rule_set_u32(a, NFTNL_RULE_COMPAT_PROTO, 0x12345678);
 	nftnl_rule_set_u32(a, NFTNL_RULE_COMPAT_FLAGS, 0x12345678);
 	nftnl_rule_set_u64(a, NFTNL_RULE_POSITION, 0x1234567812345678);
+	nftnl_rule_set_data(a, NFTNL_RULE_USERDATA, "comment", 8);
 
 	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, AF_INET, 0, 1234);
 	nftnl_rule_nlmsg_build_payload(nlh, a);
@@ -76,8 +188,46 @@ int main(int argc, char *argv[])
 
 	cmp_nftnl_rule(a,b);
 
+	nftnl_rule_add_expr(a, nftnl_expr_alloc("counter"));
+	c = nftnl_rule_clone(a);
+	if (c == NULL)
+		print_err("OOM");
+
+	cmp_nftnl_rule(a, c);
+	if (count_exprs(c) != 1)
+		print_err("Rule clone expressions mismatch");
+
+	nftnl_rule_add_expr(c, nftnl_expr_alloc("counter"));
+	if (count_exprs(a) != 1 || count_exprs(c) != 2)
+		print_err("Rule clone expressions are not copied on write");
+
+	/* Expressions handed out for changes are not the clone's any more */
+	d = nftnl_rule_clone(a);
+	if (d == NULL)
+		print_err("OOM");
+	nftnl_expr_foreach(a, set_packets_cb, &packets);
+	packets = 0;
+	nftnl_expr_foreach(d, get_packets_cb, &packets);
+	if (packets != 0)
+		print_err("Rule clone changed through the original");
+	nftnl_rule_free(d);
+
+	/* Parsing into the original again leaves the clone's userdata alone */
+	d = nftnl_rule_clone(b);
+	if (d == NULL)
+		print_err("OOM");
+	if (nftnl_rule_nlmsg_parse(nlh, b) < 0)
+		print_err("parsing problems");
+	udata = nftnl_rule_get_data(d, NFTNL_RULE_USERDATA, &len);
+	if (udata == NULL || len != 8 || memcmp(udata, "comment", 8) != 0)
+		print_err("Rule clone userdata mismatch");
+	nftnl_rule_free(d);
+
+	test_clone_strings();
+
 	nftnl_rule_free(a);
 	nftnl_rule_free(b);
+	nftnl_rule_free(c);
 	if (!test_ok)
 		exit(EXIT_FAILURE);
 
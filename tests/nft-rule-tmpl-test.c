@@ -0,0 +1,118 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <linux/netfilter/nf_tables.h>
+#include <libmnl/libmnl.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+int main(int argc, char *argv[])
+{
+	static const char *chains[] = { "a", "chain-1", "very-long-chain-name" };
+	char buf_a[4096], buf_b[4096];
+	struct nlmsghdr *nlh_a, *nlh_b;
+	struct nftnl_expr *payload, *cmp, *counter, *imm, *foreign;
+	struct nftnl_rule_tmpl *t;
+	struct nftnl_rule *r;
+	uint32_t addr;
+	int i;
+
+	r = nftnl_rule_alloc();
+	payload = nftnl_expr_alloc("payload");
+	cmp = nftnl_expr_alloc("cmp");
+	counter = nftnl_expr_alloc("counter");
+	imm = nftnl_expr_alloc("immediate");
+	if (r == NULL || payload == NULL || cmp == NULL || counter == NULL ||
+	    imm == NULL)
+		print_err("OOM");
+
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_DREG, NFT_REG_1);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_BASE,
+			   NFT_PAYLOAD_NETWORK_HEADER);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_OFFSET, 12);
+	nftnl_expr_set_u32(payload, NFTNL_EXPR_PAYLOAD_LEN, sizeof(addr));
+	nftnl_rule_add_expr(r, payload);
+
+	addr = htonl(0x0a000001);
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_SREG, NFT_REG_1);
+	nftnl_expr_set_u32(cmp, NFTNL_EXPR_CMP_OP, NFT_CMP_EQ);
+	nftnl_expr_set(cmp, NFTNL_EXPR_CMP_DATA, &addr, sizeof(addr));
+	nftnl_rule_add_expr(r, cmp);
+
+	nftnl_rule_add_expr(r, counter);
+
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_DREG, NFT_REG_VERDICT);
+	nftnl_expr_set_u32(imm, NFTNL_EXPR_IMM_VERDICT, NFT_JUMP);
+	nftnl_expr_set_str(imm, NFTNL_EXPR_IMM_CHAIN, chains[0]);
+	nftnl_rule_add_expr(r, imm);
+
+	t = nftnl_rule_tmpl_alloc(r, NFT_MSG_NEWRULE, AF_INET,
+				  NLM_F_APPEND | NLM_F_CREATE);
+	if (t == NULL)
+		print_err("OOM");
+
+	if (nftnl_rule_tmpl_add_param(t, imm) < 0 ||
+	    nftnl_rule_tmpl_add_param(t, cmp) < 0)
+		print_err("cannot add template parameters");
+
+	foreign = nftnl_expr_alloc("counter");
+	if (nftnl_rule_tmpl_add_param(t, foreign) == 0)
+		print_err("foreign expression accepted as parameter");
+	nftnl_expr_free(foreign);
+
+	for (i = 0; i < 3; i++) {
+		addr = htonl(0x0a000001 + i);
+		nftnl_expr_set(cmp, NFTNL_EXPR_CMP_DATA, &addr, sizeof(addr));
+		nftnl_expr_set_str(imm, NFTNL_EXPR_IMM_CHAIN, chains[i]);
+
+		/* Attribute padding is not always cleared */
+		memset(buf_a, 0, sizeof(buf_a));
+		memset(buf_b, 0, sizeof(buf_b));
+
+		nlh_a = nftnl_rule_nlmsg_build_hdr(buf_a, NFT_MSG_NEWRULE,
+						   AF_INET,
+						   NLM_F_APPEND | NLM_F_CREATE,
+						   1234 + i);
+		nftnl_rule_nlmsg_build_payload(nlh_a, r);
+
+		nlh_b = nftnl_rule_tmpl_nlmsg_build(t, buf_b, 1234 + i);
+		if (nlh_b == NULL) {
+			print_err("cannot build message from template");
+			break;
+		}
+
+		if (nlh_a->nlmsg_len != nlh_b->nlmsg_len ||
+		    memcmp(nlh_a, nlh_b, nlh_a->nlmsg_len) != 0)
+			print_err("template message mismatches");
+	}
+
+	nftnl_rule_tmpl_free(t);
+	nftnl_rule_free(r);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/ruleset.h>
+#include <libnftnl/set.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/batch.h>
+#include <libnftnl/common.h>
+
+#define PAGE_SIZE	(4 * 65536)
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static const char ruleset[] =
+	"{\"nftables\":[{\"flush\":[]},{\"add\":["
+	"{\"table\":{\"name\":\"filter\",\"family\":\"ip\",\"flags\":0,"
+	"\"use\":0}},"
+	"{\"chain\":{\"name\":\"input\",\"handle\":1,\"bytes\":0,"
+	"\"packets\":0,\"table\":\"filter\",\"family\":\"ip\",\"use\":0}},"
+	"{\"set\":{\"name\":\"set0\",\"table\":\"filter\",\"flags\":3,"
+	"\"family\":\"ip\",\"key_type\":12,\"key_len\":2,\"set_elem\":["
+	"{\"flags\":0,\"key\":{\"reg\":{\"type\":\"value\",\"len\":2,"
+	"\"data0\":\"0x00001700\"}}},"
+	"{\"flags\":0,\"key\":{\"reg\":{\"type\":\"value\",\"len\":2,"
+	"\"data0\":\"0x00001600\"}}}]}},"
+	"{\"rule\":{\"family\":\"ip\",\"table\":\"filter\",\"chain\":\"input\","
+	"\"expr\":[{\"type\":\"payload\",\"dreg\":1,\"offset\":12,\"len\":4,"
+	"\"base\":\"network\"},{\"type\":\"lookup\",\"set\":\"set0\","
+	"\"sreg\":1,\"dreg\":0}]}}]},"
+	"{\"delete\":[{\"rule\":{\"family\":\"ip\",\"table\":\"filter\","
+	"\"chain\":\"input\",\"handle\":5,\"expr\":[]}}]},"
+	"{\"flush\":[{\"table\":{\"name\":\"filter\",\"family\":\"ip\","
+	"\"flags\":0,\"use\":0}}]}]}";
+
+static const struct {
+	uint16_t	type;
+	uint16_t	flags;
+} expected[] = {
+	{ NFT_MSG_DELTABLE,	0 },
+	{ NFT_MSG_NEWTABLE,	NLM_F_CREATE },
+	{ NFT_MSG_NEWCHAIN,	NLM_F_CREATE },
+	{ NFT_MSG_NEWSET,	NLM_F_CREATE },
+	{ NFT_MSG_NEWSETELEM,	NLM_F_CREATE },
+	{ NFT_MSG_NEWRULE,	NLM_F_CREATE | NLM_F_APPEND },
+	{ NFT_MSG_DELRULE,	0 },
+	{ NFT_MSG_DELRULE,	0 },
+};
+
+#define NUM_MSGS	(sizeof(expected) / sizeof(expected[0]))
+
+static int lookup_cb(struct nftnl_expr *e, void *data)
+{
+	if (strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), "lookup") == 0 &&
+	    nftnl_expr_is_set(e, NFTNL_EXPR_LOOKUP_SET_ID))
+		*(uint32_t *)data = nftnl_expr_get_u32(e,
+						       NFTNL_EXPR_LOOKUP_SET_ID);
+	return 0;
+}
+
+/* The lookup refers to the set that was added before it by ID */
+static void check_set_id(const struct nlmsghdr *nlh, uint32_t *set_id)
+{
+	struct nftnl_rule *r;
+	struct nftnl_set *s;
+	uint32_t id = UINT32_MAX;
+
+	switch (NFNL_MSG_TYPE(nlh->nlmsg_type)) {
+	case NFT_MSG_NEWSET:
+		s = nftnl_set_alloc();
+		if (s == NULL || nftnl_set_nlmsg_parse(nlh, s) < 0)
+			print_err("cannot parse set");
+		else
+			*set_id = nftnl_set_get_u32(s, NFTNL_SET_ID);
+		if (s != NULL)
+			nftnl_set_free(s);
+		break;
+	case NFT_MSG_NEWRULE:
+		r = nftnl_rule_alloc();
+		if (r == NULL || nftnl_rule_nlmsg_parse(nlh, r) < 0)
+			print_err("cannot parse rule");
+		else
+			nftnl_expr_foreach(r, lookup_cb, &id);
+		if (id != *set_id)
+			print_err("lookup does not refer to the set");
+		if (r != NULL)
+			nftnl_rule_free(r);
+		break;
+	}
+}
+
+static void check_batch(struct nftnl_batch *batch, uint32_t seq)
+{
+	struct iovec iov[16];
+	const struct nlmsghdr *nlh;
+	uint32_t set_id = 0;
+	unsigned int n = 0;
+	int i, iovlen, len;
+
+	iovlen = nftnl_batch_iovec_len(batch);
+	if (iovlen > 16) {
+		print_err("too many pages");
+		return;
+	}
+	nftnl_batch_iovec(batch, iov, iovlen);
+
+	for (i = 0; i < iovlen; i++) {
+		nlh = iov[i].iov_base;
+		len = iov[i].iov_len;
+		while (mnl_nlmsg_ok(nlh, len)) {
+			if (n >= NUM_MSGS) {
+				print_err("too many messages");
+				return;
+			}
+			if (NFNL_MSG_TYPE(nlh->nlmsg_type) != expected[n].type)
+				print_err("unexpected message type");
+			if (nlh->nlmsg_flags !=
+			    (NLM_F_REQUEST | NLM_F_ACK | expected[n].flags))
+				print_err("unexpected message flags");
+			if (nlh->nlmsg_seq != seq + n)
+				print_err("unexpected sequence number");
+			check_set_id(nlh, &set_id);
+			n++;
+			nlh = mnl_nlmsg_next(nlh, &len);
+		}
+	}
+
+	if (n != NUM_MSGS)
+		print_err("messages are missing");
+}
+
+static int compile(FILE *fp, struct nftnl_batch **batch, uint32_t *seq)
+{
+	struct nftnl_parse_err *err;
+	int ret;
+
+	err = nftnl_parse_err_alloc();
+	*batch = nftnl_batch_alloc(PAGE_SIZE, PAGE_SIZE);
+	if (err == NULL || *batch == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (fp != NULL)
+		ret = nftnl_ruleset_compile_file(NFTNL_PARSE_JSON, fp, *batch,
+						 seq, err);
+	else
+		ret = nftnl_ruleset_compile_buffer(NFTNL_PARSE_JSON, ruleset,
+						   *batch, seq, err);
+	nftnl_parse_err_free(err);
+
+	return ret;
+}
+
+static void test_compile_file(void)
+{
+	struct nftnl_batch *batch;
+	uint32_t seq = 100;
+	FILE *fp;
+
+	fp = tmpfile();
+	if (fp == NULL) {
+		print_err("tmpfile");
+		return;
+	}
+	fputs(ruleset, fp);
+	rewind(fp);
+
+	if (compile(fp, &batch, &seq) < 0)
+		print_err("compiling a file failed");
+	else if (seq != 100 + NUM_MSGS)
+		print_err("sequence was not advanced");
+	else
+		check_batch(batch, 100);
+
+	nftnl_batch_free(batch);
+	fclose(fp);
+}
+
+static void test_compile_unsupported(void)
+{
+	static const char flush_rule[] =
+		"{\"nftables\":[{\"flush\":[{\"rule\":{\"family\":\"ip\","
+		"\"table\":\"filter\",\"chain\":\"input\",\"expr\":[]}}]}]}";
+	struct nftnl_parse_err *err;
+	struct nftnl_batch *batch;
+	uint32_t seq = 0;
+
+	err = nftnl_parse_err_alloc();
+	batch = nftnl_batch_alloc(PAGE_SIZE, PAGE_SIZE);
+	if (err == NULL || batch == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_ruleset_compile_buffer(NFTNL_PARSE_JSON, flush_rule, batch,
+					 &seq, err) == 0 ||
+	    errno != EOPNOTSUPP)
+		print_err("flushing a rule was accepted");
+
+	nftnl_parse_err_free(err);
+	nftnl_batch_free(batch);
+}
+
+/* Messages are built right into the batch, it must take the largest one */
+static void test_compile_small_batch(void)
+{
+	struct nftnl_parse_err *err;
+	struct nftnl_batch *batch;
+	uint32_t seq = 0;
+
+	err = nftnl_parse_err_alloc();
+	batch = nftnl_batch_alloc(PAGE_SIZE, 4096);
+	if (err == NULL || batch == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_ruleset_compile_buffer(NFTNL_PARSE_JSON, ruleset, batch,
+					 &seq, err) == 0 ||
+	    errno != EMSGSIZE || seq != 0)
+		print_err("batch with a small overrun area was accepted");
+
+	nftnl_parse_err_free(err);
+	nftnl_batch_free(batch);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_batch *batch;
+	uint32_t seq = 1;
+	int ret;
+
+	ret = compile(NULL, &batch, &seq);
+	/* Nothing to test without JSON support */
+	if (ret < 0 && errno == EOPNOTSUPP) {
+		nftnl_batch_free(batch);
+		goto out;
+	}
+
+	if (ret < 0)
+		print_err("compiling a buffer failed");
+	else
+		check_batch(batch, 1);
+	nftnl_batch_free(batch);
+
+	test_compile_file();
+	test_compile_unsupported();
+	test_compile_small_batch();
+out:
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,301 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+
+#define NUM_RULES	1000
+#define NUM_ELEMS	100
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_ruleset *build_ruleset(void)
+{
+	struct nftnl_ruleset *rs;
+	struct nftnl_table_list *tl;
+	struct nftnl_chain_list *cl;
+	struct nftnl_set_list *sl;
+	struct nftnl_rule_list *rl;
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	struct nftnl_set *s;
+	struct nftnl_set_elem *e;
+	struct nftnl_rule *r;
+	struct nftnl_expr *expr;
+	uint32_t key;
+	char name[16];
+	int i;
+
+	rs = nftnl_ruleset_alloc();
+	tl = nftnl_table_list_alloc();
+	cl = nftnl_chain_list_alloc();
+	sl = nftnl_set_list_alloc();
+	rl = nftnl_rule_list_alloc();
+	t = nftnl_table_alloc();
+	c = nftnl_chain_alloc();
+	s = nftnl_set_alloc();
+	if (rs == NULL || tl == NULL || cl == NULL || sl == NULL ||
+	    rl == NULL || t == NULL || c == NULL || s == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, AF_INET);
+	nftnl_table_list_add_tail(t, tl);
+
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, "input");
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, AF_INET);
+	nftnl_chain_list_add_tail(c, cl);
+
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "set0");
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, AF_INET);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(key));
+	for (i = 0; i < NUM_ELEMS; i++) {
+		e = nftnl_set_elem_alloc();
+		key = i;
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &key, sizeof(key));
+		nftnl_set_elem_add(s, e);
+	}
+	nftnl_set_list_add_tail(s, sl);
+
+	/* A verdict map that jumps to a few chains */
+	s = nftnl_set_alloc();
+	if (s == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "vmap0");
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, AF_INET);
+	nftnl_set_set_u32(s, NFTNL_SET_FLAGS, NFT_SET_MAP);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(key));
+	for (i = 0; i < NUM_ELEMS; i++) {
+		e = nftnl_set_elem_alloc();
+		key = i;
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &key, sizeof(key));
+		if (i % 5 == 0) {
+			nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_VERDICT,
+					       i % 2 ? NF_ACCEPT : NF_DROP);
+		} else {
+			snprintf(name, sizeof(name), "chain%d", i % 3);
+			nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_VERDICT,
+					       i % 2 ? NFT_JUMP : NFT_GOTO);
+			nftnl_set_elem_set_str(e, NFTNL_SET_ELEM_CHAIN, name);
+		}
+		nftnl_set_elem_add(s, e);
+	}
+	nftnl_set_list_add_tail(s, sl);
+
+	s = nftnl_set_alloc();
+	if (s == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "empty");
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, AF_INET);
+	nftnl_set_list_add_tail(s, sl);
+
+	for (i = 0; i < NUM_RULES; i++) {
+		r = nftnl_rule_alloc();
+		expr = nftnl_expr_alloc("counter");
+		if (r == NULL || expr == NULL) {
+			print_err("OOM");
+			exit(EXIT_FAILURE);
+		}
+		nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+		nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+		nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, AF_INET);
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+		nftnl_expr_set_u64(expr, NFTNL_EXPR_CTR_PACKETS, i);
+		nftnl_expr_set_u64(expr, NFTNL_EXPR_CTR_BYTES, i * 64);
+		nftnl_rule_add_expr(r, expr);
+		nftnl_rule_list_add_tail(r, rl);
+	}
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, cl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rl);
+
+	return rs;
+}
+
+static void test_export(struct nftnl_ruleset *rs, uint32_t type,
+			uint32_t flags)
+{
+	struct nftnl_sink *sink;
+	size_t size = 1 << 20;
+	char *buf, *data;
+	int ret;
+	FILE *fp;
+
+	buf = malloc(size);
+	sink = nftnl_sink_alloc(64);
+	if (buf == NULL || sink == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_ruleset_snprintf(buf, size, rs, type, flags) >= (int)size)
+		print_err("Reference buffer too small");
+
+	ret = nftnl_ruleset_export(sink, rs, type, flags);
+	if (ret < 0)
+		print_err("Ruleset export failed");
+	if (nftnl_sink_total(sink) != nftnl_sink_len(sink) ||
+	    nftnl_sink_len(sink) != strlen(buf))
+		print_err("Ruleset export length mismatches");
+
+	if (strcmp(buf, nftnl_sink_data(sink)) != 0)
+		print_err("Ruleset export output mismatches snprintf");
+
+	nftnl_sink_reset(sink);
+	if (nftnl_sink_len(sink) != 0 || nftnl_sink_data(sink)[0] != '\0')
+		print_err("Sink reset failed");
+
+	/* fprintf is an export into the file */
+	fp = tmpfile();
+	if (fp == NULL) {
+		print_err("Cannot create file");
+		exit(EXIT_FAILURE);
+	}
+	if (nftnl_ruleset_fprintf(fp, rs, type, flags) != (int)strlen(buf))
+		print_err("Ruleset fprintf length mismatches");
+	rewind(fp);
+	data = calloc(1, size);
+	if (data == NULL ||
+	    fread(data, 1, size, fp) != strlen(buf) || strcmp(buf, data) != 0)
+		print_err("Ruleset fprintf output mismatches snprintf");
+
+	free(data);
+	fclose(fp);
+	nftnl_sink_free(sink);
+	free(buf);
+}
+
+#define STREAM_CHUNK	512
+
+struct stream {
+	char	*buf;
+	size_t	len;
+	int	writes;
+};
+
+static ssize_t stream_write(void *data, const void *buf, size_t len)
+{
+	struct stream *st = data;
+
+	/* all but the final flush hand over complete chunks */
+	if (st->writes++ > 0 && st->len % STREAM_CHUNK != 0)
+		print_err("Stream write after a partial chunk");
+
+	memcpy(st->buf + st->len, buf, len);
+	st->len += len;
+
+	return len;
+}
+
+static void test_stream(struct nftnl_ruleset *rs, uint32_t type)
+{
+	struct nftnl_sink *sink;
+	struct stream st = {};
+	size_t size = 1 << 20;
+	char *buf;
+	FILE *fp;
+
+	buf = malloc(size);
+	st.buf = calloc(1, size);
+	sink = nftnl_sink_alloc_cb(STREAM_CHUNK, stream_write, &st);
+	if (buf == NULL || st.buf == NULL || sink == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	nftnl_ruleset_snprintf(buf, size, rs, type, 0);
+
+	if (nftnl_ruleset_export(sink, rs, type, 0) < 0)
+		print_err("Ruleset stream export failed");
+	if (nftnl_sink_len(sink) >= STREAM_CHUNK)
+		print_err("Stream sink holds more than one chunk");
+	if (nftnl_sink_flush(sink) < 0)
+		print_err("Stream sink flush failed");
+
+	if (st.writes < 2 || strcmp(buf, st.buf) != 0)
+		print_err("Ruleset stream export output mismatches snprintf");
+	if (nftnl_sink_total(sink) != st.len)
+		print_err("Ruleset stream export length mismatches");
+
+	nftnl_sink_free(sink);
+
+	/* Same thing through a file descriptor */
+	fp = tmpfile();
+	sink = nftnl_sink_alloc_fd(STREAM_CHUNK, fileno(fp));
+	if (fp == NULL || sink == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_ruleset_export(sink, rs, type, 0) < 0 ||
+	    nftnl_sink_flush(sink) < 0)
+		print_err("Ruleset fd export failed");
+
+	memset(st.buf, 0, size);
+	rewind(fp);
+	if (fread(st.buf, 1, size, fp) != strlen(buf) ||
+	    strcmp(buf, st.buf) != 0)
+		print_err("Ruleset fd export output mismatches snprintf");
+
+	nftnl_sink_free(sink);
+	fclose(fp);
+	free(st.buf);
+	free(buf);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_ruleset *rs;
+
+	rs = build_ruleset();
+
+	test_export(rs, NFTNL_OUTPUT_DEFAULT, 0);
+	test_export(rs, NFTNL_OUTPUT_XML, 0);
+	test_export(rs, NFTNL_OUTPUT_JSON, 0);
+	test_export(rs, NFTNL_OUTPUT_JSON, NFTNL_OF_EVENT_NEW);
+	test_stream(rs, NFTNL_OUTPUT_DEFAULT);
+	test_stream(rs, NFTNL_OUTPUT_XML);
+	test_stream(rs, NFTNL_OUTPUT_JSON);
+
+	nftnl_ruleset_free(rs);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/common.h>
+
+#define NUM_TABLES	40
+#define NUM_RULES	25
+#define MAX_OBJS	(NUM_TABLES * (NUM_RULES + 3) + 1)
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+/* Each table comes with a set that its rules look up by name. A flush
+ * command in the middle has to wait for everything before it.
+ */
+static FILE *build_file(int bad_table)
+{
+	FILE *fp;
+	int i, j;
+
+	fp = tmpfile();
+	if (fp == NULL) {
+		print_err("tmpfile");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(fp, "{\"nftables\":[{\"add\":[");
+	for (i = 0; i < NUM_TABLES; i++) {
+		if (i == NUM_TABLES / 2)
+			fprintf(fp, "]},\n{\"flush\":[]},\n{\"add\":[");
+		else if (i > 0)
+			fprintf(fp, ",\n");
+
+		fprintf(fp, "{\"table\":{\"name\":\"t%d\",\"family\":\"ip\","
+			    "\"flags\":0,\"use\":0}},\n", i);
+		fprintf(fp, "{\"chain\":{\"name\":\"c\",\"handle\":1,"
+			    "\"bytes\":0,\"packets\":0,\"table\":\"t%d\","
+			    "\"family\":\"ip\",\"use\":0}},\n", i);
+		fprintf(fp, "{\"set\":{\"name\":\"s%d\",\"table\":\"t%d\","
+			    "\"flags\":3,\"family\":\"ip\",\"key_type\":12,"
+			    "\"key_len\":2,\"set_elem\":[{\"flags\":0,\"key\":"
+			    "{\"reg\":{\"type\":\"value\",\"len\":2,"
+			    "\"data0\":\"0x00001700\"}}}]}}", i, i);
+		for (j = 0; j < NUM_RULES; j++) {
+			fprintf(fp, ",\n{\"rule\":{\"family\":\"ip\","
+				    "\"table\":\"t%d\",\"chain\":\"c\","
+				    "\"handle\":%d,\"expr\":[{\"type\":"
+				    "\"payload\",\"dreg\":1,\"offset\":12,"
+				    "\"len\":4,\"base\":\"network\"},"
+				    "{\"type\":\"%s\",\"set\":\"s%d\","
+				    "\"sreg\":1,\"dreg\":0}]}}",
+				i, j + 1,
+				i == bad_table && j == NUM_RULES / 2 ?
+				"bogus" : "lookup", i);
+		}
+	}
+	fprintf(fp, "]}]}\n");
+
+	return fp;
+}
+
+struct parse_result {
+	char		objs[MAX_OBJS][32];
+	int		num_objs;
+	char		set_names[NUM_TABLES][8];
+	uint32_t	set_ids[NUM_TABLES];
+	int		num_sets;
+};
+
+static int check_lookup(struct nftnl_expr *e, void *data)
+{
+	struct parse_result *res = data;
+	const uint32_t *set_id;
+	const char *name;
+	uint32_t len;
+	int i;
+
+	if (strcmp(nftnl_expr_get_str(e, NFTNL_EXPR_NAME), "lookup") != 0)
+		return 0;
+
+	name = nftnl_expr_get_str(e, NFTNL_EXPR_LOOKUP_SET);
+	for (i = 0; i < res->num_sets; i++) {
+		if (strcmp(res->set_names[i], name) == 0)
+			break;
+	}
+	set_id = nftnl_expr_get(e, NFTNL_EXPR_LOOKUP_SET_ID, &len);
+	if (i == res->num_sets || set_id == NULL ||
+	    *set_id != res->set_ids[i])
+		print_err("lookup does not refer to its set");
+
+	return 0;
+}
+
+static int parse_cb(const struct nftnl_parse_ctx *ctx)
+{
+	struct parse_result *res = nftnl_ruleset_ctx_get(ctx,
+						NFTNL_RULESET_CTX_DATA);
+	char *obj = res->objs[res->num_objs];
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	struct nftnl_set *s;
+	struct nftnl_rule *r;
+
+	if (res->num_objs == MAX_OBJS) {
+		print_err("too many objects");
+		return -1;
+	}
+
+	switch (nftnl_ruleset_ctx_get_u32(ctx, NFTNL_RULESET_CTX_TYPE)) {
+	case NFTNL_RULESET_TABLE:
+		t = nftnl_ruleset_ctx_get(ctx, NFTNL_RULESET_CTX_TABLE);
+		snprintf(obj, 32, "table %s",
+			 nftnl_table_get_str(t, NFTNL_TABLE_NAME));
+		break;
+	case NFTNL_RULESET_CHAIN:
+		c = nftnl_ruleset_ctx_get(ctx, NFTNL_RULESET_CTX_CHAIN);
+		snprintf(obj, 32, "chain %s",
+			 nftnl_chain_get_str(c, NFTNL_CHAIN_TABLE));
+		break;
+	case NFTNL_RULESET_SET:
+		s = nftnl_ruleset_ctx_get(ctx, NFTNL_RULESET_CTX_SET);
+		snprintf(obj, 32, "set %s",
+			 nftnl_set_get_str(s, NFTNL_SET_NAME));
+		snprintf(res->set_names[res->num_sets], 8, "%s",
+			 nftnl_set_get_str(s, NFTNL_SET_NAME));
+		res->set_ids[res->num_sets++] =
+			nftnl_set_get_u32(s, NFTNL_SET_ID);
+		break;
+	case NFTNL_RULESET_RULE:
+		r = nftnl_ruleset_ctx_get(ctx, NFTNL_RULESET_CTX_RULE);
+		snprintf(obj, 32, "rule %s %llu",
+			 nftnl_rule_get_str(r, NFTNL_RULE_TABLE),
+			 (unsigned long long)
+			 nftnl_rule_get_u64(r, NFTNL_RULE_HANDLE));
+		nftnl_expr_foreach(r, check_lookup, res);
+		break;
+	case NFTNL_RULESET_RULESET:
+		snprintf(obj, 32, "flush");
+		break;
+	default:
+		print_err("unexpected object");
+		return -1;
+	}
+	res->num_objs++;
+
+	nftnl_ruleset_ctx_free(ctx);
+	return 0;
+}
+
+static int parse(FILE *fp, struct parse_result *res, unsigned int nthreads,
+		 uint32_t flags)
+{
+	struct nftnl_parse_err *err;
+	int ret;
+
+	err = nftnl_parse_err_alloc();
+	if (err == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(res, 0, sizeof(*res));
+	rewind(fp);
+	if (nthreads == 0)
+		ret = nftnl_ruleset_parse_file_cb(NFTNL_PARSE_JSON, fp, err,
+						  res, parse_cb);
+	else
+		ret = nftnl_ruleset_parse_file_cb_parallel(NFTNL_PARSE_JSON,
+							   fp, err, res,
+							   parse_cb, nthreads,
+							   flags);
+	nftnl_parse_err_free(err);
+
+	return ret;
+}
+
+static int cmp_obj(const void *a, const void *b)
+{
+	return strcmp(a, b);
+}
+
+static void test_parallel(FILE *fp)
+{
+	static struct parse_result serial, sorted, res;
+	unsigned int nthreads;
+	int i;
+
+	if (parse(fp, &serial, 0, 0) < 0) {
+		print_err("serial parse failed");
+		return;
+	}
+	if (serial.num_objs != MAX_OBJS)
+		print_err("serial parse is missing objects");
+
+	sorted = serial;
+	qsort(sorted.objs, sorted.num_objs, sizeof(sorted.objs[0]), cmp_obj);
+
+	for (nthreads = 1; nthreads <= 8; nthreads *= 2) {
+		if (parse(fp, &res, nthreads, 0) < 0) {
+			print_err("parallel parse failed");
+			continue;
+		}
+		if (res.num_objs != serial.num_objs ||
+		    memcmp(res.objs, serial.objs, sizeof(res.objs)) != 0 ||
+		    memcmp(res.set_ids, serial.set_ids,
+			   sizeof(res.set_ids)) != 0)
+			print_err("parallel parse is not in document order");
+
+		if (parse(fp, &res, nthreads, NFTNL_PARSE_F_UNORDERED) < 0) {
+			print_err("unordered parse failed");
+			continue;
+		}
+		/* The flush still splits the document in two halves */
+		for (i = 0; i < res.num_objs; i++) {
+			if (strcmp(res.objs[i], "flush") == 0)
+				break;
+		}
+		if (i == res.num_objs ||
+		    strcmp(serial.objs[i], "flush") != 0)
+			print_err("unordered parse moved the flush");
+
+		qsort(res.objs, res.num_objs, sizeof(res.objs[0]), cmp_obj);
+		if (res.num_objs != sorted.num_objs ||
+		    memcmp(res.objs, sorted.objs, sizeof(res.objs)) != 0)
+			print_err("unordered parse lost objects");
+	}
+}
+
+static void test_parallel_error(FILE *fp)
+{
+	static struct parse_result serial, res;
+
+	if (parse(fp, &serial, 0, 0) == 0) {
+		print_err("serial parse of bad input succeeded");
+		return;
+	}
+
+	if (parse(fp, &res, 4, 0) == 0) {
+		print_err("parallel parse of bad input did not fail");
+		return;
+	}
+	if (res.num_objs != serial.num_objs ||
+	    memcmp(res.objs, serial.objs, sizeof(res.objs)) != 0)
+		print_err("parallel parse delivered past the error");
+}
+
+int main(int argc, char *argv[])
+{
+	struct parse_result *res;
+	FILE *fp;
+
+	res = calloc(1, sizeof(*res));
+	fp = build_file(-1);
+	if (res == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Nothing to test without JSON support */
+	if (parse(fp, res, 1, 0) < 0 && errno == EOPNOTSUPP)
+		goto out;
+
+	test_parallel(fp);
+	fclose(fp);
+
+	fp = build_file(NUM_TABLES - 3);
+	test_parallel_error(fp);
+out:
+	fclose(fp);
+	free(res);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,183 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/set.h>
+#include <libnftnl/gen.h>
+
+#define NUM_BULK	5000
+#define BULK_CHUNK	500
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static char buf[65536];
+static int num_deltas;
+static char added[64], deleted[64];
+
+struct keys {
+	char	*out;
+	size_t	size;
+	int	len;
+};
+
+static int dump_key(struct nftnl_set_elem *e, void *data)
+{
+	struct keys *k = data;
+	const uint32_t *key;
+	uint32_t len;
+
+	key = nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY, &len);
+	k->len += snprintf(k->out + k->len, k->size - k->len, "%s%u",
+			   k->len ? "," : "", *key);
+	return 0;
+}
+
+static void dump_keys(struct nftnl_set *s, char *out, size_t size)
+{
+	struct keys k = { .out = out, .size = size };
+
+	out[0] = '\0';
+	nftnl_set_elem_foreach(s, dump_key, &k);
+}
+
+static int delta_cb(struct nftnl_set *a, struct nftnl_set *d, void *data)
+{
+	num_deltas++;
+
+	if (strcmp(nftnl_set_get_str(a, NFTNL_SET_NAME), "set0") != 0 ||
+	    strcmp(nftnl_set_get_str(d, NFTNL_SET_TABLE), "filter") != 0 ||
+	    nftnl_set_get_u32(a, NFTNL_SET_FAMILY) != NFPROTO_IPV4)
+		print_err("Delta for unexpected set");
+
+	dump_keys(a, added, sizeof(added));
+	dump_keys(d, deleted, sizeof(deleted));
+
+	return 0;
+}
+
+static struct nlmsghdr *build_elems(uint16_t event, const char *set,
+				    uint32_t first, uint32_t num)
+{
+	struct nlattr *list, *elem, *key;
+	struct nlmsghdr *nlh;
+	uint32_t i;
+
+	nlh = nftnl_set_elem_nlmsg_build_hdr(buf, event, NFPROTO_IPV4, 0, 1);
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_SET_ELEM_LIST_SET, set);
+	list = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_LIST_ELEMENTS);
+	for (i = first; i < first + num; i++) {
+		elem = mnl_attr_nest_start(nlh, NFTA_LIST_ELEM);
+		key = mnl_attr_nest_start(nlh, NFTA_SET_ELEM_KEY);
+		mnl_attr_put_u32(nlh, NFTA_DATA_VALUE, i);
+		mnl_attr_nest_end(nlh, key);
+		mnl_attr_nest_end(nlh, elem);
+	}
+	mnl_attr_nest_end(nlh, list);
+
+	return nlh;
+}
+
+static struct nlmsghdr *build_gen(void)
+{
+	struct nlmsghdr *nlh;
+
+	nlh = nftnl_gen_nlmsg_build_hdr(buf, NFT_MSG_NEWGEN, AF_UNSPEC, 0, 1);
+	mnl_attr_put_u32(nlh, NFTA_GEN_ID, htonl(1));
+
+	return nlh;
+}
+
+static void feed(struct nftnl_set_delta *d, struct nlmsghdr *nlh)
+{
+	if (nftnl_set_delta_nlmsg(d, nlh) < 0)
+		print_err("Feeding message failed");
+}
+
+static void test_delta(struct nftnl_set_delta *d)
+{
+	feed(d, build_elems(NFT_MSG_NEWSETELEM, "set0", 1, 3));
+	feed(d, build_elems(NFT_MSG_DELSETELEM, "set0", 2, 1));
+	feed(d, build_elems(NFT_MSG_NEWSETELEM, "set0", 4, 1));
+	feed(d, build_elems(NFT_MSG_DELSETELEM, "set0", 5, 2));
+	feed(d, build_elems(NFT_MSG_NEWSETELEM, "set0", 6, 1));
+
+	/* Added and deleted again, nothing to report for this set */
+	feed(d, build_elems(NFT_MSG_NEWSETELEM, "set1", 1, 2));
+	feed(d, build_elems(NFT_MSG_DELSETELEM, "set1", 1, 2));
+
+	if (num_deltas != 0)
+		print_err("Delta delivered before the generation ended");
+
+	feed(d, build_gen());
+	if (num_deltas != 1 ||
+	    strcmp(added, "1,3,4,6") != 0 || strcmp(deleted, "5,6") != 0)
+		print_err("Unexpected delta");
+
+	feed(d, build_gen());
+	if (num_deltas != 1)
+		print_err("Empty generation delivered a delta");
+}
+
+static void test_bulk(struct nftnl_set_delta *d)
+{
+	uint32_t i;
+
+	num_deltas = 0;
+
+	for (i = 0; i < NUM_BULK; i += BULK_CHUNK)
+		feed(d, build_elems(NFT_MSG_NEWSETELEM, "set0", i, BULK_CHUNK));
+	for (i = 0; i < NUM_BULK; i += BULK_CHUNK)
+		feed(d, build_elems(NFT_MSG_DELSETELEM, "set0", i,
+				    i + BULK_CHUNK < NUM_BULK ?
+				    BULK_CHUNK : BULK_CHUNK - 1));
+	feed(d, build_gen());
+
+	if (num_deltas != 1 || strcmp(added, "4999") != 0 ||
+	    strcmp(deleted, "") != 0)
+		print_err("Bulk add and delete did not cancel out");
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_set_delta *d;
+
+	d = nftnl_set_delta_alloc(delta_cb, NULL);
+	if (d == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	test_delta(d);
+	test_bulk(d);
+
+	/* Pending elements are released along with the coalescer */
+	feed(d, build_elems(NFT_MSG_NEWSETELEM, "set0", 1, 3));
+	nftnl_set_delta_free(d);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
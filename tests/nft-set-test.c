@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 #include <netinet/in.h>
 #include <linux/netfilter/nf_tables.h>
 
@@ -49,9 +50,77 @@ static void cmp_nftnl_set(struct nftnl_set *a, struct nftnl_set *b)
 		print_err("Set data-len mismatches");
 }
 
+static int count_elem_cb(struct nftnl_set_elem *e, void *data)
+{
+	(*(int *)data)++;
+	return 0;
+}
+
+static int count_elems(struct nftnl_set *s)
+{
+	int n = 0;
+
+	nftnl_set_elem_foreach(s, count_elem_cb, &n);
+	return n;
+}
+
+static int set_flags_cb(struct nftnl_set_elem *e, void *data)
+{
+	nftnl_set_elem_set_u32(e, NFTNL_SET_ELEM_FLAGS, NFT_SET_ELEM_INTERVAL_END);
+	return 0;
+}
+
+static int check_flags_cb(struct nftnl_set_elem *e, void *data)
+{
+	if (nftnl_set_elem_is_set(e, NFTNL_SET_ELEM_FLAGS))
+		print_err("Set clone changed through the original");
+	return 0;
+}
+
+static int check_key_cb(const struct nftnl_set_elem *e, void *data)
+{
+	uint32_t len;
+
+	if (*(uint32_t *)nftnl_set_elem_get(e, NFTNL_SET_ELEM_KEY, &len) !=
+	    0x12345678)
+		print_err("Set clone element key mismatches");
+	return 0;
+}
+
+/* Whether the first elements of both sets are the very same */
+static bool same_elems(const struct nftnl_set *a, const struct nftnl_set *b)
+{
+	struct nftnl_set_elems_iter *ia, *ib;
+	bool same;
+
+	ia = nftnl_set_elems_iter_create_ro(a);
+	ib = nftnl_set_elems_iter_create_ro(b);
+	if (ia == NULL || ib == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	same = nftnl_set_elems_iter_cur(ia) == nftnl_set_elems_iter_cur(ib);
+
+	nftnl_set_elems_iter_destroy(ia);
+	nftnl_set_elems_iter_destroy(ib);
+	return same;
+}
+
+static void add_elem(struct nftnl_set *s, uint32_t key)
+{
+	struct nftnl_set_elem *e;
+
+	e = nftnl_set_elem_alloc();
+	if (e == NULL)
+		print_err("OOM");
+
+	nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &key, sizeof(key));
+	nftnl_set_elem_add(s, e);
+}
+
 int main(int argc, char *argv[])
 {
-	struct nftnl_set *a, *b = NULL;
+	struct nftnl_set *a, *b = NULL, *c;
 	char buf[4096];
 	struct nlmsghdr *nlh;
 
@@ -78,7 +147,33 @@ int main(int argc, char *argv[])
 
 	cmp_nftnl_set(a,b);
 
-	nftnl_set_free(a); nftnl_set_free(b);
+	add_elem(a, 0x12345678);
+	c = nftnl_set_clone(a);
+	if (c == NULL)
+		print_err("OOM");
+
+	cmp_nftnl_set(a, c);
+	if (count_elems(c) != 1)
+		print_err("Set clone elements mismatch");
+
+	add_elem(c, 0x87654321);
+	if (count_elems(a) != 1 || count_elems(c) != 2)
+		print_err("Set clone elements are not copied on write");
+
+	/* Elements handed out for changes are not the clone's any more */
+	nftnl_set_free(c);
+	c = nftnl_set_clone(a);
+	if (c == NULL)
+		print_err("OOM");
+	nftnl_set_elem_foreach_ro(c, check_key_cb, NULL);
+	if (!same_elems(a, c))
+		print_err("Read-only walk copied the set clone");
+	nftnl_set_elem_foreach(a, set_flags_cb, NULL);
+	nftnl_set_elem_foreach(c, check_flags_cb, NULL);
+	if (same_elems(a, c))
+		print_err("Set clone elements are shared after a write walk");
+
+	nftnl_set_free(a); nftnl_set_free(b); nftnl_set_free(c);
 
 	if (!test_ok)
 		exit(EXIT_FAILURE);
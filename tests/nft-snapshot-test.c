@@ -0,0 +1,386 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <libmnl/libmnl.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/ruleset.h>
+#include <libnftnl/table.h>
+#include <libnftnl/chain.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/batch.h>
+#include <libnftnl/snapshot.h>
+
+#define NUM_RULES	100
+#define NUM_ELEMS	10000
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static struct nftnl_ruleset *build_ruleset(void)
+{
+	struct nftnl_ruleset *rs;
+	struct nftnl_table_list *tl;
+	struct nftnl_chain_list *cl;
+	struct nftnl_set_list *sl;
+	struct nftnl_rule_list *rl;
+	struct nftnl_table *t;
+	struct nftnl_chain *c;
+	struct nftnl_set *s;
+	struct nftnl_set_elem *e;
+	struct nftnl_rule *r;
+	uint32_t key;
+	int i;
+
+	rs = nftnl_ruleset_alloc();
+	tl = nftnl_table_list_alloc();
+	cl = nftnl_chain_list_alloc();
+	sl = nftnl_set_list_alloc();
+	rl = nftnl_rule_list_alloc();
+	t = nftnl_table_alloc();
+	c = nftnl_chain_alloc();
+	s = nftnl_set_alloc();
+	if (rs == NULL || tl == NULL || cl == NULL || sl == NULL ||
+	    rl == NULL || t == NULL || c == NULL || s == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nftnl_table_set_u32(t, NFTNL_TABLE_FAMILY, AF_INET);
+	nftnl_table_list_add_tail(t, tl);
+
+	nftnl_chain_set_str(c, NFTNL_CHAIN_TABLE, "filter");
+	nftnl_chain_set_str(c, NFTNL_CHAIN_NAME, "input");
+	nftnl_chain_set_u32(c, NFTNL_CHAIN_FAMILY, AF_INET);
+	nftnl_chain_set_u64(c, NFTNL_CHAIN_HANDLE, 1);
+	nftnl_chain_list_add_tail(c, cl);
+
+	/* Large enough to be split over several NEWSETELEM messages */
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "set0");
+	nftnl_set_set_u32(s, NFTNL_SET_FAMILY, AF_INET);
+	nftnl_set_set_u32(s, NFTNL_SET_KEY_LEN, sizeof(key));
+	for (i = 0; i < NUM_ELEMS; i++) {
+		e = nftnl_set_elem_alloc();
+		key = i;
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &key, sizeof(key));
+		nftnl_set_elem_add(s, e);
+	}
+	nftnl_set_list_add_tail(s, sl);
+
+	for (i = 0; i < NUM_RULES; i++) {
+		r = nftnl_rule_alloc();
+		if (r == NULL) {
+			print_err("OOM");
+			exit(EXIT_FAILURE);
+		}
+		nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+		nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+		nftnl_rule_set_u32(r, NFTNL_RULE_FAMILY, AF_INET);
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+		nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+		nftnl_rule_list_add_tail(r, rl);
+	}
+
+	nftnl_ruleset_set(rs, NFTNL_RULESET_TABLELIST, tl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_CHAINLIST, cl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_SETLIST, sl);
+	nftnl_ruleset_set(rs, NFTNL_RULESET_RULELIST, rl);
+
+	return rs;
+}
+
+struct snapshot_stats {
+	int	msgs[NFT_MSG_MAX];
+	int	elems;
+};
+
+/* Elements are numbered as they are built, count the nests instead of
+ * parsing them.
+ */
+static int count_elems(const struct nlmsghdr *nlh)
+{
+	struct nlattr *attr, *elem;
+	int n = 0;
+
+	mnl_attr_for_each(attr, nlh, sizeof(struct nfgenmsg)) {
+		if (mnl_attr_get_type(attr) != NFTA_SET_ELEM_LIST_ELEMENTS)
+			continue;
+
+		mnl_attr_for_each_nested(elem, attr)
+			n++;
+	}
+
+	return n;
+}
+
+static int check_msg_cb(const struct nlmsghdr *nlh, void *data)
+{
+	struct snapshot_stats *stats = data;
+	uint16_t type = NFNL_MSG_TYPE(nlh->nlmsg_type);
+	struct nftnl_chain *c;
+	struct nftnl_rule *r;
+
+	if (type >= NFT_MSG_MAX)
+		return -1;
+	stats->msgs[type]++;
+
+	switch (type) {
+	case NFT_MSG_NEWCHAIN:
+		c = nftnl_chain_alloc();
+		if (nftnl_chain_nlmsg_parse(nlh, c) < 0)
+			print_err("Chain parsing problems");
+		if (nftnl_chain_is_set(c, NFTNL_CHAIN_HANDLE))
+			print_err("Chain handle was not stripped");
+		nftnl_chain_free(c);
+		break;
+	case NFT_MSG_NEWRULE:
+		r = nftnl_rule_alloc();
+		if (nftnl_rule_nlmsg_parse(nlh, r) < 0)
+			print_err("Rule parsing problems");
+		if (nftnl_rule_is_set(r, NFTNL_RULE_HANDLE))
+			print_err("Rule handle was not stripped");
+		if (!(nlh->nlmsg_flags & NLM_F_APPEND))
+			print_err("Rule is not appended");
+		nftnl_rule_free(r);
+		break;
+	case NFT_MSG_NEWSETELEM:
+		stats->elems += count_elems(nlh);
+		break;
+	}
+
+	return 0;
+}
+
+static void test_batch(const struct nftnl_snapshot *snap)
+{
+	struct nftnl_batch *batch;
+	struct nlmsghdr *nlh;
+	struct iovec *iov;
+	uint32_t seq = 100, msgs = 0;
+	int i, iovlen, len;
+
+	batch = nftnl_batch_alloc(4 * 65536, 2 * 65536);
+	if (batch == NULL) {
+		print_err("OOM");
+		return;
+	}
+
+	if (nftnl_snapshot_batch(snap, batch, &seq) < 0)
+		print_err("Snapshot cannot be replayed into a batch");
+	if (seq != 100 + nftnl_snapshot_count(snap))
+		print_err("Snapshot batch sequence mismatches");
+
+	iovlen = nftnl_batch_iovec_len(batch);
+	iov = calloc(iovlen, sizeof(struct iovec));
+	nftnl_batch_iovec(batch, iov, iovlen);
+
+	for (i = 0; i < iovlen; i++) {
+		nlh = iov[i].iov_base;
+		len = iov[i].iov_len;
+		while (mnl_nlmsg_ok(nlh, len)) {
+			if (nlh->nlmsg_seq != 100 + msgs)
+				print_err("Batch message sequence mismatches");
+			msgs++;
+			nlh = mnl_nlmsg_next(nlh, &len);
+		}
+	}
+	if (msgs != nftnl_snapshot_count(snap))
+		print_err("Batch message count mismatches");
+
+	free(iov);
+	nftnl_batch_free(batch);
+}
+
+/* Mimic what a GETRULE dump looks like as it comes from the kernel */
+static size_t build_dump(char *buf, uint32_t num)
+{
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+	size_t len = 0;
+	uint32_t i;
+
+	r = nftnl_rule_alloc();
+	if (r == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+
+	for (i = 0; i < num; i++) {
+		nftnl_rule_set_u64(r, NFTNL_RULE_HANDLE, i + 1);
+		nlh = nftnl_rule_nlmsg_build_hdr(buf + len, NFT_MSG_NEWRULE,
+						 AF_INET, NLM_F_MULTI, 1234);
+		nftnl_rule_nlmsg_build_payload(nlh, r);
+		len += nlh->nlmsg_len;
+	}
+	nftnl_rule_free(r);
+
+	nlh = mnl_nlmsg_put_header(buf + len);
+	nlh->nlmsg_type = NLMSG_DONE;
+	nlh->nlmsg_flags = NLM_F_MULTI;
+	nlh->nlmsg_seq = 1234;
+	len += nlh->nlmsg_len;
+
+	return len;
+}
+
+static void test_dump(void)
+{
+	static char buf[65536], out[sizeof(buf)];
+	struct nftnl_batch *batch;
+	struct nftnl_rule *r;
+	struct nlmsghdr *nlh;
+	struct iovec iov;
+	uint32_t seq = 1;
+	size_t len;
+	ssize_t ret;
+	FILE *fp;
+	int n = 0, remain;
+
+	fp = tmpfile();
+	if (fp == NULL) {
+		print_err("cannot create temporary file");
+		return;
+	}
+
+	/* Record the same dump twice, as if it was received in two parts */
+	len = build_dump(buf, 10);
+	if (nftnl_snapshot_dump_record(fileno(fp), buf, len) < 0 ||
+	    nftnl_snapshot_dump_record(fileno(fp), buf, len) < 0)
+		print_err("Dump cannot be recorded");
+
+	ret = pread(fileno(fp), out, sizeof(out), 0);
+	if (ret != 2 * (len - MNL_NLMSG_HDRLEN))
+		print_err("Recorded dump length mismatches");
+	fclose(fp);
+
+	batch = nftnl_batch_alloc(MNL_SOCKET_BUFFER_SIZE, MNL_SOCKET_BUFFER_SIZE);
+	if (batch == NULL) {
+		print_err("OOM");
+		return;
+	}
+
+	if (nftnl_snapshot_dump_replay(out, ret, batch, &seq) < 0)
+		print_err("Dump cannot be replayed into a batch");
+	if (seq != 21)
+		print_err("Dump replay sequence mismatches");
+
+	nftnl_batch_iovec(batch, &iov, 1);
+	nlh = iov.iov_base;
+	remain = iov.iov_len;
+	for (; mnl_nlmsg_ok(nlh, remain); nlh = mnl_nlmsg_next(nlh, &remain)) {
+		if (nlh->nlmsg_flags != (NLM_F_REQUEST | NLM_F_CREATE |
+					 NLM_F_ACK | NLM_F_APPEND))
+			print_err("Dump replay flags mismatch");
+		if (nlh->nlmsg_seq != ++n)
+			print_err("Dump replay message sequence mismatches");
+
+		r = nftnl_rule_alloc();
+		if (nftnl_rule_nlmsg_parse(nlh, r) < 0)
+			print_err("Replayed rule parsing problems");
+		if (nftnl_rule_is_set(r, NFTNL_RULE_HANDLE))
+			print_err("Replayed rule handle was not stripped");
+		nftnl_rule_free(r);
+	}
+	if (n != 20)
+		print_err("Dump replay message count mismatches");
+
+	nftnl_batch_free(batch);
+}
+
+int main(int argc, char *argv[])
+{
+	struct snapshot_stats stats = {};
+	struct nftnl_ruleset *rs;
+	struct nftnl_snapshot *snap;
+	FILE *fp;
+
+	rs = build_ruleset();
+
+	fp = tmpfile();
+	if (fp == NULL) {
+		print_err("cannot create temporary file");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_snapshot_write(fileno(fp), rs) < 0)
+		print_err("Snapshot cannot be written");
+
+	snap = nftnl_snapshot_map(fileno(fp));
+	if (snap == NULL) {
+		print_err("Snapshot cannot be mapped");
+		exit(EXIT_FAILURE);
+	}
+
+	if (nftnl_snapshot_foreach(snap, check_msg_cb, &stats) < 0)
+		print_err("Snapshot has unexpected messages");
+
+	if (stats.msgs[NFT_MSG_NEWTABLE] != 1 ||
+	    stats.msgs[NFT_MSG_NEWCHAIN] != 1 ||
+	    stats.msgs[NFT_MSG_NEWSET] != 1 ||
+	    stats.msgs[NFT_MSG_NEWRULE] != NUM_RULES)
+		print_err("Snapshot message count mismatches");
+	if (stats.msgs[NFT_MSG_NEWSETELEM] < 2)
+		print_err("Snapshot set elements were not split");
+	if (stats.elems != NUM_ELEMS)
+		print_err("Snapshot set element count mismatches");
+	if (nftnl_snapshot_count(snap) != 3 + NUM_RULES +
+					  stats.msgs[NFT_MSG_NEWSETELEM])
+		print_err("Snapshot record count mismatches");
+
+	test_batch(snap);
+
+	nftnl_snapshot_unmap(snap);
+
+	/* A truncated snapshot must be rejected */
+	if (ftruncate(fileno(fp), 64) < 0)
+		print_err("cannot truncate temporary file");
+	snap = nftnl_snapshot_map(fileno(fp));
+	if (snap != NULL) {
+		print_err("Truncated snapshot was accepted");
+		nftnl_snapshot_unmap(snap);
+	}
+
+	/* Written again with the offset past the end, it still maps */
+	if (nftnl_snapshot_write(fileno(fp), rs) < 0)
+		print_err("Snapshot cannot be written again");
+	snap = nftnl_snapshot_map(fileno(fp));
+	if (snap == NULL)
+		print_err("Snapshot written at an offset cannot be mapped");
+	else
+		nftnl_snapshot_unmap(snap);
+
+	fclose(fp);
+	nftnl_ruleset_free(rs);
+
+	test_dump();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
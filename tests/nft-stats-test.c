@@ -0,0 +1,305 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/table.h>
+#include <libnftnl/rule.h>
+#include <libnftnl/set.h>
+#include <libnftnl/expr.h>
+#include <libnftnl/batch.h>
+#include <libnftnl/stats.h>
+
+#define NUM_THREADS	4
+#define NUM_ITERS	1000
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static uint64_t obj_delta(struct nftnl_stats *a, struct nftnl_stats *b,
+			  uint16_t obj, uint16_t attr)
+{
+	return nftnl_stats_obj_get(b, obj, attr) -
+	       nftnl_stats_obj_get(a, obj, attr);
+}
+
+static struct nftnl_stats *snapshot(void)
+{
+	struct nftnl_stats *s;
+
+	s = nftnl_stats_snapshot();
+	if (s == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	return s;
+}
+
+static int expr_noop_cb(struct nftnl_expr *e, void *data)
+{
+	return 0;
+}
+
+static void test_rule(void)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_stats *before, *after;
+	struct nftnl_rule *r, *copy, *clone;
+	struct nlmsghdr *nlh;
+
+	before = snapshot();
+
+	r = nftnl_rule_alloc();
+	copy = nftnl_rule_alloc();
+	nftnl_rule_set_str(r, NFTNL_RULE_TABLE, "filter");
+	nftnl_rule_set_str(r, NFTNL_RULE_CHAIN, "input");
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+	nftnl_rule_add_expr(r, nftnl_expr_alloc("counter"));
+
+	nlh = nftnl_rule_nlmsg_build_hdr(buf, NFT_MSG_NEWRULE, NFPROTO_IPV4,
+					 0, 1);
+	nftnl_rule_nlmsg_build_payload(nlh, r);
+	if (nftnl_rule_nlmsg_parse(nlh, copy) < 0)
+		print_err("Parsing rule failed");
+
+	/* Copying expressions of a clone neither builds nor parses them */
+	clone = nftnl_rule_clone(r);
+	if (clone == NULL || nftnl_expr_foreach(clone, expr_noop_cb, NULL) < 0)
+		print_err("Cloning rule failed");
+
+	nftnl_rule_free(r);
+	nftnl_rule_free(copy);
+	nftnl_rule_free(clone);
+
+	after = snapshot();
+
+	if (obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_ALLOC) != 3 ||
+	    obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_FREE) != 3 ||
+	    obj_delta(before, after, NFTNL_STATS_EXPR,
+		      NFTNL_STATS_OBJ_ALLOC) != 6 ||
+	    obj_delta(before, after, NFTNL_STATS_EXPR,
+		      NFTNL_STATS_OBJ_FREE) != 6)
+		print_err("Unexpected object counts");
+
+	if (obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_BUILD_MSGS) != 1 ||
+	    obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_BUILD_BYTES) != nlh->nlmsg_len ||
+	    obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_PARSE_MSGS) != 1 ||
+	    obj_delta(before, after, NFTNL_STATS_RULE,
+		      NFTNL_STATS_OBJ_PARSE_BYTES) != nlh->nlmsg_len)
+		print_err("Unexpected message counts");
+
+	if (nftnl_stats_expr_get(after, "counter",
+				 NFTNL_STATS_EXPR_BUILD_CALLS) -
+	    nftnl_stats_expr_get(before, "counter",
+				 NFTNL_STATS_EXPR_BUILD_CALLS) != 2 ||
+	    nftnl_stats_expr_get(after, "counter",
+				 NFTNL_STATS_EXPR_PARSE_CALLS) -
+	    nftnl_stats_expr_get(before, "counter",
+				 NFTNL_STATS_EXPR_PARSE_CALLS) != 2 ||
+	    nftnl_stats_expr_get(after, "counter",
+				 NFTNL_STATS_EXPR_PARSE_NS) == 0)
+		print_err("Unexpected expression counts");
+
+	nftnl_stats_free(before);
+	nftnl_stats_free(after);
+}
+
+static void test_misc(void)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_stats *before, *after;
+	struct nftnl_set_elems_iter *iter;
+	struct nftnl_set_elem *e;
+	struct nftnl_batch *batch;
+	uint32_t msg_len;
+	char *msg;
+	struct nftnl_table *t;
+	struct nftnl_set *s;
+	struct nlmsghdr *nlh;
+	uint32_t i;
+	FILE *fp;
+
+	before = snapshot();
+
+	/* Small pages so that adding messages rolls over to new ones */
+	batch = nftnl_batch_alloc(256, MNL_SOCKET_BUFFER_SIZE);
+	t = nftnl_table_alloc();
+	nftnl_table_set_str(t, NFTNL_TABLE_NAME, "filter");
+	nlh = nftnl_table_nlmsg_build_hdr(buf, NFT_MSG_NEWTABLE, NFPROTO_IPV4,
+					  0, 1);
+	nftnl_table_nlmsg_build_payload(nlh, t);
+	for (i = 0; i < 32; i++) {
+		memcpy(nftnl_batch_buffer(batch), nlh, nlh->nlmsg_len);
+		nftnl_batch_update(batch);
+	}
+	nftnl_table_free(t);
+	nftnl_batch_free(batch);
+
+	/* Output larger than the default buffer has to be formatted again */
+	s = nftnl_set_alloc();
+	nftnl_set_set_str(s, NFTNL_SET_TABLE, "filter");
+	nftnl_set_set_str(s, NFTNL_SET_NAME, "set0");
+	for (i = 0; i < 1000; i++) {
+		e = nftnl_set_elem_alloc();
+		nftnl_set_elem_set(e, NFTNL_SET_ELEM_KEY, &i, sizeof(i));
+		nftnl_set_elem_add(s, e);
+	}
+	fp = fopen("/dev/null", "w");
+	if (fp == NULL || nftnl_set_fprintf(fp, s, NFTNL_OUTPUT_DEFAULT, 0) < 0)
+		print_err("Printing set failed");
+	if (fp != NULL)
+		fclose(fp);
+
+	/* The elements fit in one message, built the way large sets are */
+	msg = malloc(2 * UINT16_MAX);
+	iter = nftnl_set_elems_iter_create(s);
+	if (msg == NULL || iter == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	nlh = nftnl_set_elem_nlmsg_build_hdr(msg, NFT_MSG_NEWSETELEM,
+					     NFPROTO_IPV4, 0, 1);
+	nftnl_set_elems_nlmsg_build_payload_iter(nlh, iter);
+	msg_len = nlh->nlmsg_len;
+	nftnl_set_elems_iter_destroy(iter);
+	nftnl_set_free(s);
+	free(msg);
+
+	after = snapshot();
+
+	if (nftnl_stats_get(after, NFTNL_STATS_BATCH_ROLLOVERS) -
+	    nftnl_stats_get(before, NFTNL_STATS_BATCH_ROLLOVERS) == 0 ||
+	    nftnl_stats_get(after, NFTNL_STATS_BATCH_PAGES) -
+	    nftnl_stats_get(before, NFTNL_STATS_BATCH_PAGES) !=
+	    nftnl_stats_get(after, NFTNL_STATS_BATCH_ROLLOVERS) -
+	    nftnl_stats_get(before, NFTNL_STATS_BATCH_ROLLOVERS) + 1)
+		print_err("Unexpected batch page counts");
+
+	if (nftnl_stats_get(after, NFTNL_STATS_SNPRINTF_RETRIES) -
+	    nftnl_stats_get(before, NFTNL_STATS_SNPRINTF_RETRIES) != 1)
+		print_err("Unexpected snprintf retries");
+
+	if (obj_delta(before, after, NFTNL_STATS_SET_ELEM,
+		      NFTNL_STATS_OBJ_ALLOC) != 1000 ||
+	    obj_delta(before, after, NFTNL_STATS_SET_ELEM,
+		      NFTNL_STATS_OBJ_FREE) != 1000)
+		print_err("Unexpected set element counts");
+
+	if (obj_delta(before, after, NFTNL_STATS_SET_ELEM,
+		      NFTNL_STATS_OBJ_BUILD_MSGS) != 1 ||
+	    obj_delta(before, after, NFTNL_STATS_SET_ELEM,
+		      NFTNL_STATS_OBJ_BUILD_BYTES) != msg_len)
+		print_err("Unexpected set element message counts");
+
+	nftnl_stats_free(before);
+	nftnl_stats_free(after);
+}
+
+static void *worker_run(void *data)
+{
+	int i;
+
+	for (i = 0; i < NUM_ITERS; i++)
+		nftnl_table_free(nftnl_table_alloc());
+
+	return NULL;
+}
+
+static void test_threads(void)
+{
+	struct nftnl_stats *before, *during, *after;
+	pthread_t threads[NUM_THREADS];
+	int i;
+
+	before = snapshot();
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], NULL, worker_run, NULL);
+
+	/* Snapshots may be taken while other threads count */
+	during = snapshot();
+	nftnl_stats_free(during);
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	/* Counts of threads that are gone are still there */
+	after = snapshot();
+	if (obj_delta(before, after, NFTNL_STATS_TABLE,
+		      NFTNL_STATS_OBJ_ALLOC) != NUM_THREADS * NUM_ITERS ||
+	    obj_delta(before, after, NFTNL_STATS_TABLE,
+		      NFTNL_STATS_OBJ_FREE) != NUM_THREADS * NUM_ITERS)
+		print_err("Counts of other threads are missing");
+
+	nftnl_stats_free(before);
+	nftnl_stats_free(after);
+}
+
+static void test_disabled(void)
+{
+	struct nftnl_stats *before, *after;
+
+	nftnl_stats_enable(false);
+
+	before = snapshot();
+	nftnl_table_free(nftnl_table_alloc());
+	after = snapshot();
+
+	if (obj_delta(before, after, NFTNL_STATS_TABLE,
+		      NFTNL_STATS_OBJ_ALLOC) != 0)
+		print_err("Counting while disabled");
+
+	nftnl_stats_free(before);
+	nftnl_stats_free(after);
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_stats *s;
+	const char *name;
+	int i;
+
+	nftnl_stats_enable(true);
+
+	test_rule();
+	test_misc();
+	test_threads();
+	test_disabled();
+
+	s = snapshot();
+	for (i = 0; (name = nftnl_stats_expr_name(s, i)) != NULL; i++) {
+		if (strcmp(name, "counter") == 0)
+			break;
+	}
+	if (name == NULL)
+		print_err("Expression names are missing");
+	nftnl_stats_free(s);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
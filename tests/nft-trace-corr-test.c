@@ -0,0 +1,208 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/trace.h>
+
+#define MAX_PATHS	4
+#define MAX_STEPS	4
+#define TIMEOUT		100
+#define MAX_RESULTS	16
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+struct result {
+	uint32_t	id;
+	bool		complete;
+	uint32_t	verdict;
+	unsigned int	num_steps;
+	unsigned int	num_dropped;
+	char		chain[MAX_STEPS][32];
+};
+
+static struct result results[MAX_RESULTS];
+static int num_results;
+
+static int path_cb(const struct nftnl_trace_path *p, void *data)
+{
+	struct result *r = &results[num_results];
+	unsigned int i;
+	const char *chain;
+
+	if (num_results == MAX_RESULTS) {
+		print_err("Too many paths");
+		return -1;
+	}
+	num_results++;
+
+	r->id = nftnl_trace_path_id(p);
+	r->complete = nftnl_trace_path_is_complete(p);
+	r->verdict = nftnl_trace_path_verdict(p);
+	r->num_steps = nftnl_trace_path_num_steps(p);
+	r->num_dropped = nftnl_trace_path_num_dropped(p);
+	for (i = 0; i < r->num_steps && i < MAX_STEPS; i++) {
+		chain = nftnl_trace_path_step_get_str(p, i, NFTNL_TRACE_CHAIN);
+		snprintf(r->chain[i], sizeof(r->chain[i]), "%s",
+			 chain ? chain : "");
+	}
+
+	return 0;
+}
+
+/* Feed one event through a reused view, as a trace listener would */
+static void add_event(struct nftnl_trace_corr *c, struct nftnl_trace *t,
+		      uint32_t id, uint32_t type, const char *chain,
+		      int verdict, const char *target, uint64_t now)
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfg;
+	struct nlattr *nest;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_TRACE;
+	nfg = mnl_nlmsg_put_extra_header(nlh, sizeof(*nfg));
+	nfg->nfgen_family = NFPROTO_IPV4;
+
+	mnl_attr_put_u32(nlh, NFTA_TRACE_ID, htonl(id));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_TYPE, htonl(type));
+	mnl_attr_put_strz(nlh, NFTA_TRACE_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_TRACE_CHAIN, chain);
+	if (type == NFT_TRACETYPE_POLICY) {
+		mnl_attr_put_u32(nlh, NFTA_TRACE_POLICY, htonl(verdict));
+	} else {
+		mnl_attr_put_u64(nlh, NFTA_TRACE_RULE_HANDLE, htobe64(1));
+		nest = mnl_attr_nest_start(nlh, NFTA_TRACE_VERDICT);
+		mnl_attr_put_u32(nlh, NFTA_VERDICT_CODE, htonl(verdict));
+		if (target != NULL)
+			mnl_attr_put_strz(nlh, NFTA_VERDICT_CHAIN, target);
+		mnl_attr_nest_end(nlh, nest);
+	}
+
+	if (nftnl_trace_nlmsg_parse_view(nlh, t) < 0)
+		print_err("Parsing trace failed");
+	if (nftnl_trace_corr_add(c, t, now) < 0)
+		print_err("Adding trace failed");
+
+	/* The correlator must not keep pointers into the message */
+	memset(buf, 0xff, sizeof(buf));
+}
+
+static void test_paths(struct nftnl_trace_corr *c, struct nftnl_trace *t)
+{
+	/* Two packets interleaved, one accepted by a rule in a jump target,
+	 * the other returning to its base chain and dropped by policy.
+	 */
+	add_event(c, t, 1, NFT_TRACETYPE_RULE, "input", NFT_JUMP, "sub", 0);
+	add_event(c, t, 2, NFT_TRACETYPE_RULE, "input", NFT_JUMP, "sub", 1);
+	add_event(c, t, 1, NFT_TRACETYPE_RULE, "sub", NF_ACCEPT, NULL, 2);
+	add_event(c, t, 2, NFT_TRACETYPE_RETURN, "sub", NFT_RETURN, NULL, 3);
+	add_event(c, t, 2, NFT_TRACETYPE_POLICY, "input", NF_DROP, NULL, 4);
+
+	if (num_results != 2 ||
+	    results[0].id != 1 || !results[0].complete ||
+	    results[0].verdict != NF_ACCEPT || results[0].num_steps != 2 ||
+	    strcmp(results[0].chain[0], "input") != 0 ||
+	    strcmp(results[0].chain[1], "sub") != 0 ||
+	    results[1].id != 2 || !results[1].complete ||
+	    results[1].verdict != NF_DROP || results[1].num_steps != 3)
+		print_err("Unexpected completed paths");
+}
+
+static void test_expire(struct nftnl_trace_corr *c, struct nftnl_trace *t)
+{
+	num_results = 0;
+
+	add_event(c, t, 3, NFT_TRACETYPE_RULE, "input", NFT_JUMP, "sub", 10);
+	add_event(c, t, 4, NFT_TRACETYPE_RULE, "input", NFT_JUMP, "sub", 50);
+	if (nftnl_trace_corr_expire(c, 10 + TIMEOUT - 1) < 0 ||
+	    num_results != 0)
+		print_err("Path expired too early");
+
+	/* A new event pushes the deadline of path 3 */
+	add_event(c, t, 3, NFT_TRACETYPE_RULE, "sub", NFT_CONTINUE, NULL, 60);
+	if (nftnl_trace_corr_expire(c, 50 + TIMEOUT) < 0 ||
+	    num_results != 1 || results[0].id != 4 || results[0].complete)
+		print_err("Path did not expire");
+
+	if (nftnl_trace_corr_flush(c) < 0 ||
+	    num_results != 2 || results[1].id != 3 || results[1].complete ||
+	    results[1].num_steps != 2)
+		print_err("Flush did not deliver pending paths");
+}
+
+static void test_bounds(struct nftnl_trace_corr *c, struct nftnl_trace *t)
+{
+	int i;
+
+	num_results = 0;
+
+	/* Out of paths, the oldest one is given up */
+	for (i = 0; i <= MAX_PATHS; i++)
+		add_event(c, t, 10 + i, NFT_TRACETYPE_RULE, "input",
+			  NFT_JUMP, "sub", 200);
+	if (num_results != 1 || results[0].id != 10 || results[0].complete)
+		print_err("Oldest path was not evicted");
+	nftnl_trace_corr_flush(c);
+
+	/* Out of steps, the final verdict is still kept */
+	num_results = 0;
+	for (i = 0; i < MAX_STEPS + 2; i++)
+		add_event(c, t, 20, NFT_TRACETYPE_RULE, "input",
+			  NFT_JUMP, "sub", 300);
+	add_event(c, t, 20, NFT_TRACETYPE_RULE, "last", NF_ACCEPT, NULL, 300);
+	if (num_results != 1 || !results[0].complete ||
+	    results[0].verdict != NF_ACCEPT ||
+	    results[0].num_steps != MAX_STEPS ||
+	    results[0].num_dropped != 3 ||
+	    strcmp(results[0].chain[MAX_STEPS - 1], "last") != 0)
+		print_err("Path with too many steps was mangled");
+}
+
+int main(int argc, char *argv[])
+{
+	struct nftnl_trace_corr *c;
+	struct nftnl_trace *t;
+
+	c = nftnl_trace_corr_alloc(MAX_PATHS, MAX_STEPS, TIMEOUT, path_cb,
+				   NULL);
+	t = nftnl_trace_alloc();
+	if (c == NULL || t == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	test_paths(c, t);
+	test_expire(c, t);
+	test_bounds(c, t);
+
+	nftnl_trace_free(t);
+	nftnl_trace_corr_free(c);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
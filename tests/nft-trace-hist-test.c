@@ -0,0 +1,231 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/trace.h>
+
+#define NUM_THREADS	4
+#define NUM_ITERS	10000
+#define NUM_MSGS	4
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static char msgs[NUM_MSGS][512];
+
+static void build_msg(char *buf, uint32_t type, uint64_t handle,
+		      int verdict, uint32_t iif, uint32_t oif)
+{
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfg;
+	struct nlattr *nest;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_TRACE;
+	nfg = mnl_nlmsg_put_extra_header(nlh, sizeof(*nfg));
+	nfg->nfgen_family = NFPROTO_IPV4;
+
+	mnl_attr_put_u32(nlh, NFTA_TRACE_ID, htonl(1));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_TYPE, htonl(type));
+	mnl_attr_put_strz(nlh, NFTA_TRACE_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_TRACE_CHAIN, "input");
+	mnl_attr_put_u32(nlh, NFTA_TRACE_IIF, htonl(iif));
+	if (oif)
+		mnl_attr_put_u32(nlh, NFTA_TRACE_OIF, htonl(oif));
+
+	if (type == NFT_TRACETYPE_POLICY) {
+		mnl_attr_put_u32(nlh, NFTA_TRACE_POLICY, htonl(verdict));
+		return;
+	}
+
+	mnl_attr_put_u64(nlh, NFTA_TRACE_RULE_HANDLE, htobe64(handle));
+	nest = mnl_attr_nest_start(nlh, NFTA_TRACE_VERDICT);
+	mnl_attr_put_u32(nlh, NFTA_VERDICT_CODE, htonl(verdict));
+	if (verdict == NFT_JUMP)
+		mnl_attr_put_strz(nlh, NFTA_VERDICT_CHAIN, "sub");
+	mnl_attr_nest_end(nlh, nest);
+}
+
+struct worker {
+	pthread_t		thread;
+	struct nftnl_trace_hist	*hist;
+	unsigned int		shard;
+};
+
+static void *worker_run(void *data)
+{
+	struct worker *w = data;
+	int i, j;
+
+	for (i = 0; i < NUM_ITERS; i++) {
+		for (j = 0; j < NUM_MSGS; j++) {
+			if (nftnl_trace_hist_add_nlmsg(w->hist, w->shard,
+					(struct nlmsghdr *)msgs[j]) < 0) {
+				print_err("Adding trace failed");
+				return NULL;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+static void check_snap(struct nftnl_trace_hist_snap *snap, uint64_t n)
+{
+	if (nftnl_trace_hist_snap_num_rules(snap) != 2 ||
+	    nftnl_trace_hist_snap_rule_get_u64(snap, 0,
+				NFTNL_TRACE_RULE_HANDLE) != 2 ||
+	    nftnl_trace_hist_snap_rule_hits(snap, 0) != 2 * n ||
+	    nftnl_trace_hist_snap_rule_get_u64(snap, 1,
+				NFTNL_TRACE_RULE_HANDLE) != 1 ||
+	    nftnl_trace_hist_snap_rule_hits(snap, 1) != n ||
+	    strcmp(nftnl_trace_hist_snap_rule_get_str(snap, 0,
+				NFTNL_TRACE_CHAIN), "input") != 0 ||
+	    nftnl_trace_hist_snap_rule_get_u32(snap, 0,
+				NFTNL_TRACE_FAMILY) != NFPROTO_IPV4)
+		print_err("Unexpected rule hits");
+
+	if (nftnl_trace_hist_snap_verdict(snap, NFT_CONTINUE) != n ||
+	    nftnl_trace_hist_snap_verdict(snap, NFT_JUMP) != 2 * n ||
+	    nftnl_trace_hist_snap_verdict(snap, NF_ACCEPT) != n ||
+	    nftnl_trace_hist_snap_verdict(snap, NF_DROP) != 0)
+		print_err("Unexpected verdicts");
+
+	if (nftnl_trace_hist_snap_num_ifaces(snap, NFTNL_TRACE_IIF) != 2 ||
+	    nftnl_trace_hist_snap_iface_index(snap, NFTNL_TRACE_IIF, 0) != 2 ||
+	    nftnl_trace_hist_snap_iface_hits(snap, NFTNL_TRACE_IIF, 0) != 3 * n ||
+	    nftnl_trace_hist_snap_iface_hits(snap, NFTNL_TRACE_IIF, 1) != n ||
+	    nftnl_trace_hist_snap_num_ifaces(snap, NFTNL_TRACE_OIF) != 1 ||
+	    nftnl_trace_hist_snap_iface_index(snap, NFTNL_TRACE_OIF, 0) != 4)
+		print_err("Unexpected interface hits");
+
+	if (nftnl_trace_hist_snap_overflow(snap) != 0)
+		print_err("Unexpected overflow");
+}
+
+static void test_concurrent(void)
+{
+	struct worker workers[NUM_THREADS];
+	struct nftnl_trace_hist_snap *snap, *copy;
+	struct nftnl_trace_hist *hist;
+	uint64_t hits, last = 0;
+	int i;
+
+	hist = nftnl_trace_hist_alloc(NUM_THREADS, 16);
+	if (hist == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < NUM_THREADS; i++) {
+		workers[i].hist = hist;
+		workers[i].shard = i;
+		pthread_create(&workers[i].thread, NULL, worker_run,
+			       &workers[i]);
+	}
+
+	/* Snapshots taken while writers run only ever grow */
+	for (i = 0; i < 100; i++) {
+		snap = nftnl_trace_hist_snapshot(hist);
+		if (snap == NULL) {
+			print_err("Snapshot failed");
+			break;
+		}
+		hits = nftnl_trace_hist_snap_verdict(snap, NFT_JUMP);
+		if (hits < last)
+			print_err("Counters went backwards");
+		last = hits;
+		nftnl_trace_hist_snap_free(snap);
+	}
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(workers[i].thread, NULL);
+
+	snap = nftnl_trace_hist_snapshot(hist);
+	copy = nftnl_trace_hist_snapshot(hist);
+	if (snap == NULL || copy == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	check_snap(snap, NUM_THREADS * NUM_ITERS);
+
+	if (nftnl_trace_hist_snap_merge(snap, copy) < 0)
+		print_err("Merge failed");
+	check_snap(snap, 2 * NUM_THREADS * NUM_ITERS);
+
+	nftnl_trace_hist_snap_free(copy);
+	nftnl_trace_hist_snap_free(snap);
+	nftnl_trace_hist_free(hist);
+}
+
+static void test_overflow(void)
+{
+	struct nftnl_trace_hist_snap *snap;
+	struct nftnl_trace_hist *hist;
+	char buf[512];
+	int i;
+
+	hist = nftnl_trace_hist_alloc(1, 2);
+	if (hist == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 1; i <= 4; i++) {
+		build_msg(buf, NFT_TRACETYPE_RULE, i, NFT_CONTINUE, 2, 0);
+		nftnl_trace_hist_add_nlmsg(hist, 0, (struct nlmsghdr *)buf);
+	}
+	if (nftnl_trace_hist_add_nlmsg(hist, 1, (struct nlmsghdr *)buf) == 0)
+		print_err("Out of range shard accepted");
+
+	snap = nftnl_trace_hist_snapshot(hist);
+	if (snap == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+	if (nftnl_trace_hist_snap_num_rules(snap) != 2 ||
+	    nftnl_trace_hist_snap_overflow(snap) != 2 ||
+	    nftnl_trace_hist_snap_verdict(snap, NFT_CONTINUE) != 4)
+		print_err("Rule table overflow mishandled");
+
+	nftnl_trace_hist_snap_free(snap);
+	nftnl_trace_hist_free(hist);
+}
+
+int main(int argc, char *argv[])
+{
+	build_msg(msgs[0], NFT_TRACETYPE_RULE, 1, NFT_CONTINUE, 2, 0);
+	build_msg(msgs[1], NFT_TRACETYPE_RULE, 2, NFT_JUMP, 2, 0);
+	build_msg(msgs[2], NFT_TRACETYPE_RULE, 2, NFT_JUMP, 2, 0);
+	build_msg(msgs[3], NFT_TRACETYPE_POLICY, 0, NF_ACCEPT, 3, 4);
+
+	test_concurrent();
+	test_overflow();
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,165 @@
+/*
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <endian.h>
+#include <netinet/in.h>
+
+#include <libmnl/libmnl.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nfnetlink.h>
+#include <linux/netfilter/nf_tables.h>
+
+#include <libnftnl/trace.h>
+
+static int test_ok = 1;
+
+static void print_err(const char *msg)
+{
+	test_ok = 0;
+	printf("\033[31mERROR:\e[0m %s\n", msg);
+}
+
+static const char nh[] = "\x45\x00\x00\x54\x12\x34\x40\x00\x40\x01";
+static const char th[] = "\x08\x00\xf7\xff\x00\x01\x00\x01";
+
+static struct nlmsghdr *build_trace(char *buf, uint32_t id, bool full)
+{
+	struct nlmsghdr *nlh;
+	struct nfgenmsg *nfg;
+	struct nlattr *nest;
+
+	nlh = mnl_nlmsg_put_header(buf);
+	nlh->nlmsg_type = (NFNL_SUBSYS_NFTABLES << 8) | NFT_MSG_TRACE;
+	nfg = mnl_nlmsg_put_extra_header(nlh, sizeof(*nfg));
+	nfg->nfgen_family = NFPROTO_IPV4;
+
+	mnl_attr_put_u32(nlh, NFTA_TRACE_ID, htonl(id));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_TYPE, htonl(NFT_TRACETYPE_RULE));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_MARK, htonl(0x42));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_NFPROTO, htonl(NFPROTO_IPV4));
+	mnl_attr_put_u32(nlh, NFTA_TRACE_POLICY, htonl(NF_ACCEPT));
+	if (!full)
+		return nlh;
+
+	mnl_attr_put_strz(nlh, NFTA_TRACE_TABLE, "filter");
+	mnl_attr_put_strz(nlh, NFTA_TRACE_CHAIN, "input");
+	mnl_attr_put_u64(nlh, NFTA_TRACE_RULE_HANDLE, htobe64(7));
+	nest = mnl_attr_nest_start(nlh, NFTA_TRACE_VERDICT);
+	mnl_attr_put_u32(nlh, NFTA_VERDICT_CODE, htonl(NFT_JUMP));
+	mnl_attr_put_strz(nlh, NFTA_VERDICT_CHAIN, "target");
+	mnl_attr_nest_end(nlh, nest);
+	mnl_attr_put(nlh, NFTA_TRACE_NETWORK_HEADER, sizeof(nh) - 1, nh);
+	mnl_attr_put(nlh, NFTA_TRACE_TRANSPORT_HEADER, sizeof(th) - 1, th);
+
+	return nlh;
+}
+
+static bool in_buf(const void *ptr, const char *buf)
+{
+	return (const char *)ptr >= buf &&
+	       (const char *)ptr < buf + MNL_SOCKET_BUFFER_SIZE;
+}
+
+static void cmp_trace(struct nftnl_trace *a, struct nftnl_trace *b)
+{
+	const void *da, *db;
+	uint32_t la, lb;
+	int i;
+
+	for (i = 0; i <= NFTNL_TRACE_MAX; i++) {
+		if (nftnl_trace_is_set(a, i) != nftnl_trace_is_set(b, i)) {
+			print_err("Attribute set mismatches");
+			continue;
+		}
+		if (!nftnl_trace_is_set(a, i))
+			continue;
+
+		da = nftnl_trace_get_data(a, i, &la);
+		db = nftnl_trace_get_data(b, i, &lb);
+		if (la != lb || memcmp(da, db, la) != 0)
+			print_err("Attribute value mismatches");
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	char buf[MNL_SOCKET_BUFFER_SIZE];
+	struct nftnl_trace *copy, *view;
+	struct nlmsghdr *nlh;
+	const void *data;
+	uint32_t len;
+
+	copy = nftnl_trace_alloc();
+	view = nftnl_trace_alloc();
+	if (copy == NULL || view == NULL) {
+		print_err("OOM");
+		exit(EXIT_FAILURE);
+	}
+
+	nlh = build_trace(buf, 1, true);
+	if (nftnl_trace_nlmsg_parse(nlh, copy) < 0 ||
+	    nftnl_trace_nlmsg_parse_view(nlh, view) < 0)
+		print_err("Parsing trace failed");
+
+	cmp_trace(copy, view);
+
+	if (strcmp(nftnl_trace_get_str(view, NFTNL_TRACE_TABLE), "filter") ||
+	    strcmp(nftnl_trace_get_str(view, NFTNL_TRACE_CHAIN), "input"))
+		print_err("Unexpected table or chain");
+	if (nftnl_trace_get_u64(view, NFTNL_TRACE_RULE_HANDLE) != 7 ||
+	    nftnl_trace_get_u32(view, NFTNL_TRACE_VERDICT) != NFT_JUMP ||
+	    nftnl_trace_get_u32(view, NFTNL_TRACE_MARK) != 0x42)
+		print_err("Unexpected trace value");
+
+	/* Both are 32-bit attributes, not 16-bit ones */
+	if (nftnl_trace_get_u32(copy, NFTNL_TRACE_NFPROTO) != NFPROTO_IPV4 ||
+	    nftnl_trace_get_u32(copy, NFTNL_TRACE_POLICY) != NF_ACCEPT)
+		print_err("Unexpected nfproto or policy");
+
+	/* Strings and headers point into the message buffer */
+	data = nftnl_trace_get_data(view, NFTNL_TRACE_NETWORK_HEADER, &len);
+	if (len != sizeof(nh) - 1 || memcmp(data, nh, len) != 0 ||
+	    !in_buf(data, buf))
+		print_err("Network header is not a view");
+	if (!in_buf(nftnl_trace_get_str(view, NFTNL_TRACE_TABLE), buf) ||
+	    !in_buf(nftnl_trace_get_data(view, NFTNL_TRACE_JUMP_TARGET, &len),
+		    buf))
+		print_err("Strings are not a view");
+	if (in_buf(nftnl_trace_get_str(copy, NFTNL_TRACE_TABLE), buf))
+		print_err("Copy points into the message");
+
+	/* Nothing is carried over to the next event */
+	nlh = build_trace(buf, 2, false);
+	if (nftnl_trace_nlmsg_parse_view(nlh, view) < 0)
+		print_err("Parsing second trace failed");
+	if (nftnl_trace_get_u32(view, NFTNL_TRACE_ID) != 2 ||
+	    nftnl_trace_is_set(view, NFTNL_TRACE_TABLE) ||
+	    nftnl_trace_is_set(view, NFTNL_TRACE_NETWORK_HEADER) ||
+	    nftnl_trace_is_set(view, NFTNL_TRACE_JUMP_TARGET))
+		print_err("View kept attributes of the previous event");
+
+	/* A view can be turned back into a copy */
+	nlh = build_trace(buf, 1, true);
+	if (nftnl_trace_nlmsg_parse(nlh, view) < 0)
+		print_err("Parsing trace into a view failed");
+	cmp_trace(copy, view);
+	if (in_buf(nftnl_trace_get_str(view, NFTNL_TRACE_CHAIN), buf))
+		print_err("Copy points into the message");
+
+	nftnl_trace_free(copy);
+	nftnl_trace_free(view);
+
+	if (!test_ok)
+		exit(EXIT_FAILURE);
+
+	printf("%s: \033[32mOK\e[0m\n", argv[0]);
+	return EXIT_SUCCESS;
+}
@@ -17,8 +17,22 @@
 ./nft-expr_payload-test
 ./nft-expr_reject-test
 ./nft-expr_target-test
+./nft-filter-test
 ./nft-rule-test
+./nft-rule-tmpl-test
+./nft-ruleset-export-test
 ./nft-set-test
+./nft-snapshot-test
+./nft-ruleset-parallel-test
+./nft-ruleset-compile-test
+./nft-trace-test
+./nft-trace-corr-test
+./nft-trace-hist-test
+./nft-event-test
+./nft-gen-dump-test
+./nft-set-delta-test
+./nft-stats-test
+./nft-memsize-test
 ./nft-table-test
 ./nft-parsing-test -d xmlfiles
 ./nft-parsing-test -d jsonfiles